@@ -62,7 +62,7 @@ in
         wantedBy = [ "multi-user.target" ];
         after = [ "dbus.service" ];
 
-        path = [ config.nix.package cfg.package cfg.dysnomia ];
+        path = [ config.nix.package cfg.package cfg.dysnomia pkgs.openssh ];
         environment = {
           HOME = "/root";
         }
@@ -14,12 +14,14 @@ rec {
    *       properties.hostname = "test1.local";
    *       targetProperty = "hostname";
    *       clientInterface = "disnix-ssh-client";
+   *       system = "x86_64-linux";
    *     };
    *
    *     test2 = {
    *       properties.hostname = "test2.local";
    *       targetProperty = "hostname";
    *       clientInterface = "disnix-ssh-client";
+   *       system = "x86_64-linux";
    *     };
    *   }
    *   =>
@@ -27,18 +29,22 @@ rec {
    *     test1 = {
    *       targetAddress = "test1.local";
    *       clientInterface = "disnix-ssh-client";
+   *       numOfCores = 1;
+   *       system = "x86_64-linux";
    *     };
    *
    *     test2 = {
    *       targetAddress = "test2.local";
    *       clientInterface = "disnix-ssh-client";
+   *       numOfCores = 1;
+   *       system = "x86_64-linux";
    *     };
    *   }
    */
   generateInterfaces = {normalizedInfrastructure}:
     lib.mapAttrs (targetName: normalizedTarget: {
       targetAddress = normalizedTarget.properties."${normalizedTarget.targetProperty}";
-      inherit (normalizedTarget) clientInterface;
+      inherit (normalizedTarget) clientInterface numOfCores system;
     }) normalizedInfrastructure;
 
   /*
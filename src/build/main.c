@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <getopt.h>
 #include <defaultoptions.h>
+#include <buildflags.h>
 #include "run-build.h"
 
 static void print_usage(const char *command)
@@ -41,6 +42,27 @@ static void print_usage(const char *command)
     "Options:\n"
     "  -m, --max-concurrent-transfers=NUM  Maximum amount of concurrent closure\n"
     "                                      transfers. Defauls to: 2\n"
+    "      --pipeline                      Moves each derivation independently\n"
+    "                                      through the distribute, realise and\n"
+    "                                      retrieve stages, instead of completing\n"
+    "                                      each stage for all derivations first\n"
+    "      --max-concurrent-builds=NUM     Maximum amount of concurrent builds across\n"
+    "                                      all target machines. Each machine never\n"
+    "                                      runs more builds than its amount of CPU\n"
+    "                                      cores. Defaults to: 0 (no global limit)\n"
+    "      --realise-batch-size=NUM        Maximum amount of derivations that a\n"
+    "                                      target machine realises in one operation.\n"
+    "                                      Not used in pipelined mode. Defaults to:\n"
+    "                                      0 (all derivations of a machine at once)\n"
+    "      --keep-results-on-targets       Leaves the build results on the target\n"
+    "                                      machines instead of retrieving them. Only\n"
+    "                                      useful when the results are not needed on\n"
+    "                                      the coordinator machine\n"
+    "      --place-builds                  Reassigns each derivation to the target\n"
+    "                                      machine with a compatible system that is\n"
+    "                                      expected to finish it first, taking its\n"
+    "                                      queue and the inputs it already has into\n"
+    "                                      account\n"
     "  -h, --help                          Shows the usage of this command to the user\n"
     "  -v, --version                       Shows the version of this command to the\n"
     "                                      user\n"
@@ -49,6 +71,9 @@ static void print_usage(const char *command)
     "  DISNIX_TARGET_PROPERTY    Specifies which property in the infrastructure Nix\n"
     "                            expression specifies how to connect to the remote\n"
     "                            interface (defaults to: hostname)\n"
+    "  DISNIX_ADAPTIVE_TRANSFERS If set to a number, the amount of concurrent\n"
+    "                            transfers is adapted to the measured throughput,\n"
+    "                            up to the given number\n"
     );
 }
 
@@ -59,12 +84,20 @@ int main(int argc, char *argv[])
     struct option long_options[] =
     {
         {"max-concurrent-transfers", required_argument, 0, DISNIX_OPTION_MAX_CONCURRENT_TRANSFERS},
+        {"pipeline", no_argument, 0, DISNIX_OPTION_PIPELINE},
+        {"max-concurrent-builds", required_argument, 0, DISNIX_OPTION_MAX_CONCURRENT_BUILDS},
+        {"realise-batch-size", required_argument, 0, DISNIX_OPTION_REALISE_BATCH_SIZE},
+        {"keep-results-on-targets", no_argument, 0, DISNIX_OPTION_KEEP_RESULTS_ON_TARGETS},
+        {"place-builds", no_argument, 0, DISNIX_OPTION_PLACE_BUILDS},
         {"help", no_argument, 0, DISNIX_OPTION_HELP},
         {"version", no_argument, 0, DISNIX_OPTION_VERSION},
         {0, 0, 0, 0}
     };
 
     unsigned int max_concurrent_transfers = DISNIX_DEFAULT_MAX_NUM_OF_CONCURRENT_TRANSFERS;
+    unsigned int max_concurrent_builds = 0;
+    unsigned int max_batch_size = 0;
+    unsigned int flags = 0;
     char *tmpdir = NULL;
 
     /* Parse command-line options */
@@ -75,6 +108,21 @@ int main(int argc, char *argv[])
             case DISNIX_OPTION_MAX_CONCURRENT_TRANSFERS:
                 max_concurrent_transfers = atoi(optarg);
                 break;
+            case DISNIX_OPTION_PIPELINE:
+                flags |= FLAG_PIPELINE;
+                break;
+            case DISNIX_OPTION_MAX_CONCURRENT_BUILDS:
+                max_concurrent_builds = atoi(optarg);
+                break;
+            case DISNIX_OPTION_REALISE_BATCH_SIZE:
+                max_batch_size = atoi(optarg);
+                break;
+            case DISNIX_OPTION_KEEP_RESULTS_ON_TARGETS:
+                flags |= FLAG_KEEP_RESULTS;
+                break;
+            case DISNIX_OPTION_PLACE_BUILDS:
+                flags |= FLAG_PLACE_BUILDS;
+                break;
             case DISNIX_OPTION_HELP:
                 print_usage(argv[0]);
                 return 0;
@@ -97,5 +145,5 @@ int main(int argc, char *argv[])
         return 1;
     }
     else
-        return run_build(argv[optind], max_concurrent_transfers, tmpdir); /* Perform distributed build operation */
+        return run_build(argv[optind], max_concurrent_transfers, max_concurrent_builds, max_batch_size, flags, tmpdir); /* Perform distributed build operation */
 }
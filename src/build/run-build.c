@@ -23,7 +23,7 @@
 #include <derivationmappingarray.h>
 #include <interfacestable.h>
 
-int run_build(const gchar *distributed_derivation_file, const unsigned int max_concurrent_transfers, char *tmpdir)
+int run_build(const gchar *distributed_derivation_file, const unsigned int max_concurrent_transfers, const unsigned int max_concurrent_builds, const unsigned int max_batch_size, const unsigned int flags, char *tmpdir)
 {
     DistributedDerivation *distributed_derivation = create_distributed_derivation(distributed_derivation_file);
 
@@ -36,10 +36,14 @@ int run_build(const gchar *distributed_derivation_file, const unsigned int max_c
     {
         int exit_status;
 
-        if(check_distributed_derivation(distributed_derivation))
-            exit_status = !build(distributed_derivation, max_concurrent_transfers, tmpdir); /* Execute remote builds */
-        else
+        if(!check_distributed_derivation(distributed_derivation))
             exit_status = 1;
+        else if((flags & FLAG_PLACE_BUILDS) && !place_builds(distributed_derivation))
+            exit_status = 1; /* Assign derivations to interfaces at build time */
+        else if(flags & FLAG_PIPELINE)
+            exit_status = !build_pipelined(distributed_derivation, max_concurrent_transfers, max_concurrent_builds, flags, tmpdir); /* Execute remote builds, moving each derivation through the stages independently */
+        else
+            exit_status = !build(distributed_derivation, max_concurrent_transfers, max_concurrent_builds, max_batch_size, flags, tmpdir); /* Execute remote builds */
 
         /* Cleanup */
         delete_distributed_derivation(distributed_derivation);
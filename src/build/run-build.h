@@ -24,13 +24,17 @@
 /**
  * Executes a distributed build. First Nix store derivation closures are copied
  * to target machines in the network. Then the remote builds are performed
- * and finally the build results are copied back to the coordinator machine.
+ * and finally the build results that are missing on the coordinator machine
+ * are copied back.
  *
  * @param distributed_derivation_file Path to the distributed derivation file
  * @param max_concurrent_transfers Specifies the maximum amount of concurrent transfers
+ * @param max_concurrent_builds Specifies the maximum amount of concurrent builds across all interfaces, or 0 for no global limit
+ * @param max_batch_size Specifies the maximum amount of derivations that a target machine realises in one operation, or 0 for no limit
+ * @param flags Build option flags. FLAG_PIPELINE moves each derivation independently through the distribute, realise and retrieve stages. FLAG_KEEP_RESULTS leaves the build results on the target machines. FLAG_PLACE_BUILDS reassigns the derivations to the interfaces that are expected to finish them first
  * @param tmpdir Directory in which the temp files should be stored
  * @return 0 if everything succeeds, or else a non-zero exit value
  */
-int run_build(const gchar *distributed_derivation_file, const unsigned int max_concurrent_transfers, char *tmpdir);
+int run_build(const gchar *distributed_derivation_file, const unsigned int max_concurrent_transfers, const unsigned int max_concurrent_builds, const unsigned int max_batch_size, const unsigned int flags, char *tmpdir);
 
 #endif
@@ -24,6 +24,7 @@
 #include <profilemanifesttargettable.h>
 #include <profilemanifesttarget-iterator.h>
 #include <copy-closure.h>
+#include <transferlimit.h>
 #include "aggregated-manifest.h"
 
 /* Resolve profiles infrastructure */
@@ -93,13 +94,20 @@ static int resolve_profiles(GHashTable *targets_table, gchar *interface, const g
 
 /* Retrieve profiles infrastructure */
 
+typedef struct
+{
+    gchar *interface;
+    ProcReact_Lane *bulk_lane;
+}
+RetrieveProfilesData;
+
 static pid_t retrieve_profile_manifest_target(void *data, gchar *target_name, ProfileManifestTarget *profile_manifest_target, Target *target)
 {
-    gchar *interface = (gchar*)data;
+    RetrieveProfilesData *retrieve_profiles_data = (RetrieveProfilesData*)data;
     gchar *paths[] = { profile_manifest_target->profile, NULL };
     gchar *target_key = find_target_key(target);
 
-    return copy_closure_from(interface, target_key, paths, STDOUT_FILENO, STDERR_FILENO);
+    return copy_closure_from(retrieve_profiles_data->interface, target_key, paths, retrieve_profiles_data->bulk_lane, STDOUT_FILENO, STDERR_FILENO);
 }
 
 static void complete_retrieve_profile_manifest_target(void *data, gchar *target_name, ProfileManifestTarget *profile_manifest_target, Target *target, ProcReact_Status status, int result)
@@ -111,13 +119,16 @@ static void complete_retrieve_profile_manifest_target(void *data, gchar *target_
 static int retrieve_profiles(gchar *interface, GHashTable *profile_manifest_target_table, GHashTable *targets_table, const unsigned int max_concurrent_transfers)
 {
     int success;
-    ProcReact_PidIterator iterator = create_profile_manifest_target_iterator(profile_manifest_target_table, retrieve_profile_manifest_target, complete_retrieve_profile_manifest_target, targets_table, interface);
+    ProcReact_Lane bulk_lane = create_bulk_transfer_lane(max_concurrent_transfers);
+    RetrieveProfilesData data = { interface, &bulk_lane };
+    ProcReact_PidIterator iterator = create_profile_manifest_target_iterator(profile_manifest_target_table, retrieve_profile_manifest_target, complete_retrieve_profile_manifest_target, targets_table, &data);
 
     g_printerr("[coordinator]: Retrieving intra-dependency closures of the profiles...\n");
 
-    procreact_fork_and_wait_in_parallel_limit(&iterator, max_concurrent_transfers);
+    fork_and_wait_for_transfers(&iterator, max_concurrent_transfers, &bulk_lane, "profile retrieval");
     success = profile_manifest_target_iterator_has_succeeded(&iterator);
     destroy_profile_manifest_target_iterator(&iterator);
+    procreact_destroy_lane(&bulk_lane);
 
     return success;
 }
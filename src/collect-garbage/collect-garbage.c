@@ -20,6 +20,7 @@
 #include "collect-garbage.h"
 #include <targets-iterator.h>
 #include <remote-package-management.h>
+#include <valid-paths-cache.h>
 
 typedef struct
 {
@@ -32,6 +33,10 @@ static pid_t collect_garbage_on_target(void *data, gchar *target_name, Target *t
     CollectGarbageData *collect_garbage_data = (CollectGarbageData*)data;
     gchar *target_key = find_target_key(target);
     g_print("[target: %s]: Running garbage collector\n", target_name);
+
+    /* The garbage collector may remove paths that we have previously recorded as valid */
+    invalidate_valid_paths_cache((char*)target->client_interface, target_key);
+
     return pkgmgmt_remote_collect_garbage((char*)target->client_interface, target_key, collect_garbage_data->delete_old);
 }
 
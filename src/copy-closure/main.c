@@ -54,6 +54,14 @@ static void print_usage(const char *command)
     "Environment:\n"
     "  DISNIX_CLIENT_INTERFACE    Sets the client interface (which defaults to:\n"
     "                             disnix-ssh-client)\n"
+    "  DISNIX_VALID_PATHS_CACHE_MAX_AGE  Amount of seconds after which the paths\n"
+    "                             that are known to be valid on a target are fully\n"
+    "                             verified again. The cache is disabled if it is\n"
+    "                             not set or 0 (which is the default)\n"
+    "  DISNIX_VALID_PATHS_CACHE_DIR  Directory in which the known valid paths of\n"
+    "                             each target are stored\n"
+    "  DISNIX_FULL_VERIFY         If set to 1 it verifies the validity of all paths\n"
+    "                             on the target\n"
     );
 }
 
@@ -135,7 +143,7 @@ int main(int argc, char *argv[])
         return 1;
     }
     else if(to)
-        return !copy_closure_to_sync(interface, target, tmpdir, paths, STDERR_FILENO);
+        return !copy_closure_to_sync(interface, target, tmpdir, paths, NULL, STDERR_FILENO);
     else if(from)
-        return !copy_closure_from_sync(interface, target, paths, STDOUT_FILENO, STDERR_FILENO);
+        return !copy_closure_from_sync(interface, target, paths, NULL, STDOUT_FILENO, STDERR_FILENO);
 }
@@ -57,6 +57,21 @@ static void print_usage(const char *command)
     "  DYSNOMIA_STATEDIR          Specifies where the snapshots must be stored on the\n"
     "                             coordinator machine (defaults to:\n"
     "                             /var/state/dysnomia)\n"
+    "  DISNIX_DELTA_SNAPSHOTS     If set to 1, only the blocks of the snapshots that\n"
+    "                             differ from the newest generation on the\n"
+    "                             receiving machine are transferred. Requires\n"
+    "                             rsync on both machines.\n"
+    "  DISNIX_VERIFY_SNAPSHOTS\n"
+    "                             If set to 1, the digests of transferred snapshots\n"
+    "                             are compared with the digests of the originals\n"
+    "                             to detect corruption in transit\n"
+    "  DISNIX_DEDUPLICATE_SNAPSHOTS\n"
+    "                             If set to 1, files of retrieved snapshots with\n"
+    "                             identical contents, permissions, ownership and\n"
+    "                             modification time are stored once on the\n"
+    "                             coordinator\n"
+    "  DISNIX_SNAPSHOT_CHUNKS_DIR Directory in which the deduplicated files are\n"
+    "                             stored (defaults to: $DYSNOMIA_STATEDIR/chunks)\n"
     );
 }
 
@@ -147,7 +162,7 @@ int main(int argc, char *argv[])
         return 1;
     }
     else if(to)
-        return !copy_snapshots_to_sync(interface, target, container, component, all, STDERR_FILENO);
+        return !copy_snapshots_to_sync(interface, target, container, component, all, NULL, STDERR_FILENO);
     else if(from)
-        return !copy_snapshots_from_sync(interface, target, container, component, all, STDOUT_FILENO, STDERR_FILENO);
+        return !copy_snapshots_from_sync(interface, target, container, component, all, NULL, STDOUT_FILENO, STDERR_FILENO);
 }
@@ -0,0 +1,157 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "admission.h"
+#include <stdio.h>
+
+/* Waiting jobs are only reported in the log file when they have waited longer than this amount of microseconds */
+#define REPORT_WAIT_TIME_THRESHOLD 1000000
+
+typedef struct
+{
+    StartJobFunction start_job;
+    OrgNixosDisnixDisnix *object;
+    gint jid;
+    int log_fd;
+    GVariant *parameters;
+    gint64 enqueue_time;
+}
+AdmissionRequest;
+
+typedef struct
+{
+    const gchar *name;
+    unsigned int limit;
+    unsigned int running;
+    GQueue wait_queue;
+    guint64 admitted;
+    gint64 total_wait_time;
+}
+OperationClassState;
+
+/*
+ * All admission decisions are made from the main loop (the DBus method
+ * handlers and the job completion callbacks), so the state below does not
+ * require any locking.
+ */
+
+static OperationClassState operation_classes[NUM_OF_OPERATION_CLASSES] =
+{
+    { "transfer", 0, 0, G_QUEUE_INIT, 0, 0 },
+    { "build", 0, 0, G_QUEUE_INIT, 0, 0 },
+    { "activation", 0, 0, G_QUEUE_INIT, 0, 0 },
+    { "state", 0, 0, G_QUEUE_INIT, 0, 0 }
+};
+
+/* Maps the IDs of the running admitted jobs to their operation class (offset by one, so that a class never maps to NULL) */
+static GHashTable *running_jobs_table = NULL;
+
+void set_admission_limit(OperationClass operation_class, unsigned int limit)
+{
+    operation_classes[operation_class].limit = limit;
+}
+
+static gboolean slot_available(const OperationClassState *state)
+{
+    return (state->limit == 0 || state->running < state->limit);
+}
+
+static void start_admitted_job(OperationClass operation_class, AdmissionRequest *request)
+{
+    OperationClassState *state = &operation_classes[operation_class];
+    gint64 wait_time = g_get_monotonic_time() - request->enqueue_time;
+
+    state->running++;
+    state->admitted++;
+    state->total_wait_time += wait_time;
+
+    if(wait_time >= REPORT_WAIT_TIME_THRESHOLD)
+        dprintf(request->log_fd, "Admitted after waiting %.3f seconds\n", wait_time / 1000000.0);
+
+    /* Register the job before starting it, because a job that fails to start is released immediately */
+    if(running_jobs_table == NULL)
+        running_jobs_table = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    g_hash_table_insert(running_jobs_table, GINT_TO_POINTER(request->jid), GINT_TO_POINTER(operation_class + 1));
+
+    request->start_job(request->object, request->jid, request->log_fd, request->parameters);
+
+    /* Cleanup */
+    g_variant_unref(request->parameters);
+    g_free(request);
+}
+
+void admit_job(OperationClass operation_class, StartJobFunction start_job, OrgNixosDisnixDisnix *object, gint jid, int log_fd, GVariant *parameters)
+{
+    OperationClassState *state = &operation_classes[operation_class];
+    AdmissionRequest *request = (AdmissionRequest*)g_malloc(sizeof(AdmissionRequest));
+
+    request->start_job = start_job;
+    request->object = object;
+    request->jid = jid;
+    request->log_fd = log_fd;
+    request->parameters = g_variant_ref(parameters);
+    request->enqueue_time = g_get_monotonic_time();
+
+    if(slot_available(state))
+        start_admitted_job(operation_class, request);
+    else
+    {
+        dprintf(log_fd, "Waiting for admission: %u %s operations are running and %u are waiting\n", state->running, state->name, g_queue_get_length(&state->wait_queue));
+        g_queue_push_tail(&state->wait_queue, request);
+    }
+}
+
+void release_admitted_job(gint jid)
+{
+    gpointer value;
+
+    if(running_jobs_table != NULL && (value = g_hash_table_lookup(running_jobs_table, GINT_TO_POINTER(jid))) != NULL)
+    {
+        OperationClass operation_class = GPOINTER_TO_INT(value) - 1;
+        OperationClassState *state = &operation_classes[operation_class];
+
+        g_hash_table_remove(running_jobs_table, GINT_TO_POINTER(jid));
+        state->running--;
+
+        if(!g_queue_is_empty(&state->wait_queue) && slot_available(state))
+            start_admitted_job(operation_class, (AdmissionRequest*)g_queue_pop_head(&state->wait_queue));
+    }
+}
+
+gchar **query_admission_status(void)
+{
+    unsigned int i;
+    gint64 now = g_get_monotonic_time();
+    gchar **status = (gchar**)g_malloc((NUM_OF_OPERATION_CLASSES + 1) * sizeof(gchar*));
+
+    for(i = 0; i < NUM_OF_OPERATION_CLASSES; i++)
+    {
+        OperationClassState *state = &operation_classes[i];
+        AdmissionRequest *oldest_request = (AdmissionRequest*)g_queue_peek_head(&state->wait_queue);
+        double longest_wait = (oldest_request == NULL) ? 0 : (now - oldest_request->enqueue_time) / 1000000.0;
+        double average_wait = (state->admitted == 0) ? 0 : (state->total_wait_time / (double)state->admitted) / 1000000.0;
+
+        status[i] = g_strdup_printf("%s running=%u limit=%u queued=%u longest-wait=%.3f average-wait=%.3f", state->name, state->running, state->limit, g_queue_get_length(&state->wait_queue), longest_wait, average_wait);
+    }
+
+    status[i] = NULL;
+    return status;
+}
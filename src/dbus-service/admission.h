@@ -0,0 +1,100 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __DISNIX_ADMISSION_H
+#define __DISNIX_ADMISSION_H
+#include <glib.h>
+#include "disnix-dbus.h"
+
+/**
+ * Classes of operations of which the amount of concurrently running jobs can
+ * be limited. Operations that do not belong to any class are never delayed.
+ */
+typedef enum
+{
+    /** Operations that transfer closures or snapshots (import, export, import snapshots, fetch snapshots) */
+    OPERATION_CLASS_TRANSFER,
+
+    /** Operations that build or remove packages (realise, collect garbage) */
+    OPERATION_CLASS_BUILD,
+
+    /** Operations that activate or deactivate services */
+    OPERATION_CLASS_ACTIVATION,
+
+    /** Operations that manage state (snapshot, restore, delete state, query snapshot digests) */
+    OPERATION_CLASS_STATE,
+
+    NUM_OF_OPERATION_CLASSES
+}
+OperationClass;
+
+/**
+ * Function that starts the execution of an admitted job.
+ *
+ * @param object A Disnix DBus interface object
+ * @param jid ID of the job
+ * @param log_fd File descriptor of the log file of the job
+ * @param parameters Parameters of the DBus method call that requested the job
+ */
+typedef void (*StartJobFunction) (OrgNixosDisnixDisnix *object, gint jid, int log_fd, GVariant *parameters);
+
+/**
+ * Configures the maximum amount of jobs of a given operation class that are
+ * allowed to run concurrently.
+ *
+ * @param operation_class Class of operations
+ * @param limit Maximum amount of concurrent jobs, or 0 for no limit
+ */
+void set_admission_limit(OperationClass operation_class, unsigned int limit);
+
+/**
+ * Starts a job if the limit of its operation class has not been reached yet.
+ * Otherwise, the job waits in a first-in-first-out queue until one of the
+ * running jobs of the same class has completed.
+ *
+ * @param operation_class Class of the operation that the job executes
+ * @param start_job Function that starts the job
+ * @param object A Disnix DBus interface object
+ * @param jid ID of the job
+ * @param log_fd File descriptor of the log file of the job
+ * @param parameters Parameters of the DBus method call that requested the job
+ */
+void admit_job(OperationClass operation_class, StartJobFunction start_job, OrgNixosDisnixDisnix *object, gint jid, int log_fd, GVariant *parameters);
+
+/**
+ * Notifies the admission controller that a job has completed, so that the
+ * next job waiting for the same operation class can be started. It has no
+ * effect for jobs that were not started through admit_job().
+ *
+ * @param jid ID of the job
+ */
+void release_admitted_job(gint jid);
+
+/**
+ * Composes a status report that contains for each operation class the amount
+ * of running jobs, the limit, the amount of waiting jobs, how long the oldest
+ * waiting job has been waiting and the average wait time of the admitted jobs.
+ * Clients can use this information to back off when a machine is saturated.
+ *
+ * @return A NULL-terminated string array with one line per operation class. It should be freed with g_strfreev()
+ */
+gchar **query_admission_status(void);
+
+#endif
@@ -80,9 +80,19 @@ static void print_usage(const char *command)
     "                             snapshot store\n"
     "      --resolve-snapshots    Converts the relative paths to the snapshots to\n"
     "                             absolute paths\n"
+    "      --query-snapshot-sizes Prints the sizes in bytes of the given snapshots\n"
+    "      --query-snapshot-digests\n"
+    "                             Prints digests of the contents of the given\n"
+    "                             snapshots\n"
     "      --clean-snapshots      Removes older snapshots from the snapshot store\n"
+    "      --fetch-snapshots      Fetches the snapshots of a component directly from\n"
+    "                             another machine into the local snapshot store\n"
     "      --capture-config       Captures the configuration of the machine from the\n"
     "                             Dysnomia container properties in a Nix expression\n"
+    "      --query-admission-status\n"
+    "                             Prints for each class of operations how many jobs\n"
+    "                             are running, the limit, how many jobs are waiting\n"
+    "                             and how long they wait\n"
     "      --help                 Shows the usage of this command to the user\n"
     "      --version              Shows the version of this command to the user\n"
 
@@ -100,6 +110,13 @@ static void print_usage(const char *command)
     "      --remotefile           Specifies that the given paths are stored remotely\n"
     "                             and must transferred from the remote machine if\n"
     "                             needed\n"
+    "      --basis=PATH           Path to a snapshot that is used as a basis for\n"
+    "                             delta transfers. This property is ignored by this\n"
+    "                             client because it only supports loopback\n"
+    "                             connections.\n"
+    "      --digests=DIGESTS      Comma separated digests of the originals of the\n"
+    "                             snapshots that must match the given snapshots\n"
+    "                             before they are imported\n"
 
     "\nShell options:\n"
     "      --command=COMMAND      Commands to execute in the shell session\n"
@@ -124,11 +141,28 @@ static void print_usage(const char *command)
     "  -C, --container=CONTAINER  Name of the container in which the component is managed\n"
     "  -c, --component=COMPONENT  Name of the component hosted in a container\n"
 
+    "\nFetch snapshots options:\n"
+    "      --source-interface=INTERFACE\n"
+    "                             Name of the executable that must be used to\n"
+    "                             connect to the machine providing the snapshots.\n"
+    "                             It must be listed in the\n"
+    "                             DISNIX_FETCH_SNAPSHOTS_INTERFACES environment\n"
+    "                             variable of the receiving machine. Defaults to:\n"
+    "                             disnix-ssh-client\n"
+    "      --source-target=TARGET Address of the machine providing the snapshots\n"
+    "  -C, --container=CONTAINER  Name of the container in which the component is managed\n"
+    "  -c, --component=COMPONENT  Name of the component hosted in a container\n"
+    "      --all                  Fetches all snapshot generations, instead of the\n"
+    "                             latest only\n"
+
     "\nClean snapshots options:\n"
     "      --keep=NUM             Amount of snapshot generations to keep. Defaults\n"
     "                             to: 1\n"
     "  -C, --container=CONTAINER  Name of the container to filter on\n"
     "  -c, --component=COMPONENT  Name of the component to filter on\n"
+    "                             When container/component pairs are given as\n"
+    "                             arguments, the snapshots of each of these\n"
+    "                             components are cleaned in one operation\n"
 
     "\nEnvironment:\n"
     "  DISNIX_PROFILE    Sets the name of the profile that stores the manifest on the\n"
@@ -178,7 +212,16 @@ typedef enum
     DISNIX_CLIENT_OPTION_COMPONENT = 'c',
     DISNIX_CLIENT_OPTION_KEEP = 281,
     DISNIX_CLIENT_OPTION_COMMAND = 282,
-    DISNIX_CLIENT_OPTION_SESSION_BUS = 283
+    DISNIX_CLIENT_OPTION_SESSION_BUS = 283,
+    DISNIX_CLIENT_OPTION_FETCH_SNAPSHOTS = 284,
+    DISNIX_CLIENT_OPTION_SOURCE_INTERFACE = 285,
+    DISNIX_CLIENT_OPTION_SOURCE_TARGET = 286,
+    DISNIX_CLIENT_OPTION_ALL = 287,
+    DISNIX_CLIENT_OPTION_BASIS = 288,
+    DISNIX_CLIENT_OPTION_QUERY_SNAPSHOT_SIZES = 289,
+    DISNIX_CLIENT_OPTION_QUERY_SNAPSHOT_DIGESTS = 290,
+    DISNIX_CLIENT_OPTION_QUERY_ADMISSION_STATUS = 291,
+    DISNIX_CLIENT_OPTION_DIGESTS = 292
 }
 DisnixClientCommandLineOption;
 
@@ -208,12 +251,18 @@ int main(int argc, char *argv[])
         {"print-missing-snapshots", no_argument, 0, DISNIX_CLIENT_OPTION_PRINT_MISSING_SNAPSHOTS},
         {"import-snapshots", no_argument, 0, DISNIX_CLIENT_OPTION_IMPORT_SNAPSHOTS},
         {"resolve-snapshots", no_argument, 0, DISNIX_CLIENT_OPTION_RESOLVE_SNAPSHOTS},
+        {"query-snapshot-sizes", no_argument, 0, DISNIX_CLIENT_OPTION_QUERY_SNAPSHOT_SIZES},
+        {"query-snapshot-digests", no_argument, 0, DISNIX_CLIENT_OPTION_QUERY_SNAPSHOT_DIGESTS},
         {"clean-snapshots", no_argument, 0, DISNIX_CLIENT_OPTION_CLEAN_SNAPSHOTS},
         {"capture-config", no_argument, 0, DISNIX_CLIENT_OPTION_CAPTURE_CONFIG},
+        {"query-admission-status", no_argument, 0, DISNIX_CLIENT_OPTION_QUERY_ADMISSION_STATUS},
         {"shell", no_argument, 0, DISNIX_CLIENT_OPTION_SHELL},
+        {"fetch-snapshots", no_argument, 0, DISNIX_CLIENT_OPTION_FETCH_SNAPSHOTS},
         {"target", required_argument, 0, DISNIX_CLIENT_OPTION_TARGET},
         {"localfile", no_argument, 0, DISNIX_CLIENT_OPTION_LOCALFILE},
         {"remotefile", no_argument, 0, DISNIX_CLIENT_OPTION_REMOTEFILE},
+        {"basis", required_argument, 0, DISNIX_CLIENT_OPTION_BASIS},
+        {"digests", required_argument, 0, DISNIX_CLIENT_OPTION_DIGESTS},
         {"profile", required_argument, 0, DISNIX_CLIENT_OPTION_PROFILE},
         {"delete-old", no_argument, 0, DISNIX_CLIENT_OPTION_DELETE_OLD},
         {"type", required_argument, 0, DISNIX_CLIENT_OPTION_TYPE},
@@ -223,6 +272,9 @@ int main(int argc, char *argv[])
         {"keep", required_argument, 0, DISNIX_CLIENT_OPTION_KEEP},
         {"command", required_argument, 0, DISNIX_CLIENT_OPTION_COMMAND},
         {"session-bus", no_argument, 0, DISNIX_CLIENT_OPTION_SESSION_BUS},
+        {"source-interface", required_argument, 0, DISNIX_CLIENT_OPTION_SOURCE_INTERFACE},
+        {"source-target", required_argument, 0, DISNIX_CLIENT_OPTION_SOURCE_TARGET},
+        {"all", no_argument, 0, DISNIX_CLIENT_OPTION_ALL},
         {"help", no_argument, 0, DISNIX_CLIENT_OPTION_HELP},
         {"version", no_argument, 0, DISNIX_CLIENT_OPTION_VERSION},
         {0, 0, 0, 0}
@@ -230,7 +282,7 @@ int main(int argc, char *argv[])
 
     /* Option value declarations */
     Operation operation = OP_NONE;
-    char *profile = NULL, *type = NULL, *container = NULL, *component = NULL;
+    char *profile = NULL, *type = NULL, *container = NULL, *component = NULL, *source_interface = "disnix-ssh-client", *source_target = NULL, *digests = NULL;
     gchar **derivation = NULL, **arguments = NULL;
     unsigned int derivation_size = 0, arguments_size = 0, flags = 0;
     int keep = 1;
@@ -300,21 +352,38 @@ int main(int argc, char *argv[])
             case DISNIX_CLIENT_OPTION_RESOLVE_SNAPSHOTS:
                 operation = OP_RESOLVE_SNAPSHOTS;
                 break;
+            case DISNIX_CLIENT_OPTION_QUERY_SNAPSHOT_SIZES:
+                operation = OP_QUERY_SNAPSHOT_SIZES;
+                break;
+            case DISNIX_CLIENT_OPTION_QUERY_SNAPSHOT_DIGESTS:
+                operation = OP_QUERY_SNAPSHOT_DIGESTS;
+                break;
             case DISNIX_CLIENT_OPTION_CLEAN_SNAPSHOTS:
                 operation = OP_CLEAN_SNAPSHOTS;
                 break;
             case DISNIX_CLIENT_OPTION_CAPTURE_CONFIG:
                 operation = OP_CAPTURE_CONFIG;
                 break;
+            case DISNIX_CLIENT_OPTION_QUERY_ADMISSION_STATUS:
+                operation = OP_QUERY_ADMISSION_STATUS;
+                break;
             case DISNIX_CLIENT_OPTION_SHELL:
                 operation = OP_SHELL;
                 break;
+            case DISNIX_CLIENT_OPTION_FETCH_SNAPSHOTS:
+                operation = OP_FETCH_SNAPSHOTS;
+                break;
             case DISNIX_CLIENT_OPTION_TARGET:
                 break;
             case DISNIX_CLIENT_OPTION_LOCALFILE:
                 break;
             case DISNIX_CLIENT_OPTION_REMOTEFILE:
                 break;
+            case DISNIX_CLIENT_OPTION_BASIS:
+                break;
+            case DISNIX_CLIENT_OPTION_DIGESTS:
+                digests = optarg;
+                break;
             case DISNIX_CLIENT_OPTION_PROFILE:
                 profile = optarg;
                 break;
@@ -341,6 +410,15 @@ int main(int argc, char *argv[])
             case DISNIX_CLIENT_OPTION_SESSION_BUS:
                 flags |= FLAG_SESSION_BUS;
                 break;
+            case DISNIX_CLIENT_OPTION_SOURCE_INTERFACE:
+                source_interface = optarg;
+                break;
+            case DISNIX_CLIENT_OPTION_SOURCE_TARGET:
+                source_target = optarg;
+                break;
+            case DISNIX_CLIENT_OPTION_ALL:
+                flags |= FLAG_ALL;
+                break;
             case DISNIX_CLIENT_OPTION_HELP:
                 print_usage(argv[0]);
                 return 0;
@@ -373,5 +451,5 @@ int main(int argc, char *argv[])
     arguments[arguments_size] = NULL;
 
     /* Execute Disnix client */
-    return run_disnix_client(operation, derivation, flags, profile, arguments, type, container, component, keep);
+    return run_disnix_client(operation, derivation, flags, profile, arguments, type, container, component, keep, source_interface, source_target, digests);
 }
@@ -119,7 +119,7 @@ static gchar *check_dysnomia_activity_parameters(OrgNixosDisnixDisnix *proxy, gc
         return container;
 }
 
-int run_disnix_client(Operation operation, gchar **paths, const unsigned int flags, char *profile, gchar **arguments, char *type, char *container, char *component, int keep)
+int run_disnix_client(Operation operation, gchar **paths, const unsigned int flags, char *profile, gchar **arguments, char *type, char *container, char *component, int keep, char *source_interface, char *source_target, char *digests)
 {
     /* Proxy object representing the D-Bus service object. */
     OrgNixosDisnixDisnix *proxy;
@@ -290,7 +290,12 @@ int run_disnix_client(Operation operation, gchar **paths, const unsigned int fla
                 return 1;
             }
             else
-                org_nixos_disnix_disnix_call_import_snapshots_sync(proxy, pid, container, component, (const gchar**) paths, NULL, &error);
+            {
+                /* An empty array of digests lets the service import the snapshots unverified */
+                gchar **digests_array = (digests == NULL) ? g_new0(gchar*, 1) : g_strsplit(digests, ",", -1);
+                org_nixos_disnix_disnix_call_import_snapshots_sync(proxy, pid, container, component, (const gchar**) paths, (const gchar**) digests_array, NULL, &error);
+                g_strfreev(digests_array);
+            }
             break;
         case OP_RESOLVE_SNAPSHOTS:
             if(paths[0] == NULL)
@@ -302,6 +307,26 @@ int run_disnix_client(Operation operation, gchar **paths, const unsigned int fla
             else
                 org_nixos_disnix_disnix_call_resolve_snapshots_sync(proxy, pid, (const gchar**) paths, NULL, &error);
             break;
+        case OP_QUERY_SNAPSHOT_SIZES:
+            if(paths[0] == NULL)
+            {
+                g_printerr("ERROR: A Dysnomia snapshot has to be specified!\n");
+                cleanup(proxy, paths, arguments);
+                return 1;
+            }
+            else
+                org_nixos_disnix_disnix_call_query_snapshot_sizes_sync(proxy, pid, (const gchar**) paths, NULL, &error);
+            break;
+        case OP_QUERY_SNAPSHOT_DIGESTS:
+            if(paths[0] == NULL)
+            {
+                g_printerr("ERROR: A Dysnomia snapshot has to be specified!\n");
+                cleanup(proxy, paths, arguments);
+                return 1;
+            }
+            else
+                org_nixos_disnix_disnix_call_query_snapshot_digests_sync(proxy, pid, (const gchar**) paths, NULL, &error);
+            break;
         case OP_CLEAN_SNAPSHOTS:
             if(container == NULL)
                 container = "";
@@ -309,11 +334,33 @@ int run_disnix_client(Operation operation, gchar **paths, const unsigned int fla
             if(component == NULL)
                 component = "";
 
-            org_nixos_disnix_disnix_call_clean_snapshots_sync(proxy, pid, keep, container, component, NULL, &error);
+            if(paths[0] == NULL)
+                org_nixos_disnix_disnix_call_clean_snapshots_sync(proxy, pid, keep, container, component, NULL, &error);
+            else
+                org_nixos_disnix_disnix_call_clean_snapshots_of_components_sync(proxy, pid, keep, (const gchar**) paths, NULL, &error);
+            break;
+        case OP_FETCH_SNAPSHOTS:
+            if(source_target == NULL)
+            {
+                g_printerr("ERROR: A source target must be specified!\n");
+                cleanup(proxy, paths, arguments);
+                return 1;
+            }
+            else if(container == NULL || component == NULL)
+            {
+                g_printerr("ERROR: A container and component must be specified!\n");
+                cleanup(proxy, paths, arguments);
+                return 1;
+            }
+            else
+                org_nixos_disnix_disnix_call_fetch_snapshots_sync(proxy, pid, source_interface, source_target, container, component, (flags & FLAG_ALL) != 0, NULL, &error);
             break;
         case OP_CAPTURE_CONFIG:
             org_nixos_disnix_disnix_call_capture_config_sync(proxy, pid, NULL, &error);
             break;
+        case OP_QUERY_ADMISSION_STATUS:
+            org_nixos_disnix_disnix_call_query_admission_status_sync(proxy, pid, NULL, &error);
+            break;
         case OP_SHELL:
             g_printerr("ERROR: This operation is unsupported by this client!\n");
             cleanup(proxy, paths, arguments);
@@ -22,6 +22,7 @@
 
 #define FLAG_DELETE_OLD 0x1
 #define FLAG_SESSION_BUS 0x2
+#define FLAG_ALL 0x4
 
 #include <glib.h>
 
@@ -50,10 +51,14 @@ typedef enum
     OP_PRINT_MISSING_SNAPSHOTS,
     OP_IMPORT_SNAPSHOTS,
     OP_RESOLVE_SNAPSHOTS,
+    OP_QUERY_SNAPSHOT_SIZES,
+    OP_QUERY_SNAPSHOT_DIGESTS,
     OP_CLEAN_SNAPSHOTS,
     OP_DELETE_STATE,
     OP_CAPTURE_CONFIG,
-    OP_SHELL
+    OP_SHELL,
+    OP_FETCH_SNAPSHOTS,
+    OP_QUERY_ADMISSION_STATUS
 }
 Operation;
 
@@ -69,8 +74,11 @@ Operation;
  * @param container Name of the container in which snapshots must be deployed
  * @param component Name of a mutable component in a container
  * @param keep Amount of snapshot generations to keep
+ * @param source_interface Name of the interface executable that connects to the machine providing the snapshots
+ * @param source_target Target address of the machine providing the snapshots
+ * @param digests Comma separated digests that the snapshots to import must match, or NULL to import them unverified
  * @return 0 if the operation succeeds, else a non-zero exit value
  */
-int run_disnix_client(Operation operation, gchar **paths, const unsigned int flags, char *profile, gchar **arguments, char *type, char *container, char *component, int keep);
+int run_disnix_client(Operation operation, gchar **paths, const unsigned int flags, char *profile, gchar **arguments, char *type, char *container, char *component, int keep, char *source_interface, char *source_target, char *digests);
 
 #endif
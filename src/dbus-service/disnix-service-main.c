@@ -18,6 +18,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <getopt.h>
 #include "disnix-service.h"
 
@@ -54,8 +55,26 @@ static void print_usage(const char *command)
     "                     is stored (defaults to: /var/run/disnix-service.pid)\n"
     "      --log-file     Specifies to which file the general daemon output messages\n"
     "                     should be logged (defaults to: /var/log/disnix.log)\n"
+    "      --max-concurrent-transfers=NUM\n"
+    "                     Maximum amount of import, export, snapshot import and\n"
+    "                     snapshot fetch jobs that run concurrently (defaults\n"
+    "                     to: 0, unlimited)\n"
+    "      --max-concurrent-builds=NUM\n"
+    "                     Maximum amount of build and garbage collection jobs\n"
+    "                     that run concurrently (defaults to: 0, unlimited)\n"
+    "      --max-concurrent-activations=NUM\n"
+    "                     Maximum amount of activation and deactivation jobs\n"
+    "                     that run concurrently (defaults to: 0, unlimited)\n"
+    "      --max-concurrent-state-operations=NUM\n"
+    "                     Maximum amount of snapshot, restore, delete state and\n"
+    "                     snapshot digest jobs that run concurrently (defaults\n"
+    "                     to: 0, unlimited)\n"
     "  -h, --help         Shows the usage of this command to the user\n"
     "  -v, --version      Shows the version of this command to the user\n"
+
+    "\nJobs that exceed the limit of their class wait in a first-in-first-out\n"
+    "queue. The amount of waiting jobs and their wait times can be queried with:\n"
+    "`disnix-client --query-admission-status'.\n"
     );
 }
 
@@ -74,6 +93,10 @@ typedef enum
     DISNIX_SERVICE_OPTION_LOG_DIR = 257,
     DISNIX_SERVICE_OPTION_PID_FILE = 258,
     DISNIX_SERVICE_OPTION_LOG_FILE = 259,
+    DISNIX_SERVICE_OPTION_MAX_CONCURRENT_TRANSFERS = 260,
+    DISNIX_SERVICE_OPTION_MAX_CONCURRENT_BUILDS = 261,
+    DISNIX_SERVICE_OPTION_MAX_CONCURRENT_ACTIVATIONS = 262,
+    DISNIX_SERVICE_OPTION_MAX_CONCURRENT_STATE_OPERATIONS = 263,
     DISNIX_SERVICE_OPTION_HELP = 'h',
     DISNIX_SERVICE_OPTION_VERSION = 'v'
 }
@@ -90,6 +113,10 @@ int main(int argc, char *argv[])
         {"log-dir", required_argument, 0, DISNIX_SERVICE_OPTION_LOG_DIR},
         {"pid-file", required_argument, 0, DISNIX_SERVICE_OPTION_PID_FILE},
         {"log-file", required_argument, 0, DISNIX_SERVICE_OPTION_LOG_FILE},
+        {"max-concurrent-transfers", required_argument, 0, DISNIX_SERVICE_OPTION_MAX_CONCURRENT_TRANSFERS},
+        {"max-concurrent-builds", required_argument, 0, DISNIX_SERVICE_OPTION_MAX_CONCURRENT_BUILDS},
+        {"max-concurrent-activations", required_argument, 0, DISNIX_SERVICE_OPTION_MAX_CONCURRENT_ACTIVATIONS},
+        {"max-concurrent-state-operations", required_argument, 0, DISNIX_SERVICE_OPTION_MAX_CONCURRENT_STATE_OPERATIONS},
         {"help", no_argument, 0, DISNIX_SERVICE_OPTION_HELP},
         {"version", no_argument, 0, DISNIX_SERVICE_OPTION_VERSION},
         {0, 0, 0, 0}
@@ -100,6 +127,7 @@ int main(int argc, char *argv[])
     char *logdir = "/var/log/disnix";
     char *pid_file = "/var/run/disnix-service.pid";
     char *log_file = "/var/log/disnix.log";
+    unsigned int max_transfers = 0, max_builds = 0, max_activations = 0, max_state_operations = 0;
 
     /* Parse command-line options */
     while((c = getopt_long(argc, argv, "Dhv", long_options, &option_index)) != -1)
@@ -121,6 +149,18 @@ int main(int argc, char *argv[])
             case DISNIX_SERVICE_OPTION_LOG_FILE:
                 log_file = optarg;
                 break;
+            case DISNIX_SERVICE_OPTION_MAX_CONCURRENT_TRANSFERS:
+                max_transfers = atoi(optarg);
+                break;
+            case DISNIX_SERVICE_OPTION_MAX_CONCURRENT_BUILDS:
+                max_builds = atoi(optarg);
+                break;
+            case DISNIX_SERVICE_OPTION_MAX_CONCURRENT_ACTIVATIONS:
+                max_activations = atoi(optarg);
+                break;
+            case DISNIX_SERVICE_OPTION_MAX_CONCURRENT_STATE_OPERATIONS:
+                max_state_operations = atoi(optarg);
+                break;
             case DISNIX_SERVICE_OPTION_HELP:
                 print_usage(argv[0]);
                 return 0;
@@ -134,6 +174,8 @@ int main(int argc, char *argv[])
     }
 
     /* Start the program with the given options */
+    set_disnix_service_limits(max_transfers, max_builds, max_activations, max_state_operations);
+
     if(daemon)
         return start_disnix_service_daemon(session_bus, logdir, pid_file, log_file);
     else
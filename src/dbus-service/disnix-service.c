@@ -27,6 +27,7 @@
 #include "jobmanagement.h"
 #include "logging.h"
 #include "methods.h"
+#include "admission.h"
 #include "daemonize.h"
 
 /* Server settings variables */
@@ -37,6 +38,14 @@ char *tmpdir;
 /* Path to the log directory */
 extern char *logdir;
 
+void set_disnix_service_limits(unsigned int max_transfers, unsigned int max_builds, unsigned int max_activations, unsigned int max_state_operations)
+{
+    set_admission_limit(OPERATION_CLASS_TRANSFER, max_transfers);
+    set_admission_limit(OPERATION_CLASS_BUILD, max_builds);
+    set_admission_limit(OPERATION_CLASS_ACTIVATION, max_activations);
+    set_admission_limit(OPERATION_CLASS_STATE, max_state_operations);
+}
+
 typedef struct
 {
     /* Indicates whether we want to connect to the session bus or system bus */
@@ -82,9 +91,14 @@ static void on_bus_acquired(GDBusConnection *connection, const gchar *name, gpoi
     g_signal_connect(interface, "handle-print-missing-snapshots", G_CALLBACK(on_handle_print_missing_snapshots), NULL);
     g_signal_connect(interface, "handle-import-snapshots", G_CALLBACK(on_handle_import_snapshots), NULL);
     g_signal_connect(interface, "handle-resolve-snapshots", G_CALLBACK(on_handle_resolve_snapshots), NULL);
+    g_signal_connect(interface, "handle-query-snapshot-sizes", G_CALLBACK(on_handle_query_snapshot_sizes), NULL);
+    g_signal_connect(interface, "handle-query-snapshot-digests", G_CALLBACK(on_handle_query_snapshot_digests), NULL);
     g_signal_connect(interface, "handle-clean-snapshots", G_CALLBACK(on_handle_clean_snapshots), NULL);
+    g_signal_connect(interface, "handle-clean-snapshots-of-components", G_CALLBACK(on_handle_clean_snapshots_of_components), NULL);
+    g_signal_connect(interface, "handle-fetch-snapshots", G_CALLBACK(on_handle_fetch_snapshots), NULL);
     g_signal_connect(interface, "handle-get-logdir", G_CALLBACK(on_handle_get_logdir), NULL);
     g_signal_connect(interface, "handle-capture-config", G_CALLBACK(on_handle_capture_config), NULL);
+    g_signal_connect(interface, "handle-query-admission-status", G_CALLBACK(on_handle_query_admission_status), NULL);
 
     /* Export skeleton */
     if(!g_dbus_interface_skeleton_export(G_DBUS_INTERFACE_SKELETON(interface),
@@ -21,6 +21,18 @@
 #define __DISNIX_SERVICE_H
 #include <procreact_types.h>
 
+/**
+ * Configures the maximum amount of jobs per class of operations that the
+ * service runs concurrently. Jobs that exceed a limit wait until a running job
+ * of the same class has completed.
+ *
+ * @param max_transfers Maximum amount of concurrent import, export and snapshot import jobs, or 0 for no limit
+ * @param max_builds Maximum amount of concurrent build and garbage collection jobs, or 0 for no limit
+ * @param max_activations Maximum amount of concurrent activation and deactivation jobs, or 0 for no limit
+ * @param max_state_operations Maximum amount of concurrent snapshot, restore and delete state jobs, or 0 for no limit
+ */
+void set_disnix_service_limits(unsigned int max_transfers, unsigned int max_builds, unsigned int max_activations, unsigned int max_state_operations);
+
 /**
  * Starts the Disnix D-Bus service in the foreground
  *
@@ -23,6 +23,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include "signaling.h"
 
 /** Path to the log directory */
 char *logdir;
@@ -47,7 +48,7 @@ int open_log_file(OrgNixosDisnixDisnix *object, const gint pid)
     if(log_fd == -1)
     {
         g_printerr("Cannot write logfile for job id: %d\n", pid);
-        org_nixos_disnix_disnix_emit_failure(object, pid);
+        emit_job_failure(object, pid);
     }
 
     g_free(log_path);
@@ -25,9 +25,11 @@
 #include "locking.h"
 #include "jobmanagement.h"
 #include "signaling.h"
+#include "admission.h"
 #include "package-management.h"
 #include "state-management.h"
 #include "snapshot-management.h"
+#include "copy-snapshots.h"
 
 #define BUFFER_SIZE 1024
 
@@ -39,12 +41,23 @@ gboolean on_handle_get_job_id(OrgNixosDisnixDisnix *object, GDBusMethodInvocatio
 {
     int job_counter = assign_pid();
     g_printerr("Assigned job id: %d\n", job_counter);
+    register_job_client(job_counter, g_dbus_method_invocation_get_sender(invocation));
     org_nixos_disnix_disnix_complete_get_job_id(object, invocation, job_counter);
     return TRUE;
 }
 
 /* Import method */
 
+static void start_import(OrgNixosDisnixDisnix *object, gint jid, int log_fd, GVariant *parameters)
+{
+    const gchar *closure;
+
+    g_variant_get(parameters, "(i&s)", NULL, &closure);
+
+    /* Execute command */
+    signal_boolean_result(pkgmgmt_import_closure(closure, log_fd, log_fd), object, jid, log_fd);
+}
+
 gboolean on_handle_import(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, const gchar *arg_closure)
 {
     int log_fd = open_log_file(object, arg_pid);
@@ -54,8 +67,8 @@ gboolean on_handle_import(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *i
         /* Print log entry */
         dprintf(log_fd, "Importing: %s\n", arg_closure);
 
-        /* Execute command */
-        signal_boolean_result(pkgmgmt_import_closure(arg_closure, log_fd, log_fd), object, arg_pid, log_fd);
+        /* Execute command when the amount of running transfers permits it */
+        admit_job(OPERATION_CLASS_TRANSFER, start_import, object, arg_pid, log_fd, g_dbus_method_invocation_get_parameters(invocation));
     }
 
     org_nixos_disnix_disnix_complete_import(object, invocation);
@@ -64,24 +77,35 @@ gboolean on_handle_import(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *i
 
 /* Export method */
 
+static void start_export(OrgNixosDisnixDisnix *object, gint jid, int log_fd, GVariant *parameters)
+{
+    const gchar **derivation;
+    pid_t pid;
+    int temp_fd;
+    gchar *tempfilename;
+
+    g_variant_get(parameters, "(i^a&s)", NULL, &derivation);
+
+    /* Execute command */
+    tempfilename = pkgmgmt_export_closure(tmpdir, (gchar**)derivation, g_strv_length((gchar**)derivation), log_fd, &pid, &temp_fd);
+    signal_tempfile_result(pid, tempfilename, temp_fd, object, jid, log_fd);
+
+    g_free(derivation);
+}
+
 gboolean on_handle_export(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, const gchar *const *arg_derivation)
 {
     int log_fd = open_log_file(object, arg_pid);
 
     if(log_fd != -1)
     {
-        pid_t pid;
-        int temp_fd;
-        gchar *tempfilename;
-
         /* Print log entry */
         dprintf(log_fd, "Exporting: ");
         print_paths(log_fd, (gchar**)arg_derivation);
         dprintf(log_fd, "\n");
 
-        /* Execute command */
-        tempfilename = pkgmgmt_export_closure(tmpdir, (gchar**)arg_derivation, g_strv_length((gchar**)arg_derivation), log_fd, &pid, &temp_fd);
-        signal_tempfile_result(pid, tempfilename, temp_fd, object, arg_pid, log_fd);
+        /* Execute command when the amount of running transfers permits it */
+        admit_job(OPERATION_CLASS_TRANSFER, start_export, object, arg_pid, log_fd, g_dbus_method_invocation_get_parameters(invocation));
     }
 
     org_nixos_disnix_disnix_complete_export(object, invocation);
@@ -111,6 +135,18 @@ gboolean on_handle_print_invalid(OrgNixosDisnixDisnix *object, GDBusMethodInvoca
 
 /* Realise method */
 
+static void start_realise(OrgNixosDisnixDisnix *object, gint jid, int log_fd, GVariant *parameters)
+{
+    const gchar **derivation;
+
+    g_variant_get(parameters, "(i^a&s)", NULL, &derivation);
+
+    /* Execute command and wait and asychronously propagate its end result */
+    signal_strv_result(pkgmgmt_realise((gchar**)derivation, g_strv_length((gchar**)derivation), log_fd), object, jid, log_fd);
+
+    g_free(derivation);
+}
+
 gboolean on_handle_realise(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, const gchar *const *arg_derivation)
 {
     int log_fd = open_log_file(object, arg_pid);
@@ -122,8 +158,8 @@ gboolean on_handle_realise(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *
         print_paths(log_fd, (gchar**)arg_derivation);
         dprintf(log_fd, "\n");
 
-        /* Execute command and wait and asychronously propagate its end result */
-        signal_strv_result(pkgmgmt_realise((gchar**)arg_derivation, g_strv_length((gchar**)arg_derivation), log_fd), object, arg_pid, log_fd);
+        /* Execute command when the amount of running builds permits it */
+        admit_job(OPERATION_CLASS_BUILD, start_realise, object, arg_pid, log_fd, g_dbus_method_invocation_get_parameters(invocation));
     }
 
     org_nixos_disnix_disnix_complete_realise(object, invocation);
@@ -191,6 +227,16 @@ gboolean on_handle_query_requisites(OrgNixosDisnixDisnix *object, GDBusMethodInv
 
 /* Garbage collect method */
 
+static void start_collect_garbage(OrgNixosDisnixDisnix *object, gint jid, int log_fd, GVariant *parameters)
+{
+    gboolean delete_old;
+
+    g_variant_get(parameters, "(ib)", NULL, &delete_old);
+
+    /* Execute command */
+    signal_boolean_result(pkgmgmt_collect_garbage(delete_old, log_fd, log_fd), object, jid, log_fd);
+}
+
 gboolean on_handle_collect_garbage(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, gboolean arg_delete_old)
 {
     int log_fd = open_log_file(object, arg_pid);
@@ -203,8 +249,8 @@ gboolean on_handle_collect_garbage(OrgNixosDisnixDisnix *object, GDBusMethodInvo
         else
             dprintf(log_fd, "Garbage collect\n");
 
-        /* Execute command */
-        signal_boolean_result(pkgmgmt_collect_garbage(arg_delete_old, log_fd, log_fd), object, arg_pid, log_fd);
+        /* Execute command when the amount of running builds permits it */
+        admit_job(OPERATION_CLASS_BUILD, start_collect_garbage, object, arg_pid, log_fd, g_dbus_method_invocation_get_parameters(invocation));
     }
 
     org_nixos_disnix_disnix_complete_collect_garbage(object, invocation);
@@ -215,7 +261,20 @@ gboolean on_handle_collect_garbage(OrgNixosDisnixDisnix *object, GDBusMethodInvo
 
 typedef pid_t StateActivityFunction(gchar *type, gchar *component, gchar *container, char **arguments, int stdout_fd, int stderr_fd);
 
-static gboolean on_handle_state_activity(gchar *activity, StateActivityFunction *activity_function, OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, const gchar *arg_derivation, const gchar *arg_container, const gchar *arg_type, const gchar *const *arg_arguments)
+static void start_state_activity(StateActivityFunction *activity_function, OrgNixosDisnixDisnix *object, gint jid, int log_fd, GVariant *parameters)
+{
+    const gchar *derivation, *container, *type;
+    const gchar **arguments;
+
+    g_variant_get(parameters, "(i&s&s&s^a&s)", NULL, &derivation, &container, &type, &arguments);
+
+    /* Execute command */
+    signal_boolean_result(activity_function((gchar*)type, (gchar*)derivation, (gchar*)container, (gchar**)arguments, log_fd, log_fd), object, jid, log_fd);
+
+    g_free(arguments);
+}
+
+static gboolean on_handle_state_activity(gchar *activity, OperationClass operation_class, StartJobFunction start_job, OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, const gchar *arg_derivation, const gchar *arg_container, const gchar *arg_type, const gchar *const *arg_arguments)
 {
     int log_fd = open_log_file(object, arg_pid);
 
@@ -226,8 +285,8 @@ static gboolean on_handle_state_activity(gchar *activity, StateActivityFunction
         print_paths(log_fd, (gchar**)arg_arguments);
         dprintf(log_fd, "\n");
 
-        /* Execute command */
-        signal_boolean_result(activity_function((gchar*)arg_type, (gchar*)arg_derivation, (gchar*)arg_container, (gchar**)arg_arguments, log_fd, log_fd), object, arg_pid, log_fd);
+        /* Execute command when the amount of running operations of the same class permits it */
+        admit_job(operation_class, start_job, object, arg_pid, log_fd, g_dbus_method_invocation_get_parameters(invocation));
     }
 
     org_nixos_disnix_disnix_complete_activate(object, invocation);
@@ -236,16 +295,26 @@ static gboolean on_handle_state_activity(gchar *activity, StateActivityFunction
 
 /* Activate method */
 
+static void start_activate(OrgNixosDisnixDisnix *object, gint jid, int log_fd, GVariant *parameters)
+{
+    start_state_activity(statemgmt_activate, object, jid, log_fd, parameters);
+}
+
 gboolean on_handle_activate(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, const gchar *arg_derivation, const gchar *arg_container, const gchar *arg_type, const gchar *const *arg_arguments)
 {
-    return on_handle_state_activity("activate", statemgmt_activate, object, invocation, arg_pid, arg_derivation, arg_container, arg_type, arg_arguments);
+    return on_handle_state_activity("activate", OPERATION_CLASS_ACTIVATION, start_activate, object, invocation, arg_pid, arg_derivation, arg_container, arg_type, arg_arguments);
 }
 
 /* Deactivate method */
 
+static void start_deactivate(OrgNixosDisnixDisnix *object, gint jid, int log_fd, GVariant *parameters)
+{
+    start_state_activity(statemgmt_deactivate, object, jid, log_fd, parameters);
+}
+
 gboolean on_handle_deactivate(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, const gchar *arg_derivation, const gchar *arg_container, const gchar *arg_type, const gchar *const *arg_arguments)
 {
-    return on_handle_state_activity("deactivate", statemgmt_deactivate, object, invocation, arg_pid, arg_derivation, arg_container, arg_type, arg_arguments);
+    return on_handle_state_activity("deactivate", OPERATION_CLASS_ACTIVATION, start_deactivate, object, invocation, arg_pid, arg_derivation, arg_container, arg_type, arg_arguments);
 }
 
 /* Lock method */
@@ -269,7 +338,7 @@ gboolean on_handle_lock(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *inv
         if(profile_manifest == NULL)
         {
             dprintf(log_fd, "Corrupt profile manifest: cannot open profile manifest!\n");
-            org_nixos_disnix_disnix_emit_failure(object, arg_pid);
+            emit_job_failure(object, arg_pid);
         }
         else
         {
@@ -278,7 +347,7 @@ gboolean on_handle_lock(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *inv
             else
             {
                 dprintf(log_fd, "Corrupt profile manifest: a service or type is missing!\n");
-                org_nixos_disnix_disnix_emit_failure(object, arg_pid);
+                emit_job_failure(object, arg_pid);
             }
 
             /* Cleanup */
@@ -313,7 +382,7 @@ gboolean on_handle_unlock(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *i
         else
         {
             dprintf(log_fd, "Corrupt profile manifest: a service or type is missing!\n");
-            org_nixos_disnix_disnix_emit_failure(object, arg_pid);
+            emit_job_failure(object, arg_pid);
         }
 
         /* Cleanup */
@@ -326,16 +395,26 @@ gboolean on_handle_unlock(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *i
 
 /* Snapshot method */
 
+static void start_snapshot(OrgNixosDisnixDisnix *object, gint jid, int log_fd, GVariant *parameters)
+{
+    start_state_activity(statemgmt_snapshot, object, jid, log_fd, parameters);
+}
+
 gboolean on_handle_snapshot(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, const gchar *arg_derivation, const gchar *arg_container, const gchar *arg_type, const gchar *const *arg_arguments)
 {
-    return on_handle_state_activity("snapshot", statemgmt_snapshot, object, invocation, arg_pid, arg_derivation, arg_container, arg_type, arg_arguments);
+    return on_handle_state_activity("snapshot", OPERATION_CLASS_STATE, start_snapshot, object, invocation, arg_pid, arg_derivation, arg_container, arg_type, arg_arguments);
 }
 
 /* Restore method */
 
+static void start_restore(OrgNixosDisnixDisnix *object, gint jid, int log_fd, GVariant *parameters)
+{
+    start_state_activity(statemgmt_restore, object, jid, log_fd, parameters);
+}
+
 gboolean on_handle_restore(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, const gchar *arg_derivation, const gchar *arg_container, const gchar *arg_type, const gchar *const *arg_arguments)
 {
-    return on_handle_state_activity("restore", statemgmt_restore, object, invocation, arg_pid, arg_derivation, arg_container, arg_type, arg_arguments);
+    return on_handle_state_activity("restore", OPERATION_CLASS_STATE, start_restore, object, invocation, arg_pid, arg_derivation, arg_container, arg_type, arg_arguments);
 }
 
 /* Query all snapshots method */
@@ -399,7 +478,21 @@ gboolean on_handle_print_missing_snapshots(OrgNixosDisnixDisnix *object, GDBusMe
 
 /* Import snapshots operation */
 
-gboolean on_handle_import_snapshots(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, const gchar *arg_container, const gchar *arg_component, const gchar *const *arg_snapshots)
+static void start_import_snapshots(OrgNixosDisnixDisnix *object, gint jid, int log_fd, GVariant *parameters)
+{
+    const gchar *container, *component;
+    const gchar **snapshots, **digests;
+
+    g_variant_get(parameters, "(i&s&s^a&s^a&s)", NULL, &container, &component, &snapshots, &digests);
+
+    /* Execute command. Without any digests, the snapshots are imported unverified */
+    signal_boolean_result(statemgmt_import_snapshots((gchar*)container, (gchar*)component, (gchar**)snapshots, g_strv_length((gchar**)snapshots), (digests[0] == NULL) ? NULL : (gchar**)digests, log_fd, log_fd), object, jid, log_fd);
+
+    g_free(snapshots);
+    g_free(digests);
+}
+
+gboolean on_handle_import_snapshots(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, const gchar *arg_container, const gchar *arg_component, const gchar *const *arg_snapshots, const gchar *const *arg_digests)
 {
     int log_fd = open_log_file(object, arg_pid);
 
@@ -410,8 +503,8 @@ gboolean on_handle_import_snapshots(OrgNixosDisnixDisnix *object, GDBusMethodInv
         print_paths(log_fd, (gchar**)arg_snapshots);
         dprintf(log_fd, "\n");
 
-        /* Execute command */
-        signal_boolean_result(statemgmt_import_snapshots((gchar*)arg_container, (gchar*)arg_component, (gchar**)arg_snapshots, g_strv_length((gchar**)arg_snapshots), log_fd, log_fd), object, arg_pid, log_fd);
+        /* Execute command when the amount of running transfers permits it */
+        admit_job(OPERATION_CLASS_TRANSFER, start_import_snapshots, object, arg_pid, log_fd, g_dbus_method_invocation_get_parameters(invocation));
     }
 
     org_nixos_disnix_disnix_complete_import_snapshots(object, invocation);
@@ -439,6 +532,60 @@ gboolean on_handle_resolve_snapshots(OrgNixosDisnixDisnix *object, GDBusMethodIn
     return TRUE;
 }
 
+/* Query snapshot sizes operation */
+
+gboolean on_handle_query_snapshot_sizes(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, const gchar *const *arg_snapshots)
+{
+    int log_fd = open_log_file(object, arg_pid);
+
+    if(log_fd != -1)
+    {
+        /* Print log entry */
+        dprintf(log_fd, "Query snapshot sizes: ");
+        print_paths(log_fd, (gchar**)arg_snapshots);
+        dprintf(log_fd, "\n");
+
+        /* Execute command */
+        signal_strv_result(statemgmt_query_snapshot_sizes((gchar**)arg_snapshots, g_strv_length((gchar**)arg_snapshots), log_fd), object, arg_pid, log_fd);
+    }
+
+    org_nixos_disnix_disnix_complete_query_snapshot_sizes(object, invocation);
+    return TRUE;
+}
+
+/* Query snapshot digests operation */
+
+static void start_query_snapshot_digests(OrgNixosDisnixDisnix *object, gint jid, int log_fd, GVariant *parameters)
+{
+    const gchar **snapshots;
+
+    g_variant_get(parameters, "(i^a&s)", NULL, &snapshots);
+
+    /* Execute command */
+    signal_strv_result(statemgmt_query_snapshot_digests((gchar**)snapshots, g_strv_length((gchar**)snapshots), log_fd), object, jid, log_fd);
+
+    g_free(snapshots);
+}
+
+gboolean on_handle_query_snapshot_digests(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, const gchar *const *arg_snapshots)
+{
+    int log_fd = open_log_file(object, arg_pid);
+
+    if(log_fd != -1)
+    {
+        /* Print log entry */
+        dprintf(log_fd, "Query snapshot digests: ");
+        print_paths(log_fd, (gchar**)arg_snapshots);
+        dprintf(log_fd, "\n");
+
+        /* Execute command when the amount of running state operations permits it. Hashing reads all data of the snapshots */
+        admit_job(OPERATION_CLASS_STATE, start_query_snapshot_digests, object, arg_pid, log_fd, g_dbus_method_invocation_get_parameters(invocation));
+    }
+
+    org_nixos_disnix_disnix_complete_query_snapshot_digests(object, invocation);
+    return TRUE;
+}
+
 /* Clean snapshots method */
 
 gboolean on_handle_clean_snapshots(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, gint arg_keep, const gchar *arg_container, const char *arg_component)
@@ -466,11 +613,78 @@ gboolean on_handle_clean_snapshots(OrgNixosDisnixDisnix *object, GDBusMethodInvo
     return TRUE;
 }
 
+/* Clean snapshots of components method */
+
+gboolean on_handle_clean_snapshots_of_components(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, gint arg_keep, const gchar *const *arg_components)
+{
+    int log_fd = open_log_file(object, arg_pid);
+
+    if(log_fd != -1)
+    {
+        /* Print log entry */
+        dprintf(log_fd, "Clean old snapshots of components: ");
+        print_paths(log_fd, (gchar**)arg_components);
+        dprintf(log_fd, " num of generations to keep: %d!\n", arg_keep);
+
+        /* Execute command */
+        signal_boolean_result(statemgmt_clean_snapshots_of_components(arg_keep, (gchar**)arg_components, g_strv_length((gchar**)arg_components), log_fd, log_fd), object, arg_pid, log_fd);
+    }
+
+    org_nixos_disnix_disnix_complete_clean_snapshots_of_components(object, invocation);
+    return TRUE;
+}
+
+/* Fetch snapshots method */
+
+static void start_fetch_snapshots(OrgNixosDisnixDisnix *object, gint jid, int log_fd, GVariant *parameters)
+{
+    const gchar *source_interface, *source_target, *container, *component;
+    gboolean all;
+
+    g_variant_get(parameters, "(i&s&s&s&sb)", NULL, &source_interface, &source_target, &container, &component, &all);
+
+    /* Execute command */
+    signal_boolean_result(copy_snapshots_from((gchar*)source_interface, (gchar*)source_target, (gchar*)container, (gchar*)component, all, NULL, log_fd, log_fd), object, jid, log_fd);
+}
+
+gboolean on_handle_fetch_snapshots(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, const gchar *arg_source_interface, const gchar *arg_source_target, const gchar *arg_container, const gchar *arg_component, gboolean arg_all)
+{
+    int log_fd = open_log_file(object, arg_pid);
+
+    if(log_fd != -1)
+    {
+        /* Print log entry */
+        dprintf(log_fd, "Fetch snapshots of component: %s in container: %s from target: %s\n", arg_component, arg_container, arg_source_target);
+
+        /* The service runs as root, so it must only execute the client interfaces that its own configuration permits */
+        if(!check_fetch_snapshots_interface(arg_source_interface))
+        {
+            dprintf(log_fd, "Client interface: %s is not permitted for fetching snapshots!\n", arg_source_interface);
+            emit_job_failure(object, arg_pid);
+        }
+        else if(!check_fetch_snapshots_source_target(arg_source_target)) /* The client interface would take such a target for an option of the programs that it runs */
+        {
+            dprintf(log_fd, "Invalid source target: %s\n", arg_source_target);
+            emit_job_failure(object, arg_pid);
+        }
+        else /* Execute command when the amount of running transfers permits it */
+            admit_job(OPERATION_CLASS_TRANSFER, start_fetch_snapshots, object, arg_pid, log_fd, g_dbus_method_invocation_get_parameters(invocation));
+    }
+
+    org_nixos_disnix_disnix_complete_fetch_snapshots(object, invocation);
+    return TRUE;
+}
+
 /* Delete state operation */
 
+static void start_delete_state(OrgNixosDisnixDisnix *object, gint jid, int log_fd, GVariant *parameters)
+{
+    start_state_activity(statemgmt_collect_garbage, object, jid, log_fd, parameters);
+}
+
 gboolean on_handle_delete_state(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid, const gchar *arg_derivation, const gchar *arg_container, const gchar *arg_type, const gchar *const *arg_arguments)
 {
-    return on_handle_state_activity("collect-garbage", statemgmt_collect_garbage, object, invocation, arg_pid, arg_derivation, arg_container, arg_type, arg_arguments);
+    return on_handle_state_activity("collect-garbage", OPERATION_CLASS_STATE, start_delete_state, object, invocation, arg_pid, arg_derivation, arg_container, arg_type, arg_arguments);
 }
 
 /* Get logdir operation */
@@ -499,3 +713,17 @@ gboolean on_handle_capture_config(OrgNixosDisnixDisnix *object, GDBusMethodInvoc
     org_nixos_disnix_disnix_complete_capture_config(object, invocation);
     return TRUE;
 }
+
+/* Query admission status operation */
+
+gboolean on_handle_query_admission_status(OrgNixosDisnixDisnix *object, GDBusMethodInvocation *invocation, gint arg_pid)
+{
+    gchar **status = query_admission_status();
+
+    /* The status is known immediately, so that it can be propagated without spawning a process or opening a log file */
+    emit_job_success(object, arg_pid, (const gchar**)status);
+    g_strfreev(status);
+
+    org_nixos_disnix_disnix_complete_query_admission_status(object, invocation);
+    return TRUE;
+}
@@ -19,8 +19,80 @@
 
 #include "signaling.h"
 #include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
+#include <glib-unix.h>
 #include <procreact_pid.h>
+#include "admission.h"
+
+/* Interval in milliseconds in which a process that has closed its output is checked for termination */
+#define EXIT_POLL_INTERVAL 10
+
+/*
+ * The outcomes of the jobs are propagated from the main loop: the termination
+ * of a process is observed with a child watch and the output of a future is
+ * read whenever it becomes available, so that no thread is needed per job.
+ */
+
+/* Signal routing infrastructure */
+
+/* Maps job IDs to the unique bus names of the clients that requested them */
+static GHashTable *job_clients_table = NULL;
+
+void register_job_client(gint jid, const gchar *client)
+{
+    if(client != NULL)
+    {
+        if(job_clients_table == NULL)
+            job_clients_table = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+
+        g_hash_table_insert(job_clients_table, GINT_TO_POINTER(jid), g_strdup(client));
+    }
+}
+
+static void emit_job_signal(OrgNixosDisnixDisnix *object, gint jid, const gchar *signal_name, GVariant *parameters)
+{
+    GDBusInterfaceSkeleton *skeleton = G_DBUS_INTERFACE_SKELETON(object);
+    const gchar *client = (job_clients_table == NULL) ? NULL : g_hash_table_lookup(job_clients_table, GINT_TO_POINTER(jid));
+
+    /* Address the signal to the client of the job, or broadcast it if the client is unknown */
+    g_dbus_connection_emit_signal(g_dbus_interface_skeleton_get_connection(skeleton),
+        client,
+        g_dbus_interface_skeleton_get_object_path(skeleton),
+        g_dbus_interface_skeleton_get_info(skeleton)->name,
+        signal_name,
+        parameters,
+        NULL);
+
+    /* Each job emits exactly one of these signals, so its client is no longer needed */
+    if(client != NULL)
+        g_hash_table_remove(job_clients_table, GINT_TO_POINTER(jid));
+}
+
+void emit_job_finish(OrgNixosDisnixDisnix *object, gint jid)
+{
+    emit_job_signal(object, jid, "finish", g_variant_new("(i)", jid));
+}
+
+void emit_job_success(OrgNixosDisnixDisnix *object, gint jid, const gchar *const *result)
+{
+    emit_job_signal(object, jid, "success", g_variant_new("(i^as)", jid, result));
+}
+
+void emit_job_failure(OrgNixosDisnixDisnix *object, gint jid)
+{
+    emit_job_signal(object, jid, "failure", g_variant_new("(i)", jid));
+}
+
+/* Closes the log file of a completed job and gives its admission slot to the next waiting job */
+
+static void finish_job(gint jid, int log_fd)
+{
+    close(log_fd);
+    release_admitted_job(jid);
+}
 
 /* Boolean signaling infrastructure */
 
@@ -29,43 +101,48 @@ typedef struct
     OrgNixosDisnixDisnix *object;
     gint jid;
     int log_fd;
-    pid_t pid;
 }
-SignalBooleanResultThreadData;
+SignalBooleanResultData;
 
-static gpointer signal_boolean_result_thread_func(gpointer data)
+static void on_boolean_process_exit(GPid pid, gint wstatus, gpointer user_data)
 {
+    SignalBooleanResultData *boolean_data = (SignalBooleanResultData*)user_data;
     ProcReact_Status status;
-    SignalBooleanResultThreadData *boolean_data = (SignalBooleanResultThreadData*)data;
-    int result = procreact_wait_for_boolean(boolean_data->pid, &status);
+    ProcReact_bool result = procreact_retrieve_boolean(pid, wstatus, &status);
 
     if(status == PROCREACT_STATUS_OK && result)
-        org_nixos_disnix_disnix_emit_finish(boolean_data->object, boolean_data->jid);
+        emit_job_finish(boolean_data->object, boolean_data->jid);
     else
-        org_nixos_disnix_disnix_emit_failure(boolean_data->object, boolean_data->jid);
+        emit_job_failure(boolean_data->object, boolean_data->jid);
 
     /* Cleanup */
+    finish_job(boolean_data->jid, boolean_data->log_fd);
     g_free(boolean_data);
-    close(boolean_data->log_fd);
-
-    return NULL;
+    g_spawn_close_pid(pid);
 }
 
 void signal_boolean_result(pid_t pid, OrgNixosDisnixDisnix *object, gint jid, int log_fd)
 {
-    GThread *thread;
-    SignalBooleanResultThreadData *data = (SignalBooleanResultThreadData*)g_malloc(sizeof(SignalBooleanResultThreadData));
+    if(pid == -1)
+    {
+        emit_job_failure(object, jid);
+        finish_job(jid, log_fd);
+    }
+    else
+    {
+        SignalBooleanResultData *data = (SignalBooleanResultData*)g_malloc(sizeof(SignalBooleanResultData));
 
-    data->object = object;
-    data->jid = jid;
-    data->log_fd = log_fd;
-    data->pid = pid;
+        data->object = object;
+        data->jid = jid;
+        data->log_fd = log_fd;
 
-    thread = g_thread_new("evaluate-boolean", signal_boolean_result_thread_func, data);
-    g_thread_unref(thread);
+        g_child_watch_add(pid, on_boolean_process_exit, data);
+    }
 }
 
-/* String vector signaling infrastructure */
+/* Future signaling infrastructure */
+
+typedef void (*emit_future_result_function) (OrgNixosDisnixDisnix *object, gint jid, void *result);
 
 typedef struct
 {
@@ -73,42 +150,100 @@ typedef struct
     gint jid;
     int log_fd;
     ProcReact_Future future;
+    emit_future_result_function emit_future_result;
 }
-SignalStrvResultThreadData;
+SignalFutureResultData;
 
-static gpointer signal_strv_result_thread_func(gpointer data)
+static gboolean finalize_future_when_exited(gpointer user_data)
 {
-    SignalStrvResultThreadData *strv_data = (SignalStrvResultThreadData*)data;
-    ProcReact_Status status;
-    char **result = procreact_future_get(&strv_data->future, &status);
+    SignalFutureResultData *future_data = (SignalFutureResultData*)user_data;
+    siginfo_t info;
 
-    if(status != PROCREACT_STATUS_OK || result == NULL)
-        org_nixos_disnix_disnix_emit_failure(strv_data->object, strv_data->jid);
+    /* Check whether the process has terminated without reaping it, so that finalizing the future never blocks the main loop */
+    info.si_pid = 0;
+
+    if(waitid(P_PID, future_data->future.pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid == 0)
+        return G_SOURCE_CONTINUE;
     else
     {
-        org_nixos_disnix_disnix_emit_success(strv_data->object, strv_data->jid, (const gchar**)result);
-        procreact_free_string_array(result);
+        ProcReact_Status status;
+        void *result = future_data->future.type.finalize(future_data->future.state, future_data->future.pid, &status); /* Yields NULL if the process failed */
+
+        future_data->emit_future_result(future_data->object, future_data->jid, result);
+
+        /* Cleanup */
+        finish_job(future_data->jid, future_data->log_fd);
+        g_free(future_data);
+
+        return G_SOURCE_REMOVE;
     }
+}
 
-    /* Cleanup */
-    g_free(strv_data);
-    close(strv_data->log_fd);
+static gboolean on_future_output(gint fd, GIOCondition condition, gpointer user_data)
+{
+    SignalFutureResultData *future_data = (SignalFutureResultData*)user_data;
+    ProcReact_Future *future = &future_data->future;
+    ssize_t bytes_read;
+
+    /* Read everything that is currently available */
+    while((bytes_read = future->type.append(&future->type, future->state, fd)) > 0)
+        ;
+
+    if(bytes_read == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return G_SOURCE_CONTINUE;
+    else
+    {
+        /* The process has closed its output, which it typically does when it terminates */
+        procreact_destroy_future(future);
 
-    return NULL;
+        if(finalize_future_when_exited(future_data))
+            g_timeout_add(EXIT_POLL_INTERVAL, finalize_future_when_exited, future_data);
+
+        return G_SOURCE_REMOVE;
+    }
 }
 
-void signal_strv_result(ProcReact_Future future, OrgNixosDisnixDisnix *object, gint jid, int log_fd)
+static void signal_future_result(ProcReact_Future future, OrgNixosDisnixDisnix *object, gint jid, int log_fd, emit_future_result_function emit_future_result)
 {
-    GThread *thread;
-    SignalStrvResultThreadData *data = (SignalStrvResultThreadData*)g_malloc(sizeof(SignalStrvResultThreadData));
+    if(future.pid == -1 || future.fd == -1)
+    {
+        emit_future_result(object, jid, NULL);
+        finish_job(jid, log_fd);
+    }
+    else
+    {
+        SignalFutureResultData *data = (SignalFutureResultData*)g_malloc(sizeof(SignalFutureResultData));
 
-    data->object = object;
-    data->jid = jid;
-    data->log_fd = log_fd;
-    data->future = future;
+        data->object = object;
+        data->jid = jid;
+        data->log_fd = log_fd;
+        data->future = future;
+        data->future.state = future.type.initialize();
+        data->emit_future_result = emit_future_result;
 
-    thread = g_thread_new("evaluate-strv", signal_strv_result_thread_func, data);
-    g_thread_unref(thread);
+        fcntl(future.fd, F_SETFL, fcntl(future.fd, F_GETFL) | O_NONBLOCK);
+        g_unix_fd_add(future.fd, G_IO_IN | G_IO_HUP | G_IO_ERR, on_future_output, data);
+    }
+}
+
+/* String vector signaling infrastructure */
+
+static void emit_strv_result(OrgNixosDisnixDisnix *object, gint jid, void *result)
+{
+    char **strv_result = (char**)result;
+
+    if(strv_result == NULL)
+        emit_job_failure(object, jid);
+    else
+    {
+        emit_job_success(object, jid, (const gchar**)strv_result);
+        procreact_free_string_array(strv_result);
+    }
+}
+
+void signal_strv_result(ProcReact_Future future, OrgNixosDisnixDisnix *object, gint jid, int log_fd)
+{
+    signal_future_result(future, object, jid, log_fd, emit_strv_result);
 }
 
 /* Temp file signaling infrastructure */
@@ -118,99 +253,73 @@ typedef struct
     OrgNixosDisnixDisnix *object;
     gint jid;
     int log_fd;
-    pid_t pid;
     gchar *tempfilename;
     int temp_fd;
 }
-SignalTempFileResultThreadData;
+SignalTempFileResultData;
 
-static gpointer evaluate_tempfile_process_thread_func(gpointer data)
+static void on_tempfile_process_exit(GPid pid, gint wstatus, gpointer user_data)
 {
-    SignalTempFileResultThreadData *tempfile_data = (SignalTempFileResultThreadData*)data;
+    SignalTempFileResultData *tempfile_data = (SignalTempFileResultData*)user_data;
     ProcReact_Status status;
-    int result = procreact_wait_for_boolean(tempfile_data->pid, &status);
+    ProcReact_bool result = procreact_retrieve_boolean(pid, wstatus, &status);
 
     if(status == PROCREACT_STATUS_OK && result)
     {
         const gchar *tempfilepaths[] = { tempfile_data->tempfilename, NULL };
 
-        if(fchmod(tempfile_data->temp_fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) == 1)
+        if(fchmod(tempfile_data->temp_fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) == -1)
         {
             dprintf(tempfile_data->log_fd, "Cannot change permissions of tempfile: %s\n", tempfile_data->tempfilename);
-            org_nixos_disnix_disnix_emit_failure(tempfile_data->object, tempfile_data->jid);
+            emit_job_failure(tempfile_data->object, tempfile_data->jid);
         }
         else
-            org_nixos_disnix_disnix_emit_success(tempfile_data->object, tempfile_data->jid, tempfilepaths);
+            emit_job_success(tempfile_data->object, tempfile_data->jid, tempfilepaths);
     }
-
-    g_free(tempfile_data->tempfilename);
+    else
+        emit_job_failure(tempfile_data->object, tempfile_data->jid);
 
     /* Cleanup */
-    close(tempfile_data->log_fd);
+    finish_job(tempfile_data->jid, tempfile_data->log_fd);
     close(tempfile_data->temp_fd);
-
-    return NULL;
+    g_free(tempfile_data->tempfilename);
+    g_free(tempfile_data);
+    g_spawn_close_pid(pid);
 }
 
 void signal_tempfile_result(pid_t pid, gchar *tempfilename, int temp_fd, OrgNixosDisnixDisnix *object, gint jid, int log_fd)
 {
-    GThread *thread;
-    SignalTempFileResultThreadData *data = (SignalTempFileResultThreadData*)g_malloc(sizeof(SignalTempFileResultThreadData));
+    SignalTempFileResultData *data = (SignalTempFileResultData*)g_malloc(sizeof(SignalTempFileResultData));
 
     data->object = object;
     data->jid = jid;
     data->log_fd = log_fd;
-    data->pid = pid;
     data->tempfilename = tempfilename;
     data->temp_fd = temp_fd;
 
-    thread = g_thread_new("evaluate-tempfile", evaluate_tempfile_process_thread_func, data);
-    g_thread_unref(thread);
+    if(pid == -1)
+        on_tempfile_process_exit(pid, 0, data);
+    else
+        g_child_watch_add(pid, on_tempfile_process_exit, data);
 }
 
 /* String signaling infrastructure */
 
-typedef struct
-{
-    OrgNixosDisnixDisnix *object;
-    gint jid;
-    int log_fd;
-    ProcReact_Future future;
-}
-SignalStringResultThreadData;
-
-static gpointer signal_string_result_thread_func(gpointer data)
+static void emit_string_result(OrgNixosDisnixDisnix *object, gint jid, void *result)
 {
-    SignalStringResultThreadData *string_data = (SignalStringResultThreadData*)data;
-    ProcReact_Status status;
-    char *result = procreact_future_get(&string_data->future, &status);
+    char *string_result = (char*)result;
 
-    if(status != PROCREACT_STATUS_OK || result == NULL)
-        org_nixos_disnix_disnix_emit_failure(string_data->object, string_data->jid);
+    if(string_result == NULL)
+        emit_job_failure(object, jid);
     else
     {
-        char *result_array[] = { result, NULL };
-        org_nixos_disnix_disnix_emit_success(string_data->object, string_data->jid, (const gchar**)result_array);
-        free(result);
+        char *result_array[] = { string_result, NULL };
+        emit_job_success(object, jid, (const gchar**)result_array);
+        free(string_result);
     }
-
-    /* Cleanup */
-    g_free(string_data);
-    close(string_data->log_fd);
-
-    return NULL;
 }
 
 void signal_string_result(ProcReact_Future future, OrgNixosDisnixDisnix *object, gint jid, int log_fd)
 {
-    GThread *thread;
-    SignalStringResultThreadData *data = (SignalStringResultThreadData*)g_malloc(sizeof(SignalStringResultThreadData));
-
-    data->object = object;
-    data->jid = jid;
-    data->log_fd = log_fd;
-    data->future = future;
-
-    thread = g_thread_new("evaluate-string", signal_string_result_thread_func, data);
-    g_thread_unref(thread);
+    signal_future_result(future, object, jid, log_fd, emit_string_result);
 }
@@ -26,8 +26,44 @@
 #include "disnix-dbus.h"
 
 /**
- * Spawns a thread that waits for process to complete and propagates a finish
- * signal when it yields TRUE or a failure signal when it yiels FALSE.
+ * Records which client requested a job ID, so that the signals that report the
+ * outcome of the job are only delivered to that client instead of being
+ * broadcast to every client on the bus.
+ *
+ * @param jid Job ID
+ * @param client Unique bus name of the client, or NULL if it is unknown
+ */
+void register_job_client(gint jid, const gchar *client);
+
+/**
+ * Propagates a finish signal for a job to the client that requested it.
+ *
+ * @param object A Disnix DBus interface object
+ * @param jid Job ID
+ */
+void emit_job_finish(OrgNixosDisnixDisnix *object, gint jid);
+
+/**
+ * Propagates a success signal with the results of a job to the client that
+ * requested it.
+ *
+ * @param object A Disnix DBus interface object
+ * @param jid Job ID
+ * @param result A NULL-terminated string array with the results of the job
+ */
+void emit_job_success(OrgNixosDisnixDisnix *object, gint jid, const gchar *const *result);
+
+/**
+ * Propagates a failure signal for a job to the client that requested it.
+ *
+ * @param object A Disnix DBus interface object
+ * @param jid Job ID
+ */
+void emit_job_failure(OrgNixosDisnixDisnix *object, gint jid);
+
+/**
+ * Watches a process from the main loop and propagates a finish signal when it
+ * yields TRUE or a failure signal when it yields FALSE.
  *
  * @param pid PID of the running process
  * @param object A Disnix DBus interface object
@@ -37,8 +73,9 @@
 void signal_boolean_result(pid_t pid, OrgNixosDisnixDisnix *object, gint jid, int log_fd);
 
 /**
- * Spawns a thread that waits for future to complete and propagates a success
- * signal with the result if it succeeds or a failure signal when it fails.
+ * Reads the output of a future from the main loop as soon as it becomes
+ * available and propagates a success signal with the result if it succeeds or
+ * a failure signal when it fails.
  *
  * @param future Future delivering a string vector
  * @param object A Disnix DBus interface object
@@ -48,9 +85,9 @@ void signal_boolean_result(pid_t pid, OrgNixosDisnixDisnix *object, gint jid, in
 void signal_strv_result(ProcReact_Future future, OrgNixosDisnixDisnix *object, gint jid, int log_fd);
 
 /**
- * Spawns a thread that waits for process that writes to a tempfile to complete
- * and propagates a success signal with the correspondng path if it succeeds or
- * a failure signal when it fails.
+ * Watches a process that writes to a tempfile from the main loop and propagates
+ * a success signal with the corresponding path if it succeeds or a failure
+ * signal when it fails.
  *
  * @param pid PID of the running process
  * @param tempfilename String containing the path to the tempfile
@@ -61,6 +98,16 @@ void signal_strv_result(ProcReact_Future future, OrgNixosDisnixDisnix *object, g
  */
 void signal_tempfile_result(pid_t pid, gchar *tempfilename, int temp_fd, OrgNixosDisnixDisnix *object, gint jid, int log_fd);
 
+/**
+ * Reads the output of a future from the main loop as soon as it becomes
+ * available and propagates a success signal with the resulting string if it
+ * succeeds or a failure signal when it fails.
+ *
+ * @param future Future delivering a string
+ * @param object A Disnix DBus interface object
+ * @param jid Job ID of the running process
+ * @param log_fd File descriptor of the job's logfile
+ */
 void signal_string_result(ProcReact_Future future, OrgNixosDisnixDisnix *object, gint jid, int log_fd);
 
 #endif
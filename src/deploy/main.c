@@ -82,6 +82,38 @@ static void print_usage(const char *command)
     "                       state after upgrading. (defaults to: 0)\n"
     "  DYSNOMIA_STATEDIR    Specifies where the snapshots must be stored on the\n"
     "                       coordinator machine (defaults to: /var/state/dysnomia)\n"
+    "  DISNIX_ADAPTIVE_TRANSFERS\n"
+    "                       If set to a number, the amount of concurrent\n"
+    "                       transfers is adapted to the measured throughput,\n"
+    "                       up to the given number\n"
+    "  DISNIX_MAX_TRANSFERS_PER_TARGET\n"
+    "                       Maximum amount of components of the same target\n"
+    "                       whose snapshots are transferred concurrently\n"
+    "                       (defaults to: the maximum amount of concurrent\n"
+    "                       transfers)\n"
+    "  DISNIX_DELTA_SNAPSHOTS\n"
+    "                       If set to 1, only the blocks of the snapshots\n"
+    "                       that differ from the newest generation on the\n"
+    "                       receiving machine are transferred. Requires\n"
+    "                       rsync on both machines.\n"
+    "  DISNIX_VERIFY_SNAPSHOTS\n"
+    "                       If set to 1, the digests of transferred snapshots\n"
+    "                       are compared with the digests of the originals\n"
+    "                       to detect corruption in transit\n"
+    "  DISNIX_DEDUPLICATE_SNAPSHOTS\n"
+    "                       If set to 1, files of retrieved snapshots with\n"
+    "                       identical contents, permissions, ownership and\n"
+    "                       modification time are stored once on the\n"
+    "                       coordinator\n"
+    "  DISNIX_SNAPSHOT_CHUNKS_DIR\n"
+    "                       Directory in which the deduplicated files are\n"
+    "                       stored (defaults to: $DYSNOMIA_STATEDIR/chunks)\n"
+    "  DISNIX_MAX_SNAPSHOT_BYTES\n"
+    "                       Maximum amount of snapshot data in bytes that is\n"
+    "                       staged on the coordinator. The components are\n"
+    "                       migrated in batches that fit in this budget and\n"
+    "                       the staged snapshots of a batch are removed once\n"
+    "                       it has been restored (defaults to: no limit)\n"
     );
 }
 
@@ -42,6 +42,22 @@ static void print_usage(const char *command)
     "  -h, --help                          Shows the usage of this command to the user\n"
     "  -v, --version                       Shows the version of this command to the\n"
     "                                      user\n"
+
+    "\nEnvironment:\n"
+    "  DISNIX_VALID_PATHS_CACHE_MAX_AGE  Amount of seconds after which the paths\n"
+    "                                    that are known to be valid on a target are\n"
+    "                                    fully verified again. The cache is disabled\n"
+    "                                    if it is not set or 0 (which is the\n"
+    "                                    default)\n"
+    "  DISNIX_VALID_PATHS_CACHE_DIR      Directory in which the known valid paths\n"
+    "                                    of each target are stored (Defaults to:\n"
+    "                                    ~/.cache/disnix/valid-paths)\n"
+    "  DISNIX_FULL_VERIFY                If set to 1 it verifies the validity of all\n"
+    "                                    paths on the targets\n"
+    "  DISNIX_ADAPTIVE_TRANSFERS         If set to a number, the amount of\n"
+    "                                    concurrent transfers is adapted to the\n"
+    "                                    measured throughput in bytes per second,\n"
+    "                                    up to the given number\n"
     );
 }
 
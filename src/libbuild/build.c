@@ -18,20 +18,33 @@
  */
 
 #include "build.h"
+#include <unistd.h>
 #include <distributedderivation.h>
 #include <derivationmapping-iterator.h>
+#include <derivationmappingbatch-iterator.h>
+#include <buildplacement.h>
 #include <interfacestable.h>
 #include <copy-closure.h>
 #include <remote-package-management.h>
+#include <package-management.h>
+#include <valid-paths-cache.h>
+#include <transferlimit.h>
 
 /* Distribute store derivations infrastructure */
 
+typedef struct
+{
+    char *tmpdir;
+    ProcReact_Lane *bulk_lane;
+}
+DistributeDerivationsData;
+
 static pid_t copy_derivation_mapping_to(void *data, DerivationMapping *mapping, Interface *interface)
 {
-    char *tmpdir = (char*)data;
+    DistributeDerivationsData *distribute_data = (DistributeDerivationsData*)data;
     char *paths[] = { (char*)mapping->derivation, NULL };
     g_print("[target: %s]: Receiving intra-dependency closure of store derivation: %s\n", mapping->interface, mapping->derivation);
-    return copy_closure_to((char*)interface->client_interface, (char*)interface->target_address, tmpdir, paths, STDERR_FILENO);
+    return copy_closure_to((char*)interface->client_interface, (char*)interface->target_address, distribute_data->tmpdir, paths, distribute_data->bulk_lane, STDERR_FILENO);
 }
 
 static void complete_copy_derivation_mapping_to(void *data, DerivationMapping *mapping, ProcReact_Status status, int result)
@@ -43,51 +56,291 @@ static void complete_copy_derivation_mapping_to(void *data, DerivationMapping *m
 static ProcReact_bool distribute_derivation_mappings(const GPtrArray *derivation_mapping_array, GHashTable *interfaces_table, const unsigned int max_concurrent_transfers, char *tmpdir)
 {
     ProcReact_bool success;
-    ProcReact_PidIterator iterator = create_derivation_mapping_pid_iterator(derivation_mapping_array, interfaces_table, copy_derivation_mapping_to, complete_copy_derivation_mapping_to, tmpdir);
+    ProcReact_Lane bulk_lane = create_bulk_transfer_lane(max_concurrent_transfers);
+    DistributeDerivationsData data = { tmpdir, &bulk_lane };
+    ProcReact_PidIterator iterator = create_derivation_mapping_pid_iterator(derivation_mapping_array, interfaces_table, copy_derivation_mapping_to, complete_copy_derivation_mapping_to, &data);
 
     g_print("[coordinator]: Distributing store derivation files...\n");
 
-    procreact_fork_and_wait_in_parallel_limit(&iterator, max_concurrent_transfers);
+    fork_and_wait_for_transfers(&iterator, max_concurrent_transfers, &bulk_lane, "derivation distribution");
     success = derivation_mapping_iterator_has_succeeded(iterator.data);
 
     destroy_derivation_mapping_pid_iterator(&iterator);
+    procreact_destroy_lane(&bulk_lane);
     return success;
 }
 
 /* Realisation infrastructure */
 
-static ProcReact_Future realise_derivation_mapping(void *data, DerivationMapping *mapping, Interface *interface)
+static ProcReact_Future realise_derivation_mapping_batch(void *data, DerivationMappingBatch *batch, Interface *interface)
+{
+    gchar **derivations = generate_derivation_mapping_batch_derivations(batch);
+    ProcReact_Future future;
+    unsigned int i;
+
+    for(i = 0; derivations[i] != NULL; i++)
+        g_print("[target: %s]: Realising derivation: %s\n", batch->interface, derivations[i]);
+
+    future = pkgmgmt_remote_realise((char*)interface->client_interface, (char*)interface->target_address, derivations, batch->derivation_mapping_array->len);
+    g_free(derivations);
+    return future;
+}
+
+static void complete_realise_derivation_mapping_batch(void *data, DerivationMappingBatch *batch, ProcReact_Future *future, ProcReact_Status status)
+{
+    if(status == PROCREACT_STATUS_OK && future->result != NULL)
+    {
+        if(batch->derivation_mapping_array->len == 1)
+        {
+            /* The outputs of a batch with a single derivation belong to that derivation */
+            DerivationMapping *mapping = g_ptr_array_index(batch->derivation_mapping_array, 0);
+            mapping->result = future->result;
+        }
+        else
+            procreact_free_string_array(future->result); /* The outputs are assigned to the mappings after all batches have been realised */
+    }
+    else
+    {
+        unsigned int i;
+
+        for(i = 0; i < batch->derivation_mapping_array->len; i++)
+        {
+            DerivationMapping *mapping = g_ptr_array_index(batch->derivation_mapping_array, i);
+            g_printerr("[target: %s]: Realising derivation: %s has failed!\n", mapping->interface, mapping->derivation);
+        }
+    }
+}
+
+static unsigned int determine_build_limit(const GPtrArray *array, const unsigned int max_concurrent_builds)
+{
+    if(max_concurrent_builds == 0)
+        return array->len; /* No global limit, only the cores of each interface bound the amount of builds */
+    else
+        return max_concurrent_builds;
+}
+
+static unsigned int determine_pipelined_build_limit(GHashTable *interfaces_table, const unsigned int max_concurrent_builds)
+{
+    if(max_concurrent_builds == 0)
+    {
+        /* No global limit, only the cores of each interface bound the amount of builds */
+        unsigned int total_cores = 0;
+        GHashTableIter iter;
+        gpointer key, value;
+
+        g_hash_table_iter_init(&iter, interfaces_table);
+        while(g_hash_table_iter_next(&iter, &key, &value))
+        {
+            Interface *interface = (Interface*)value;
+            total_cores += interface->num_of_cores;
+        }
+
+        return total_cores;
+    }
+    else
+        return max_concurrent_builds;
+}
+
+static ProcReact_Future query_derivation_mapping_outputs(void *data, DerivationMapping *mapping, Interface *interface)
 {
-    g_print("[target: %s]: Realising derivation: %s\n", mapping->interface, mapping->derivation);
-    return pkgmgmt_remote_realise((char*)interface->client_interface, (char*)interface->target_address, (char*)mapping->derivation);
+    return pkgmgmt_query_derivation_outputs((gchar*)mapping->derivation, STDERR_FILENO);
 }
 
-static void complete_realise_derivation_mapping(void *data, DerivationMapping *mapping, ProcReact_Future *future, ProcReact_Status status)
+static void complete_query_derivation_mapping_outputs(void *data, DerivationMapping *mapping, ProcReact_Future *future, ProcReact_Status status)
 {
     if(status == PROCREACT_STATUS_OK && future->result != NULL)
         mapping->result = future->result;
     else
-        g_printerr("[target: %s]: Realising derivation: %s has failed!\n", mapping->interface, mapping->derivation);
+        g_printerr("[coordinator]: Cannot query the outputs of store derivation: %s\n", mapping->derivation);
 }
 
-static ProcReact_bool realise(const GPtrArray *derivation_mapping_array, GHashTable *interfaces_table)
+static ProcReact_bool demultiplex_results(const GPtrArray *derivation_mapping_array, GHashTable *interfaces_table)
 {
+    GPtrArray *unassigned_mapping_array = g_ptr_array_new();
     ProcReact_bool success;
-    ProcReact_FutureIterator iterator = create_derivation_mapping_future_iterator(derivation_mapping_array, interfaces_table, realise_derivation_mapping, complete_realise_derivation_mapping, NULL);
-    procreact_fork_in_parallel_buffer_and_wait(&iterator);
+    unsigned int i;
+
+    for(i = 0; i < derivation_mapping_array->len; i++)
+    {
+        DerivationMapping *mapping = g_ptr_array_index(derivation_mapping_array, i);
+
+        if(mapping->result == NULL)
+            g_ptr_array_add(unassigned_mapping_array, mapping);
+    }
+
+    /*
+     * The output of a batched realise does not tell which paths belong to
+     * which derivation. Because the store derivations originate from the
+     * coordinator, we can look up their outputs locally.
+     */
+    if(unassigned_mapping_array->len == 0)
+        success = TRUE;
+    else
+    {
+        ProcReact_FutureIterator iterator = create_derivation_mapping_future_iterator(unassigned_mapping_array, interfaces_table, query_derivation_mapping_outputs, complete_query_derivation_mapping_outputs, NULL);
+        procreact_fork_buffer_and_wait_in_parallel_limit(&iterator, sysconf(_SC_NPROCESSORS_ONLN));
+        success = derivation_mapping_iterator_has_succeeded(iterator.data);
+        destroy_derivation_mapping_future_iterator(&iterator);
+    }
+
+    g_ptr_array_free(unassigned_mapping_array, TRUE);
+    return success;
+}
+
+static ProcReact_bool realise(const GPtrArray *derivation_mapping_array, GHashTable *interfaces_table, const unsigned int max_concurrent_builds, const unsigned int max_batch_size)
+{
+    ProcReact_bool success;
+    GPtrArray *batch_array = create_derivation_mapping_batch_array(derivation_mapping_array, max_batch_size);
+    ProcReact_FutureIterator iterator = create_derivation_mapping_batch_future_iterator(batch_array, interfaces_table, realise_derivation_mapping_batch, complete_realise_derivation_mapping_batch, NULL);
+    procreact_fork_buffer_and_wait_in_parallel_limit(&iterator, determine_build_limit(batch_array, max_concurrent_builds));
 
     g_print("[coordinator]: Realising store derivation files...\n");
 
-    success = derivation_mapping_iterator_has_succeeded(iterator.data);
+    success = derivation_mapping_batch_iterator_has_succeeded(iterator.data)
+      && demultiplex_results(derivation_mapping_array, interfaces_table);
 
-    destroy_derivation_mapping_future_iterator(&iterator);
+    destroy_derivation_mapping_batch_future_iterator(&iterator);
+    delete_derivation_mapping_batch_array(batch_array);
     return success;
 }
 
+/* Build result requisites infrastructure */
+
+static ProcReact_Future query_result_requisites(void *data, DerivationMapping *mapping, Interface *interface)
+{
+    return pkgmgmt_remote_query_requisites((char*)interface->client_interface, (char*)interface->target_address, mapping->result, g_strv_length(mapping->result));
+}
+
+static void complete_query_result_requisites(void *data, DerivationMapping *mapping, ProcReact_Future *future, ProcReact_Status status)
+{
+    GHashTable *requisites_table = (GHashTable*)data;
+
+    if(status == PROCREACT_STATUS_OK && future->result != NULL)
+        g_hash_table_insert(requisites_table, mapping, future->result);
+    else
+        g_printerr("[target: %s]: Cannot query the requisites of the build results of store derivation: %s\n", mapping->interface, mapping->derivation);
+}
+
+static GHashTable *query_requisites_of_results(const GPtrArray *derivation_mapping_array, GHashTable *interfaces_table, const unsigned int max_concurrent_transfers)
+{
+    GHashTable *requisites_table = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)procreact_free_string_array);
+    ProcReact_FutureIterator iterator = create_derivation_mapping_future_iterator(derivation_mapping_array, interfaces_table, query_result_requisites, complete_query_result_requisites, requisites_table);
+
+    procreact_fork_buffer_and_wait_in_parallel_limit(&iterator, max_concurrent_transfers);
+
+    if(!derivation_mapping_iterator_has_succeeded(iterator.data))
+    {
+        g_hash_table_destroy(requisites_table);
+        requisites_table = NULL;
+    }
+
+    destroy_derivation_mapping_future_iterator(&iterator);
+    return requisites_table;
+}
+
+/* Build result ordering infrastructure */
+
+static gint compare_estimated_weights(gconstpointer l, gconstpointer r, gpointer user_data)
+{
+    GHashTable *weights_table = (GHashTable*)user_data;
+    const DerivationMapping *left = *((const DerivationMapping **)l);
+    const DerivationMapping *right = *((const DerivationMapping **)r);
+    guint left_weight = GPOINTER_TO_UINT(g_hash_table_lookup(weights_table, left));
+    guint right_weight = GPOINTER_TO_UINT(g_hash_table_lookup(weights_table, right));
+
+    if(left_weight > right_weight)
+        return -1;
+    else if(left_weight < right_weight)
+        return 1;
+    else
+        return 0;
+}
+
+static GPtrArray *order_results_by_weight(const GPtrArray *derivation_mapping_array, GHashTable *requisites_table, GHashTable *weights_table)
+{
+    unsigned int i;
+    GPtrArray *ordered_mapping_array = g_ptr_array_sized_new(derivation_mapping_array->len);
+    GHashTable *paths_table = g_hash_table_new(g_str_hash, g_str_equal);
+    GPtrArray *paths_array = g_ptr_array_new();
+    char **invalid_paths;
+
+    /* Collect the requisites of all mappings, so that their validity can be checked in one go */
+    for(i = 0; i < derivation_mapping_array->len; i++)
+    {
+        DerivationMapping *mapping = g_ptr_array_index(derivation_mapping_array, i);
+        gchar **requisites = g_hash_table_lookup(requisites_table, mapping);
+        unsigned int j;
+
+        for(j = 0; requisites[j] != NULL; j++)
+        {
+            if(!g_hash_table_contains(paths_table, requisites[j]))
+            {
+                g_hash_table_add(paths_table, requisites[j]);
+                g_ptr_array_add(paths_array, requisites[j]);
+            }
+        }
+    }
+
+    /*
+     * The build results are not present on the coordinator, so we cannot query
+     * their NAR sizes. Instead, we estimate the amount of work by the amount of
+     * requisites that are not valid on the coordinator yet.
+     */
+    g_hash_table_remove_all(paths_table);
+
+    if(paths_array->len == 0)
+        invalid_paths = NULL;
+    else
+        invalid_paths = pkgmgmt_print_invalid_packages_sync((gchar**)paths_array->pdata, paths_array->len, STDERR_FILENO);
+
+    if(invalid_paths != NULL)
+    {
+        for(i = 0; invalid_paths[i] != NULL; i++)
+            g_hash_table_add(paths_table, invalid_paths[i]);
+    }
+
+    for(i = 0; i < derivation_mapping_array->len; i++)
+    {
+        DerivationMapping *mapping = g_ptr_array_index(derivation_mapping_array, i);
+        gchar **requisites = g_hash_table_lookup(requisites_table, mapping);
+        guint weight = 0;
+        unsigned int j;
+
+        for(j = 0; requisites[j] != NULL; j++)
+        {
+            if(g_hash_table_contains(paths_table, requisites[j]))
+                weight++;
+        }
+
+        g_hash_table_insert(weights_table, mapping, GUINT_TO_POINTER(weight));
+        g_ptr_array_add(ordered_mapping_array, mapping);
+    }
+
+    /* Retrieve the largest closures first so that they do not determine the tail of the retrieval phase */
+    g_ptr_array_sort_with_data(ordered_mapping_array, compare_estimated_weights, weights_table);
+
+    if(invalid_paths != NULL)
+        procreact_free_string_array(invalid_paths);
+
+    g_ptr_array_free(paths_array, TRUE);
+    g_hash_table_destroy(paths_table);
+    return ordered_mapping_array;
+}
+
 /* Build result retrieval infrastructure */
 
+typedef struct
+{
+    GHashTable *requisites_table;
+    GHashTable *weights_table;
+    ProcReact_Lane *bulk_lane;
+    ProcReact_AdaptiveLimit *adaptive_limit;
+}
+RetrieveResultsData;
+
 static pid_t copy_result_from(void *data, DerivationMapping *mapping, Interface *interface)
 {
+    RetrieveResultsData *retrieve_data = (RetrieveResultsData*)data;
     char *path;
     unsigned int count = 0;
 
@@ -101,34 +354,417 @@ static pid_t copy_result_from(void *data, DerivationMapping *mapping, Interface
 
     g_print("\n");
 
-    return copy_closure_from((char*)interface->client_interface, (char*)interface->target_address, mapping->result, STDOUT_FILENO, STDERR_FILENO);
+    return copy_requisites_from((char*)interface->client_interface, (char*)interface->target_address, g_hash_table_lookup(retrieve_data->requisites_table, mapping), retrieve_data->bulk_lane, STDOUT_FILENO, STDERR_FILENO);
 }
 
 static void complete_copy_result_from(void *data, DerivationMapping *mapping, ProcReact_Status status, int result)
 {
+    RetrieveResultsData *retrieve_data = (RetrieveResultsData*)data;
+
     if(status != PROCREACT_STATUS_OK || !result)
         g_print("[target: %s]: Cannot send build result of store derivation to coordinator: %s\n", mapping->interface, mapping->derivation);
+    else if(retrieve_data->adaptive_limit != NULL)
+    {
+        /* Let the adaptive concurrency controller measure the throughput in retrieved requisites, the same estimate that orders the retrievals */
+        procreact_adaptive_limit_add_units(retrieve_data->adaptive_limit, GPOINTER_TO_UINT(g_hash_table_lookup(retrieve_data->weights_table, mapping)));
+    }
+}
+
+static GPtrArray *select_mappings_with_missing_results(const GPtrArray *derivation_mapping_array)
+{
+    GPtrArray *selected_mapping_array = g_ptr_array_new();
+    GPtrArray *result_paths_array = g_ptr_array_new();
+    char **invalid_paths;
+    unsigned int i;
+
+    for(i = 0; i < derivation_mapping_array->len; i++)
+    {
+        DerivationMapping *mapping = g_ptr_array_index(derivation_mapping_array, i);
+        unsigned int j;
+
+        for(j = 0; mapping->result[j] != NULL; j++)
+            g_ptr_array_add(result_paths_array, mapping->result[j]);
+    }
+
+    /* Check the validity of the build results of all mappings on the coordinator in one go */
+    invalid_paths = pkgmgmt_print_invalid_packages_sync((gchar**)result_paths_array->pdata, result_paths_array->len, STDERR_FILENO);
+
+    if(invalid_paths == NULL)
+    {
+        /* If we cannot check the validity, retrieve everything */
+        for(i = 0; i < derivation_mapping_array->len; i++)
+            g_ptr_array_add(selected_mapping_array, g_ptr_array_index(derivation_mapping_array, i));
+    }
+    else
+    {
+        GHashTable *invalid_paths_table = g_hash_table_new(g_str_hash, g_str_equal);
+
+        for(i = 0; invalid_paths[i] != NULL; i++)
+            g_hash_table_insert(invalid_paths_table, invalid_paths[i], invalid_paths[i]);
+
+        for(i = 0; i < derivation_mapping_array->len; i++)
+        {
+            DerivationMapping *mapping = g_ptr_array_index(derivation_mapping_array, i);
+            ProcReact_bool missing = FALSE;
+            unsigned int j;
+
+            for(j = 0; mapping->result[j] != NULL; j++)
+            {
+                if(g_hash_table_lookup(invalid_paths_table, mapping->result[j]) != NULL)
+                {
+                    missing = TRUE;
+                    break;
+                }
+            }
+
+            if(missing)
+                g_ptr_array_add(selected_mapping_array, mapping);
+            else
+                g_print("[target: %s]: Build results of store derivation: %s are already present on the coordinator\n", mapping->interface, mapping->derivation);
+        }
+
+        g_hash_table_destroy(invalid_paths_table);
+        procreact_free_string_array(invalid_paths);
+    }
+
+    g_ptr_array_free(result_paths_array, TRUE);
+    return selected_mapping_array;
+}
+
+static ProcReact_bool retrieve_missing_results(const GPtrArray *derivation_mapping_array, GHashTable *interfaces_table, const unsigned int max_concurrent_transfers)
+{
+    GHashTable *requisites_table = query_requisites_of_results(derivation_mapping_array, interfaces_table, max_concurrent_transfers);
+
+    if(requisites_table == NULL)
+        return FALSE;
+    else
+    {
+        ProcReact_bool success;
+        GHashTable *weights_table = g_hash_table_new(g_direct_hash, g_direct_equal);
+        GPtrArray *ordered_mapping_array = order_results_by_weight(derivation_mapping_array, requisites_table, weights_table);
+        ProcReact_Lane bulk_lane = create_bulk_transfer_lane(max_concurrent_transfers);
+        RetrieveResultsData data = { requisites_table, weights_table, &bulk_lane, NULL };
+        ProcReact_PidIterator iterator = create_derivation_mapping_pid_iterator(ordered_mapping_array, interfaces_table, copy_result_from, complete_copy_result_from, &data);
+
+        fork_and_wait_for_measured_transfers(&iterator, max_concurrent_transfers, &bulk_lane, &data.adaptive_limit, "build result retrieval");
+        success = derivation_mapping_iterator_has_succeeded(iterator.data);
+
+        destroy_derivation_mapping_pid_iterator(&iterator);
+        procreact_destroy_lane(&bulk_lane);
+        g_ptr_array_free(ordered_mapping_array, TRUE);
+        g_hash_table_destroy(weights_table);
+        g_hash_table_destroy(requisites_table);
+        return success;
+    }
 }
 
 static ProcReact_bool retrieve_results(const GPtrArray *derivation_mapping_array, GHashTable *interfaces_table, const unsigned int max_concurrent_transfers)
 {
     ProcReact_bool success;
-    ProcReact_PidIterator iterator = create_derivation_mapping_pid_iterator(derivation_mapping_array, interfaces_table, copy_result_from, complete_copy_result_from, NULL);
+    GPtrArray *selected_mapping_array;
 
     g_print("[coordinator]: Retrieving build results...\n");
 
-    procreact_fork_and_wait_in_parallel_limit(&iterator, max_concurrent_transfers);
-    success = derivation_mapping_iterator_has_succeeded(iterator.data);
+    selected_mapping_array = select_mappings_with_missing_results(derivation_mapping_array);
 
-    destroy_derivation_mapping_pid_iterator(&iterator);
+    if(selected_mapping_array->len == 0)
+        success = TRUE;
+    else
+        success = retrieve_missing_results(selected_mapping_array, interfaces_table, max_concurrent_transfers);
+
+    g_ptr_array_free(selected_mapping_array, TRUE);
     return success;
 }
 
-/* Build orchestration */
+/* Pipelined build infrastructure */
+
+typedef struct
+{
+    char *tmpdir;
+    ProcReact_Lane *distribute_lane;
+    ProcReact_Lane *realise_lane;
+    ProcReact_Lane *retrieve_lane;
+    unsigned int flags;
+}
+PipelinedBuildData;
+
+static char **realise_derivation_mapping_sync(DerivationMapping *mapping, Interface *interface, const PipelinedBuildData *pipelined_build_data)
+{
+    /* The iterator has already allocated a CPU core of the interface, so only the global build limit remains */
+    if(!procreact_lane_acquire(pipelined_build_data->realise_lane))
+        return NULL;
+    else
+    {
+        char *derivations[] = { (char*)mapping->derivation, NULL };
+        char **result;
+
+        g_print("[target: %s]: Realising derivation: %s\n", mapping->interface, mapping->derivation);
+        result = pkgmgmt_remote_realise_sync((char*)interface->client_interface, (char*)interface->target_address, derivations, 1);
+        procreact_lane_release(pipelined_build_data->realise_lane);
+
+        if(result == NULL)
+            g_printerr("[target: %s]: Realising derivation: %s has failed!\n", mapping->interface, mapping->derivation);
+
+        return result;
+    }
+}
+
+static ProcReact_bool result_is_present_sync(char **result)
+{
+    char **invalid_paths = pkgmgmt_print_invalid_packages_sync(result, g_strv_length(result), STDERR_FILENO);
+
+    if(invalid_paths == NULL)
+        return FALSE;
+    else
+    {
+        ProcReact_bool present = (g_strv_length(invalid_paths) == 0);
+        procreact_free_string_array(invalid_paths);
+        return present;
+    }
+}
+
+static ProcReact_bool retrieve_result_sync(DerivationMapping *mapping, Interface *interface, char **result, const ProcReact_Lane *retrieve_lane)
+{
+    char **requisites;
+
+    if(result_is_present_sync(result))
+    {
+        g_print("[target: %s]: Build results of store derivation: %s are already present on the coordinator\n", mapping->interface, mapping->derivation);
+        return TRUE;
+    }
+
+    requisites = pkgmgmt_remote_query_requisites_sync((char*)interface->client_interface, (char*)interface->target_address, result, g_strv_length(result));
+
+    if(requisites == NULL)
+    {
+        g_printerr("[target: %s]: Cannot query the requisites of the build results of store derivation: %s\n", mapping->interface, mapping->derivation);
+        return FALSE;
+    }
+    else
+    {
+        ProcReact_bool status;
+        unsigned int i;
+
+        g_print("[target: %s]: Sending build results to coordinator:", mapping->interface);
+
+        for(i = 0; result[i] != NULL; i++)
+            g_print(" %s", result[i]);
+
+        g_print("\n");
+
+        status = copy_requisites_from_sync((char*)interface->client_interface, (char*)interface->target_address, requisites, retrieve_lane, STDOUT_FILENO, STDERR_FILENO);
+        procreact_free_string_array(requisites);
+        return status;
+    }
+}
+
+static ProcReact_bool build_derivation_mapping_sync(DerivationMapping *mapping, Interface *interface, const PipelinedBuildData *pipelined_build_data)
+{
+    char *paths[] = { (char*)mapping->derivation, NULL };
+    ProcReact_bool status;
+
+    /* Distribute */
+    g_print("[target: %s]: Receiving intra-dependency closure of store derivation: %s\n", mapping->interface, mapping->derivation);
+
+    if(!copy_closure_to_sync((char*)interface->client_interface, (char*)interface->target_address, pipelined_build_data->tmpdir, paths, pipelined_build_data->distribute_lane, STDERR_FILENO))
+    {
+        g_printerr("[target: %s]: Cannot receive intra-dependency closure of store derivation: %s\n", mapping->interface, mapping->derivation);
+        status = FALSE;
+    }
+    else
+    {
+        /* Realise */
+        char **result = realise_derivation_mapping_sync(mapping, interface, pipelined_build_data);
+
+        if(result == NULL)
+            status = FALSE;
+        else if(pipelined_build_data->flags & FLAG_KEEP_RESULTS)
+        {
+            status = TRUE;
+            procreact_free_string_array(result);
+        }
+        else
+        {
+            /* Retrieve */
+            status = retrieve_result_sync(mapping, interface, result, pipelined_build_data->retrieve_lane);
+
+            if(!status)
+                g_printerr("[target: %s]: Cannot send build result of store derivation to coordinator: %s\n", mapping->interface, mapping->derivation);
+
+            procreact_free_string_array(result);
+        }
+    }
+
+    return status;
+}
+
+static pid_t build_derivation_mapping(void *data, DerivationMapping *mapping, Interface *interface)
+{
+    pid_t pid = fork();
+
+    if(pid == 0)
+        _exit(!build_derivation_mapping_sync(mapping, interface, (PipelinedBuildData*)data));
+
+    return pid;
+}
+
+static void complete_build_derivation_mapping(void *data, DerivationMapping *mapping, ProcReact_Status status, int result)
+{
+    if(status != PROCREACT_STATUS_OK)
+        g_printerr("[target: %s]: Building store derivation: %s terminated abnormally!\n", mapping->interface, mapping->derivation);
+}
+
+/* Build placement infrastructure */
+
+static ProcReact_Future query_derivation_mapping_inputs(void *data, DerivationMapping *mapping, Interface *interface)
+{
+    return pkgmgmt_query_requisites((gchar**)&mapping->derivation, 1, STDERR_FILENO);
+}
+
+static void complete_query_derivation_mapping_inputs(void *data, DerivationMapping *mapping, ProcReact_Future *future, ProcReact_Status status)
+{
+    GHashTable *inputs_table = (GHashTable*)data;
+
+    if(status == PROCREACT_STATUS_OK && future->result != NULL)
+        g_hash_table_insert(inputs_table, mapping, future->result);
+    else
+        g_printerr("[coordinator]: Cannot query the inputs of store derivation: %s\n", mapping->derivation);
+}
+
+static GHashTable *query_inputs_of_derivations(const GPtrArray *derivation_mapping_array, GHashTable *interfaces_table)
+{
+    GHashTable *inputs_table = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)procreact_free_string_array);
+    ProcReact_FutureIterator iterator = create_derivation_mapping_future_iterator(derivation_mapping_array, interfaces_table, query_derivation_mapping_inputs, complete_query_derivation_mapping_inputs, inputs_table);
+
+    procreact_fork_buffer_and_wait_in_parallel_limit(&iterator, sysconf(_SC_NPROCESSORS_ONLN));
+
+    if(!derivation_mapping_iterator_has_succeeded(iterator.data))
+    {
+        g_hash_table_destroy(inputs_table);
+        inputs_table = NULL;
+    }
+
+    destroy_derivation_mapping_future_iterator(&iterator);
+    return inputs_table;
+}
+
+static void add_known_valid_paths_to_build_placement(GHashTable *placement_table, GHashTable *interfaces_table)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_hash_table_iter_init(&iter, interfaces_table);
+    while(g_hash_table_iter_next(&iter, &key, &value))
+    {
+        Interface *interface = (Interface*)value;
+        ValidPathsCache *cache = open_valid_paths_cache(interface->client_interface, interface->target_address);
+
+        /* The paths of previous transfers tell us which inputs are likely to be present already */
+        if(cache != NULL)
+        {
+            GHashTableIter cache_iter;
+            gpointer path;
+
+            g_hash_table_iter_init(&cache_iter, cache->valid_paths_table);
+            while(g_hash_table_iter_next(&cache_iter, &path, NULL))
+                add_present_path_to_build_placement(placement_table, (gchar*)key, (gchar*)path);
 
-ProcReact_bool build(DistributedDerivation *distributed_derivation, const unsigned int max_concurrent_transfers, char *tmpdir)
+            delete_valid_paths_cache(cache);
+        }
+    }
+}
+
+static gint compare_amount_of_inputs(gconstpointer l, gconstpointer r, gpointer user_data)
+{
+    GHashTable *inputs_table = (GHashTable*)user_data;
+    unsigned int left_length = g_strv_length(g_hash_table_lookup(inputs_table, *((DerivationMapping**)l)));
+    unsigned int right_length = g_strv_length(g_hash_table_lookup(inputs_table, *((DerivationMapping**)r)));
+
+    /* Place the derivations with the largest closures first */
+    if(left_length > right_length)
+        return -1;
+    else if(left_length < right_length)
+        return 1;
+    else
+        return 0;
+}
+
+ProcReact_bool place_builds(DistributedDerivation *distributed_derivation)
+{
+    GHashTable *inputs_table;
+
+    g_print("[coordinator]: Placing store derivations...\n");
+
+    inputs_table = query_inputs_of_derivations(distributed_derivation->derivation_mapping_array, distributed_derivation->interfaces_table);
+
+    if(inputs_table == NULL)
+        return FALSE;
+    else
+    {
+        ProcReact_bool success = TRUE;
+        GHashTable *placement_table = create_build_placement_table(distributed_derivation->interfaces_table);
+        GPtrArray *ordered_mapping_array = g_ptr_array_sized_new(distributed_derivation->derivation_mapping_array->len);
+        unsigned int i;
+
+        add_known_valid_paths_to_build_placement(placement_table, distributed_derivation->interfaces_table);
+
+        for(i = 0; i < distributed_derivation->derivation_mapping_array->len; i++)
+            g_ptr_array_add(ordered_mapping_array, g_ptr_array_index(distributed_derivation->derivation_mapping_array, i));
+
+        g_ptr_array_sort_with_data(ordered_mapping_array, compare_amount_of_inputs, inputs_table);
+
+        for(i = 0; i < ordered_mapping_array->len; i++)
+        {
+            DerivationMapping *mapping = g_ptr_array_index(ordered_mapping_array, i);
+
+            if(!place_derivation_mapping(placement_table, distributed_derivation->interfaces_table, mapping, g_hash_table_lookup(inputs_table, mapping)))
+            {
+                success = FALSE;
+                break;
+            }
+        }
+
+        g_ptr_array_free(ordered_mapping_array, TRUE);
+        delete_build_placement_table(placement_table);
+        g_hash_table_destroy(inputs_table);
+        return success;
+    }
+}
+
+ProcReact_bool build(DistributedDerivation *distributed_derivation, const unsigned int max_concurrent_transfers, const unsigned int max_concurrent_builds, const unsigned int max_batch_size, const unsigned int flags, char *tmpdir)
 {
     return (distribute_derivation_mappings(distributed_derivation->derivation_mapping_array, distributed_derivation->interfaces_table, max_concurrent_transfers, tmpdir) /* Distribute derivations to target machines */
-      && realise(distributed_derivation->derivation_mapping_array, distributed_derivation->interfaces_table) /* Realise derivations on target machines */
-      && retrieve_results(distributed_derivation->derivation_mapping_array, distributed_derivation->interfaces_table, max_concurrent_transfers)); /* Retrieve back the build results */
+      && realise(distributed_derivation->derivation_mapping_array, distributed_derivation->interfaces_table, max_concurrent_builds, max_batch_size) /* Realise derivations on target machines */
+      && ((flags & FLAG_KEEP_RESULTS) || retrieve_results(distributed_derivation->derivation_mapping_array, distributed_derivation->interfaces_table, max_concurrent_transfers))); /* Retrieve back the build results, unless they should stay on the target machines */
+}
+
+ProcReact_bool build_pipelined(DistributedDerivation *distributed_derivation, const unsigned int max_concurrent_transfers, const unsigned int max_concurrent_builds, const unsigned int flags, char *tmpdir)
+{
+    ProcReact_bool success;
+    ProcReact_Lane distribute_lane = procreact_create_lane(max_concurrent_transfers);
+    ProcReact_Lane realise_lane = procreact_create_lane(max_concurrent_builds);
+    ProcReact_Lane retrieve_lane = procreact_create_lane(max_concurrent_transfers);
+    PipelinedBuildData data = { tmpdir, &distribute_lane, max_concurrent_builds == 0 ? NULL : &realise_lane, &retrieve_lane, flags };
+    ProcReact_PidIterator iterator = create_derivation_mapping_scheduled_pid_iterator(distributed_derivation->derivation_mapping_array, distributed_derivation->interfaces_table, build_derivation_mapping, complete_build_derivation_mapping, &data);
+
+    g_print("[coordinator]: Distributing, realising and retrieving store derivations...\n");
+
+    /*
+     * Every derivation mapping moves through the stages independently. The
+     * iterator only starts a mapping when its interface has a CPU core
+     * available, so that mappings of a busy interface never occupy the process
+     * slots of the other interfaces. The stages are bounded by their own
+     * lanes, so the amount of processes only needs to be bounded to keep
+     * every stage busy.
+     */
+    procreact_fork_and_wait_in_parallel_limit(&iterator, 2 * max_concurrent_transfers + determine_pipelined_build_limit(distributed_derivation->interfaces_table, max_concurrent_builds));
+
+    success = derivation_mapping_iterator_has_succeeded(iterator.data);
+
+    destroy_derivation_mapping_pid_iterator(&iterator);
+    procreact_destroy_lane(&distribute_lane);
+    procreact_destroy_lane(&realise_lane);
+    procreact_destroy_lane(&retrieve_lane);
+
+    return success;
 }
@@ -22,15 +22,54 @@
 #include <glib.h>
 #include <procreact_types.h>
 #include <distributedderivation.h>
+#include "buildflags.h"
+
+/**
+ * Reassigns each store derivation to the interface that is expected to finish
+ * it first. It considers the system of each interface, the amount of
+ * derivations already placed on it in relation to its CPU cores, and how many
+ * of the derivation's inputs are already present on it, according to the
+ * valid paths cache and the derivations placed before. Derivations with the
+ * largest closures are placed first.
+ *
+ * @param distributed_derivation Configuration specifying a mapping between store derivations and machines
+ * @return TRUE if every derivation could be placed, else FALSE
+ */
+ProcReact_bool place_builds(DistributedDerivation *distributed_derivation);
 
 /**
  * Delegates all store derivations to the remote machines and retrieves their build results.
+ * The derivations are realised in batches, so that Nix on each target machine
+ * can schedule the builds of all derivations mapped to it. Each interface runs
+ * at most as many batches as it has CPU cores (numOfCores).
  *
  * @param distributed_derivation Configuration specifying a mapping between store derivations and machines
  * @param max_concurrent_transfers Specifies the maximum amount of concurrent transfers
+ * @param max_concurrent_builds Specifies the maximum amount of concurrent batches across all interfaces, or 0 for no global limit
+ * @param max_batch_size Specifies the maximum amount of derivations in a batch, or 0 to realise all derivations of an interface in one batch
+ * @param flags Build option flags. FLAG_KEEP_RESULTS leaves the build results on the target machines
+ * @param tmpdir Directory in which the temp files should be stored
+ * @return TRUE if all the remote builds succeed, else FALSE
+ */
+ProcReact_bool build(DistributedDerivation *distributed_derivation, const unsigned int max_concurrent_transfers, const unsigned int max_concurrent_builds, const unsigned int max_batch_size, const unsigned int flags, char *tmpdir);
+
+/**
+ * Delegates all store derivations to the remote machines and retrieves their
+ * build results in a pipelined fashion. Rather than waiting for all
+ * derivations to be distributed before realising any of them, each derivation
+ * mapping independently moves through the distribute, realise and retrieve
+ * stages as soon as a slot in the corresponding stage is available. Each
+ * interface has at most as many derivation mappings in progress as it has CPU
+ * cores, and mappings of a busy interface are postponed in favour of the
+ * mappings of the other interfaces.
+ *
+ * @param distributed_derivation Configuration specifying a mapping between store derivations and machines
+ * @param max_concurrent_transfers Specifies the maximum amount of concurrent transfers in each of the distribute and retrieve stages
+ * @param max_concurrent_builds Specifies the maximum amount of concurrent builds across all interfaces, or 0 for no global limit
+ * @param flags Build option flags. FLAG_KEEP_RESULTS leaves the build results on the target machines
  * @param tmpdir Directory in which the temp files should be stored
  * @return TRUE if all the remote builds succeed, else FALSE
  */
-ProcReact_bool build(DistributedDerivation *distributed_derivation, const unsigned int max_concurrent_transfers, char *tmpdir);
+ProcReact_bool build_pipelined(DistributedDerivation *distributed_derivation, const unsigned int max_concurrent_transfers, const unsigned int max_concurrent_builds, const unsigned int flags, char *tmpdir);
 
 #endif
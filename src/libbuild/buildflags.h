@@ -0,0 +1,28 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __DISNIX_BUILDFLAGS_H
+#define __DISNIX_BUILDFLAGS_H
+
+#define FLAG_PIPELINE 0x1
+#define FLAG_KEEP_RESULTS 0x2
+#define FLAG_PLACE_BUILDS 0x4
+
+#endif
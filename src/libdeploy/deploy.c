@@ -1,5 +1,6 @@
 #include "deploy.h"
 #include <migrate.h>
+#include <snapshot-budget.h>
 #include "distribute.h"
 #include "activate.h"
 #include "locking.h"
@@ -58,7 +59,7 @@ static int migrate_data(Manifest *manifest, Manifest *old_manifest, const unsign
     else
     {
         g_print("[coordinator]: Migrating data...\n");
-        return migrate(manifest, old_manifest, max_concurrent_transfers, flags, keep);
+        return migrate(manifest, old_manifest, max_concurrent_transfers, flags, keep, determine_max_snapshot_bytes());
     }
 }
 
@@ -18,36 +18,350 @@
  */
 
 #include "distribute.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <remote-package-management.h>
+#include <package-management.h>
+#include <valid-paths-cache.h>
 #include <profilemapping-iterator.h>
 #include <targetstable.h>
 #include <copy-closure.h>
+#include <transferlimit.h>
+#include <procreact_future_iterator.h>
+
+typedef struct
+{
+    char *tmpdir;
+    ProcReact_Lane *bulk_lane;
+    GHashTable *requisites_table;
+    GHashTable *invalid_paths_table;
+    GHashTable *sizes_table;
+    ProcReact_AdaptiveLimit *adaptive_limit;
+}
+DistributeData;
 
 static pid_t transfer_profile_mapping_to(void *data, gchar *target_name, xmlChar *profile_path, Target *target)
 {
-    char *tmpdir = (char*)data;
-    char *paths[] = { (char*)profile_path, NULL };
+    DistributeData *distribute_data = (DistributeData*)data;
+    gchar **requisites = g_hash_table_lookup(distribute_data->requisites_table, target_name);
+    gchar **invalid_paths = g_hash_table_lookup(distribute_data->invalid_paths_table, target_name);
     gchar *target_key = find_target_key(target);
     g_print("[target: %s]: Receiving intra-dependency closure of profile: %s\n", target_name, profile_path);
-    return copy_closure_to((char*)target->client_interface, target_key, tmpdir, paths, STDERR_FILENO);
+
+    /* Reuse the requisites and invalid paths that were queried to order the transfers, if they are available */
+    if(requisites == NULL)
+    {
+        char *paths[] = { (char*)profile_path, NULL };
+        return copy_closure_to((char*)target->client_interface, target_key, distribute_data->tmpdir, paths, distribute_data->bulk_lane, STDERR_FILENO);
+    }
+    else if(invalid_paths == NULL)
+        return copy_requisites_to((char*)target->client_interface, target_key, distribute_data->tmpdir, requisites, distribute_data->bulk_lane, STDERR_FILENO);
+    else
+        return copy_invalid_requisites_to((char*)target->client_interface, target_key, distribute_data->tmpdir, requisites, invalid_paths, distribute_data->bulk_lane, STDERR_FILENO);
 }
 
 static void complete_transfer_profile_mapping_to(void *data, gchar *target_name, xmlChar *profile_path, Target *target, ProcReact_Status status, int result)
 {
+    DistributeData *distribute_data = (DistributeData*)data;
+
     if(status != PROCREACT_STATUS_OK || !result)
         g_printerr("[target: %s]: Cannot receive intra-dependency closure of profile: %s\n", target_name, profile_path);
+    else if(distribute_data->adaptive_limit != NULL)
+    {
+        /* Let the adaptive concurrency controller measure the throughput in bytes */
+        guint64 *size = (guint64*)g_hash_table_lookup(distribute_data->sizes_table, target_name);
+
+        if(size != NULL)
+            procreact_adaptive_limit_add_units(distribute_data->adaptive_limit, *size);
+    }
+}
+
+/* Closure requisites infrastructure */
+
+typedef struct
+{
+    GHashTable *profile_mapping_table;
+    GPtrArray *target_names;
+    unsigned int index;
+    GHashTable *pids_table;
+    GHashTable *requisites_table;
+}
+QueryRequisitesData;
+
+static ProcReact_bool has_next_profile_mapping(void *data)
+{
+    QueryRequisitesData *query_data = (QueryRequisitesData*)data;
+    return query_data->index < query_data->target_names->len;
+}
+
+static ProcReact_Future query_profile_requisites(void *data)
+{
+    QueryRequisitesData *query_data = (QueryRequisitesData*)data;
+    gchar *target_name = g_ptr_array_index(query_data->target_names, query_data->index);
+    char *paths[] = { g_hash_table_lookup(query_data->profile_mapping_table, target_name), NULL };
+    ProcReact_Future future = pkgmgmt_query_requisites(paths, 1, STDERR_FILENO);
+
+    g_hash_table_insert(query_data->pids_table, GINT_TO_POINTER(future.pid), target_name);
+    query_data->index++;
+    return future;
+}
+
+static void complete_query_profile_requisites(void *data, ProcReact_Future *future, ProcReact_Status status)
+{
+    QueryRequisitesData *query_data = (QueryRequisitesData*)data;
+    gchar *target_name = g_hash_table_lookup(query_data->pids_table, GINT_TO_POINTER(future->pid));
+
+    if(status == PROCREACT_STATUS_OK && future->result != NULL)
+        g_hash_table_insert(query_data->requisites_table, target_name, future->result);
+    else
+        g_printerr("[target: %s]: Cannot query the requisites of profile: %s\n", target_name, (gchar*)g_hash_table_lookup(query_data->profile_mapping_table, target_name));
+}
+
+static GHashTable *query_requisites_of_profiles(GHashTable *profile_mapping_table, GPtrArray *target_names)
+{
+    GHashTable *requisites_table = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)procreact_free_string_array);
+    QueryRequisitesData data = { profile_mapping_table, target_names, 0, g_hash_table_new(g_direct_hash, g_direct_equal), requisites_table };
+    ProcReact_FutureIterator iterator = procreact_initialize_future_iterator(has_next_profile_mapping, query_profile_requisites, complete_query_profile_requisites, &data);
+
+    /* The queries are local, so we run as many as we have cores */
+    procreact_fork_buffer_and_wait_in_parallel_limit(&iterator, sysconf(_SC_NPROCESSORS_ONLN));
+
+    procreact_destroy_future_iterator(&iterator);
+    g_hash_table_destroy(data.pids_table);
+    return requisites_table;
+}
+
+/* Transfer ordering infrastructure */
+
+static gint compare_estimated_sizes(gconstpointer l, gconstpointer r, gpointer user_data)
+{
+    GHashTable *sizes_table = (GHashTable*)user_data;
+    const gchar *left = *((const gchar **)l);
+    const gchar *right = *((const gchar **)r);
+    guint64 *left_size = (guint64*)g_hash_table_lookup(sizes_table, left);
+    guint64 *right_size = (guint64*)g_hash_table_lookup(sizes_table, right);
+    guint64 left_value = (left_size == NULL) ? 0 : *left_size;
+    guint64 right_value = (right_size == NULL) ? 0 : *right_size;
+
+    if(left_value > right_value)
+        return -1;
+    else if(left_value < right_value)
+        return 1;
+    else
+        return g_strcmp0(left, right);
+}
+
+static gchar **select_unknown_requisites(Target *target, gchar **requisites)
+{
+    unsigned int requisites_length = g_strv_length(requisites);
+    ValidPathsCache *cache = open_valid_paths_cache((char*)target->client_interface, find_target_key(target));
+
+    /* Paths that are known to be valid on the target will not be transferred */
+    if(cache == NULL)
+    {
+        gchar **unknown_paths = (gchar**)g_malloc((requisites_length + 1) * sizeof(gchar*));
+        memcpy(unknown_paths, requisites, (requisites_length + 1) * sizeof(gchar*));
+        return unknown_paths;
+    }
+    else
+    {
+        gchar **unknown_paths = subtract_known_valid_paths(cache, requisites, requisites_length);
+        delete_valid_paths_cache(cache);
+        return unknown_paths;
+    }
+}
+
+/* Invalid paths infrastructure */
+
+typedef struct
+{
+    GHashTable *requisites_table;
+    GHashTable *targets_table;
+    GPtrArray *target_names;
+    unsigned int index;
+    GHashTable *pids_table;
+    GHashTable *invalid_paths_table;
+}
+QueryInvalidPathsData;
+
+static ProcReact_bool has_next_target_with_unknown_paths(void *data)
+{
+    QueryInvalidPathsData *query_data = (QueryInvalidPathsData*)data;
+    return query_data->index < query_data->target_names->len;
+}
+
+static ProcReact_Future query_invalid_requisites(void *data)
+{
+    QueryInvalidPathsData *query_data = (QueryInvalidPathsData*)data;
+    gchar *target_name = g_ptr_array_index(query_data->target_names, query_data->index);
+    Target *target = g_hash_table_lookup(query_data->targets_table, target_name);
+    gchar **unknown_paths = select_unknown_requisites(target, g_hash_table_lookup(query_data->requisites_table, target_name));
+    ProcReact_Future future = pkgmgmt_remote_print_invalid((char*)target->client_interface, find_target_key(target), unknown_paths, g_strv_length(unknown_paths));
+
+    g_free(unknown_paths); /* Only the child process uses the paths */
+    g_hash_table_insert(query_data->pids_table, GINT_TO_POINTER(future.pid), target_name);
+    query_data->index++;
+    return future;
+}
+
+static void complete_query_invalid_requisites(void *data, ProcReact_Future *future, ProcReact_Status status)
+{
+    QueryInvalidPathsData *query_data = (QueryInvalidPathsData*)data;
+    gchar *target_name = g_hash_table_lookup(query_data->pids_table, GINT_TO_POINTER(future->pid));
+
+    /* If the query fails, the transfer queries the invalid paths again and reports the error */
+    if(status == PROCREACT_STATUS_OK && future->result != NULL)
+        g_hash_table_insert(query_data->invalid_paths_table, target_name, future->result);
+}
+
+static GHashTable *query_invalid_requisites_of_profiles(GHashTable *requisites_table, GHashTable *targets_table, const unsigned int max_concurrent_transfers)
+{
+    GHashTable *invalid_paths_table = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)procreact_free_string_array);
+    QueryInvalidPathsData data = { requisites_table, targets_table, g_ptr_array_new(), 0, g_hash_table_new(g_direct_hash, g_direct_equal), invalid_paths_table };
+    ProcReact_FutureIterator iterator;
+    GHashTableIter iter;
+    gpointer key, value;
+
+    /* Only query the targets that have paths of which the validity is unknown */
+    g_hash_table_iter_init(&iter, requisites_table);
+    while(g_hash_table_iter_next(&iter, &key, &value))
+    {
+        Target *target = g_hash_table_lookup(targets_table, key);
+        gchar **unknown_paths = select_unknown_requisites(target, (gchar**)value);
+
+        if(unknown_paths[0] == NULL)
+            g_hash_table_insert(invalid_paths_table, key, calloc(1, sizeof(char*)));
+        else
+            g_ptr_array_add(data.target_names, key);
+
+        g_free(unknown_paths);
+    }
+
+    iterator = procreact_initialize_future_iterator(has_next_target_with_unknown_paths, query_invalid_requisites, complete_query_invalid_requisites, &data);
+    procreact_fork_buffer_and_wait_in_parallel_limit(&iterator, max_concurrent_transfers);
+
+    procreact_destroy_future_iterator(&iterator);
+    g_hash_table_destroy(data.pids_table);
+    g_ptr_array_free(data.target_names, TRUE);
+    return invalid_paths_table;
+}
+
+static GHashTable *estimate_transfer_sizes(GHashTable *invalid_paths_table)
+{
+    GHashTable *sizes_table = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+    GHashTable *nar_sizes_table = g_hash_table_new(g_str_hash, g_str_equal);
+    GPtrArray *paths_array = g_ptr_array_new();
+    char **nar_sizes;
+    GHashTableIter iter;
+    gpointer key, value;
+
+    /* Collect the paths that must be transferred to each target */
+    g_hash_table_iter_init(&iter, invalid_paths_table);
+    while(g_hash_table_iter_next(&iter, &key, &value))
+    {
+        gchar **invalid_paths = (gchar**)value;
+        unsigned int i;
+
+        for(i = 0; invalid_paths[i] != NULL; i++)
+        {
+            if(!g_hash_table_contains(nar_sizes_table, invalid_paths[i]))
+            {
+                g_hash_table_insert(nar_sizes_table, invalid_paths[i], NULL);
+                g_ptr_array_add(paths_array, invalid_paths[i]);
+            }
+        }
+    }
+
+    /* Query the NAR sizes of the paths of all targets in one go, since many targets share the same paths */
+    if(paths_array->len == 0)
+        nar_sizes = NULL;
+    else
+        nar_sizes = pkgmgmt_query_nar_sizes_sync((gchar**)paths_array->pdata, paths_array->len, STDERR_FILENO);
+
+    if(nar_sizes != NULL)
+    {
+        unsigned int i;
+
+        for(i = 0; i < paths_array->len && nar_sizes[i] != NULL; i++)
+            g_hash_table_insert(nar_sizes_table, g_ptr_array_index(paths_array, i), nar_sizes[i]);
+    }
+
+    /* Sum the NAR sizes of the paths of each target */
+    g_hash_table_iter_init(&iter, invalid_paths_table);
+    while(g_hash_table_iter_next(&iter, &key, &value))
+    {
+        gchar **invalid_paths = (gchar**)value;
+        guint64 *size = (guint64*)g_malloc(sizeof(guint64));
+        unsigned int i;
+
+        *size = 0;
+
+        for(i = 0; invalid_paths[i] != NULL; i++)
+        {
+            gchar *nar_size = g_hash_table_lookup(nar_sizes_table, invalid_paths[i]);
+
+            if(nar_size != NULL)
+                *size += g_ascii_strtoull(nar_size, NULL, 10);
+        }
+
+        g_hash_table_insert(sizes_table, key, size);
+    }
+
+    procreact_free_string_array(nar_sizes);
+    g_ptr_array_free(paths_array, TRUE);
+    g_hash_table_destroy(nar_sizes_table);
+    return sizes_table;
+}
+
+static GPtrArray *create_target_names_array(GHashTable *profile_mapping_table)
+{
+    GPtrArray *target_names = g_ptr_array_new();
+    GHashTableIter iter;
+    gpointer key;
+
+    g_hash_table_iter_init(&iter, profile_mapping_table);
+    while(g_hash_table_iter_next(&iter, &key, NULL))
+        g_ptr_array_add(target_names, key);
+
+    return target_names;
 }
 
 ProcReact_bool distribute(const Manifest *manifest, const unsigned int max_concurrent_transfers, char *tmpdir)
 {
-    /* Iterate over the profile mappings, limiting concurrency to the desired concurrent transfers and distribute them */
+    /* Query the requisites of all profiles and the paths that the targets are missing in parallel, and estimate the sizes of the transfers */
+    GPtrArray *target_names = create_target_names_array(manifest->profile_mapping_table);
+    GHashTable *requisites_table = query_requisites_of_profiles(manifest->profile_mapping_table, target_names);
+    GHashTable *invalid_paths_table = query_invalid_requisites_of_profiles(requisites_table, manifest->targets_table, max_concurrent_transfers);
+    GHashTable *sizes_table = estimate_transfer_sizes(invalid_paths_table);
+
     ProcReact_bool success;
-    ProcReact_PidIterator iterator = create_profile_mapping_iterator(manifest->profile_mapping_table, manifest->targets_table, transfer_profile_mapping_to, complete_transfer_profile_mapping_to, tmpdir);
-    procreact_fork_and_wait_in_parallel_limit(&iterator, max_concurrent_transfers);
+    ProcReact_Lane bulk_lane;
+    DistributeData data;
+    ProcReact_PidIterator iterator;
+
+    /* Start the largest transfers first so that they do not determine the tail of the distribution phase */
+    g_ptr_array_sort_with_data(target_names, compare_estimated_sizes, sizes_table);
+
+    /* Iterate over the profile mappings, limiting concurrency to the desired concurrent transfers and distribute them */
+    bulk_lane = create_bulk_transfer_lane(max_concurrent_transfers);
+    data.tmpdir = tmpdir;
+    data.bulk_lane = &bulk_lane;
+    data.requisites_table = requisites_table;
+    data.invalid_paths_table = invalid_paths_table;
+    data.sizes_table = sizes_table;
+    data.adaptive_limit = NULL;
+    iterator = create_ordered_profile_mapping_iterator(manifest->profile_mapping_table, manifest->targets_table, target_names, transfer_profile_mapping_to, complete_transfer_profile_mapping_to, &data);
+    fork_and_wait_for_measured_transfers(&iterator, max_concurrent_transfers, &bulk_lane, &data.adaptive_limit, "distribution");
     success = profile_mapping_iterator_has_succeeded(&iterator);
 
     /* Delete resources */
     destroy_profile_mapping_iterator(&iterator);
+    procreact_destroy_lane(&bulk_lane);
+    g_ptr_array_free(target_names, TRUE);
+    g_hash_table_destroy(sizes_table);
+    g_hash_table_destroy(invalid_paths_table);
+    g_hash_table_destroy(requisites_table);
 
     /* Return status */
     return success;
@@ -24,7 +24,9 @@
 
 /**
  * Distributes the Nix store closures of all services in the manifest to the
- * target machines in the network.
+ * target machines in the network. The paths that each target is missing are
+ * queried up front, the transfers are estimated by the NAR sizes of these
+ * paths, and the largest ones are transferred first.
  *
  * @param manifest Manifest containing all deployment information
  * @param max_concurrent_transfers Specifies the maximum amount of concurrent transfers
@@ -0,0 +1,149 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "buildplacement.h"
+#include <string.h>
+#include "interface.h"
+
+static void delete_build_placement_target(gpointer data)
+{
+    BuildPlacementTarget *target = (BuildPlacementTarget*)data;
+    g_hash_table_destroy(target->present_paths_table);
+    g_free(target);
+}
+
+GHashTable *create_build_placement_table(GHashTable *interfaces_table)
+{
+    GHashTable *placement_table = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, delete_build_placement_target);
+    GHashTableIter iter;
+    gpointer key;
+
+    g_hash_table_iter_init(&iter, interfaces_table);
+    while(g_hash_table_iter_next(&iter, &key, NULL))
+    {
+        BuildPlacementTarget *target = (BuildPlacementTarget*)g_malloc(sizeof(BuildPlacementTarget));
+        target->present_paths_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        target->queue_depth = 0;
+        g_hash_table_insert(placement_table, key, target);
+    }
+
+    return placement_table;
+}
+
+void delete_build_placement_table(GHashTable *placement_table)
+{
+    g_hash_table_destroy(placement_table);
+}
+
+void add_present_path_to_build_placement(GHashTable *placement_table, const gchar *interface_name, const gchar *path)
+{
+    BuildPlacementTarget *target = g_hash_table_lookup(placement_table, interface_name);
+
+    if(target != NULL)
+        g_hash_table_add(target->present_paths_table, g_strdup(path));
+}
+
+static NixXML_bool is_compatible_interface(const Interface *interface, const gchar *system)
+{
+    /* An unknown system is compatible with everything, for build models that do not specify systems */
+    return (system == NULL || interface->system == NULL || strcmp(interface->system, system) == 0);
+}
+
+static double estimate_placement_cost(const BuildPlacementTarget *target, const Interface *interface, gchar **inputs, const unsigned int inputs_length)
+{
+    unsigned int i, missing = 0;
+    double rounds = (double)(target->queue_depth + 1) / interface->num_of_cores;
+
+    if(inputs_length == 0)
+        return rounds;
+
+    for(i = 0; i < inputs_length; i++)
+    {
+        if(!g_hash_table_contains(target->present_paths_table, inputs[i]))
+            missing++;
+    }
+
+    return rounds + (double)missing / inputs_length;
+}
+
+static NixXML_bool is_preferred_interface(const gchar *interface_name, const gchar *best_interface_name, const xmlChar *original_interface_name)
+{
+    if(xmlStrcmp((xmlChar*)interface_name, original_interface_name) == 0)
+        return TRUE;
+    else if(xmlStrcmp((xmlChar*)best_interface_name, original_interface_name) == 0)
+        return FALSE;
+    else
+        return (strcmp(interface_name, best_interface_name) < 0); /* Resolve remaining ties deterministically */
+}
+
+NixXML_bool place_derivation_mapping(GHashTable *placement_table, GHashTable *interfaces_table, DerivationMapping *mapping, gchar **inputs)
+{
+    Interface *original_interface = g_hash_table_lookup(interfaces_table, (gchar*)mapping->interface);
+    gchar *system = (original_interface == NULL) ? NULL : original_interface->system;
+    unsigned int inputs_length = (inputs == NULL) ? 0 : g_strv_length(inputs);
+    gchar *best_interface_name = NULL;
+    double best_cost = 0;
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_hash_table_iter_init(&iter, interfaces_table);
+    while(g_hash_table_iter_next(&iter, &key, &value))
+    {
+        gchar *interface_name = (gchar*)key;
+        Interface *interface = (Interface*)value;
+
+        if(is_compatible_interface(interface, system))
+        {
+            BuildPlacementTarget *target = g_hash_table_lookup(placement_table, interface_name);
+            double cost = estimate_placement_cost(target, interface, inputs, inputs_length);
+
+            if(best_interface_name == NULL || cost < best_cost || (cost == best_cost && is_preferred_interface(interface_name, best_interface_name, mapping->interface)))
+            {
+                best_interface_name = interface_name;
+                best_cost = cost;
+            }
+        }
+    }
+
+    if(best_interface_name == NULL)
+    {
+        g_printerr("[coordinator]: No interface is compatible with system: %s of store derivation: %s\n", system, mapping->derivation);
+        return FALSE;
+    }
+    else
+    {
+        BuildPlacementTarget *target = g_hash_table_lookup(placement_table, best_interface_name);
+        unsigned int i;
+
+        for(i = 0; i < inputs_length; i++)
+            g_hash_table_add(target->present_paths_table, g_strdup(inputs[i]));
+
+        target->queue_depth++;
+
+        if(xmlStrcmp((xmlChar*)best_interface_name, mapping->interface) != 0)
+        {
+            g_print("[coordinator]: Placing store derivation: %s on interface: %s instead of: %s\n", mapping->derivation, best_interface_name, mapping->interface);
+            xmlFree(mapping->interface);
+            mapping->interface = xmlStrdup((xmlChar*)best_interface_name);
+        }
+
+        return TRUE;
+    }
+}
@@ -0,0 +1,85 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __DISNIX_BUILDPLACEMENT_H
+#define __DISNIX_BUILDPLACEMENT_H
+#include <glib.h>
+#include <nixxml-types.h>
+#include "derivationmapping.h"
+
+/**
+ * @brief Tracks the state of a target machine while derivations are placed on it
+ */
+typedef struct
+{
+    /** Hash table used as a set of Nix store paths that are (or will be) present on the target machine */
+    GHashTable *present_paths_table;
+    /** Amount of derivations that have been placed on the target machine */
+    unsigned int queue_depth;
+}
+BuildPlacementTarget;
+
+/**
+ * Creates a build placement table that tracks the state of each interface
+ * while derivations are placed. Initially, no paths are known to be present
+ * and all queues are empty.
+ *
+ * @param interfaces_table Hash table with interfaces
+ * @return A hash table mapping interface names to build placement targets. It should be removed from memory with delete_build_placement_table()
+ */
+GHashTable *create_build_placement_table(GHashTable *interfaces_table);
+
+/**
+ * Deletes a build placement table from heap memory.
+ *
+ * @param placement_table A build placement table
+ */
+void delete_build_placement_table(GHashTable *placement_table);
+
+/**
+ * Records that a Nix store path is present on the target machine of an interface.
+ *
+ * @param placement_table A build placement table
+ * @param interface_name Name of the interface
+ * @param path A Nix store path
+ */
+void add_present_path_to_build_placement(GHashTable *placement_table, const gchar *interface_name, const gchar *path);
+
+/**
+ * Assigns a derivation mapping to the interface that is expected to finish it
+ * first. Only interfaces having the same system as the interface that the
+ * derivation was originally mapped to are considered. The cost of an interface
+ * is the amount of build rounds its queue needs per CPU core, plus the
+ * fraction of the derivation's inputs that are not yet present on it (so that
+ * transferring all inputs weighs as much as one build round). Ties are
+ * resolved in favour of the original interface.
+ *
+ * After placement, the inputs are recorded as present on the chosen interface,
+ * because distributing the derivation copies them, and its queue grows by one.
+ *
+ * @param placement_table A build placement table
+ * @param interfaces_table Hash table with interfaces
+ * @param mapping A derivation mapping of which the interface may be changed
+ * @param inputs NULL-terminated array with the requisites of the store derivation
+ * @return TRUE if a compatible interface was found, else FALSE
+ */
+NixXML_bool place_derivation_mapping(GHashTable *placement_table, GHashTable *interfaces_table, DerivationMapping *mapping, gchar **inputs);
+
+#endif
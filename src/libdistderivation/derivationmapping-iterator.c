@@ -55,6 +55,47 @@ static void complete_derivation_mapping_process(void *data, pid_t pid, ProcReact
     derivation_mapping_iterator_data->complete_derivation_mapping_function.pid(derivation_mapping_iterator_data->data, mapping, status, result);
 }
 
+static xmlChar *get_derivation_mapping_interface(gpointer element)
+{
+    DerivationMapping *mapping = (DerivationMapping*)element;
+    return mapping->interface;
+}
+
+static int has_next_scheduled_derivation_mapping(void *data)
+{
+    DerivationMappingIteratorData *derivation_mapping_iterator_data = (DerivationMappingIteratorData*)data;
+    return schedule_next_on_available_interface(derivation_mapping_iterator_data->scheduled_mapping_array, derivation_mapping_iterator_data->model_iterator_data.index, derivation_mapping_iterator_data->interfaces_table, get_derivation_mapping_interface);
+}
+
+static pid_t next_scheduled_derivation_mapping_process(void *data)
+{
+    DerivationMappingIteratorData *derivation_mapping_iterator_data = (DerivationMappingIteratorData*)data;
+    DerivationMapping *mapping = g_ptr_array_index(derivation_mapping_iterator_data->scheduled_mapping_array, derivation_mapping_iterator_data->model_iterator_data.index);
+    Interface *interface = g_hash_table_lookup(derivation_mapping_iterator_data->interfaces_table, (gchar*)mapping->interface);
+
+    /* Allocate a CPU core and invoke the next derivation mapping operation process */
+    request_available_interface_core(interface);
+    return next_derivation_mapping_process(data);
+}
+
+static void complete_scheduled_derivation_mapping_process(void *data, pid_t pid, ProcReact_Status status, int result)
+{
+    DerivationMappingIteratorData *derivation_mapping_iterator_data = (DerivationMappingIteratorData*)data;
+
+    /* Retrieve the completed mapping */
+    DerivationMapping *mapping = complete_iteration_process(&derivation_mapping_iterator_data->model_iterator_data, pid, status, result);
+
+    /* Invoke callback that handles the completion of derivation mapping */
+    derivation_mapping_iterator_data->complete_derivation_mapping_function.pid(derivation_mapping_iterator_data->data, mapping, status, result);
+
+    /* Signal the interface to make the CPU core available again */
+    if(mapping != NULL)
+    {
+        Interface *interface = g_hash_table_lookup(derivation_mapping_iterator_data->interfaces_table, (gchar*)mapping->interface);
+        signal_available_interface_core(interface);
+    }
+}
+
 static DerivationMappingIteratorData *create_common_iterator(const GPtrArray *derivation_mapping_array, GHashTable *interfaces_table, void *data)
 {
     DerivationMappingIteratorData *derivation_mapping_iterator_data = (DerivationMappingIteratorData*)g_malloc(sizeof(DerivationMappingIteratorData));
@@ -62,6 +103,7 @@ static DerivationMappingIteratorData *create_common_iterator(const GPtrArray *de
     init_model_iterator_data(&derivation_mapping_iterator_data->model_iterator_data, derivation_mapping_array->len);
     derivation_mapping_iterator_data->derivation_mapping_array = derivation_mapping_array;
     derivation_mapping_iterator_data->interfaces_table = interfaces_table;
+    derivation_mapping_iterator_data->scheduled_mapping_array = NULL;
     derivation_mapping_iterator_data->data = data;
 
     return derivation_mapping_iterator_data;
@@ -76,6 +118,24 @@ ProcReact_PidIterator create_derivation_mapping_pid_iterator(const GPtrArray *de
     return procreact_initialize_pid_iterator(has_next_derivation_mapping, next_derivation_mapping_process, procreact_retrieve_boolean, complete_derivation_mapping_process, derivation_mapping_iterator_data);
 }
 
+ProcReact_PidIterator create_derivation_mapping_scheduled_pid_iterator(const GPtrArray *derivation_mapping_array, GHashTable *interfaces_table, map_derivation_mapping_pid_function map_derivation_mapping, complete_derivation_mapping_pid_function complete_derivation_mapping, void *data)
+{
+    GPtrArray *scheduled_mapping_array = g_ptr_array_sized_new(derivation_mapping_array->len);
+    DerivationMappingIteratorData *derivation_mapping_iterator_data;
+    unsigned int i;
+
+    /* Make a copy of the mappings that we can reorder when mappings must be postponed */
+    for(i = 0; i < derivation_mapping_array->len; i++)
+        g_ptr_array_add(scheduled_mapping_array, g_ptr_array_index(derivation_mapping_array, i));
+
+    derivation_mapping_iterator_data = create_common_iterator(scheduled_mapping_array, interfaces_table, data);
+    derivation_mapping_iterator_data->scheduled_mapping_array = scheduled_mapping_array;
+    derivation_mapping_iterator_data->map_derivation_mapping_function.pid = map_derivation_mapping;
+    derivation_mapping_iterator_data->complete_derivation_mapping_function.pid = complete_derivation_mapping;
+
+    return procreact_initialize_pid_iterator(has_next_scheduled_derivation_mapping, next_scheduled_derivation_mapping_process, procreact_retrieve_boolean, complete_scheduled_derivation_mapping_process, derivation_mapping_iterator_data);
+}
+
 static ProcReact_Future next_derivation_mapping_future(void *data)
 {
     /* Declarations */
@@ -118,6 +178,10 @@ ProcReact_FutureIterator create_derivation_mapping_future_iterator(const GPtrArr
 static void destroy_derivation_mapping_iterator_data(DerivationMappingIteratorData *derivation_mapping_iterator_data)
 {
     destroy_model_iterator_data(&derivation_mapping_iterator_data->model_iterator_data);
+
+    if(derivation_mapping_iterator_data->scheduled_mapping_array != NULL)
+        g_ptr_array_free(derivation_mapping_iterator_data->scheduled_mapping_array, TRUE);
+
     g_free(derivation_mapping_iterator_data);
 }
 
@@ -78,6 +78,8 @@ typedef struct
     const GPtrArray *derivation_mapping_array;
     /** Hash table with interfaces */
     GHashTable *interfaces_table;
+    /** Array with derivation mappings in the order in which they are started, or NULL if they are started in their original order */
+    GPtrArray *scheduled_mapping_array;
 
     /** Function that maps over each mapping in the derivation mapping array */
     union
@@ -117,6 +119,24 @@ DerivationMappingIteratorData;
  */
 ProcReact_PidIterator create_derivation_mapping_pid_iterator(const GPtrArray *derivation_mapping_array, GHashTable *interfaces_table, map_derivation_mapping_pid_function map_derivation_mapping, complete_derivation_mapping_pid_function complete_derivation_mapping, void *data);
 
+/**
+ * Creates a new PID iterator that steps over each derivation mapping and
+ * interface and executes the provided functions on start and completion. A
+ * process is only started for a mapping if its interface has a CPU core
+ * available, which the process occupies until it completes. Mappings of
+ * interfaces that have no cores available are postponed until a process for
+ * the same interface completes, so that a busy interface does not hold back
+ * the mappings of the other interfaces.
+ *
+ * @param derivation_mapping_array Array with derivation mappings
+ * @param interfaces_table Hash table with interfaces
+ * @param map_derivation_mapping Pointer to a function that executes an operation for each derivation mapping
+ * @param complete_derivation_mapping Pointer to a function that gets executed when a process completes for a derivation mapping
+ * @param data Pointer to arbitrary data passed to the above functions
+ * @return A PID iterator that can be used to traverse the derivation mappings
+ */
+ProcReact_PidIterator create_derivation_mapping_scheduled_pid_iterator(const GPtrArray *derivation_mapping_array, GHashTable *interfaces_table, map_derivation_mapping_pid_function map_derivation_mapping, complete_derivation_mapping_pid_function complete_derivation_mapping, void *data);
+
 /**
  * Creates a new future iterator that steps over each derivation mapping and
  * interface and executes the provided functions on start and completion.
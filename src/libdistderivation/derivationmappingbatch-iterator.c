@@ -0,0 +1,110 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "derivationmappingbatch-iterator.h"
+
+static xmlChar *get_derivation_mapping_batch_interface(gpointer element)
+{
+    DerivationMappingBatch *batch = (DerivationMappingBatch*)element;
+    return batch->interface;
+}
+
+static int has_next_derivation_mapping_batch(void *data)
+{
+    DerivationMappingBatchIteratorData *iterator_data = (DerivationMappingBatchIteratorData*)data;
+    return schedule_next_on_available_interface(iterator_data->scheduled_batch_array, iterator_data->model_iterator_data.index, iterator_data->interfaces_table, get_derivation_mapping_batch_interface);
+}
+
+static ProcReact_Future next_derivation_mapping_batch_future(void *data)
+{
+    /* Declarations */
+    DerivationMappingBatchIteratorData *iterator_data = (DerivationMappingBatchIteratorData*)data;
+
+    /* Retrieve batch, interface pair */
+    DerivationMappingBatch *batch = g_ptr_array_index(iterator_data->scheduled_batch_array, iterator_data->model_iterator_data.index);
+    Interface *interface = g_hash_table_lookup(iterator_data->interfaces_table, (gchar*)batch->interface);
+
+    /* Allocate a CPU core and invoke the next batch operation process */
+    ProcReact_Future future;
+    request_available_interface_core(interface);
+    future = iterator_data->map_derivation_mapping_batch(iterator_data->data, batch, interface);
+
+    /* Increase the iterator and update the pid table */
+    next_iteration_future(&iterator_data->model_iterator_data, &future, batch);
+
+    /* Return the future of the invoked process */
+    return future;
+}
+
+static void complete_derivation_mapping_batch_future(void *data, ProcReact_Future *future, ProcReact_Status status)
+{
+    DerivationMappingBatchIteratorData *iterator_data = (DerivationMappingBatchIteratorData*)data;
+
+    /* Retrieve the completed batch */
+    DerivationMappingBatch *batch = complete_iteration_future(&iterator_data->model_iterator_data, future, status);
+
+    if(batch != NULL)
+    {
+        Interface *interface = g_hash_table_lookup(iterator_data->interfaces_table, (gchar*)batch->interface);
+
+        /* Invoke callback that handles the completion of the batch */
+        iterator_data->complete_derivation_mapping_batch(iterator_data->data, batch, future, status);
+
+        /* Signal the interface to make the CPU core available again */
+        signal_available_interface_core(interface);
+    }
+}
+
+ProcReact_FutureIterator create_derivation_mapping_batch_future_iterator(const GPtrArray *batch_array, GHashTable *interfaces_table, map_derivation_mapping_batch_function map_derivation_mapping_batch, complete_derivation_mapping_batch_function complete_derivation_mapping_batch, void *data)
+{
+    DerivationMappingBatchIteratorData *iterator_data = (DerivationMappingBatchIteratorData*)g_malloc(sizeof(DerivationMappingBatchIteratorData));
+    unsigned int i;
+
+    init_model_iterator_data(&iterator_data->model_iterator_data, batch_array->len);
+
+    /* Make a copy of the batches that we can reorder when batches must be postponed */
+    iterator_data->scheduled_batch_array = g_ptr_array_sized_new(batch_array->len);
+
+    for(i = 0; i < batch_array->len; i++)
+        g_ptr_array_add(iterator_data->scheduled_batch_array, g_ptr_array_index(batch_array, i));
+
+    iterator_data->interfaces_table = interfaces_table;
+    iterator_data->map_derivation_mapping_batch = map_derivation_mapping_batch;
+    iterator_data->complete_derivation_mapping_batch = complete_derivation_mapping_batch;
+    iterator_data->data = data;
+
+    return procreact_initialize_future_iterator(has_next_derivation_mapping_batch, next_derivation_mapping_batch_future, complete_derivation_mapping_batch_future, iterator_data);
+}
+
+void destroy_derivation_mapping_batch_future_iterator(ProcReact_FutureIterator *iterator)
+{
+    DerivationMappingBatchIteratorData *iterator_data = (DerivationMappingBatchIteratorData*)iterator->data;
+
+    destroy_model_iterator_data(&iterator_data->model_iterator_data);
+    g_ptr_array_free(iterator_data->scheduled_batch_array, TRUE);
+    g_free(iterator_data);
+
+    procreact_destroy_future_iterator(iterator);
+}
+
+ProcReact_bool derivation_mapping_batch_iterator_has_succeeded(const DerivationMappingBatchIteratorData *derivation_mapping_batch_iterator_data)
+{
+    return derivation_mapping_batch_iterator_data->model_iterator_data.success;
+}
@@ -0,0 +1,105 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __DISNIX_DERIVATIONMAPPINGBATCH_ITERATOR_H
+#define __DISNIX_DERIVATIONMAPPINGBATCH_ITERATOR_H
+#include <procreact_future_iterator.h>
+#include <modeliterator.h>
+#include "derivationmappingbatch.h"
+#include "interfacestable.h"
+
+/**
+ * Pointer to a function that constructs a future for each derivation mapping batch
+ *
+ * @param data An arbitrary data structure
+ * @param batch A batch of derivation mappings that share the same interface
+ * @param interface The corresponding interface of the batch
+ * @return A future instance
+ */
+typedef ProcReact_Future (*map_derivation_mapping_batch_function) (void *data, DerivationMappingBatch *batch, Interface *interface);
+
+/**
+ * Pointer to a function that gets executed when a future completes for a
+ * derivation mapping batch.
+ *
+ * @param data An arbitrary data structure
+ * @param batch A batch of derivation mappings that share the same interface
+ * @param future The future that has completed
+ * @param status Indicates whether the process terminated abnormally or not
+ */
+typedef void (*complete_derivation_mapping_batch_function) (void *data, DerivationMappingBatch *batch, ProcReact_Future *future, ProcReact_Status status);
+
+/**
+ * @brief Iterator that can be used to construct a future for each derivation mapping batch
+ */
+typedef struct
+{
+    /** Common properties for all model iterators */
+    ModelIteratorData model_iterator_data;
+    /** Array with derivation mapping batches in the order in which they are started */
+    GPtrArray *scheduled_batch_array;
+    /** Hash table with interfaces */
+    GHashTable *interfaces_table;
+    /** Pointer to a function that constructs a future for each batch */
+    map_derivation_mapping_batch_function map_derivation_mapping_batch;
+    /** Pointer to a function that gets executed when a future completes for a batch */
+    complete_derivation_mapping_batch_function complete_derivation_mapping_batch;
+    /** Pointer to arbitrary data passed to the above functions */
+    void *data;
+}
+DerivationMappingBatchIteratorData;
+
+/**
+ * Creates a new future iterator that steps over each derivation mapping batch
+ * and executes the provided functions on start and completion. A future is
+ * only started for a batch if its interface has a CPU core available. Batches
+ * of interfaces that have no cores available are postponed until a future for
+ * the same interface completes.
+ *
+ * Because the iterator may temporarily have no next element while there are
+ * batches remaining, it should be used with
+ * procreact_fork_buffer_and_wait_in_parallel_limit().
+ *
+ * @param batch_array Array with derivation mapping batches
+ * @param interfaces_table Hash table with interfaces
+ * @param map_derivation_mapping_batch Pointer to a function that constructs a future for each batch
+ * @param complete_derivation_mapping_batch Pointer to a function that gets executed when a future completes for a batch
+ * @param data Pointer to arbitrary data passed to the above functions
+ * @return A future iterator that can be used to traverse the derivation mapping batches
+ */
+ProcReact_FutureIterator create_derivation_mapping_batch_future_iterator(const GPtrArray *batch_array, GHashTable *interfaces_table, map_derivation_mapping_batch_function map_derivation_mapping_batch, complete_derivation_mapping_batch_function complete_derivation_mapping_batch, void *data);
+
+/**
+ * Destroys all resources allocated with the provided derivation mapping batch
+ * future iterator
+ *
+ * @param iterator A derivation mapping batch future iterator instance
+ */
+void destroy_derivation_mapping_batch_future_iterator(ProcReact_FutureIterator *iterator);
+
+/**
+ * Checks whether all the futures of the batches have succeeded.
+ *
+ * @param derivation_mapping_batch_iterator_data Derivation mapping batch iterator data
+ * @return TRUE if all futures succeeded, else FALSE
+ */
+ProcReact_bool derivation_mapping_batch_iterator_has_succeeded(const DerivationMappingBatchIteratorData *derivation_mapping_batch_iterator_data);
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "derivationmappingbatch.h"
+
+static DerivationMappingBatch *create_derivation_mapping_batch(xmlChar *interface)
+{
+    DerivationMappingBatch *batch = (DerivationMappingBatch*)g_malloc(sizeof(DerivationMappingBatch));
+    batch->interface = interface;
+    batch->derivation_mapping_array = g_ptr_array_new();
+    return batch;
+}
+
+GPtrArray *create_derivation_mapping_batch_array(const GPtrArray *derivation_mapping_array, const unsigned int max_batch_size)
+{
+    GPtrArray *batch_array = g_ptr_array_new();
+    GHashTable *open_batches_table = g_hash_table_new(g_str_hash, g_str_equal);
+    unsigned int i;
+
+    for(i = 0; i < derivation_mapping_array->len; i++)
+    {
+        DerivationMapping *mapping = g_ptr_array_index(derivation_mapping_array, i);
+        DerivationMappingBatch *batch = g_hash_table_lookup(open_batches_table, (gchar*)mapping->interface);
+
+        /* Start a new batch if the interface has none yet, or if its current batch is full */
+        if(batch == NULL || (max_batch_size > 0 && batch->derivation_mapping_array->len >= max_batch_size))
+        {
+            batch = create_derivation_mapping_batch(mapping->interface);
+            g_hash_table_insert(open_batches_table, (gchar*)mapping->interface, batch);
+            g_ptr_array_add(batch_array, batch);
+        }
+
+        g_ptr_array_add(batch->derivation_mapping_array, mapping);
+    }
+
+    g_hash_table_destroy(open_batches_table);
+    return batch_array;
+}
+
+void delete_derivation_mapping_batch_array(GPtrArray *batch_array)
+{
+    if(batch_array != NULL)
+    {
+        unsigned int i;
+
+        for(i = 0; i < batch_array->len; i++)
+        {
+            DerivationMappingBatch *batch = g_ptr_array_index(batch_array, i);
+            g_ptr_array_free(batch->derivation_mapping_array, TRUE);
+            g_free(batch);
+        }
+
+        g_ptr_array_free(batch_array, TRUE);
+    }
+}
+
+gchar **generate_derivation_mapping_batch_derivations(const DerivationMappingBatch *batch)
+{
+    gchar **derivations = (gchar**)g_malloc((batch->derivation_mapping_array->len + 1) * sizeof(gchar*));
+    unsigned int i;
+
+    for(i = 0; i < batch->derivation_mapping_array->len; i++)
+    {
+        DerivationMapping *mapping = g_ptr_array_index(batch->derivation_mapping_array, i);
+        derivations[i] = (gchar*)mapping->derivation;
+    }
+
+    derivations[i] = NULL;
+    return derivations;
+}
@@ -0,0 +1,64 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __DISNIX_DERIVATIONMAPPINGBATCH_H
+#define __DISNIX_DERIVATIONMAPPINGBATCH_H
+#include <glib.h>
+#include "derivationmapping.h"
+
+/**
+ * @brief Contains a group of derivation mappings that are realised by the same interface in one operation
+ */
+typedef struct
+{
+    /** Name of the interface that realises the derivations */
+    xmlChar *interface;
+    /** Array of derivation mappings that belong to the batch */
+    GPtrArray *derivation_mapping_array;
+}
+DerivationMappingBatch;
+
+/**
+ * Groups derivation mappings by interface into batches. The batches and the
+ * mappings inside them retain the order of the derivation mapping array.
+ *
+ * @param derivation_mapping_array Array with derivation mappings
+ * @param max_batch_size Maximum amount of derivation mappings in a batch, or 0 to put all mappings of an interface in one batch
+ * @return An array of derivation mapping batches. It should be removed from memory with delete_derivation_mapping_batch_array()
+ */
+GPtrArray *create_derivation_mapping_batch_array(const GPtrArray *derivation_mapping_array, const unsigned int max_batch_size);
+
+/**
+ * Deletes an array of derivation mapping batches. The derivation mappings
+ * themselves are not deleted.
+ *
+ * @param batch_array An array of derivation mapping batches
+ */
+void delete_derivation_mapping_batch_array(GPtrArray *batch_array);
+
+/**
+ * Composes an array with the store derivation paths of all mappings in a batch.
+ *
+ * @param batch A derivation mapping batch
+ * @return A NULL-terminated array of store derivation paths. The array should be freed with g_free(), but its elements refer to the derivation mappings.
+ */
+gchar **generate_derivation_mapping_batch_derivations(const DerivationMappingBatch *batch);
+
+#endif
@@ -18,11 +18,15 @@
  */
 
 #include "interface.h"
+#include <stdlib.h>
 #include <nixxml-parse.h>
 
 static void *create_interface(xmlNodePtr element, void *userdata)
 {
-    return g_malloc0(sizeof(Interface));
+    Interface *interface = g_malloc0(sizeof(Interface));
+    interface->num_of_cores = 1;
+    interface->available_cores = 1;
+    return interface;
 }
 
 static void insert_interface_attributes(void *table, const xmlChar *key, void *value, void *userdata)
@@ -33,6 +37,14 @@ static void insert_interface_attributes(void *table, const xmlChar *key, void *v
         interface->target_address = value;
     else if(xmlStrcmp(key, (xmlChar*) "clientInterface") == 0)
         interface->client_interface = value;
+    else if(xmlStrcmp(key, (xmlChar*) "system") == 0)
+        interface->system = value;
+    else if(xmlStrcmp(key, (xmlChar*) "numOfCores") == 0)
+    {
+        interface->num_of_cores = atoi((char*)value);
+        interface->available_cores = interface->num_of_cores;
+        xmlFree(value);
+    }
     else
         xmlFree(value);
 }
@@ -48,6 +60,7 @@ void delete_interface(Interface *interface)
     {
         g_free(interface->target_address);
         g_free(interface->client_interface);
+        g_free(interface->system);
         g_free(interface);
     }
 }
@@ -56,6 +69,12 @@ NixXML_bool check_interface(const Interface *interface)
 {
     NixXML_bool status = TRUE;
 
+    if(interface->num_of_cores <= 0)
+    {
+        g_printerr("interface.numOfCores should be greater than 0\n");
+        status = FALSE;
+    }
+
     if(interface->target_address == NULL)
     {
         g_printerr("interface.targetAddress is not set!\n");
@@ -70,3 +89,19 @@ NixXML_bool check_interface(const Interface *interface)
 
     return status;
 }
+
+NixXML_bool request_available_interface_core(Interface *interface)
+{
+    if(interface->available_cores > 0)
+    {
+        interface->available_cores--;
+        return TRUE;
+    }
+    else
+        return FALSE;
+}
+
+void signal_available_interface_core(Interface *interface)
+{
+    interface->available_cores++;
+}
@@ -33,6 +33,15 @@ typedef struct
 
     /** Executable that needs to be run to connect to the remote machine */
     gchar *client_interface;
+
+    /** System architecture identifier of the machine, or NULL if it is unknown */
+    gchar *system;
+
+    /** Contains the amount of CPU cores the machine has */
+    int num_of_cores;
+
+    /** Contains the amount of CPU cores that are currently available for building */
+    int available_cores;
 }
 Interface;
 
@@ -60,4 +69,19 @@ void delete_interface(Interface *interface);
  */
 NixXML_bool check_interface(const Interface *interface);
 
+/**
+ * Requests a CPU core for building.
+ *
+ * @param interface An interface struct instance
+ * @return TRUE if a CPU core is allocated, FALSE if none is available
+ */
+NixXML_bool request_available_interface_core(Interface *interface);
+
+/**
+ * Signals the availability of an additional CPU core for building.
+ *
+ * @param interface An interface struct instance
+ */
+void signal_available_interface_core(Interface *interface);
+
 #endif
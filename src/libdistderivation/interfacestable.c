@@ -35,3 +35,28 @@ NixXML_bool check_interfaces_table(GHashTable *interfaces_table)
 {
     return NixXML_check_g_hash_table(interfaces_table, (NixXML_CheckGHashTableValueFunc)check_interface);
 }
+
+NixXML_bool schedule_next_on_available_interface(GPtrArray *scheduled_array, unsigned int index, GHashTable *interfaces_table, get_scheduled_interface_function get_interface)
+{
+    unsigned int i, j;
+
+    /* Look for the first remaining element of which the interface has a CPU core available */
+    for(i = index; i < scheduled_array->len; i++)
+    {
+        gpointer element = g_ptr_array_index(scheduled_array, i);
+        Interface *interface = g_hash_table_lookup(interfaces_table, (gchar*)get_interface(element));
+
+        if(interface->available_cores > 0)
+        {
+            /* Move the element to the current position, so that it is the next one to be started */
+            for(j = i; j > index; j--)
+                scheduled_array->pdata[j] = scheduled_array->pdata[j - 1];
+
+            scheduled_array->pdata[index] = element;
+
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
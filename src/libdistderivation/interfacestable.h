@@ -48,4 +48,29 @@ void delete_interfaces_table(GHashTable *interfaces_table);
  */
 NixXML_bool check_interfaces_table(GHashTable *interfaces_table);
 
+/**
+ * Pointer to a function that returns the name of the interface that an element
+ * of a scheduled array is assigned to.
+ *
+ * @param element An element of a scheduled array
+ * @return The name of the interface of the element
+ */
+typedef xmlChar *(*get_scheduled_interface_function) (gpointer element);
+
+/**
+ * Looks for the first element of a scheduled array, starting from the given
+ * index, of which the interface has a CPU core available and moves it to that
+ * index, so that it is the next one to be started. The elements that are
+ * skipped keep their order and are postponed until their interface has a core
+ * available, so that a busy interface does not hold back the elements of the
+ * other interfaces.
+ *
+ * @param scheduled_array Array of elements in the order in which they are started
+ * @param index Position of the next element to be started
+ * @param interfaces_table Hash table with interfaces
+ * @param get_interface Pointer to a function that returns the interface name of an element
+ * @return TRUE if an element can be started, else FALSE
+ */
+NixXML_bool schedule_next_on_available_interface(GPtrArray *scheduled_array, unsigned int index, GHashTable *interfaces_table, get_scheduled_interface_function get_interface);
+
 #endif
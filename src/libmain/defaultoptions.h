@@ -79,6 +79,7 @@ typedef enum
     DISNIX_OPTION_TRANSFER_ONLY = 266,
     DISNIX_OPTION_DEPTH_FIRST = 267,
     DISNIX_OPTION_ALL = 268,
+    DISNIX_OPTION_DIRECT = 280,
 
     /* Diagnose options */
     DISNIX_OPTION_SHOW_MAPPINGS = 269,
@@ -92,6 +93,13 @@ typedef enum
     /* Visualize options */
     DISNIX_OPTION_NO_CONTAINERS = 274,
 
+    /* Build options */
+    DISNIX_OPTION_PIPELINE = 275,
+    DISNIX_OPTION_MAX_CONCURRENT_BUILDS = 276,
+    DISNIX_OPTION_REALISE_BATCH_SIZE = 277,
+    DISNIX_OPTION_KEEP_RESULTS_ON_TARGETS = 278,
+    DISNIX_OPTION_PLACE_BUILDS = 279,
+
     /* Convert options */
     DISNIX_OPTION_INFRASTRUCTURE = 'i'
 }
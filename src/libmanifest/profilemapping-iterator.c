@@ -31,10 +31,22 @@ static pid_t next_profile_mapping_process(void *data)
     ProfileMappingIteratorData *profile_mapping_iterator_data = (ProfileMappingIteratorData*)data;
 
     /* Retrieve profile mapping, target pair */
-    void *key, *value;
-    g_hash_table_iter_next(&profile_mapping_iterator_data->iter, &key, &value);
-    gchar *target_name = (gchar*)key;
-    xmlChar *profile_path = (xmlChar*)value;
+    gchar *target_name;
+    xmlChar *profile_path;
+
+    if(profile_mapping_iterator_data->target_names == NULL)
+    {
+        void *key, *value;
+        g_hash_table_iter_next(&profile_mapping_iterator_data->iter, &key, &value);
+        target_name = (gchar*)key;
+        profile_path = (xmlChar*)value;
+    }
+    else
+    {
+        target_name = g_ptr_array_index(profile_mapping_iterator_data->target_names, profile_mapping_iterator_data->model_iterator_data.index);
+        profile_path = g_hash_table_lookup(profile_mapping_iterator_data->profile_mapping_table, target_name);
+    }
+
     Target *target = g_hash_table_lookup(profile_mapping_iterator_data->targets_table, target_name);
 
     /* Invoke the next profile mapping operation process */
@@ -60,14 +72,15 @@ static void complete_profile_mapping_process(void *data, pid_t pid, ProcReact_St
     profile_mapping_iterator_data->complete_map_profile_mapping(profile_mapping_iterator_data->data, target_name, profile_path, target, status, result);
 }
 
-ProcReact_PidIterator create_profile_mapping_iterator(GHashTable *profile_mapping_table, GHashTable *targets_table, map_profile_mapping_function map_profile_mapping, complete_map_profile_mapping_function complete_map_profile_mapping, void *data)
+static ProcReact_PidIterator create_common_iterator(GHashTable *profile_mapping_table, GHashTable *targets_table, const GPtrArray *target_names, const unsigned int length, map_profile_mapping_function map_profile_mapping, complete_map_profile_mapping_function complete_map_profile_mapping, void *data)
 {
     ProfileMappingIteratorData *profile_mapping_iterator_data = (ProfileMappingIteratorData*)g_malloc(sizeof(ProfileMappingIteratorData));
 
-    init_model_iterator_data(&profile_mapping_iterator_data->model_iterator_data, g_hash_table_size(profile_mapping_table));
+    init_model_iterator_data(&profile_mapping_iterator_data->model_iterator_data, length);
     profile_mapping_iterator_data->profile_mapping_table = profile_mapping_table;
     g_hash_table_iter_init(&profile_mapping_iterator_data->iter, profile_mapping_iterator_data->profile_mapping_table);
     profile_mapping_iterator_data->targets_table = targets_table;
+    profile_mapping_iterator_data->target_names = target_names;
     profile_mapping_iterator_data->map_profile_mapping = map_profile_mapping;
     profile_mapping_iterator_data->complete_map_profile_mapping = complete_map_profile_mapping;
     profile_mapping_iterator_data->data = data;
@@ -75,6 +88,16 @@ ProcReact_PidIterator create_profile_mapping_iterator(GHashTable *profile_mappin
     return procreact_initialize_pid_iterator(has_next_profile_mapping, next_profile_mapping_process, procreact_retrieve_boolean, complete_profile_mapping_process, profile_mapping_iterator_data);
 }
 
+ProcReact_PidIterator create_profile_mapping_iterator(GHashTable *profile_mapping_table, GHashTable *targets_table, map_profile_mapping_function map_profile_mapping, complete_map_profile_mapping_function complete_map_profile_mapping, void *data)
+{
+    return create_common_iterator(profile_mapping_table, targets_table, NULL, g_hash_table_size(profile_mapping_table), map_profile_mapping, complete_map_profile_mapping, data);
+}
+
+ProcReact_PidIterator create_ordered_profile_mapping_iterator(GHashTable *profile_mapping_table, GHashTable *targets_table, const GPtrArray *target_names, map_profile_mapping_function map_profile_mapping, complete_map_profile_mapping_function complete_map_profile_mapping, void *data)
+{
+    return create_common_iterator(profile_mapping_table, targets_table, target_names, target_names->len, map_profile_mapping, complete_map_profile_mapping, data);
+}
+
 void destroy_profile_mapping_iterator(ProcReact_PidIterator *iterator)
 {
     ProfileMappingIteratorData *profile_mapping_iterator_data = (ProfileMappingIteratorData*)iterator->data;
@@ -60,6 +60,8 @@ typedef struct
     GHashTable *profile_mapping_table;
     /** Hash table with target items */
     GHashTable *targets_table;
+    /** Optional array of target names specifying the order in which the profile mappings are traversed */
+    const GPtrArray *target_names;
 
     /** Pointer to a function that executes an operation for each profile mapping */
     map_profile_mapping_function map_profile_mapping;
@@ -84,10 +86,25 @@ ProfileMappingIteratorData;
  */
 ProcReact_PidIterator create_profile_mapping_iterator(GHashTable *profile_mapping_table, GHashTable *targets_table, map_profile_mapping_function map_profile_mapping, complete_map_profile_mapping_function complete_map_profile_mapping, void *data);
 
+/**
+ * Creates a new iterator that steps over the profile mappings in the order of
+ * the given array of target names and executes the provided functions on start
+ * and completion.
+ *
+ * @param profile_mapping_table Hash table with profile mappings
+ * @param targets_table Hash table of targets
+ * @param target_names Array of target names of the profile mappings to traverse, in order
+ * @param map_profile_mapping Pointer to a function that executes an operation for each distribution item
+ * @param complete_map_profile_mapping Pointer to a function that gets executed when a process completes for a profile mapping
+ * @param data Pointer to arbitrary data passed to the above functions
+ * @return A PID iterator that can be used to traverse the profile mappings
+ */
+ProcReact_PidIterator create_ordered_profile_mapping_iterator(GHashTable *profile_mapping_table, GHashTable *targets_table, const GPtrArray *target_names, map_profile_mapping_function map_profile_mapping, complete_map_profile_mapping_function complete_map_profile_mapping, void *data);
+
 /**
  * Destroys the resources attached to the given profile mapping iterator.
  *
- * @param iterator Pid iterator constructed with create_profile_mapping_iterator()
+ * @param iterator Pid iterator constructed with create_profile_mapping_iterator() or create_ordered_profile_mapping_iterator()
  */
 void destroy_profile_mapping_iterator(ProcReact_PidIterator *iterator);
 
@@ -0,0 +1,102 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __DISNIX_SNAPSHOTMAPPING_ITERATOR_H
+#define __DISNIX_SNAPSHOTMAPPING_ITERATOR_H
+
+#include <procreact_pid_iterator.h>
+#include <modeliterator.h>
+#include <targetstable.h>
+#include "snapshotmappingarray.h"
+
+/**
+ * Pointer to a function that executes a process for each snapshot mapping.
+ *
+ * @param data An arbitrary data structure
+ * @param mapping A snapshot mapping from a snapshot mapping array
+ * @param target The target machine to which the snapshot mapping belongs
+ * @return The PID of the spawned process
+ */
+typedef pid_t (*map_snapshot_mapping_function) (void *data, SnapshotMapping *mapping, Target *target);
+
+/**
+ * Pointer to a function that gets executed when a process completes for a
+ * snapshot mapping.
+ *
+ * @param data An arbitrary data structure
+ * @param mapping A snapshot mapping from a snapshot mapping array
+ * @param target The target machine to which the snapshot mapping belongs
+ * @param status Indicates whether the process terminated abnormally or not
+ * @param result TRUE if the operation succeeded, else FALSE
+ */
+typedef void (*complete_snapshot_mapping_function) (void *data, SnapshotMapping *mapping, Target *target, ProcReact_Status status, ProcReact_bool result);
+
+/**
+ * @brief Iterator that can be used to execute a process for each snapshot mapping
+ */
+typedef struct
+{
+    /** Common properties for all model iterators */
+    ModelIteratorData model_iterator_data;
+    /** Array with snapshot mappings */
+    const GPtrArray *snapshot_mapping_array;
+    /** Hash table with targets */
+    GHashTable *targets_table;
+    /** Pointer to a function that executes a process for each snapshot mapping */
+    map_snapshot_mapping_function map_snapshot_mapping;
+    /** Pointer to a function that gets executed when a process completes for a snapshot mapping */
+    complete_snapshot_mapping_function complete_snapshot_mapping;
+    /** Pointer to arbitrary data passed to the above functions */
+    void *data;
+}
+SnapshotMappingIteratorData;
+
+/**
+ * Creates a new PID iterator that steps over each snapshot mapping and its
+ * target and executes the provided functions on start and completion. Unlike
+ * map_snapshot_items(), it does not take the CPU cores of the targets into
+ * account, so the amount of concurrent processes should be bounded by the
+ * caller.
+ *
+ * @param snapshot_mapping_array Array with snapshot mappings
+ * @param targets_table Hash table with targets
+ * @param map_snapshot_mapping Pointer to a function that executes a process for each snapshot mapping
+ * @param complete_snapshot_mapping Pointer to a function that gets executed when a process completes for a snapshot mapping
+ * @param data Pointer to arbitrary data passed to the above functions
+ * @return A PID iterator that can be used to traverse the snapshot mappings
+ */
+ProcReact_PidIterator create_snapshot_mapping_pid_iterator(const GPtrArray *snapshot_mapping_array, GHashTable *targets_table, map_snapshot_mapping_function map_snapshot_mapping, complete_snapshot_mapping_function complete_snapshot_mapping, void *data);
+
+/**
+ * Destroys all resources allocated with the provided snapshot mapping PID iterator
+ *
+ * @param iterator A snapshot mapping PID iterator instance
+ */
+void destroy_snapshot_mapping_pid_iterator(ProcReact_PidIterator *iterator);
+
+/**
+ * Checks whether all iteration steps have succeeded.
+ *
+ * @param snapshot_mapping_iterator_data Struct with properties that facilitate iteration over snapshot mappings
+ * @return TRUE if it indicates success, else FALSE
+ */
+ProcReact_bool snapshot_mapping_iterator_has_succeeded(const SnapshotMappingIteratorData *snapshot_mapping_iterator_data);
+
+#endif
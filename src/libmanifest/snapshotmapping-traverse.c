@@ -20,87 +20,200 @@
 #include "snapshotmapping-traverse.h"
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <errno.h>
 #include <nixxml-generate-env.h>
 #include "interdependencymapping.h"
 #include "manifestservicestable.h"
 #include "mappingparameters.h"
 
-static int wait_to_complete_snapshot_item(GHashTable *pid_table, GHashTable *services_table, GHashTable *targets_table, complete_snapshot_item_mapping_function complete_snapshot_item_mapping)
+static void complete_snapshot_item(SnapshotMapping *mapping, GHashTable *services_table, Target *target, complete_snapshot_item_mapping_function complete_snapshot_item_mapping, ProcReact_Status status, ProcReact_bool result)
 {
-    if(g_hash_table_size(pid_table) > 0)
+    ManifestService *service = g_hash_table_lookup(services_table, mapping->service);
+
+    /* Mark mapping as transferred to prevent it from snapshotting again */
+    mapping->transferred = TRUE;
+
+    /* Signal the target to make the CPU core available again */
+    signal_available_target_core(target);
+
+    complete_snapshot_item_mapping(mapping, service, target, status, result);
+}
+
+static ProcReact_bool dispatch_snapshot_items(GQueue *queue, Target *target, GHashTable *pid_table, GHashTable *services_table, map_snapshot_item_function map_snapshot_item, complete_snapshot_item_mapping_function complete_snapshot_item_mapping)
+{
+    ProcReact_bool status = TRUE;
+
+    /* Pop mappings from the target's ready queue as long as the machine has cores available */
+    while(!g_queue_is_empty(queue) && request_available_target_core(target))
     {
-        int wstatus;
-        pid_t pid = wait(&wstatus);
+        SnapshotMapping *mapping = g_queue_pop_head(queue);
+        MappingParameters params = create_mapping_parameters(mapping->service, mapping->container, mapping->target, mapping->container_provided_by_service, services_table, target);
+        pid_t pid = map_snapshot_item(mapping, params.service, target, params.type, params.arguments, params.arguments_size);
 
         if(pid == -1)
-            return FALSE;
+        {
+            complete_snapshot_item(mapping, services_table, target, complete_snapshot_item_mapping, PROCREACT_STATUS_FORK_FAIL, FALSE);
+            status = FALSE;
+        }
+        else
+        {
+            /* Add pid and mapping to the hash table */
+            gint *pid_ptr = g_malloc(sizeof(gint));
+            *pid_ptr = pid;
+            g_hash_table_insert(pid_table, pid_ptr, mapping);
+        }
+
+        /* Cleanup */
+        destroy_mapping_parameters(&params);
+    }
+
+    return status;
+}
+
+static GHashTable *create_ready_queues_table(const GPtrArray *snapshot_mapping_array, GHashTable *targets_table, GPtrArray *target_names_array)
+{
+    unsigned int i;
+    GHashTable *queues_table = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)g_queue_free);
+
+    for(i = 0; i < snapshot_mapping_array->len; i++)
+    {
+        SnapshotMapping *mapping = g_ptr_array_index(snapshot_mapping_array, i);
+        Target *target = g_hash_table_lookup(targets_table, (gchar*)mapping->target);
+
+        if(target == NULL)
+            g_print("[target: %s]: Skip state of component: %s deployed to container: %s since machine is no longer present!\n", mapping->target, mapping->component, mapping->container);
+        else if(!mapping->transferred)
+        {
+            GQueue *queue = g_hash_table_lookup(queues_table, (gchar*)mapping->target);
+
+            if(queue == NULL)
+            {
+                /* Remember the order in which the targets appear, so that the initial dispatch follows the order of the array */
+                queue = g_queue_new();
+                g_hash_table_insert(queues_table, (gchar*)mapping->target, queue);
+                g_ptr_array_add(target_names_array, mapping->target);
+            }
+
+            g_queue_push_tail(queue, mapping);
+        }
+    }
+
+    return queues_table;
+}
+
+static ProcReact_bool wait_to_complete_snapshot_item(GHashTable *pid_table, GHashTable *queues_table, GHashTable *services_table, GHashTable *targets_table, map_snapshot_item_function map_snapshot_item, complete_snapshot_item_mapping_function complete_snapshot_item_mapping)
+{
+    int wstatus;
+    pid_t pid;
+
+    do
+        pid = wait(&wstatus);
+    while(pid == -1 && errno == EINTR);
+
+    if(pid == -1)
+    {
+        GHashTableIter iter;
+        gpointer key, value;
+
+        /* There are no child processes left to wait for, so the remaining entries can never complete */
+        g_hash_table_iter_init(&iter, pid_table);
+
+        while(g_hash_table_iter_next(&iter, &key, &value))
+        {
+            SnapshotMapping *mapping = (SnapshotMapping*)value;
+            Target *target = g_hash_table_lookup(targets_table, (gchar*)mapping->target);
+            complete_snapshot_item(mapping, services_table, target, complete_snapshot_item_mapping, PROCREACT_STATUS_WAIT_FAIL, FALSE);
+        }
+
+        g_hash_table_remove_all(pid_table);
+        return FALSE;
+    }
+    else
+    {
+        SnapshotMapping *mapping = g_hash_table_lookup(pid_table, &pid);
+
+        if(mapping == NULL)
+            return TRUE; /* Not one of our processes */
         else
         {
-            ManifestService *service;
             Target *target;
             ProcReact_Status status;
             int result;
+            ProcReact_bool dispatch_status;
 
-            /* Find the corresponding snapshot mapping and remove it from the pids table */
-            SnapshotMapping *mapping = g_hash_table_lookup(pid_table, &pid);
+            /* Remove the mapping from the pids table */
             g_hash_table_remove(pid_table, &pid);
 
-            /* Mark mapping as transferred to prevent it from snapshotting again */
-            mapping->transferred = TRUE;
-
-            /* Signal the target to make the CPU core available again */
+            /* Complete the mapping, which makes the CPU core of the target available again */
             target = g_hash_table_lookup(targets_table, (gchar*)mapping->target);
-            signal_available_target_core(target);
-
-            /* Return the status */
             result = procreact_retrieve_boolean(pid, wstatus, &status);
-            service = g_hash_table_lookup(services_table, mapping->service);
-            complete_snapshot_item_mapping(mapping, service, target, status, result);
-            return(status == PROCREACT_STATUS_OK && result);
+            complete_snapshot_item(mapping, services_table, target, complete_snapshot_item_mapping, status, result);
+
+            /* Hand the freed core to the next mapping in the ready queue of the same target */
+            dispatch_status = dispatch_snapshot_items(g_hash_table_lookup(queues_table, (gchar*)mapping->target), target, pid_table, services_table, map_snapshot_item, complete_snapshot_item_mapping);
+
+            return(status == PROCREACT_STATUS_OK && result && dispatch_status);
         }
     }
-    else
-        return TRUE;
 }
 
-ProcReact_bool map_snapshot_items(const GPtrArray *snapshot_mapping_array, GHashTable *services_table, GHashTable *targets_table, map_snapshot_item_function map_snapshot_item, complete_snapshot_item_mapping_function complete_snapshot_item_mapping)
+static ProcReact_bool fail_queued_snapshot_items(GHashTable *queues_table, GPtrArray *target_names_array, GHashTable *services_table, GHashTable *targets_table, complete_snapshot_item_mapping_function complete_snapshot_item_mapping)
 {
-    unsigned int num_processed = 0;
     ProcReact_bool status = TRUE;
-    GHashTable *pid_table = g_hash_table_new_full(g_int_hash, g_int_equal, g_free, NULL);
+    unsigned int i;
 
-    while(num_processed < snapshot_mapping_array->len)
+    for(i = 0; i < target_names_array->len; i++)
     {
-        unsigned int i;
+        gchar *target_name = g_ptr_array_index(target_names_array, i);
+        GQueue *queue = g_hash_table_lookup(queues_table, target_name);
+        Target *target = g_hash_table_lookup(targets_table, target_name);
 
-        for(i = 0; i < snapshot_mapping_array->len; i++)
+        while(!g_queue_is_empty(queue))
         {
-            SnapshotMapping *mapping = g_ptr_array_index(snapshot_mapping_array, i);
-            Target *target = g_hash_table_lookup(targets_table, (gchar*)mapping->target);
+            SnapshotMapping *mapping = g_queue_pop_head(queue);
+            ManifestService *service = g_hash_table_lookup(services_table, mapping->service);
 
-            if(target == NULL)
-                g_print("[target: %s]: Skip state of component: %s deployed to container: %s since machine is no longer present!\n", mapping->target, mapping->component, mapping->container);
-            else if(!mapping->transferred && request_available_target_core(target)) /* Check if machine has any cores available, if not wait and try again later */
-            {
-                MappingParameters params = create_mapping_parameters(mapping->service, mapping->container, mapping->target, mapping->container_provided_by_service, services_table, target);
-                pid_t pid = map_snapshot_item(mapping, params.service, target, params.type, params.arguments, params.arguments_size);
+            /* The mapping never got a CPU core, so there is none to make available again */
+            mapping->transferred = TRUE;
+            complete_snapshot_item_mapping(mapping, service, target, PROCREACT_STATUS_WAIT_FAIL, FALSE);
+            status = FALSE;
+        }
+    }
 
-                /* Add pid and mapping to the hash table */
-                gint *pid_ptr = g_malloc(sizeof(gint));
-                *pid_ptr = pid;
-                g_hash_table_insert(pid_table, pid_ptr, mapping);
+    return status;
+}
 
-                /* Cleanup */
-                destroy_mapping_parameters(&params);
-            }
-        }
+ProcReact_bool map_snapshot_items(const GPtrArray *snapshot_mapping_array, GHashTable *services_table, GHashTable *targets_table, map_snapshot_item_function map_snapshot_item, complete_snapshot_item_mapping_function complete_snapshot_item_mapping)
+{
+    unsigned int i;
+    ProcReact_bool status = TRUE;
+    GHashTable *pid_table = g_hash_table_new_full(g_int_hash, g_int_equal, g_free, NULL);
+    GPtrArray *target_names_array = g_ptr_array_new();
+    GHashTable *queues_table = create_ready_queues_table(snapshot_mapping_array, targets_table, target_names_array);
+
+    /* Start as many mappings on each target as it has cores available */
+    for(i = 0; i < target_names_array->len; i++)
+    {
+        gchar *target_name = g_ptr_array_index(target_names_array, i);
+        Target *target = g_hash_table_lookup(targets_table, target_name);
 
-        if(!wait_to_complete_snapshot_item(pid_table, services_table, targets_table, complete_snapshot_item_mapping))
+        if(!dispatch_snapshot_items(g_hash_table_lookup(queues_table, target_name), target, pid_table, services_table, map_snapshot_item, complete_snapshot_item_mapping))
             status = FALSE;
+    }
 
-        num_processed++;
+    /* Each completion dispatches the next mapping of the same target, until all queues are drained */
+    while(g_hash_table_size(pid_table) > 0)
+    {
+        if(!wait_to_complete_snapshot_item(pid_table, queues_table, services_table, targets_table, map_snapshot_item, complete_snapshot_item_mapping))
+            status = FALSE;
     }
 
+    /* Mappings that are still queued when no process is left to complete can no longer be dispatched */
+    if(!fail_queued_snapshot_items(queues_table, target_names_array, services_table, targets_table, complete_snapshot_item_mapping))
+        status = FALSE;
+
+    g_hash_table_destroy(queues_table);
+    g_ptr_array_free(target_names_array, TRUE);
     g_hash_table_destroy(pid_table);
     return status;
 }
@@ -0,0 +1,196 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "budgeted-migrate.h"
+#define _XOPEN_SOURCE 500
+#define __USE_XOPEN_EXTENDED 1
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib/gstdio.h>
+#include <snapshotmappingarray.h>
+#include "snapshot.h"
+#include "restore.h"
+#include "snapshot-budget.h"
+
+/* Staging snapshot store infrastructure */
+
+static gchar *create_staging_snapshot_store(void)
+{
+    char *state_dir = getenv("DYSNOMIA_STATEDIR");
+    gchar *staging_dir;
+
+    if(state_dir == NULL)
+        state_dir = "/var/state/dysnomia";
+
+    /* Stage on the same file system as the coordinator's own snapshots, rather than in a temp dir that may reside in memory */
+    staging_dir = g_strconcat(state_dir, "/disnix-staging-XXXXXX", NULL);
+
+    if(g_mkdir_with_parents(state_dir, 0755) == -1 || g_mkdtemp(staging_dir) == NULL)
+    {
+        g_printerr("[coordinator]: Cannot create a staging snapshot store in: %s\n", state_dir);
+        g_free(staging_dir);
+        return NULL;
+    }
+    else
+        return staging_dir;
+}
+
+static int unlink_cb(const char *fpath, const struct stat *sb, int typeflag, struct FTW *ftwbuf)
+{
+    int rv = remove(fpath);
+
+    if(rv == -1)
+        fprintf(stderr, "Cannot remove: %s\n", fpath);
+
+    return rv;
+}
+
+static ProcReact_bool remove_staging_snapshot_store(gchar *staging_dir)
+{
+    return (nftw(staging_dir, unlink_cb, 64, FTW_DEPTH | FTW_PHYS) == 0);
+}
+
+static ProcReact_bool migrate_snapshot_batch(const SnapshotBatch *batch, GPtrArray *destination_mapping_array, const Manifest *manifest, const unsigned int max_concurrent_transfers, const unsigned int flags)
+{
+    gchar *staging_dir = create_staging_snapshot_store();
+
+    if(staging_dir == NULL)
+        return FALSE;
+    else
+    {
+        gchar *state_dir = g_strdup(g_getenv("DYSNOMIA_STATEDIR"));
+        ProcReact_bool success;
+
+        /*
+         * Stage the batch in a snapshot store of its own, so that all
+         * generations retrieved for it can be removed afterwards without
+         * touching the generations in the coordinator's own snapshot store.
+         * The Dysnomia processes that we spawn inherit the state directory.
+         */
+        g_setenv("DYSNOMIA_STATEDIR", staging_dir, TRUE);
+
+        success = retrieve_snapshots(batch->snapshot_mapping_array, manifest->targets_table, max_concurrent_transfers, flags)
+          && send_and_restore_snapshots(destination_mapping_array, manifest->services_table, manifest->targets_table, max_concurrent_transfers, flags);
+
+        if(state_dir == NULL)
+            g_unsetenv("DYSNOMIA_STATEDIR");
+        else
+            g_setenv("DYSNOMIA_STATEDIR", state_dir, TRUE);
+
+        /* Also remove the staged snapshots of a failed batch, so that they do not remain behind on the coordinator */
+        g_print("[coordinator]: Removing the staged snapshots of the batch...\n");
+
+        if(!remove_staging_snapshot_store(staging_dir))
+        {
+            g_printerr("[coordinator]: Cannot remove staging snapshot store: %s\n", staging_dir);
+            success = FALSE;
+        }
+
+        g_free(state_dir);
+        g_free(staging_dir);
+        return success;
+    }
+}
+
+static ProcReact_bool migrate_snapshot_batches(GPtrArray *snapshot_batches_array, GPtrArray *destination_mapping_array, const Manifest *manifest, const unsigned int max_concurrent_transfers, const unsigned int flags)
+{
+    ProcReact_bool success = TRUE;
+    GPtrArray *remaining_mapping_array;
+    unsigned int i;
+
+    for(i = 0; i < snapshot_batches_array->len; i++)
+    {
+        SnapshotBatch *batch = g_ptr_array_index(snapshot_batches_array, i);
+        GPtrArray *batch_mapping_array = select_snapshot_mappings_of_batch(batch, NULL, destination_mapping_array);
+
+        g_print("[coordinator]: Migrating snapshots of batch: %u of %u (%" G_GUINT64_FORMAT " bytes)...\n", i + 1, snapshot_batches_array->len, batch->size);
+        success = migrate_snapshot_batch(batch, batch_mapping_array, manifest, max_concurrent_transfers, flags);
+        g_ptr_array_free(batch_mapping_array, TRUE);
+
+        if(!success)
+            return FALSE;
+    }
+
+    /* Components that were not snapshotted on another machine can only be restored from the snapshots that the coordinator already has */
+    remaining_mapping_array = select_snapshot_mappings_of_batch(NULL, snapshot_batches_array, destination_mapping_array);
+
+    if(remaining_mapping_array->len > 0)
+    {
+        success = send_and_restore_snapshots(remaining_mapping_array, manifest->services_table, manifest->targets_table, max_concurrent_transfers, flags);
+    }
+
+    g_ptr_array_free(remaining_mapping_array, TRUE);
+    return success;
+}
+
+ProcReact_bool migrate_within_budget(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const guint64 max_snapshot_bytes)
+{
+    GPtrArray *source_mapping_array, *destination_mapping_array, *snapshot_batches_array;
+    GHashTable *previous_services_table;
+    ProcReact_bool success;
+
+    /* Determine the same snapshot mappings as snapshot() and restore() */
+    if(flags & FLAG_NO_UPGRADE)
+    {
+        source_mapping_array = manifest->snapshot_mapping_array;
+        destination_mapping_array = manifest->snapshot_mapping_array;
+    }
+    else if(previous_manifest == NULL)
+    {
+        g_printerr("[coordinator]: No snapshots are taken since an upgrade is requested and no previous deployment state is known\n");
+        source_mapping_array = g_ptr_array_new();
+        destination_mapping_array = manifest->snapshot_mapping_array;
+    }
+    else
+    {
+        source_mapping_array = subtract_snapshot_mappings(previous_manifest->snapshot_mapping_array, manifest->snapshot_mapping_array);
+        destination_mapping_array = subtract_snapshot_mappings(manifest->snapshot_mapping_array, previous_manifest->snapshot_mapping_array);
+    }
+
+    previous_services_table = (previous_manifest == NULL) ? manifest->services_table : previous_manifest->services_table;
+
+    /* Snapshots are taken breadth first, only the data that must be staged on the coordinator is bounded */
+    if((flags & FLAG_TRANSFER_ONLY) || snapshot_services(source_mapping_array, previous_services_table, manifest->targets_table))
+    {
+        g_print("[coordinator]: Determining the sizes of the snapshots to migrate...\n");
+        snapshot_batches_array = create_snapshot_batches_array(source_mapping_array, manifest->targets_table, flags, max_snapshot_bytes, FALSE, max_concurrent_transfers);
+
+        if(snapshot_batches_array == NULL)
+            success = FALSE;
+        else
+        {
+            success = migrate_snapshot_batches(snapshot_batches_array, destination_mapping_array, manifest, max_concurrent_transfers, flags);
+            delete_snapshot_batches_array(snapshot_batches_array);
+        }
+    }
+    else
+        success = FALSE;
+
+    if(!(flags & FLAG_NO_UPGRADE))
+    {
+        g_ptr_array_free(source_mapping_array, TRUE);
+
+        if(previous_manifest != NULL)
+            g_ptr_array_free(destination_mapping_array, TRUE);
+    }
+
+    return success;
+}
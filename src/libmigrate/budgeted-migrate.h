@@ -0,0 +1,49 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __DISNIX_BUDGETED_MIGRATE_H
+#define __DISNIX_BUDGETED_MIGRATE_H
+#include <glib.h>
+#include <procreact_types.h>
+#include <manifest.h>
+#include "datamigrationflags.h"
+
+/**
+ * Migrates the state of all stateful services from the previous locations to
+ * the desired locations, without staging more snapshot data on the
+ * coordinator than the given budget.
+ *
+ * First, all snapshots are taken breadth first on the previous machines. Then
+ * the components are partitioned into batches using the snapshot sizes that
+ * the targets report. Each batch is retrieved into a staging snapshot store
+ * of its own, sent and restored breadth first, after which the staging store
+ * is removed to make room for the next batch. The generations in the
+ * coordinator's own snapshot store are left untouched.
+ *
+ * @param manifest Manifest containing all deployment information
+ * @param previous_manifest Manifest containing the previous deployment information or NULL if it is unknown
+ * @param max_concurrent_transfers Specifies the maximum amount of concurrent transfers
+ * @param flags Data migration option flags
+ * @param max_snapshot_bytes Maximum amount of snapshot data in bytes that may be staged on the coordinator
+ * @return TRUE if the migration completed successfully, else FALSE
+ */
+ProcReact_bool migrate_within_budget(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const guint64 max_snapshot_bytes);
+
+#endif
@@ -0,0 +1,117 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "clean-snapshot-mappings.h"
+#include <stdlib.h>
+#include <sys/types.h>
+#include <procreact_pid.h>
+#include <procreact_pid_iterator.h>
+#include <remote-snapshot-management.h>
+#include <targets-iterator.h>
+
+static GPtrArray *compose_components_array(const GPtrArray *snapshot_mapping_array)
+{
+    GPtrArray *components_array = g_ptr_array_new_with_free_func(g_free);
+    GHashTable *components_table = g_hash_table_new(g_str_hash, g_str_equal);
+    unsigned int i;
+
+    for(i = 0; i < snapshot_mapping_array->len; i++)
+    {
+        SnapshotMapping *mapping = g_ptr_array_index(snapshot_mapping_array, i);
+        gchar *component = g_strconcat((gchar*)mapping->container, "/", (gchar*)mapping->component, NULL);
+
+        /* Each component only needs to be cleaned once */
+        if(g_hash_table_contains(components_table, component))
+            g_free(component);
+        else
+        {
+            g_hash_table_add(components_table, component);
+            g_ptr_array_add(components_array, component);
+        }
+    }
+
+    g_hash_table_destroy(components_table);
+    return components_array;
+}
+
+pid_t clean_snapshot_mappings_on_target(const GPtrArray *snapshot_mapping_array, Target *target, const int keep)
+{
+    gchar *target_key = find_target_key(target);
+    GPtrArray *components_array = compose_components_array(snapshot_mapping_array);
+    pid_t pid;
+
+    g_print("[target: %s]: Cleaning snapshots of %u components\n", target_key, components_array->len);
+    pid = statemgmt_remote_clean_snapshots_of_components((gchar*)target->client_interface, target_key, keep, (gchar**)components_array->pdata, components_array->len);
+
+    g_ptr_array_free(components_array, TRUE);
+    return pid;
+}
+
+typedef struct
+{
+    GPtrArray *snapshot_mapping_array;
+    int keep;
+}
+CleanSnapshotMappingsData;
+
+static pid_t clean_snapshot_mappings_of_target(void *data, gchar *target_name, Target *target)
+{
+    pid_t pid = fork();
+
+    if(pid == 0)
+    {
+        CleanSnapshotMappingsData *clean_snapshot_mappings_data = (CleanSnapshotMappingsData*)data;
+        gchar *target_key = find_target_key(target);
+        GPtrArray *snapshots_per_target_array = find_snapshot_mappings_per_target(clean_snapshot_mappings_data->snapshot_mapping_array, target_key);
+        int exit_status;
+
+        if(snapshots_per_target_array->len == 0)
+            exit_status = 0; /* Nothing to clean on this target */
+        else
+        {
+            ProcReact_Status status;
+            exit_status = !procreact_wait_for_boolean(clean_snapshot_mappings_on_target(snapshots_per_target_array, target, clean_snapshot_mappings_data->keep), &status) || status != PROCREACT_STATUS_OK;
+        }
+
+        g_ptr_array_free(snapshots_per_target_array, TRUE);
+        exit(exit_status);
+    }
+
+    return pid;
+}
+
+static void complete_clean_snapshot_mappings_of_target(void *data, gchar *target_name, Target *target, ProcReact_Status status, ProcReact_bool result)
+{
+    if(status != PROCREACT_STATUS_OK || !result)
+        g_printerr("[target: %s]: Cannot clean snapshots!\n", target_name);
+}
+
+ProcReact_bool clean_snapshot_mappings(GPtrArray *snapshot_mapping_array, GHashTable *targets_table, const unsigned int max_concurrent_transfers, const int keep)
+{
+    ProcReact_bool success;
+    CleanSnapshotMappingsData data = { snapshot_mapping_array, keep };
+    ProcReact_PidIterator iterator = create_target_pid_iterator(targets_table, clean_snapshot_mappings_of_target, complete_clean_snapshot_mappings_of_target, &data);
+
+    procreact_fork_and_wait_in_parallel_limit(&iterator, max_concurrent_transfers);
+    success = target_iterator_has_succeeded(iterator.data);
+
+    destroy_target_pid_iterator(&iterator);
+    return success;
+}
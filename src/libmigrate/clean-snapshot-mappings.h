@@ -0,0 +1,52 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __DISNIX_CLEAN_SNAPSHOT_MAPPINGS_H
+#define __DISNIX_CLEAN_SNAPSHOT_MAPPINGS_H
+#include <glib.h>
+#include <procreact_types.h>
+#include <snapshotmappingarray.h>
+#include <targetstable.h>
+
+/**
+ * Removes the obsolete snapshot generations of all the given snapshot mappings
+ * of a target with a single garbage collect operation.
+ *
+ * @param snapshot_mapping_array Array of snapshot mappings that belong to the target
+ * @param target Target machine to clean the snapshots on
+ * @param keep Number of snapshot generations to keep
+ * @return PID of the process performing the operation, or -1 in case of a failure
+ */
+pid_t clean_snapshot_mappings_on_target(const GPtrArray *snapshot_mapping_array, Target *target, const int keep);
+
+/**
+ * Removes the obsolete snapshot generations of the given snapshot mappings.
+ * Each target receives one garbage collect operation for all its mappings,
+ * and the targets are cleaned concurrently.
+ *
+ * @param snapshot_mapping_array Array of snapshot mappings
+ * @param targets_table Hash table with targets
+ * @param max_concurrent_transfers Maximum amount of targets that are cleaned concurrently
+ * @param keep Number of snapshot generations to keep
+ * @return TRUE if the snapshots on all targets were successfully cleaned, else FALSE
+ */
+ProcReact_bool clean_snapshot_mappings(GPtrArray *snapshot_mapping_array, GHashTable *targets_table, const unsigned int max_concurrent_transfers, const int keep);
+
+#endif
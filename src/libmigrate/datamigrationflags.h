@@ -25,5 +25,7 @@
 #define FLAG_ALL 0x4
 #define FLAG_NO_UPGRADE 0x8
 #define FLAG_DELETE_STATE 0x10
+#define FLAG_DIRECT 0x20
+#define FLAG_PIPELINE 0x40
 
 #endif
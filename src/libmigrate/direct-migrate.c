@@ -0,0 +1,204 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "direct-migrate.h"
+#include <sys/types.h>
+#include <remote-snapshot-management.h>
+#include <snapshotmapping-iterator.h>
+#include <transferlimit.h>
+#include "snapshot.h"
+#include "restore.h"
+#include "clean-snapshot-mappings.h"
+
+/* Source location infrastructure */
+
+static gchar *compose_source_key(const SnapshotMapping *mapping)
+{
+    return g_strconcat((gchar*)mapping->container, "/", (gchar*)mapping->component, NULL);
+}
+
+static GHashTable *create_source_mappings_table(const GPtrArray *old_snapshot_mapping_array)
+{
+    GHashTable *source_mappings_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    unsigned int i;
+
+    for(i = 0; i < old_snapshot_mapping_array->len; i++)
+    {
+        SnapshotMapping *mapping = g_ptr_array_index(old_snapshot_mapping_array, i);
+        gchar *source_key = compose_source_key(mapping);
+
+        /* If a component was deployed to multiple machines, then the first occurrence is used as the source */
+        if(g_hash_table_contains(source_mappings_table, source_key))
+            g_free(source_key);
+        else
+            g_hash_table_insert(source_mappings_table, source_key, mapping);
+    }
+
+    return source_mappings_table;
+}
+
+static SnapshotMapping *find_source_mapping(GHashTable *source_mappings_table, const SnapshotMapping *mapping)
+{
+    gchar *source_key = compose_source_key(mapping);
+    SnapshotMapping *source_mapping = g_hash_table_lookup(source_mappings_table, source_key);
+    g_free(source_key);
+    return source_mapping;
+}
+
+static GPtrArray *select_mappings_with_source(const GPtrArray *new_snapshot_mapping_array, GHashTable *source_mappings_table)
+{
+    GPtrArray *mappings_with_source_array = g_ptr_array_new();
+    unsigned int i;
+
+    for(i = 0; i < new_snapshot_mapping_array->len; i++)
+    {
+        SnapshotMapping *mapping = g_ptr_array_index(new_snapshot_mapping_array, i);
+
+        if(find_source_mapping(source_mappings_table, mapping) != NULL)
+            g_ptr_array_add(mappings_with_source_array, mapping);
+    }
+
+    return mappings_with_source_array;
+}
+
+/* Fetch snapshots infrastructure */
+
+typedef struct
+{
+    GHashTable *source_mappings_table;
+    GHashTable *targets_table;
+    GHashTable *previous_targets_table;
+    unsigned int flags;
+}
+FetchSnapshotsData;
+
+static Target *find_source_target(const FetchSnapshotsData *fetch_snapshots_data, const SnapshotMapping *source_mapping)
+{
+    /* The previous machine may no longer be part of the current configuration */
+    Target *source_target = g_hash_table_lookup(fetch_snapshots_data->targets_table, (gchar*)source_mapping->target);
+
+    if(source_target == NULL)
+        source_target = g_hash_table_lookup(fetch_snapshots_data->previous_targets_table, (gchar*)source_mapping->target);
+
+    return source_target;
+}
+
+static pid_t fetch_snapshot_mapping_process(void *data, SnapshotMapping *mapping, Target *target)
+{
+    FetchSnapshotsData *fetch_snapshots_data = (FetchSnapshotsData*)data;
+    SnapshotMapping *source_mapping = find_source_mapping(fetch_snapshots_data->source_mappings_table, mapping);
+    Target *source_target = find_source_target(fetch_snapshots_data, source_mapping);
+    gchar *target_key = find_target_key(target);
+    gchar *source_target_key = find_target_key(source_target);
+    /* The receiving machine looks up the source interface in its own PATH, so only the name of the executable is passed */
+    gchar *source_interface = g_path_get_basename((gchar*)source_target->client_interface);
+    pid_t pid;
+
+    g_print("[target: %s]: Fetching snapshots of component: %s deployed to container: %s from target: %s\n", mapping->target, mapping->component, mapping->container, source_mapping->target);
+    pid = statemgmt_remote_fetch_snapshots((gchar*)target->client_interface, target_key, source_interface, source_target_key, (gchar*)mapping->container, (gchar*)mapping->component, fetch_snapshots_data->flags & FLAG_ALL);
+
+    g_free(source_interface);
+    return pid;
+}
+
+static ProcReact_bool check_source_targets(const FetchSnapshotsData *fetch_snapshots_data, const GPtrArray *mappings_with_source_array)
+{
+    ProcReact_bool success = TRUE;
+    unsigned int i;
+
+    for(i = 0; i < mappings_with_source_array->len; i++)
+    {
+        SnapshotMapping *mapping = g_ptr_array_index(mappings_with_source_array, i);
+        SnapshotMapping *source_mapping = find_source_mapping(fetch_snapshots_data->source_mappings_table, mapping);
+
+        if(find_source_target(fetch_snapshots_data, source_mapping) == NULL)
+        {
+            g_printerr("[target: %s]: Cannot find the previous machine: %s of component: %s\n", mapping->target, source_mapping->target, mapping->component);
+            success = FALSE;
+        }
+    }
+
+    return success;
+}
+
+static void complete_fetch_snapshot_mapping_process(void *data, SnapshotMapping *mapping, Target *target, ProcReact_Status status, ProcReact_bool result)
+{
+    if(status != PROCREACT_STATUS_OK || !result)
+        g_printerr("[target: %s]: Cannot fetch snapshots of component: %s deployed to container: %s\n", mapping->target, mapping->component, mapping->container);
+}
+
+static ProcReact_bool fetch_snapshots(GPtrArray *new_snapshot_mapping_array, GPtrArray *old_snapshot_mapping_array, GHashTable *targets_table, GHashTable *previous_targets_table, const unsigned int max_concurrent_transfers, const unsigned int flags)
+{
+    ProcReact_bool success;
+    GHashTable *source_mappings_table = create_source_mappings_table(old_snapshot_mapping_array);
+    GPtrArray *mappings_with_source_array = select_mappings_with_source(new_snapshot_mapping_array, source_mappings_table);
+    FetchSnapshotsData data = { source_mappings_table, targets_table, previous_targets_table, flags };
+
+    if(check_source_targets(&data, mappings_with_source_array))
+    {
+        ProcReact_PidIterator iterator = create_snapshot_mapping_pid_iterator(mappings_with_source_array, targets_table, fetch_snapshot_mapping_process, complete_fetch_snapshot_mapping_process, &data);
+
+        g_print("[coordinator]: Fetching snapshots directly from the previous machines...\n");
+
+        /* The snapshots do not pass through the coordinator, so there is no bulk lane to share */
+        fork_and_wait_for_transfers(&iterator, max_concurrent_transfers, NULL, "direct snapshot transfer");
+        success = snapshot_mapping_iterator_has_succeeded(iterator.data);
+
+        destroy_snapshot_mapping_pid_iterator(&iterator);
+    }
+    else
+        success = FALSE;
+
+    g_ptr_array_free(mappings_with_source_array, TRUE);
+    g_hash_table_destroy(source_mappings_table);
+
+    return success;
+}
+
+/* Clean snapshots infrastructure */
+
+static ProcReact_bool clean_migrated_snapshots(GPtrArray *new_snapshot_mapping_array, GPtrArray *old_snapshot_mapping_array, GHashTable *targets_table, GHashTable *previous_targets_table, const unsigned int max_concurrent_transfers, const int keep)
+{
+    g_print("[coordinator]: Cleaning snapshots on the previous and new machines...\n");
+
+    return clean_snapshot_mappings(old_snapshot_mapping_array, previous_targets_table, max_concurrent_transfers, keep)
+      && clean_snapshot_mappings(new_snapshot_mapping_array, targets_table, max_concurrent_transfers, keep);
+}
+
+/* The entire direct migration operation */
+
+ProcReact_bool migrate_directly(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const int keep)
+{
+    ProcReact_bool exit_status;
+    GPtrArray *old_snapshot_mapping_array = subtract_snapshot_mappings(previous_manifest->snapshot_mapping_array, manifest->snapshot_mapping_array);
+    GPtrArray *new_snapshot_mapping_array = subtract_snapshot_mappings(manifest->snapshot_mapping_array, previous_manifest->snapshot_mapping_array);
+
+    g_printerr("[coordinator]: Migrating state of moved components directly between machines...\n");
+
+    exit_status = ((flags & FLAG_TRANSFER_ONLY) || snapshot_services(old_snapshot_mapping_array, previous_manifest->services_table, manifest->targets_table))
+      && fetch_snapshots(new_snapshot_mapping_array, old_snapshot_mapping_array, manifest->targets_table, previous_manifest->targets_table, max_concurrent_transfers, flags)
+      && ((flags & FLAG_TRANSFER_ONLY) || restore_services(new_snapshot_mapping_array, manifest->services_table, manifest->targets_table))
+      && (!(flags & FLAG_DEPTH_FIRST) || clean_migrated_snapshots(new_snapshot_mapping_array, old_snapshot_mapping_array, manifest->targets_table, previous_manifest->targets_table, max_concurrent_transfers, keep)); /* Like the depth-first restore, do not leave the snapshots behind */
+
+    g_ptr_array_free(new_snapshot_mapping_array, TRUE);
+    g_ptr_array_free(old_snapshot_mapping_array, TRUE);
+
+    return exit_status;
+}
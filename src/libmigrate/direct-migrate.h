@@ -0,0 +1,51 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __DISNIX_DIRECT_MIGRATE_H
+#define __DISNIX_DIRECT_MIGRATE_H
+#include <glib.h>
+#include <procreact_types.h>
+#include <manifest.h>
+#include "datamigrationflags.h"
+
+/**
+ * Migrates the state of all moved stateful services directly from their
+ * previous machines to their new machines. The coordinator takes the snapshots
+ * on the previous machines and then instructs each new machine to fetch the
+ * snapshots from the previous machine itself, so that no snapshot is staged on
+ * the coordinator machine. Finally, the state is restored on the new machines.
+ *
+ * Services that have no previous location are only restored from the snapshots
+ * that already reside on their new machine.
+ *
+ * If FLAG_DEPTH_FIRST is set, then the obsolete snapshot generations of the
+ * migrated components are removed from both the previous and the new machines
+ * afterwards, like the depth-first snapshot and restore operations do.
+ *
+ * @param manifest Manifest containing all deployment information
+ * @param previous_manifest Manifest containing the previous deployment information
+ * @param max_concurrent_transfers Specifies the maximum amount of concurrent transfers
+ * @param flags Data migration option flags
+ * @param keep Number of snapshot generations to keep when cleaning the snapshots
+ * @return TRUE if the migration completed successfully, else FALSE
+ */
+ProcReact_bool migrate_directly(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const int keep);
+
+#endif
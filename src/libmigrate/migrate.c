@@ -21,10 +21,27 @@
 #include "snapshot.h"
 #include "restore.h"
 #include "delete-state.h"
+#include "direct-migrate.h"
+#include "pipelined-migrate.h"
+#include "budgeted-migrate.h"
 
-ProcReact_bool migrate(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const int keep)
+ProcReact_bool migrate(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const int keep, const guint64 max_snapshot_bytes)
 {
-    return (snapshot(manifest, previous_manifest, max_concurrent_transfers, flags, keep)
-      && restore(manifest, previous_manifest, max_concurrent_transfers, flags, keep)
+    ProcReact_bool transferred;
+
+    /* A direct migration only applies to components that move between machines, so it requires a previous configuration */
+    if((flags & FLAG_DIRECT) && previous_manifest != NULL && !(flags & FLAG_NO_UPGRADE))
+        transferred = migrate_directly(manifest, previous_manifest, max_concurrent_transfers, flags, keep);
+    else if(flags & FLAG_PIPELINE)
+        transferred = migrate_pipelined(manifest, previous_manifest, max_concurrent_transfers, flags, keep);
+    else if(max_snapshot_bytes > 0 && !(flags & FLAG_DEPTH_FIRST)) /* The depth first operation only stages the snapshots of one component per target at the time */
+        transferred = migrate_within_budget(manifest, previous_manifest, max_concurrent_transfers, flags, max_snapshot_bytes);
+    else
+    {
+        transferred = snapshot(manifest, previous_manifest, max_concurrent_transfers, flags, keep, 0)
+          && restore(manifest, previous_manifest, max_concurrent_transfers, flags, keep, 0);
+    }
+
+    return (transferred
       && (!(flags & FLAG_DELETE_STATE) || (previous_manifest == NULL) || (flags & FLAG_NO_UPGRADE) || delete_obsolete_state(previous_manifest->snapshot_mapping_array, previous_manifest->services_table, manifest->targets_table)));
 }
@@ -33,8 +33,9 @@
  * @param max_concurrent_transfers Specifies the maximum amount of concurrent transfers
  * @param flags Data migration option flags
  * @param keep Indicates how many snapshot generations should be kept remotely while executing the depth first operation
+ * @param max_snapshot_bytes Maximum amount of snapshot data in bytes that may be staged on the coordinator, or 0 for no limit
  * @return TRUE if the migration completed successfully, else FALSE
  */
-ProcReact_bool migrate(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const int keep);
+ProcReact_bool migrate(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const int keep, const guint64 max_snapshot_bytes);
 
 #endif
@@ -0,0 +1,408 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "pipelined-migrate.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <procreact_pid_iterator.h>
+#include <procreact_lane.h>
+#include <remote-state-management.h>
+#include <snapshot-management.h>
+#include <copy-snapshots.h>
+#include <snapshotmappingarray.h>
+#include <mappingparameters.h>
+#include <modeliterator.h>
+#include <transferlimit.h>
+
+/* Migration item infrastructure */
+
+/**
+ * @brief Groups the snapshot mappings of the same component that must be migrated together
+ */
+typedef struct
+{
+    /** Snapshot mappings from which snapshots must be taken and retrieved */
+    GPtrArray *source_mapping_array;
+    /** Snapshot mappings to which snapshots must be sent and restored */
+    GPtrArray *destination_mapping_array;
+}
+MigrationItem;
+
+static MigrationItem *find_or_create_migration_item(GHashTable *items_table, GPtrArray *items_array, const SnapshotMapping *mapping)
+{
+    gchar *key = g_strconcat((gchar*)mapping->container, "/", (gchar*)mapping->component, NULL);
+    MigrationItem *item = g_hash_table_lookup(items_table, key);
+
+    if(item == NULL)
+    {
+        item = (MigrationItem*)g_malloc(sizeof(MigrationItem));
+        item->source_mapping_array = g_ptr_array_new();
+        item->destination_mapping_array = g_ptr_array_new();
+        g_hash_table_insert(items_table, key, item);
+        g_ptr_array_add(items_array, item);
+    }
+    else
+        g_free(key);
+
+    return item;
+}
+
+static GPtrArray *create_migration_items_array(const GPtrArray *source_mapping_array, const GPtrArray *destination_mapping_array)
+{
+    GPtrArray *items_array = g_ptr_array_new();
+    GHashTable *items_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    unsigned int i;
+
+    if(source_mapping_array != NULL)
+    {
+        for(i = 0; i < source_mapping_array->len; i++)
+        {
+            SnapshotMapping *mapping = g_ptr_array_index(source_mapping_array, i);
+            MigrationItem *item = find_or_create_migration_item(items_table, items_array, mapping);
+            g_ptr_array_add(item->source_mapping_array, mapping);
+        }
+    }
+
+    for(i = 0; i < destination_mapping_array->len; i++)
+    {
+        SnapshotMapping *mapping = g_ptr_array_index(destination_mapping_array, i);
+        MigrationItem *item = find_or_create_migration_item(items_table, items_array, mapping);
+        g_ptr_array_add(item->destination_mapping_array, mapping);
+    }
+
+    g_hash_table_destroy(items_table);
+    return items_array;
+}
+
+static void delete_migration_items_array(GPtrArray *items_array)
+{
+    unsigned int i;
+
+    for(i = 0; i < items_array->len; i++)
+    {
+        MigrationItem *item = g_ptr_array_index(items_array, i);
+        g_ptr_array_free(item->source_mapping_array, TRUE);
+        g_ptr_array_free(item->destination_mapping_array, TRUE);
+        g_free(item);
+    }
+
+    g_ptr_array_free(items_array, TRUE);
+}
+
+/* Stage limits infrastructure */
+
+static unsigned int determine_max_staged_snapshots(const unsigned int max_concurrent_transfers)
+{
+    char *max_staged_snapshots = getenv("DISNIX_MAX_STAGED_SNAPSHOTS");
+
+    if(max_staged_snapshots == NULL || atoi(max_staged_snapshots) <= 0)
+        return 2 * max_concurrent_transfers;
+    else
+        return atoi(max_staged_snapshots);
+}
+
+static void delete_lane(gpointer data)
+{
+    ProcReact_Lane *lane = (ProcReact_Lane*)data;
+    procreact_destroy_lane(lane);
+    g_free(lane);
+}
+
+static GHashTable *create_target_lanes_table(GHashTable *targets_table)
+{
+    GHashTable *target_lanes_table = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, delete_lane);
+    GHashTableIter iter;
+    gpointer key, value;
+
+    /* Each target gets a lane with a token for each of its CPU cores, shared by the snapshot and restore stages */
+    g_hash_table_iter_init(&iter, targets_table);
+    while(g_hash_table_iter_next(&iter, &key, &value))
+    {
+        Target *target = (Target*)value;
+        ProcReact_Lane *lane = (ProcReact_Lane*)g_malloc(sizeof(ProcReact_Lane));
+        *lane = procreact_create_lane(target->num_of_cores > 0 ? target->num_of_cores : 1);
+        g_hash_table_insert(target_lanes_table, key, lane);
+    }
+
+    return target_lanes_table;
+}
+
+/* Pipelined migration infrastructure */
+
+typedef struct
+{
+    GHashTable *previous_services_table;
+    GHashTable *services_table;
+    GHashTable *targets_table;
+    GHashTable *target_lanes_table;
+    ProcReact_Lane *bulk_lane;
+    ProcReact_Lane *staging_lane;
+    unsigned int flags;
+    int keep;
+}
+PipelinedMigrationData;
+
+typedef pid_t (*run_state_activity_function) (gchar *interface, gchar *target, gchar *container, gchar *type, gchar **arguments, const unsigned int arguments_size, gchar *service);
+
+static ProcReact_bool run_state_activity_on_target_sync(SnapshotMapping *mapping, GHashTable *services_table, const PipelinedMigrationData *pipelined_migration_data, run_state_activity_function run_state_activity)
+{
+    Target *target = g_hash_table_lookup(pipelined_migration_data->targets_table, (gchar*)mapping->target);
+    ProcReact_Lane *target_lane = g_hash_table_lookup(pipelined_migration_data->target_lanes_table, (gchar*)mapping->target);
+
+    if(target == NULL || target_lane == NULL)
+    {
+        g_printerr("[target: %s]: Skipping state of component: %s since the machine is not present!\n", mapping->target, mapping->component);
+        return TRUE;
+    }
+    else if(!procreact_lane_acquire(target_lane))
+        return FALSE;
+    else
+    {
+        MappingParameters params = create_mapping_parameters(mapping->service, mapping->container, mapping->target, mapping->container_provided_by_service, services_table, target);
+        gchar *target_key = find_target_key(target);
+        ProcReact_Status status;
+        ProcReact_bool result = procreact_wait_for_boolean(run_state_activity((gchar*)target->client_interface, target_key, (gchar*)mapping->container, (gchar*)params.type, (gchar**)params.arguments, params.arguments_size, (gchar*)params.service->pkg), &status);
+
+        procreact_lane_release(target_lane);
+        destroy_mapping_parameters(&params);
+
+        return (status == PROCREACT_STATUS_OK && result);
+    }
+}
+
+static ProcReact_bool take_snapshots_sync(const MigrationItem *item, const PipelinedMigrationData *pipelined_migration_data)
+{
+    unsigned int i;
+
+    for(i = 0; i < item->source_mapping_array->len; i++)
+    {
+        SnapshotMapping *mapping = g_ptr_array_index(item->source_mapping_array, i);
+
+        g_print("[target: %s]: Snapshotting state of service: %s\n", mapping->target, mapping->component);
+
+        if(!run_state_activity_on_target_sync(mapping, pipelined_migration_data->previous_services_table, pipelined_migration_data, statemgmt_remote_snapshot))
+        {
+            g_printerr("[target: %s]: Cannot snapshot state of service: %s\n", mapping->target, mapping->component);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static ProcReact_bool retrieve_snapshots_sync(const MigrationItem *item, const PipelinedMigrationData *pipelined_migration_data)
+{
+    unsigned int i;
+
+    for(i = 0; i < item->source_mapping_array->len; i++)
+    {
+        SnapshotMapping *mapping = g_ptr_array_index(item->source_mapping_array, i);
+        Target *target = g_hash_table_lookup(pipelined_migration_data->targets_table, (gchar*)mapping->target);
+
+        if(target != NULL)
+        {
+            gchar *target_key = find_target_key(target);
+
+            g_print("[target: %s]: Retrieving snapshots of component: %s deployed to container: %s\n", mapping->target, mapping->component, mapping->container);
+
+            if(!copy_snapshots_from_sync((gchar*)target->client_interface, target_key, (gchar*)mapping->container, (gchar*)mapping->component, pipelined_migration_data->flags & FLAG_ALL, pipelined_migration_data->bulk_lane, STDOUT_FILENO, STDERR_FILENO))
+            {
+                g_printerr("[target: %s]: Cannot retrieve snapshots of component: %s deployed to container: %s\n", mapping->target, mapping->component, mapping->container);
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+static ProcReact_bool send_and_restore_snapshots_sync(const MigrationItem *item, const PipelinedMigrationData *pipelined_migration_data)
+{
+    unsigned int i;
+
+    for(i = 0; i < item->destination_mapping_array->len; i++)
+    {
+        SnapshotMapping *mapping = g_ptr_array_index(item->destination_mapping_array, i);
+        Target *target = g_hash_table_lookup(pipelined_migration_data->targets_table, (gchar*)mapping->target);
+
+        if(target != NULL)
+        {
+            gchar *target_key = find_target_key(target);
+
+            g_print("[target: %s]: Sending snapshots of component: %s deployed to container: %s\n", mapping->target, mapping->component, mapping->container);
+
+            if(!copy_snapshots_to_sync((gchar*)target->client_interface, target_key, (gchar*)mapping->container, (gchar*)mapping->component, pipelined_migration_data->flags & FLAG_ALL, pipelined_migration_data->bulk_lane, STDERR_FILENO))
+            {
+                g_printerr("[target: %s]: Cannot send snapshots of component: %s deployed to container: %s\n", mapping->target, mapping->component, mapping->container);
+                return FALSE;
+            }
+
+            if(!(pipelined_migration_data->flags & FLAG_TRANSFER_ONLY))
+            {
+                g_print("[target: %s]: Restoring state of service: %s\n", mapping->target, mapping->component);
+
+                if(!run_state_activity_on_target_sync(mapping, pipelined_migration_data->services_table, pipelined_migration_data, statemgmt_remote_restore))
+                {
+                    g_printerr("[target: %s]: Cannot restore state of service: %s\n", mapping->target, mapping->component);
+                    return FALSE;
+                }
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+static ProcReact_bool clean_staged_snapshots_sync(const MigrationItem *item, const PipelinedMigrationData *pipelined_migration_data)
+{
+    SnapshotMapping *mapping = g_ptr_array_index(item->destination_mapping_array, 0);
+    ProcReact_Status status;
+    ProcReact_bool result = procreact_wait_for_boolean(statemgmt_clean_snapshots(pipelined_migration_data->keep, (gchar*)mapping->container, (gchar*)mapping->component, STDOUT_FILENO, STDERR_FILENO), &status);
+    return (status == PROCREACT_STATUS_OK && result);
+}
+
+static ProcReact_bool migrate_item_sync(const MigrationItem *item, const PipelinedMigrationData *pipelined_migration_data)
+{
+    if(item->source_mapping_array->len == 0)
+        return send_and_restore_snapshots_sync(item, pipelined_migration_data); /* There is nothing to stage, the snapshots already reside on the coordinator */
+    else if(!(pipelined_migration_data->flags & FLAG_TRANSFER_ONLY) && !take_snapshots_sync(item, pipelined_migration_data))
+        return FALSE;
+    else if(!procreact_lane_acquire(pipelined_migration_data->staging_lane))
+        return FALSE;
+    else
+    {
+        /* The staging token is held from the retrieval until the snapshots have been delivered, so that the amount of staged snapshots stays bounded */
+        ProcReact_bool status = retrieve_snapshots_sync(item, pipelined_migration_data)
+          && send_and_restore_snapshots_sync(item, pipelined_migration_data)
+          && (item->destination_mapping_array->len == 0 || clean_staged_snapshots_sync(item, pipelined_migration_data));
+
+        procreact_lane_release(pipelined_migration_data->staging_lane);
+        return status;
+    }
+}
+
+/* Migration item iterator infrastructure */
+
+typedef struct
+{
+    ModelIteratorData model_iterator_data;
+    const GPtrArray *items_array;
+    PipelinedMigrationData *pipelined_migration_data;
+}
+MigrationItemIteratorData;
+
+static int has_next_migration_item(void *data)
+{
+    MigrationItemIteratorData *iterator_data = (MigrationItemIteratorData*)data;
+    return has_next_iteration_process(&iterator_data->model_iterator_data);
+}
+
+static pid_t next_migration_item_process(void *data)
+{
+    MigrationItemIteratorData *iterator_data = (MigrationItemIteratorData*)data;
+    MigrationItem *item = g_ptr_array_index(iterator_data->items_array, iterator_data->model_iterator_data.index);
+    pid_t pid = fork();
+
+    if(pid == 0)
+        _exit(!migrate_item_sync(item, iterator_data->pipelined_migration_data));
+
+    next_iteration_process(&iterator_data->model_iterator_data, pid, item);
+    return pid;
+}
+
+static void complete_migration_item_process(void *data, pid_t pid, ProcReact_Status status, int result)
+{
+    MigrationItemIteratorData *iterator_data = (MigrationItemIteratorData*)data;
+    complete_iteration_process(&iterator_data->model_iterator_data, pid, status, result);
+}
+
+/* The entire pipelined migration operation */
+
+ProcReact_bool migrate_pipelined(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const int keep)
+{
+    GPtrArray *source_mapping_array, *destination_mapping_array, *items_array;
+    GHashTable *previous_services_table, *target_lanes_table;
+    ProcReact_Lane bulk_lane, staging_lane;
+    unsigned int max_staged_snapshots;
+    ProcReact_bool success;
+
+    /* Determine the same snapshot mappings as snapshot() and restore() */
+    if(flags & FLAG_NO_UPGRADE)
+    {
+        source_mapping_array = manifest->snapshot_mapping_array;
+        destination_mapping_array = manifest->snapshot_mapping_array;
+    }
+    else if(previous_manifest == NULL)
+    {
+        g_printerr("[coordinator]: No snapshots are taken since an upgrade is requested and no previous deployment state is known\n");
+        source_mapping_array = NULL;
+        destination_mapping_array = manifest->snapshot_mapping_array;
+    }
+    else
+    {
+        source_mapping_array = subtract_snapshot_mappings(previous_manifest->snapshot_mapping_array, manifest->snapshot_mapping_array);
+        destination_mapping_array = subtract_snapshot_mappings(manifest->snapshot_mapping_array, previous_manifest->snapshot_mapping_array);
+    }
+
+    previous_services_table = (previous_manifest == NULL) ? manifest->services_table : previous_manifest->services_table;
+
+    items_array = create_migration_items_array(source_mapping_array, destination_mapping_array);
+    target_lanes_table = create_target_lanes_table(manifest->targets_table);
+    max_staged_snapshots = determine_max_staged_snapshots(max_concurrent_transfers);
+    bulk_lane = create_bulk_transfer_lane(max_concurrent_transfers);
+    staging_lane = procreact_create_lane(max_staged_snapshots);
+
+    {
+        PipelinedMigrationData data = { previous_services_table, manifest->services_table, manifest->targets_table, target_lanes_table, &bulk_lane, &staging_lane, flags, keep };
+        MigrationItemIteratorData iterator_data;
+        ProcReact_PidIterator iterator = procreact_initialize_pid_iterator(has_next_migration_item, next_migration_item_process, procreact_retrieve_boolean, complete_migration_item_process, &iterator_data);
+
+        init_model_iterator_data(&iterator_data.model_iterator_data, items_array->len);
+        iterator_data.items_array = items_array;
+        iterator_data.pipelined_migration_data = &data;
+
+        g_print("[coordinator]: Snapshotting, transferring and restoring state of components...\n");
+
+        /*
+         * Every component moves through the stages independently. The stages
+         * are bounded by their own lanes, so the amount of processes only
+         * needs to be bounded to keep every stage busy while the staging slots
+         * are occupied.
+         */
+        procreact_fork_and_wait_in_parallel_limit(&iterator, max_staged_snapshots + max_concurrent_transfers);
+        success = iterator_data.model_iterator_data.success;
+
+        destroy_model_iterator_data(&iterator_data.model_iterator_data);
+    }
+
+    procreact_destroy_lane(&staging_lane);
+    procreact_destroy_lane(&bulk_lane);
+    g_hash_table_destroy(target_lanes_table);
+    delete_migration_items_array(items_array);
+
+    if(!(flags & FLAG_NO_UPGRADE) && previous_manifest != NULL)
+    {
+        g_ptr_array_free(source_mapping_array, TRUE);
+        g_ptr_array_free(destination_mapping_array, TRUE);
+    }
+
+    return success;
+}
@@ -22,25 +22,108 @@
 #include <remote-state-management.h>
 #include <remote-snapshot-management.h>
 #include <snapshotmapping-traverse.h>
+#include <snapshotmapping-iterator.h>
 #include <targets-iterator.h>
 #include <manifestservicestable.h>
 #include <mappingparameters.h>
 #include <copy-snapshots.h>
+#include <transferlimit.h>
+#include "snapshot-budget.h"
+#include "clean-snapshot-mappings.h"
+
+/* Restore snapshot infrastructure */
+
+static pid_t restore_snapshot_on_target(SnapshotMapping *mapping, ManifestService *service, Target *target, xmlChar *type, xmlChar **arguments, unsigned int arguments_length)
+{
+    gchar *target_key = find_target_key(target);
+    g_print("[target: %s]: Restoring state of service: %s\n", mapping->target, mapping->component);
+    return statemgmt_remote_restore((char*)target->client_interface, target_key, (char*)mapping->container, (char*)type, (char**)arguments, arguments_length, (char*)service->pkg);
+}
+
+static void complete_restore_snapshot_on_target(SnapshotMapping *mapping, ManifestService *service, Target *target, ProcReact_Status status, int result)
+{
+    if(status != PROCREACT_STATUS_OK || !result)
+        g_printerr("[target: %s]: Cannot restore state of service: %s\n", mapping->target, mapping->component);
+}
 
 /* Send snapshots infrastructure */
 
 typedef struct
 {
     GPtrArray *snapshot_mapping_array;
+    GHashTable *services_table;
+    GHashTable *targets_table;
     unsigned int flags;
+    ProcReact_Lane *bulk_lane;
+    ProcReact_Lane *core_lane;
+    GHashTable *sizes_table;
+    ProcReact_AdaptiveLimit *adaptive_limit;
 }
 SendSnapshotsData;
 
-static pid_t send_snapshot_mapping(SnapshotMapping *mapping, Target *target, const unsigned int flags)
+static pid_t send_snapshot_mapping(SnapshotMapping *mapping, Target *target, const unsigned int flags, const ProcReact_Lane *bulk_lane)
 {
     gchar *target_key = find_target_key(target);
     g_print("[target: %s]: Sending snapshots of component: %s deployed to container: %s\n", mapping->target, mapping->component, mapping->container);
-    return copy_snapshots_to((gchar*)target->client_interface, target_key, (gchar*)mapping->container, (gchar*)mapping->component, flags & FLAG_ALL, STDERR_FILENO);
+    return copy_snapshots_to((gchar*)target->client_interface, target_key, (gchar*)mapping->container, (gchar*)mapping->component, flags & FLAG_ALL, bulk_lane, STDERR_FILENO);
+}
+
+static ProcReact_bool restore_snapshot_mapping_sync(SnapshotMapping *mapping, Target *target, const SendSnapshotsData *send_snapshots_data)
+{
+    if(!procreact_lane_acquire(send_snapshots_data->core_lane))
+        return FALSE;
+    else
+    {
+        MappingParameters params = create_mapping_parameters(mapping->service, mapping->container, mapping->target, mapping->container_provided_by_service, send_snapshots_data->services_table, target);
+        ProcReact_Status status;
+        ProcReact_bool result = procreact_wait_for_boolean(restore_snapshot_on_target(mapping, params.service, target, params.type, params.arguments, params.arguments_size), &status);
+
+        complete_restore_snapshot_on_target(mapping, params.service, target, status, result);
+
+        destroy_mapping_parameters(&params);
+        procreact_lane_release(send_snapshots_data->core_lane);
+
+        return (status == PROCREACT_STATUS_OK && result);
+    }
+}
+
+static pid_t send_and_restore_snapshot_mapping(SnapshotMapping *mapping, Target *target, const SendSnapshotsData *send_snapshots_data)
+{
+    pid_t pid = fork();
+
+    if(pid == 0)
+    {
+        ProcReact_Status status;
+        ProcReact_bool result = procreact_wait_for_boolean(send_snapshot_mapping(mapping, target, send_snapshots_data->flags, send_snapshots_data->bulk_lane), &status);
+
+        /* Restore the state as soon as its snapshots have been imported, while the snapshots of the other components are still being sent */
+        _exit(status != PROCREACT_STATUS_OK || !result || !restore_snapshot_mapping_sync(mapping, target, send_snapshots_data));
+    }
+
+    return pid;
+}
+
+static pid_t send_snapshot_mapping_process(void *data, SnapshotMapping *mapping, Target *target)
+{
+    SendSnapshotsData *send_snapshots_data = (SendSnapshotsData*)data;
+
+    if(send_snapshots_data->core_lane == NULL)
+        return send_snapshot_mapping(mapping, target, send_snapshots_data->flags, send_snapshots_data->bulk_lane);
+    else
+        return send_and_restore_snapshot_mapping(mapping, target, send_snapshots_data);
+}
+
+static void complete_send_snapshot_mapping_process(void *data, SnapshotMapping *mapping, Target *target, ProcReact_Status status, ProcReact_bool result)
+{
+    SendSnapshotsData *send_snapshots_data = (SendSnapshotsData*)data;
+
+    if(status != PROCREACT_STATUS_OK || !result)
+    {
+        if(send_snapshots_data->core_lane == NULL)
+            g_printerr("[target: %s]: Cannot send snapshots of component: %s deployed to container: %s\n", mapping->target, mapping->component, mapping->container);
+        else
+            g_printerr("[target: %s]: Cannot send or restore snapshots of component: %s deployed to container: %s\n", mapping->target, mapping->component, mapping->container);
+    }
 }
 
 pid_t send_snapshots_to_target(void *data, gchar *target_name, Target *target)
@@ -49,30 +132,33 @@ pid_t send_snapshots_to_target(void *data, gchar *target_name, Target *target)
 
     if(pid == 0)
     {
-        SendSnapshotsData *send_snapshots_data = (SendSnapshotsData*)data;
+        SendSnapshotsData send_snapshots_data = *((SendSnapshotsData*)data);
 
         gchar *target_key = find_target_key(target);
-        GPtrArray *snapshots_per_target_array = find_snapshot_mappings_per_target(send_snapshots_data->snapshot_mapping_array, target_key);
-        unsigned int i;
-        int exit_status = 0;
-        ProcReact_Status status;
+        GPtrArray *snapshots_per_target_array = find_snapshot_mappings_per_target(send_snapshots_data.snapshot_mapping_array, target_key);
+        ProcReact_PidIterator iterator;
+        ProcReact_Lane core_lane;
+        int exit_status;
 
-        for(i = 0; i < snapshots_per_target_array->len; i++)
+        /* When the state must be restored as well, the restore operations on this target are bounded by its amount of CPU cores */
+        if(send_snapshots_data.services_table != NULL)
         {
-            SnapshotMapping *mapping = g_ptr_array_index(snapshots_per_target_array, i);
-            exit_status = procreact_wait_for_exit_status(send_snapshot_mapping(mapping, target, send_snapshots_data->flags), &status);
-
-            if(status != PROCREACT_STATUS_OK)
-            {
-                exit_status = 1;
-                break;
-            }
-            else if(exit_status != 0)
-                break;
+            core_lane = procreact_create_lane(target->num_of_cores > 0 ? target->num_of_cores : 1);
+            send_snapshots_data.core_lane = &core_lane;
         }
 
+        iterator = create_snapshot_mapping_pid_iterator(snapshots_per_target_array, send_snapshots_data.targets_table, send_snapshot_mapping_process, complete_send_snapshot_mapping_process, &send_snapshots_data);
+
+        /* Send the snapshots of multiple components of this target concurrently, their bulk transfers are still bounded by the shared bulk lane */
+        procreact_fork_and_wait_in_parallel_limit(&iterator, determine_max_transfers_per_target(send_snapshots_data.bulk_lane));
+        exit_status = !snapshot_mapping_iterator_has_succeeded(iterator.data);
+
+        destroy_snapshot_mapping_pid_iterator(&iterator);
         g_ptr_array_free(snapshots_per_target_array, TRUE);
 
+        if(send_snapshots_data.core_lane != NULL)
+            procreact_destroy_lane(send_snapshots_data.core_lane);
+
         exit(exit_status);
     }
 
@@ -81,59 +167,72 @@ pid_t send_snapshots_to_target(void *data, gchar *target_name, Target *target)
 
 void complete_send_snapshots_to_target(void *data, gchar *target_name, Target *target, ProcReact_Status status, int result)
 {
+    SendSnapshotsData *send_snapshots_data = (SendSnapshotsData*)data;
+
     if(status != PROCREACT_STATUS_OK || !result)
-        g_printerr("[target: %s]: Cannot retrieve snapshots!\n", target_name);
+        g_printerr("[target: %s]: Cannot send snapshots!\n", target_name);
+    else if(send_snapshots_data->adaptive_limit != NULL)
+    {
+        /* Let the adaptive concurrency controller measure the throughput in bytes */
+        guint64 *size = (guint64*)g_hash_table_lookup(send_snapshots_data->sizes_table, target_name);
+
+        if(size != NULL)
+            procreact_adaptive_limit_add_units(send_snapshots_data->adaptive_limit, *size);
+    }
 }
 
-static ProcReact_bool send_snapshots(GPtrArray *snapshot_mapping_array, GHashTable *targets_table, const unsigned int max_concurrent_transfers, const unsigned int flags)
+static ProcReact_bool send_snapshots_and_optionally_restore(GPtrArray *snapshot_mapping_array, GHashTable *services_table, GHashTable *targets_table, const unsigned int max_concurrent_transfers, const unsigned int flags)
 {
     ProcReact_bool success;
-    SendSnapshotsData data = { snapshot_mapping_array, flags };
+    ProcReact_Lane bulk_lane = create_bulk_transfer_lane(max_concurrent_transfers);
+    GHashTable *sizes_table = adaptive_transfers_enabled() ? query_snapshot_sizes_per_target(snapshot_mapping_array, targets_table, flags, TRUE, max_concurrent_transfers) : NULL;
+    SendSnapshotsData data = { snapshot_mapping_array, services_table, targets_table, flags, &bulk_lane, NULL, sizes_table, NULL };
     ProcReact_PidIterator iterator = create_target_pid_iterator(targets_table, send_snapshots_to_target, complete_send_snapshots_to_target, &data);
-    procreact_fork_and_wait_in_parallel_limit(&iterator, max_concurrent_transfers);
+    fork_and_wait_for_measured_transfers(&iterator, max_concurrent_transfers, &bulk_lane, &data.adaptive_limit, "snapshot transfer");
     success = target_iterator_has_succeeded(iterator.data);
 
     destroy_target_pid_iterator(&iterator);
+    procreact_destroy_lane(&bulk_lane);
+
+    if(sizes_table != NULL)
+        g_hash_table_destroy(sizes_table);
 
     return success;
 }
 
-/* Restore snapshot infrastructure */
-
-static pid_t restore_snapshot_on_target(SnapshotMapping *mapping, ManifestService *service, Target *target, xmlChar *type, xmlChar **arguments, unsigned int arguments_length)
+ProcReact_bool send_snapshots(GPtrArray *snapshot_mapping_array, GHashTable *targets_table, const unsigned int max_concurrent_transfers, const unsigned int flags)
 {
-    gchar *target_key = find_target_key(target);
-    g_print("[target: %s]: Restoring state of service: %s\n", mapping->target, mapping->component);
-    return statemgmt_remote_restore((char*)target->client_interface, target_key, (char*)mapping->container, (char*)type, (char**)arguments, arguments_length, (char*)service->pkg);
+    return send_snapshots_and_optionally_restore(snapshot_mapping_array, NULL, targets_table, max_concurrent_transfers, flags);
 }
 
-static void complete_restore_snapshot_on_target(SnapshotMapping *mapping, ManifestService *service, Target *target, ProcReact_Status status, int result)
+ProcReact_bool send_and_restore_snapshots(GPtrArray *snapshot_mapping_array, GHashTable *services_table, GHashTable *targets_table, const unsigned int max_concurrent_transfers, const unsigned int flags)
 {
-    if(status != PROCREACT_STATUS_OK || !result)
-        g_printerr("[target: %s]: Cannot restore state of service: %s\n", mapping->target, mapping->component);
+    if(flags & FLAG_TRANSFER_ONLY)
+        return send_snapshots(snapshot_mapping_array, targets_table, max_concurrent_transfers, flags);
+    else
+    {
+        g_print("[coordinator]: Sending snapshots and restoring state of services...\n");
+        return send_snapshots_and_optionally_restore(snapshot_mapping_array, services_table, targets_table, max_concurrent_transfers, flags);
+    }
 }
 
-static ProcReact_bool restore_services(GPtrArray *snapshot_mapping_array, GHashTable *services_table, GHashTable *targets_table)
+/* Restore services infrastructure */
+
+ProcReact_bool restore_services(GPtrArray *snapshot_mapping_array, GHashTable *services_table, GHashTable *targets_table)
 {
     g_print("[coordinator]: Restoring state of services...\n");
     return map_snapshot_items(snapshot_mapping_array, services_table, targets_table, restore_snapshot_on_target, complete_restore_snapshot_on_target);
 }
 
-/* Clean snapshot mapping infrastructure */
-
-static pid_t clean_snapshot_mapping(SnapshotMapping *mapping, Target *target, int keep)
-{
-    gchar *target_key = find_target_key(target);
-    g_print("[target: %s]: Cleaning snapshots of component: %s deployed to container: %s\n", mapping->target, mapping->component, mapping->container);
-    return statemgmt_remote_clean_snapshots((char*)target->client_interface, target_key, keep, (char*)mapping->container, (char*)mapping->component);
-}
-
 typedef struct
 {
     GHashTable *services_table;
     GPtrArray *snapshot_mapping_array;
     unsigned int flags;
     int keep;
+    ProcReact_Lane *bulk_lane;
+    GHashTable *sizes_table;
+    ProcReact_AdaptiveLimit *adaptive_limit;
 }
 SendRestoreAndCleanSnapshotsData;
 
@@ -159,9 +258,8 @@ static pid_t send_restore_and_clean_snapshot_on_target(void *data, gchar *target
 
             MappingParameters params = create_mapping_parameters(mapping->service, mapping->container, mapping->target, mapping->container_provided_by_service, send_snapshots_data->services_table, target);
 
-            if(!procreact_wait_for_boolean(send_snapshot_mapping(mapping, target, send_snapshots_data->flags), &status) || (status != PROCREACT_STATUS_OK)
-              || !procreact_wait_for_boolean(restore_snapshot_on_target(mapping, params.service, target, params.type, params.arguments, params.arguments_size), &status) || (status != PROCREACT_STATUS_OK)
-              || !procreact_wait_for_boolean(clean_snapshot_mapping(mapping, target, send_snapshots_data->keep), &status) || (status != PROCREACT_STATUS_OK))
+            if(!procreact_wait_for_boolean(send_snapshot_mapping(mapping, target, send_snapshots_data->flags, send_snapshots_data->bulk_lane), &status) || (status != PROCREACT_STATUS_OK)
+              || !procreact_wait_for_boolean(restore_snapshot_on_target(mapping, params.service, target, params.type, params.arguments, params.arguments_size), &status) || (status != PROCREACT_STATUS_OK))
             {
                 exit_status = 1;
                 destroy_mapping_parameters(&params);
@@ -171,6 +269,11 @@ static pid_t send_restore_and_clean_snapshot_on_target(void *data, gchar *target
             destroy_mapping_parameters(&params);
         }
 
+        /* Clean the snapshots of all components of this target with a single garbage collect operation */
+        if(exit_status == 0 && snapshots_per_target_array->len > 0
+          && (!procreact_wait_for_boolean(clean_snapshot_mappings_on_target(snapshots_per_target_array, target, send_snapshots_data->keep), &status) || (status != PROCREACT_STATUS_OK)))
+            exit_status = 1;
+
         g_ptr_array_free(snapshots_per_target_array, TRUE);
 
         exit(exit_status);
@@ -181,29 +284,79 @@ static pid_t send_restore_and_clean_snapshot_on_target(void *data, gchar *target
 
 void complete_send_restore_and_clean_snapshots_on_target(void *data, gchar *target_name, Target *target, ProcReact_Status status, int result)
 {
+    SendRestoreAndCleanSnapshotsData *send_snapshots_data = (SendRestoreAndCleanSnapshotsData*)data;
+
     if(status != PROCREACT_STATUS_OK || !result)
         g_printerr("[target: %s]: Cannot send, restore or clean snapshots!\n", target_name);
+    else if(send_snapshots_data->adaptive_limit != NULL)
+    {
+        /* Let the adaptive concurrency controller measure the throughput in bytes */
+        guint64 *size = (guint64*)g_hash_table_lookup(send_snapshots_data->sizes_table, target_name);
+
+        if(size != NULL)
+            procreact_adaptive_limit_add_units(send_snapshots_data->adaptive_limit, *size);
+    }
 }
 
 static ProcReact_bool restore_depth_first(GPtrArray *snapshot_mapping_array, GHashTable *services_table, GHashTable *targets_table, const unsigned int max_concurrent_transfers, const unsigned int flags, const int keep)
 {
     ProcReact_bool success;
-    SendRestoreAndCleanSnapshotsData data = { services_table, snapshot_mapping_array, flags, keep };
+    ProcReact_Lane bulk_lane = create_bulk_transfer_lane(max_concurrent_transfers);
+    GHashTable *sizes_table = adaptive_transfers_enabled() ? query_snapshot_sizes_per_target(snapshot_mapping_array, targets_table, flags, TRUE, max_concurrent_transfers) : NULL;
+    SendRestoreAndCleanSnapshotsData data = { services_table, snapshot_mapping_array, flags, keep, &bulk_lane, sizes_table, NULL };
     ProcReact_PidIterator iterator = create_target_pid_iterator(targets_table, send_restore_and_clean_snapshot_on_target, complete_send_restore_and_clean_snapshots_on_target, &data);
 
     g_print("[coordinator]: Sending, restoring and cleaning snapshots...\n");
 
-    procreact_fork_and_wait_in_parallel_limit(&iterator, max_concurrent_transfers);
+    fork_and_wait_for_measured_transfers(&iterator, max_concurrent_transfers, &bulk_lane, &data.adaptive_limit, "snapshot transfer");
     success = target_iterator_has_succeeded(iterator.data);
 
     destroy_target_pid_iterator(&iterator);
+    procreact_destroy_lane(&bulk_lane);
+
+    if(sizes_table != NULL)
+        g_hash_table_destroy(sizes_table);
 
     return success;
 }
 
+/* Restore within snapshot budget infrastructure */
+
+static ProcReact_bool restore_within_budget(GPtrArray *snapshot_mapping_array, GHashTable *services_table, GHashTable *targets_table, const unsigned int max_concurrent_transfers, const unsigned int flags, const int keep, const guint64 max_snapshot_bytes)
+{
+    ProcReact_bool success = TRUE;
+    GPtrArray *snapshot_batches_array = create_snapshot_batches_array(snapshot_mapping_array, targets_table, flags, max_snapshot_bytes, TRUE, max_concurrent_transfers);
+    unsigned int i;
+
+    if(snapshot_batches_array == NULL)
+        return FALSE;
+
+    /*
+     * Each batch is sent, restored and cleaned breadth first before the next
+     * batch is sent, so that the snapshot data that the targets receive at the
+     * same time never exceeds the budget
+     */
+    for(i = 0; i < snapshot_batches_array->len; i++)
+    {
+        SnapshotBatch *batch = g_ptr_array_index(snapshot_batches_array, i);
+
+        g_print("[coordinator]: Sending, restoring and cleaning snapshots of batch: %u of %u (%" G_GUINT64_FORMAT " bytes)...\n", i + 1, snapshot_batches_array->len, batch->size);
+
+        if(!send_and_restore_snapshots(batch->snapshot_mapping_array, services_table, targets_table, max_concurrent_transfers, flags)
+          || !clean_snapshot_mappings(batch->snapshot_mapping_array, targets_table, max_concurrent_transfers, keep))
+        {
+            success = FALSE;
+            break;
+        }
+    }
+
+    delete_snapshot_batches_array(snapshot_batches_array);
+    return success;
+}
+
 /* The entire restore operation */
 
-ProcReact_bool restore(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const unsigned int keep)
+ProcReact_bool restore(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const unsigned int keep, const guint64 max_snapshot_bytes)
 {
     ProcReact_bool exit_status;
     GPtrArray *snapshot_mapping_array;
@@ -221,11 +374,10 @@ ProcReact_bool restore(const Manifest *manifest, const Manifest *previous_manife
 
     if(flags & FLAG_DEPTH_FIRST)
         exit_status = restore_depth_first(snapshot_mapping_array, manifest->services_table, manifest->targets_table, max_concurrent_transfers, flags, keep);
+    else if(max_snapshot_bytes > 0)
+        exit_status = restore_within_budget(snapshot_mapping_array, manifest->services_table, manifest->targets_table, max_concurrent_transfers, flags, keep, max_snapshot_bytes);
     else
-    {
-        exit_status = send_snapshots(snapshot_mapping_array, manifest->targets_table, max_concurrent_transfers, flags) /* First, send the snapshots to the remote machines */
-          && ((flags & FLAG_TRANSFER_ONLY) || restore_services(snapshot_mapping_array, manifest->services_table, manifest->targets_table)); /* Then, restore them on the remote machines */
-    }
+        exit_status = send_and_restore_snapshots(snapshot_mapping_array, manifest->services_table, manifest->targets_table, max_concurrent_transfers, flags);
 
     if(!(flags & FLAG_NO_UPGRADE) && previous_manifest != NULL)
         g_ptr_array_free(snapshot_mapping_array, TRUE);
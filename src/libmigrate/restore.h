@@ -25,6 +25,45 @@
 #include <manifest.h>
 #include "datamigrationflags.h"
 
+/**
+ * Restores the state of the given stateful services from the latest snapshots
+ * in the snapshot stores of the machines to which they are deployed.
+ *
+ * @param snapshot_mapping_array Array of snapshot mappings to restore
+ * @param services_table Hash table with services that provides the activation properties of the snapshot mappings
+ * @param targets_table Hash table with targets
+ * @return TRUE if all services were restored successfully, else FALSE
+ */
+ProcReact_bool restore_services(GPtrArray *snapshot_mapping_array, GHashTable *services_table, GHashTable *targets_table);
+
+/**
+ * Sends the snapshots of the given stateful services from the coordinator's
+ * snapshot store to the machines to which they are deployed.
+ *
+ * @param snapshot_mapping_array Array of snapshot mappings whose snapshots must be sent
+ * @param targets_table Hash table with targets
+ * @param max_concurrent_transfers Specifies the maximum amount of concurrent transfers
+ * @param flags Data migration option flags
+ * @return TRUE if all snapshots were sent successfully, else FALSE
+ */
+ProcReact_bool send_snapshots(GPtrArray *snapshot_mapping_array, GHashTable *targets_table, const unsigned int max_concurrent_transfers, const unsigned int flags);
+
+/**
+ * Sends the snapshots of the given stateful services to the machines to which
+ * they are deployed and restores the state of each service as soon as its
+ * snapshots have been imported, so that restore operations on one machine
+ * overlap with the transfers to other machines. If the transfer only flag has
+ * been set, the snapshots are only sent.
+ *
+ * @param snapshot_mapping_array Array of snapshot mappings whose snapshots must be sent and restored
+ * @param services_table Hash table with services that provides the activation properties of the snapshot mappings
+ * @param targets_table Hash table with targets
+ * @param max_concurrent_transfers Specifies the maximum amount of concurrent transfers
+ * @param flags Data migration option flags
+ * @return TRUE if all snapshots were sent and restored successfully, else FALSE
+ */
+ProcReact_bool send_and_restore_snapshots(GPtrArray *snapshot_mapping_array, GHashTable *services_table, GHashTable *targets_table, const unsigned int max_concurrent_transfers, const unsigned int flags);
+
 /**
  * Transfers and restores snapshots of the state of all the stateful services in
  * the manifest that are not in the previous configuration.
@@ -33,9 +72,10 @@
  * @param old_snapshots_array Array of stateful components belonging to the previous configurations
  * @param max_concurrent_transfers Specifies the maximum amount of concurrent transfers
  * @param flags Data migration option flags
- * @param keep Indicates how many snapshot generations should be kept remotely while executing the depth first operation
+ * @param keep Indicates how many snapshot generations should be kept remotely while executing the depth first operation or a budgeted operation
+ * @param max_snapshot_bytes Maximum amount of snapshot data in bytes that is sent to the targets in one batch, or 0 for no limit. With a budget, each batch is sent, restored and cleaned before the next batch is sent.
  * @return TRUE if the restore completed successfully, else FALSE
  */
-ProcReact_bool restore(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const unsigned int keep);
+ProcReact_bool restore(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const unsigned int keep, const guint64 max_snapshot_bytes);
 
 #endif
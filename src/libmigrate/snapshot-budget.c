@@ -0,0 +1,375 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "snapshot-budget.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <snapshot-management.h>
+#include <remote-snapshot-management.h>
+#include <targetstable.h>
+#include <targets-iterator.h>
+#include "datamigrationflags.h"
+
+guint64 determine_max_snapshot_bytes(void)
+{
+    char *max_snapshot_bytes = getenv("DISNIX_MAX_SNAPSHOT_BYTES");
+
+    if(max_snapshot_bytes == NULL)
+        return 0;
+    else
+        return g_ascii_strtoull(max_snapshot_bytes, NULL, 10);
+}
+
+static gchar *compose_component_key(const SnapshotMapping *mapping)
+{
+    return g_strconcat((gchar*)mapping->container, "/", (gchar*)mapping->component, NULL);
+}
+
+/* Snapshot size infrastructure */
+
+typedef struct
+{
+    const GPtrArray *snapshot_mapping_array;
+    unsigned int flags;
+    ProcReact_bool local;
+    GHashTable *sizes_table;
+}
+QuerySnapshotSizesData;
+
+static char **query_snapshots(const SnapshotMapping *mapping, Target *target, const unsigned int flags, const ProcReact_bool local)
+{
+    if(local)
+    {
+        if(flags & FLAG_ALL)
+            return statemgmt_query_all_snapshots_sync((gchar*)mapping->container, (gchar*)mapping->component, STDERR_FILENO);
+        else
+            return statemgmt_query_latest_snapshot_sync((gchar*)mapping->container, (gchar*)mapping->component, STDERR_FILENO);
+    }
+    else
+    {
+        gchar *target_key = find_target_key(target);
+
+        if(flags & FLAG_ALL)
+            return statemgmt_remote_query_all_snapshots_sync((gchar*)target->client_interface, target_key, (gchar*)mapping->container, (gchar*)mapping->component);
+        else
+            return statemgmt_remote_query_latest_snapshot_sync((gchar*)target->client_interface, target_key, (gchar*)mapping->container, (gchar*)mapping->component);
+    }
+}
+
+static ProcReact_Future query_snapshot_sizes_on_target(void *data, gchar *target_name, Target *target)
+{
+    QuerySnapshotSizesData *query_data = (QuerySnapshotSizesData*)data;
+    ProcReact_Future future = procreact_initialize_future(procreact_create_string_array_type('\n'));
+
+    if(future.pid == 0)
+    {
+        GPtrArray *snapshots_per_target_array = find_snapshot_mappings_per_target(query_data->snapshot_mapping_array, target_name);
+        GPtrArray *snapshots_array = g_ptr_array_new();
+        unsigned int *snapshots_lengths = (unsigned int*)g_malloc(snapshots_per_target_array->len * sizeof(unsigned int));
+        char **sizes;
+        unsigned int i, j, k = 0;
+
+        /* Collect the snapshots of all components of this target, so that their sizes can be queried in one go */
+        for(i = 0; i < snapshots_per_target_array->len; i++)
+        {
+            SnapshotMapping *mapping = g_ptr_array_index(snapshots_per_target_array, i);
+            char **snapshots = query_snapshots(mapping, target, query_data->flags, query_data->local);
+
+            if(snapshots == NULL)
+                _exit(1);
+
+            snapshots_lengths[i] = g_strv_length(snapshots);
+
+            for(j = 0; j < snapshots_lengths[i]; j++)
+                g_ptr_array_add(snapshots_array, snapshots[j]);
+        }
+
+        if(snapshots_array->len == 0)
+            sizes = NULL; /* There are no snapshots to transfer */
+        else if(query_data->local)
+            sizes = statemgmt_query_snapshot_sizes_sync((gchar**)snapshots_array->pdata, snapshots_array->len, STDERR_FILENO);
+        else
+            sizes = statemgmt_remote_query_snapshot_sizes_sync((gchar*)target->client_interface, find_target_key(target), (gchar**)snapshots_array->pdata, snapshots_array->len);
+
+        if(snapshots_array->len > 0 && (sizes == NULL || g_strv_length(sizes) != snapshots_array->len))
+            _exit(1);
+
+        /* Report the total size of the snapshots of each component, in the order of the mappings */
+        for(i = 0; i < snapshots_per_target_array->len; i++)
+        {
+            guint64 size = 0;
+
+            for(j = 0; j < snapshots_lengths[i]; j++, k++)
+                size += g_ascii_strtoull(sizes[k], NULL, 10);
+
+            dprintf(future.fd, "%" G_GUINT64_FORMAT "\n", size);
+        }
+
+        _exit(0);
+    }
+
+    return future;
+}
+
+static void complete_query_snapshot_sizes_on_target(void *data, gchar *target_name, Target *target, ProcReact_Future *future, ProcReact_Status status)
+{
+    QuerySnapshotSizesData *query_data = (QuerySnapshotSizesData*)data;
+
+    if(status != PROCREACT_STATUS_OK || future->result == NULL)
+        g_printerr("[target: %s]: Cannot determine the sizes of the snapshots!\n", target_name);
+    else
+    {
+        GPtrArray *snapshots_per_target_array = find_snapshot_mappings_per_target(query_data->snapshot_mapping_array, target_name);
+        char **sizes = (char**)future->result;
+        unsigned int i;
+
+        for(i = 0; i < snapshots_per_target_array->len && sizes[i] != NULL; i++)
+        {
+            guint64 *size = (guint64*)g_malloc(sizeof(guint64));
+            *size = g_ascii_strtoull(sizes[i], NULL, 10);
+            g_hash_table_insert(query_data->sizes_table, g_ptr_array_index(snapshots_per_target_array, i), size);
+        }
+
+        g_ptr_array_free(snapshots_per_target_array, TRUE);
+        procreact_free_string_array(sizes);
+    }
+}
+
+static GHashTable *query_snapshot_mapping_sizes(const GPtrArray *snapshot_mapping_array, GHashTable *targets_table, const unsigned int flags, const ProcReact_bool local, const unsigned int max_concurrent_transfers)
+{
+    GHashTable *sizes_table = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    QuerySnapshotSizesData data = { snapshot_mapping_array, flags, local, sizes_table };
+    ProcReact_FutureIterator iterator = create_target_future_iterator(targets_table, query_snapshot_sizes_on_target, complete_query_snapshot_sizes_on_target, &data);
+
+    /* Query the sizes of the snapshots of all targets in parallel */
+    procreact_fork_buffer_and_wait_in_parallel_limit(&iterator, max_concurrent_transfers);
+    destroy_target_future_iterator(&iterator);
+
+    return sizes_table;
+}
+
+GHashTable *query_snapshot_sizes_per_target(const GPtrArray *snapshot_mapping_array, GHashTable *targets_table, const unsigned int flags, const ProcReact_bool local, const unsigned int max_concurrent_transfers)
+{
+    GHashTable *sizes_table = query_snapshot_mapping_sizes(snapshot_mapping_array, targets_table, flags, local, max_concurrent_transfers);
+    GHashTable *target_sizes_table = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+    unsigned int i;
+
+    for(i = 0; i < snapshot_mapping_array->len; i++)
+    {
+        SnapshotMapping *mapping = g_ptr_array_index(snapshot_mapping_array, i);
+        guint64 *size = g_hash_table_lookup(sizes_table, mapping);
+
+        if(size != NULL)
+        {
+            guint64 *target_size = g_hash_table_lookup(target_sizes_table, (gchar*)mapping->target);
+
+            if(target_size == NULL)
+            {
+                target_size = (guint64*)g_malloc(sizeof(guint64));
+                *target_size = 0;
+                g_hash_table_insert(target_sizes_table, (gchar*)mapping->target, target_size);
+            }
+
+            *target_size += *size;
+        }
+    }
+
+    g_hash_table_destroy(sizes_table);
+    return target_sizes_table;
+}
+
+/* Snapshot batch infrastructure */
+
+static SnapshotBatch *create_snapshot_batch(void)
+{
+    SnapshotBatch *batch = (SnapshotBatch*)g_malloc(sizeof(SnapshotBatch));
+    batch->snapshot_mapping_array = g_ptr_array_new();
+    batch->components_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    batch->size = 0;
+    return batch;
+}
+
+static void delete_snapshot_batch(SnapshotBatch *batch)
+{
+    g_ptr_array_free(batch->snapshot_mapping_array, TRUE);
+    g_hash_table_destroy(batch->components_table);
+    g_free(batch);
+}
+
+static SnapshotBatch *find_or_create_batch_with_space(GPtrArray *snapshot_batches_array, const guint64 size, const guint64 max_snapshot_bytes)
+{
+    unsigned int i;
+    SnapshotBatch *batch;
+
+    /* Put the component in the first batch that still has room for it, so that earlier batches are filled up as much as possible */
+    for(i = 0; i < snapshot_batches_array->len; i++)
+    {
+        batch = g_ptr_array_index(snapshot_batches_array, i);
+
+        if(batch->size + size <= max_snapshot_bytes)
+            return batch;
+    }
+
+    batch = create_snapshot_batch();
+    g_ptr_array_add(snapshot_batches_array, batch);
+    return batch;
+}
+
+GPtrArray *create_snapshot_batches_array(const GPtrArray *snapshot_mapping_array, GHashTable *targets_table, const unsigned int flags, const guint64 max_snapshot_bytes, const ProcReact_bool local, const unsigned int max_concurrent_transfers)
+{
+    GHashTable *sizes_table = query_snapshot_mapping_sizes(snapshot_mapping_array, targets_table, flags, local, max_concurrent_transfers);
+    GHashTable *components_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)delete_snapshot_batch);
+    GPtrArray *components_array = g_ptr_array_new();
+    GPtrArray *snapshot_batches_array;
+    unsigned int i;
+
+    /*
+     * Sum the sizes of the snapshots per component first, since its mappings on
+     * all previous machines must end up in the same batch. Each component is
+     * collected in a batch of its own.
+     */
+    for(i = 0; i < snapshot_mapping_array->len; i++)
+    {
+        SnapshotMapping *mapping = g_ptr_array_index(snapshot_mapping_array, i);
+        gchar *key = compose_component_key(mapping);
+        SnapshotBatch *component = g_hash_table_lookup(components_table, key);
+        guint64 *size = g_hash_table_lookup(sizes_table, mapping);
+
+        /* Mappings of machines that are no longer present are skipped by all operations, so they do not take any space */
+        if(size == NULL && g_hash_table_lookup(targets_table, (gchar*)mapping->target) != NULL)
+        {
+            g_printerr("[target: %s]: Cannot determine the size of the snapshots of component: %s deployed to container: %s\n", mapping->target, mapping->component, mapping->container);
+            g_free(key);
+            g_ptr_array_free(components_array, TRUE);
+            g_hash_table_destroy(components_table);
+            g_hash_table_destroy(sizes_table);
+            return NULL;
+        }
+
+        if(component == NULL)
+        {
+            component = create_snapshot_batch();
+            g_hash_table_add(component->components_table, g_strdup(key));
+            g_hash_table_insert(components_table, key, component);
+            g_ptr_array_add(components_array, component);
+        }
+        else
+            g_free(key);
+
+        g_ptr_array_add(component->snapshot_mapping_array, mapping);
+
+        if(size != NULL)
+            component->size += *size;
+    }
+
+    /* Place each component as a whole in the first batch that still has room for it */
+    snapshot_batches_array = g_ptr_array_new();
+
+    for(i = 0; i < components_array->len; i++)
+    {
+        SnapshotBatch *component = g_ptr_array_index(components_array, i);
+        SnapshotMapping *mapping = g_ptr_array_index(component->snapshot_mapping_array, 0);
+        SnapshotBatch *batch;
+        GHashTableIter iter;
+        gpointer key;
+        unsigned int j;
+
+        if(component->size > max_snapshot_bytes)
+            g_printerr("[coordinator]: The snapshots of component: %s deployed to container: %s take %" G_GUINT64_FORMAT " bytes, which exceeds the snapshot budget of %" G_GUINT64_FORMAT " bytes\n", mapping->component, mapping->container, component->size, max_snapshot_bytes);
+
+        batch = find_or_create_batch_with_space(snapshot_batches_array, component->size, max_snapshot_bytes);
+
+        g_hash_table_iter_init(&iter, component->components_table);
+        while(g_hash_table_iter_next(&iter, &key, NULL))
+            g_hash_table_add(batch->components_table, g_strdup((gchar*)key));
+
+        for(j = 0; j < component->snapshot_mapping_array->len; j++)
+            g_ptr_array_add(batch->snapshot_mapping_array, g_ptr_array_index(component->snapshot_mapping_array, j));
+
+        batch->size += component->size;
+    }
+
+    g_ptr_array_free(components_array, TRUE);
+    g_hash_table_destroy(components_table);
+    g_hash_table_destroy(sizes_table);
+    return snapshot_batches_array;
+}
+
+void delete_snapshot_batches_array(GPtrArray *snapshot_batches_array)
+{
+    if(snapshot_batches_array != NULL)
+    {
+        unsigned int i;
+
+        for(i = 0; i < snapshot_batches_array->len; i++)
+            delete_snapshot_batch(g_ptr_array_index(snapshot_batches_array, i));
+
+        g_ptr_array_free(snapshot_batches_array, TRUE);
+    }
+}
+
+guint64 determine_snapshot_batches_size(const GPtrArray *snapshot_batches_array)
+{
+    unsigned int i;
+    guint64 size = 0;
+
+    for(i = 0; i < snapshot_batches_array->len; i++)
+    {
+        SnapshotBatch *batch = g_ptr_array_index(snapshot_batches_array, i);
+        size += batch->size;
+    }
+
+    return size;
+}
+
+static ProcReact_bool snapshot_batches_contain(const GPtrArray *snapshot_batches_array, const gchar *key)
+{
+    unsigned int i;
+
+    for(i = 0; i < snapshot_batches_array->len; i++)
+    {
+        SnapshotBatch *batch = g_ptr_array_index(snapshot_batches_array, i);
+
+        if(g_hash_table_contains(batch->components_table, key))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+GPtrArray *select_snapshot_mappings_of_batch(const SnapshotBatch *batch, const GPtrArray *snapshot_batches_array, const GPtrArray *snapshot_mapping_array)
+{
+    GPtrArray *selected_mapping_array = g_ptr_array_new();
+    unsigned int i;
+
+    for(i = 0; i < snapshot_mapping_array->len; i++)
+    {
+        SnapshotMapping *mapping = g_ptr_array_index(snapshot_mapping_array, i);
+        gchar *key = compose_component_key(mapping);
+
+        if(batch == NULL ? !snapshot_batches_contain(snapshot_batches_array, key) : g_hash_table_contains(batch->components_table, key))
+            g_ptr_array_add(selected_mapping_array, mapping);
+
+        g_free(key);
+    }
+
+    return selected_mapping_array;
+}
@@ -0,0 +1,108 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __DISNIX_SNAPSHOT_BUDGET_H
+#define __DISNIX_SNAPSHOT_BUDGET_H
+#include <glib.h>
+#include <procreact_types.h>
+#include <snapshotmappingarray.h>
+
+/**
+ * @brief A group of components whose snapshots fit in the byte budget and are migrated together.
+ */
+typedef struct
+{
+    /** Snapshot mappings whose snapshots belong to the batch */
+    GPtrArray *snapshot_mapping_array;
+
+    /** Hash table used as a set of container/component keys of the mappings in the batch */
+    GHashTable *components_table;
+
+    /** Total size of the snapshots in bytes */
+    guint64 size;
+}
+SnapshotBatch;
+
+/**
+ * Determines the byte budget for snapshot data that is in flight from the
+ * DISNIX_MAX_SNAPSHOT_BYTES environment variable.
+ *
+ * @return The budget in bytes or 0 if the budget is unlimited
+ */
+guint64 determine_max_snapshot_bytes(void);
+
+/**
+ * Determines the total size of the snapshots that are transferred to or from
+ * each target. The sizes are queried per target, for all targets in parallel.
+ * Targets of which the sizes cannot be determined have no entry.
+ *
+ * @param snapshot_mapping_array Array of snapshot mappings
+ * @param targets_table Hash table with targets
+ * @param flags Data migration option flags
+ * @param local TRUE to use the sizes of the snapshots in the coordinator's snapshot store, FALSE to use the sizes reported by the targets
+ * @param max_concurrent_transfers Specifies the maximum amount of targets that are queried concurrently
+ * @return A hash table mapping target names to their total snapshot size in bytes (guint64)
+ */
+GHashTable *query_snapshot_sizes_per_target(const GPtrArray *snapshot_mapping_array, GHashTable *targets_table, const unsigned int flags, const ProcReact_bool local, const unsigned int max_concurrent_transfers);
+
+/**
+ * Partitions the snapshot mappings into batches of which the snapshots fit in
+ * the given budget. The snapshot mappings of the same container and component
+ * always end up in the same batch, and a component whose snapshots exceed the
+ * budget on its own gets a batch of its own. The sizes of the snapshots are
+ * queried per target, for all targets in parallel.
+ *
+ * @param snapshot_mapping_array Array of snapshot mappings
+ * @param targets_table Hash table with targets
+ * @param flags Data migration option flags
+ * @param max_snapshot_bytes Maximum amount of snapshot data in bytes that a batch may contain
+ * @param local TRUE to use the sizes of the snapshots in the coordinator's snapshot store, FALSE to use the sizes reported by the targets
+ * @param max_concurrent_transfers Specifies the maximum amount of targets that are queried concurrently
+ * @return An array of SnapshotBatch items, or NULL if the sizes of the snapshots cannot be determined
+ */
+GPtrArray *create_snapshot_batches_array(const GPtrArray *snapshot_mapping_array, GHashTable *targets_table, const unsigned int flags, const guint64 max_snapshot_bytes, const ProcReact_bool local, const unsigned int max_concurrent_transfers);
+
+/**
+ * Deletes an array of snapshot batches and its contents from memory.
+ *
+ * @param snapshot_batches_array An array of SnapshotBatch items
+ */
+void delete_snapshot_batches_array(GPtrArray *snapshot_batches_array);
+
+/**
+ * Determines the total size of the snapshots in all batches.
+ *
+ * @param snapshot_batches_array An array of SnapshotBatch items
+ * @return The total size in bytes
+ */
+guint64 determine_snapshot_batches_size(const GPtrArray *snapshot_batches_array);
+
+/**
+ * Selects the snapshot mappings that belong to the same components as the
+ * mappings in a batch.
+ *
+ * @param batch A snapshot batch, or NULL to select the mappings of the components that are in none of the batches
+ * @param snapshot_batches_array An array of SnapshotBatch items. Only used if batch is NULL.
+ * @param snapshot_mapping_array Array of snapshot mappings to select from
+ * @return An array of snapshot mappings that should be freed with g_ptr_array_free(), its elements refer to the elements of snapshot_mapping_array
+ */
+GPtrArray *select_snapshot_mappings_of_batch(const SnapshotBatch *batch, const GPtrArray *snapshot_batches_array, const GPtrArray *snapshot_mapping_array);
+
+#endif
@@ -22,10 +22,14 @@
 #include <remote-state-management.h>
 #include <remote-snapshot-management.h>
 #include <snapshotmapping-traverse.h>
+#include <snapshotmapping-iterator.h>
 #include <manifestservicestable.h>
 #include <targets-iterator.h>
 #include <mappingparameters.h>
 #include <copy-snapshots.h>
+#include <transferlimit.h>
+#include "snapshot-budget.h"
+#include "clean-snapshot-mappings.h"
 
 /* Snapshot services infrastructure */
 
@@ -42,7 +46,7 @@ static void complete_take_snapshot_on_target(SnapshotMapping *mapping, ManifestS
         g_printerr("[target: %s]: Cannot snapshot state of service: %s\n", mapping->target, mapping->component);
 }
 
-static ProcReact_bool snapshot_services(GPtrArray *snapshots_array, GHashTable *services_table, GHashTable *targets_table)
+ProcReact_bool snapshot_services(GPtrArray *snapshots_array, GHashTable *services_table, GHashTable *targets_table)
 {
     return map_snapshot_items(snapshots_array, services_table, targets_table, take_snapshot_on_target, complete_take_snapshot_on_target);
 }
@@ -52,15 +56,31 @@ static ProcReact_bool snapshot_services(GPtrArray *snapshots_array, GHashTable *
 typedef struct
 {
     GPtrArray *snapshots_array;
+    GHashTable *targets_table;
     unsigned int flags;
+    ProcReact_Lane *bulk_lane;
+    GHashTable *sizes_table;
+    ProcReact_AdaptiveLimit *adaptive_limit;
 }
 RetrieveSnapshotsData;
 
-static pid_t retrieve_snapshot_mapping(SnapshotMapping *mapping, Target *target, const unsigned int flags)
+static pid_t retrieve_snapshot_mapping(SnapshotMapping *mapping, Target *target, const unsigned int flags, const ProcReact_Lane *bulk_lane)
 {
     gchar *target_key = find_target_key(target);
     g_print("[target: %s]: Retrieving snapshots of component: %s deployed to container: %s\n", mapping->target, mapping->component, mapping->container);
-    return copy_snapshots_from((char*)target->client_interface, target_key, (char*)mapping->container, (char*)mapping->component, flags & FLAG_ALL, STDOUT_FILENO, STDERR_FILENO);
+    return copy_snapshots_from((char*)target->client_interface, target_key, (char*)mapping->container, (char*)mapping->component, flags & FLAG_ALL, bulk_lane, STDOUT_FILENO, STDERR_FILENO);
+}
+
+static pid_t retrieve_snapshot_mapping_process(void *data, SnapshotMapping *mapping, Target *target)
+{
+    RetrieveSnapshotsData *retrieve_snapshots_data = (RetrieveSnapshotsData*)data;
+    return retrieve_snapshot_mapping(mapping, target, retrieve_snapshots_data->flags, retrieve_snapshots_data->bulk_lane);
+}
+
+static void complete_retrieve_snapshot_mapping_process(void *data, SnapshotMapping *mapping, Target *target, ProcReact_Status status, ProcReact_bool result)
+{
+    if(status != PROCREACT_STATUS_OK || !result)
+        g_printerr("[target: %s]: Cannot retrieve snapshots of component: %s deployed to container: %s\n", mapping->target, mapping->component, mapping->container);
 }
 
 pid_t retrieve_snapshots_from_target(void *data, gchar *target_name, Target *target)
@@ -73,24 +93,14 @@ pid_t retrieve_snapshots_from_target(void *data, gchar *target_name, Target *tar
 
         gchar *target_key = find_target_key(target);
         GPtrArray *snapshots_per_target_array = find_snapshot_mappings_per_target(retrieve_snapshots_data->snapshots_array, target_key);
-        unsigned int i;
-        int exit_status = 0;
-        ProcReact_Status status;
+        ProcReact_PidIterator iterator = create_snapshot_mapping_pid_iterator(snapshots_per_target_array, retrieve_snapshots_data->targets_table, retrieve_snapshot_mapping_process, complete_retrieve_snapshot_mapping_process, retrieve_snapshots_data);
+        int exit_status;
 
-        for(i = 0; i < snapshots_per_target_array->len; i++)
-        {
-            SnapshotMapping *mapping = g_ptr_array_index(snapshots_per_target_array, i);
-            exit_status = procreact_wait_for_exit_status(retrieve_snapshot_mapping(mapping, target, retrieve_snapshots_data->flags), &status);
-
-            if(status != PROCREACT_STATUS_OK)
-            {
-                exit_status = 1;
-                break;
-            }
-            else if(exit_status != 0)
-                break;
-        }
+        /* Retrieve the snapshots of multiple components of this target concurrently, their bulk transfers are still bounded by the shared bulk lane */
+        procreact_fork_and_wait_in_parallel_limit(&iterator, determine_max_transfers_per_target(retrieve_snapshots_data->bulk_lane));
+        exit_status = !snapshot_mapping_iterator_has_succeeded(iterator.data);
 
+        destroy_snapshot_mapping_pid_iterator(&iterator);
         g_ptr_array_free(snapshots_per_target_array, TRUE);
 
         exit(exit_status);
@@ -101,33 +111,40 @@ pid_t retrieve_snapshots_from_target(void *data, gchar *target_name, Target *tar
 
 void complete_retrieve_snapshots_from_target(void *data, gchar *target_name, Target *target, ProcReact_Status status, int result)
 {
+    RetrieveSnapshotsData *retrieve_snapshots_data = (RetrieveSnapshotsData*)data;
+
     if(status != PROCREACT_STATUS_OK || !result)
         g_printerr("[target: %s]: Cannot send snapshots!\n", target_name);
+    else if(retrieve_snapshots_data->adaptive_limit != NULL)
+    {
+        /* Let the adaptive concurrency controller measure the throughput in bytes */
+        guint64 *size = (guint64*)g_hash_table_lookup(retrieve_snapshots_data->sizes_table, target_name);
+
+        if(size != NULL)
+            procreact_adaptive_limit_add_units(retrieve_snapshots_data->adaptive_limit, *size);
+    }
 }
 
-static ProcReact_bool retrieve_snapshots(GPtrArray *snapshots_array, GHashTable *targets_table, const unsigned int max_concurrent_transfers, const unsigned int flags)
+ProcReact_bool retrieve_snapshots(GPtrArray *snapshots_array, GHashTable *targets_table, const unsigned int max_concurrent_transfers, const unsigned int flags)
 {
     ProcReact_bool success;
-    RetrieveSnapshotsData data = { snapshots_array, flags };
+    ProcReact_Lane bulk_lane = create_bulk_transfer_lane(max_concurrent_transfers);
+    GHashTable *sizes_table = adaptive_transfers_enabled() ? query_snapshot_sizes_per_target(snapshots_array, targets_table, flags, FALSE, max_concurrent_transfers) : NULL;
+    RetrieveSnapshotsData data = { snapshots_array, targets_table, flags, &bulk_lane, sizes_table, NULL };
     ProcReact_PidIterator iterator = create_target_pid_iterator(targets_table, retrieve_snapshots_from_target, complete_retrieve_snapshots_from_target, &data);
 
     g_print("[coordinator]: Retrieving snapshots...\n");
 
-    procreact_fork_and_wait_in_parallel_limit(&iterator, max_concurrent_transfers);
+    fork_and_wait_for_measured_transfers(&iterator, max_concurrent_transfers, &bulk_lane, &data.adaptive_limit, "snapshot retrieval");
     success = target_iterator_has_succeeded(iterator.data);
 
     destroy_target_pid_iterator(&iterator);
+    procreact_destroy_lane(&bulk_lane);
 
-    return success;
-}
-
-/* Clean snapshot mapping infrastructure */
+    if(sizes_table != NULL)
+        g_hash_table_destroy(sizes_table);
 
-static pid_t clean_snapshot_mapping(SnapshotMapping *mapping, Target *target, int keep)
-{
-    gchar *target_key = find_target_key(target);
-    g_print("[target: %s]: Cleaning snapshots of component: %s deployed to container: %s\n", mapping->target, mapping->component, mapping->container);
-    return statemgmt_remote_clean_snapshots((char*)target->client_interface, target_key, keep, (char*)mapping->container, (char*)mapping->component);
+    return success;
 }
 
 typedef struct
@@ -136,6 +153,9 @@ typedef struct
     GPtrArray *snapshot_mapping_array;
     unsigned int flags;
     int keep;
+    ProcReact_Lane *bulk_lane;
+    GHashTable *sizes_table;
+    ProcReact_AdaptiveLimit *adaptive_limit;
 }
 TakeRetrieveAndCleanSnapshotsData;
 
@@ -162,8 +182,7 @@ static pid_t take_retrieve_and_clean_snapshot_on_target(void *data, gchar *targe
             MappingParameters params = create_mapping_parameters(mapping->service, mapping->container, mapping->target, mapping->container_provided_by_service, retrieve_snapshots_data->services_table, target);
 
             if(!procreact_wait_for_boolean(take_snapshot_on_target(mapping, params.service, target, params.type, params.arguments, params.arguments_size), &status) || (status != PROCREACT_STATUS_OK)
-              || !procreact_wait_for_boolean(retrieve_snapshot_mapping(mapping, target, retrieve_snapshots_data->flags), &status) || (status != PROCREACT_STATUS_OK)
-              || !procreact_wait_for_boolean(clean_snapshot_mapping(mapping, target, retrieve_snapshots_data->keep), &status) || (status != PROCREACT_STATUS_OK))
+              || !procreact_wait_for_boolean(retrieve_snapshot_mapping(mapping, target, retrieve_snapshots_data->flags, retrieve_snapshots_data->bulk_lane), &status) || (status != PROCREACT_STATUS_OK))
             {
                 exit_status = 1;
                 destroy_mapping_parameters(&params);
@@ -173,6 +192,11 @@ static pid_t take_retrieve_and_clean_snapshot_on_target(void *data, gchar *targe
             destroy_mapping_parameters(&params);
         }
 
+        /* Clean the snapshots of all components of this target with a single garbage collect operation */
+        if(exit_status == 0 && snapshots_per_target_array->len > 0
+          && (!procreact_wait_for_boolean(clean_snapshot_mappings_on_target(snapshots_per_target_array, target, retrieve_snapshots_data->keep), &status) || (status != PROCREACT_STATUS_OK)))
+            exit_status = 1;
+
         g_ptr_array_free(snapshots_per_target_array, TRUE);
 
         exit(exit_status);
@@ -183,29 +207,77 @@ static pid_t take_retrieve_and_clean_snapshot_on_target(void *data, gchar *targe
 
 void complete_take_retrieve_and_clean_snapshots_on_target(void *data, gchar *target_name, Target *target, ProcReact_Status status, int result)
 {
+    TakeRetrieveAndCleanSnapshotsData *retrieve_snapshots_data = (TakeRetrieveAndCleanSnapshotsData*)data;
+
     if(status != PROCREACT_STATUS_OK || !result)
         g_printerr("[target: %s]: Cannot take, send or clean snapshots!\n", target_name);
+    else if(retrieve_snapshots_data->adaptive_limit != NULL)
+    {
+        /* Let the adaptive concurrency controller measure the throughput in bytes */
+        guint64 *size = (guint64*)g_hash_table_lookup(retrieve_snapshots_data->sizes_table, target_name);
+
+        if(size != NULL)
+            procreact_adaptive_limit_add_units(retrieve_snapshots_data->adaptive_limit, *size);
+    }
 }
 
 static ProcReact_bool snapshot_depth_first(GPtrArray *snapshot_mapping_array, GHashTable *services_table, GHashTable *targets_table, const unsigned int max_concurrent_transfers, const unsigned int flags, const int keep)
 {
     ProcReact_bool success;
-    TakeRetrieveAndCleanSnapshotsData data = { services_table, snapshot_mapping_array, flags, keep };
+    ProcReact_Lane bulk_lane = create_bulk_transfer_lane(max_concurrent_transfers);
+    /* The snapshots are taken during this phase, so the sizes of the snapshots that the targets already have serve as an estimate */
+    GHashTable *sizes_table = adaptive_transfers_enabled() ? query_snapshot_sizes_per_target(snapshot_mapping_array, targets_table, flags, FALSE, max_concurrent_transfers) : NULL;
+    TakeRetrieveAndCleanSnapshotsData data = { services_table, snapshot_mapping_array, flags, keep, &bulk_lane, sizes_table, NULL };
     ProcReact_PidIterator iterator = create_target_pid_iterator(targets_table, take_retrieve_and_clean_snapshot_on_target, complete_take_retrieve_and_clean_snapshots_on_target, &data);
 
     g_print("[coordinator]: Snapshotting, retrieving and cleaning snapshots...\n");
 
-    procreact_fork_and_wait_in_parallel_limit(&iterator, max_concurrent_transfers);
+    fork_and_wait_for_measured_transfers(&iterator, max_concurrent_transfers, &bulk_lane, &data.adaptive_limit, "snapshot retrieval");
     success = target_iterator_has_succeeded(iterator.data);
 
     destroy_target_pid_iterator(&iterator);
+    procreact_destroy_lane(&bulk_lane);
+
+    if(sizes_table != NULL)
+        g_hash_table_destroy(sizes_table);
+
+    return success;
+}
+
+/* Snapshot budget infrastructure */
+
+static ProcReact_bool check_snapshot_budget(GPtrArray *snapshot_mapping_array, GHashTable *targets_table, const unsigned int max_concurrent_transfers, const unsigned int flags, const guint64 max_snapshot_bytes)
+{
+    ProcReact_bool success;
+    GPtrArray *snapshot_batches_array;
+
+    if(max_snapshot_bytes == 0)
+        return TRUE;
+
+    g_print("[coordinator]: Determining the sizes of the snapshots to retrieve...\n");
+
+    /* Admit the retrieval only if the snapshots reported by the targets fit in the budget, so that the coordinator cannot run out of disk space halfway */
+    snapshot_batches_array = create_snapshot_batches_array(snapshot_mapping_array, targets_table, flags, max_snapshot_bytes, FALSE, max_concurrent_transfers);
+
+    if(snapshot_batches_array == NULL)
+        success = FALSE;
+    else
+    {
+        guint64 size = determine_snapshot_batches_size(snapshot_batches_array);
+        success = (size <= max_snapshot_bytes);
+
+        if(!success)
+            g_printerr("[coordinator]: The snapshots to retrieve take %" G_GUINT64_FORMAT " bytes, which exceeds the snapshot budget of %" G_GUINT64_FORMAT " bytes!\n", size, max_snapshot_bytes);
+
+        delete_snapshot_batches_array(snapshot_batches_array);
+    }
 
     return success;
 }
 
 /* The entire snapshot operation */
 
-ProcReact_bool snapshot(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const int keep)
+ProcReact_bool snapshot(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const int keep, const guint64 max_snapshot_bytes)
 {
     if(!(flags & FLAG_NO_UPGRADE) && previous_manifest == NULL)
     {
@@ -246,6 +318,7 @@ ProcReact_bool snapshot(const Manifest *manifest, const Manifest *previous_manif
         else
         {
             exit_status = ((flags & FLAG_TRANSFER_ONLY) || snapshot_services(snapshot_mapping_array, previous_services_table, manifest->targets_table))
+              && check_snapshot_budget(snapshot_mapping_array, manifest->targets_table, max_concurrent_transfers, flags, max_snapshot_bytes)
               && retrieve_snapshots(snapshot_mapping_array, manifest->targets_table, max_concurrent_transfers, flags);
         }
 
@@ -25,6 +25,30 @@
 #include <manifest.h>
 #include "datamigrationflags.h"
 
+/**
+ * Takes snapshots of the state of the given stateful services on the machines
+ * to which they are deployed.
+ *
+ * @param snapshots_array Array of snapshot mappings to take snapshots of
+ * @param services_table Hash table with services that provides the activation properties of the snapshot mappings
+ * @param targets_table Hash table with targets
+ * @return TRUE if all snapshots were taken successfully, else FALSE
+ */
+ProcReact_bool snapshot_services(GPtrArray *snapshots_array, GHashTable *services_table, GHashTable *targets_table);
+
+/**
+ * Retrieves the snapshots of the given stateful services from the machines to
+ * which they are deployed and imports them into the coordinator's snapshot
+ * store.
+ *
+ * @param snapshots_array Array of snapshot mappings whose snapshots must be retrieved
+ * @param targets_table Hash table with targets
+ * @param max_concurrent_transfers Specifies the maximum amount of concurrent transfers
+ * @param flags Data migration option flags
+ * @return TRUE if all snapshots were retrieved successfully, else FALSE
+ */
+ProcReact_bool retrieve_snapshots(GPtrArray *snapshots_array, GHashTable *targets_table, const unsigned int max_concurrent_transfers, const unsigned int flags);
+
 /**
  * Takes and retrieves snapshots of the state of all the stateful services in
  * the manifest that are not in the previous configuration.
@@ -34,8 +58,9 @@
  * @param max_concurrent_transfers Specifies the maximum amount of concurrent transfers
  * @param flags Data migration option flags
  * @param keep Indicates how many snapshot generations should be kept remotely while executing the depth first operation
+ * @param max_snapshot_bytes Maximum amount of snapshot data in bytes that may be retrieved, as reported by the targets, or 0 for no limit. Only applies to the breadth first operation.
  * @param TRUE if the snapshot completed successfully, else FALSE
  */
-ProcReact_bool snapshot(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const int keep);
+ProcReact_bool snapshot(const Manifest *manifest, const Manifest *previous_manifest, const unsigned int max_concurrent_transfers, const unsigned int flags, const int keep, const guint64 max_snapshot_bytes);
 
 #endif
@@ -0,0 +1,107 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "transferlimit.h"
+#include <stdlib.h>
+
+static unsigned int determine_max_adaptive_transfers(void)
+{
+    char *max_adaptive_transfers = getenv("DISNIX_ADAPTIVE_TRANSFERS");
+
+    if(max_adaptive_transfers == NULL)
+        return 0;
+    else
+        return atoi(max_adaptive_transfers);
+}
+
+ProcReact_bool adaptive_transfers_enabled(void)
+{
+    return determine_max_adaptive_transfers() > 0;
+}
+
+ProcReact_Lane create_bulk_transfer_lane(const unsigned int max_concurrent_transfers)
+{
+    unsigned int max_adaptive_transfers = determine_max_adaptive_transfers();
+    unsigned int max_bulk_transfers;
+
+    /* When the concurrency is adaptive, the controller decides how many transfers run concurrently */
+    if(max_adaptive_transfers > 0)
+        max_bulk_transfers = max_adaptive_transfers;
+    else
+        max_bulk_transfers = max_concurrent_transfers;
+
+    if(max_bulk_transfers == 0)
+        return procreact_create_lane(0); /* An unbounded lane has no tokens to reserve */
+    else
+        return procreact_create_lane_with_reserve(max_bulk_transfers + DISNIX_METADATA_LANE_SIZE, DISNIX_METADATA_LANE_SIZE);
+}
+
+unsigned int determine_max_transfers_per_target(const ProcReact_Lane *bulk_lane)
+{
+    char *max_transfers_per_target = getenv("DISNIX_MAX_TRANSFERS_PER_TARGET");
+    unsigned int limit = bulk_lane->capacity - bulk_lane->reserved; /* The reserved tokens cannot be used for bulk transfers */
+
+    if(max_transfers_per_target != NULL)
+    {
+        int value = atoi(max_transfers_per_target);
+
+        if(value > 0 && (unsigned int)value < limit)
+            limit = value;
+    }
+
+    if(limit == 0)
+        return 1;
+    else
+        return limit;
+}
+
+void fork_and_wait_for_measured_transfers(ProcReact_PidIterator *iterator, const unsigned int max_concurrent_transfers, const ProcReact_Lane *bulk_lane, ProcReact_AdaptiveLimit **adaptive_limit, const gchar *phase)
+{
+    unsigned int max_adaptive_transfers = determine_max_adaptive_transfers();
+    unsigned int metadata_lane_size = (bulk_lane == NULL) ? 0 : DISNIX_METADATA_LANE_SIZE;
+
+    if(max_adaptive_transfers > 0)
+    {
+        ProcReact_AdaptiveLimit limit = procreact_initialize_adaptive_limit(max_concurrent_transfers + metadata_lane_size, 1, max_adaptive_transfers + metadata_lane_size, adaptive_limit != NULL);
+
+        /* Allow the completion callbacks of the iterator to report the amount of work that was transferred */
+        if(adaptive_limit != NULL)
+            *adaptive_limit = &limit;
+
+        procreact_fork_and_wait_in_parallel_adaptive_limit(iterator, &limit);
+
+        if(adaptive_limit != NULL)
+            *adaptive_limit = NULL;
+
+        if(limit.total_completed > 0)
+            g_print("[coordinator]: Adaptive concurrency for %s: final limit: %u, peak limit: %u, transfers: %u, failed: %u\n", phase, limit.limit, limit.peak_limit, limit.total_completed, limit.total_failed);
+    }
+    else
+    {
+        if(adaptive_limit != NULL)
+            *adaptive_limit = NULL;
+
+        procreact_fork_and_wait_in_parallel_limit(iterator, max_concurrent_transfers + metadata_lane_size);
+    }
+}
+
+void fork_and_wait_for_transfers(ProcReact_PidIterator *iterator, const unsigned int max_concurrent_transfers, const ProcReact_Lane *bulk_lane, const gchar *phase)
+{
+    fork_and_wait_for_measured_transfers(iterator, max_concurrent_transfers, bulk_lane, NULL, phase);
+}
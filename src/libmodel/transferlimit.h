@@ -0,0 +1,117 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __DISNIX_TRANSFERLIMIT_H
+#define __DISNIX_TRANSFERLIMIT_H
+
+#include <glib.h>
+#include <procreact_pid_iterator.h>
+#include <procreact_lane.h>
+
+/**
+ * Amount of tokens in the transfer lane that are reserved for metadata
+ * operations (such as querying the invalid paths, requisites or missing
+ * snapshots of a target). Bulk transfers can never take these tokens, so that
+ * metadata operations do not queue behind them. An equal amount of additional
+ * processes may run, so that the processes performing these operations can be
+ * spawned while the bulk transfers occupy the other slots.
+ */
+#define DISNIX_METADATA_LANE_SIZE 2
+
+/**
+ * Creates a lane that bounds the amount of concurrent bulk transfers (closure
+ * and snapshot imports and exports). Jobs acquire a token from this lane only
+ * around their bulk I/O. Their remote metadata queries acquire a priority
+ * token instead, which the lane reserves for them in addition to the bulk
+ * transfer tokens, so that they never queue behind the bulk transfers of
+ * other jobs.
+ *
+ * @param max_concurrent_transfers Specifies the maximum amount of concurrent transfers
+ * @return A lane that should be passed to fork_and_wait_for_transfers() and to the transfer operations
+ */
+ProcReact_Lane create_bulk_transfer_lane(const unsigned int max_concurrent_transfers);
+
+/**
+ * Checks whether the DISNIX_ADAPTIVE_TRANSFERS environment variable enables
+ * adaptive transfers, so that callers only determine the sizes of their
+ * transfers when the adaptive limit uses them.
+ *
+ * @return TRUE if adaptive transfers are enabled, else FALSE
+ */
+ProcReact_bool adaptive_transfers_enabled(void);
+
+/**
+ * Spawns the transfer processes of a PID iterator in parallel and waits for
+ * their completion.
+ *
+ * At most max_concurrent_transfers processes perform bulk transfers at the same
+ * time, as bounded by the bulk lane, and DISNIX_METADATA_LANE_SIZE additional
+ * processes are allowed to run their metadata operations in the meantime, with
+ * the tokens that the lane reserves for them. If
+ * the DISNIX_ADAPTIVE_TRANSFERS environment variable is set to a positive
+ * number, then the limit is adjusted at runtime by an AIMD controller: it
+ * starts at max_concurrent_transfers, grows while the throughput improves, and
+ * backs off when it saturates or transfers fail. The value of the environment
+ * variable is used as the upper bound. The chosen limits are reported when all
+ * transfers have completed.
+ *
+ * This function measures the throughput in completed transfers per second. Use
+ * fork_and_wait_for_measured_transfers() when the sizes of the transfers are
+ * known.
+ *
+ * @param iterator PID iterator that spawns the transfer processes
+ * @param max_concurrent_transfers Specifies the maximum amount of concurrent transfers, or the initial amount when adaptive transfers are enabled
+ * @param bulk_lane Lane created with create_bulk_transfer_lane() that the spawned processes use for their bulk transfers, or NULL if they do not use a lane
+ * @param phase Description of the transfer phase used in the report
+ */
+void fork_and_wait_for_transfers(ProcReact_PidIterator *iterator, const unsigned int max_concurrent_transfers, const ProcReact_Lane *bulk_lane, const gchar *phase);
+
+/**
+ * Spawns the transfer processes of a PID iterator in parallel and waits for
+ * their completion, like fork_and_wait_for_transfers(), but measures the
+ * throughput of adaptive transfers in the amount of work (such as bytes) that
+ * is transferred per second.
+ *
+ * While the transfers run, *adaptive_limit refers to the adaptive limit (or
+ * NULL if adaptive transfers are disabled). The completion callback of the
+ * iterator should report the amount of work that a successful transfer has
+ * processed with procreact_adaptive_limit_add_units(). All transfers of the
+ * iterator should report their work in the same unit.
+ *
+ * @param iterator PID iterator that spawns the transfer processes
+ * @param max_concurrent_transfers Specifies the maximum amount of concurrent transfers, or the initial amount when adaptive transfers are enabled
+ * @param bulk_lane Lane created with create_bulk_transfer_lane() that the spawned processes use for their bulk transfers, or NULL if they do not use a lane
+ * @param adaptive_limit Pointer that refers to the adaptive limit while the transfers run
+ * @param phase Description of the transfer phase used in the report
+ */
+void fork_and_wait_for_measured_transfers(ProcReact_PidIterator *iterator, const unsigned int max_concurrent_transfers, const ProcReact_Lane *bulk_lane, ProcReact_AdaptiveLimit **adaptive_limit, const gchar *phase);
+
+/**
+ * Determines how many components of the same target may transfer their
+ * snapshots concurrently. The DISNIX_MAX_TRANSFERS_PER_TARGET environment
+ * variable can lower this amount. A target never gets more than the bulk
+ * transfer tokens of the lane, because the bulk transfers of all targets share
+ * that lane.
+ *
+ * @param bulk_lane Lane created with create_bulk_transfer_lane()
+ * @return The maximum amount of concurrent snapshot transfers per target
+ */
+unsigned int determine_max_transfers_per_target(const ProcReact_Lane *bulk_lane);
+
+#endif
@@ -21,84 +21,184 @@
 #include <procreact_types.h>
 #include "package-management.h"
 #include "remote-package-management.h"
+#include "valid-paths-cache.h"
 
-ProcReact_bool copy_closure_to_sync(gchar *interface, gchar *target, gchar *tmpdir, gchar **paths, int stderr_fd)
+static ProcReact_bool transfer_invalid_paths_to(gchar *interface, gchar *target, gchar *tmpdir, gchar **invalid_paths, const ProcReact_Lane *bulk_lane, int stderr_fd)
 {
-    char **requisites = pkgmgmt_query_requisites_sync(paths, g_strv_length(paths), stderr_fd);
+    unsigned int invalid_paths_length = g_strv_length(invalid_paths);
 
-    if(requisites == NULL)
+    if(invalid_paths_length == 0)
+        return TRUE;
+    else if(!procreact_lane_acquire(bulk_lane)) /* The export and import are bulk I/O and must share the bulk lane with other transfers */
         return FALSE;
     else
     {
-        ProcReact_bool exit_status = TRUE;
-        unsigned int requisites_length = g_strv_length(requisites);
+        ProcReact_bool exit_status;
+        char *tempfile = pkgmgmt_export_closure_sync(tmpdir, invalid_paths, invalid_paths_length, stderr_fd);
 
-        if(requisites_length > 0)
+        if(tempfile == NULL)
+            exit_status = FALSE;
+        else
         {
-            char **invalid_paths = pkgmgmt_remote_print_invalid_sync(interface, target, requisites, requisites_length);
+            exit_status = pkgmgmt_import_local_closure_sync(interface, target, tempfile);
+            unlink(tempfile);
+            g_free(tempfile);
+        }
+
+        procreact_lane_release(bulk_lane);
+        return exit_status;
+    }
+}
+
+/* Remote metadata queries take a token that the lane reserves for them, so that they do not queue behind bulk transfers */
+
+static char **remote_print_invalid(gchar *interface, gchar *target, gchar **paths, unsigned int paths_length, const ProcReact_Lane *bulk_lane)
+{
+    if(!procreact_lane_acquire_priority(bulk_lane))
+        return NULL;
+    else
+    {
+        char **invalid_paths = pkgmgmt_remote_print_invalid_sync(interface, target, paths, paths_length);
+        procreact_lane_release(bulk_lane);
+        return invalid_paths;
+    }
+}
+
+static char **remote_query_requisites(gchar *interface, gchar *target, gchar **paths, const ProcReact_Lane *bulk_lane)
+{
+    if(!procreact_lane_acquire_priority(bulk_lane))
+        return NULL;
+    else
+    {
+        char **requisites = pkgmgmt_remote_query_requisites_sync(interface, target, paths, g_strv_length(paths));
+        procreact_lane_release(bulk_lane);
+        return requisites;
+    }
+}
+
+static ProcReact_bool copy_requisites_and_invalid_paths_to_sync(gchar *interface, gchar *target, gchar *tmpdir, gchar **requisites, gchar **invalid_paths, const ProcReact_Lane *bulk_lane, int stderr_fd)
+{
+    ProcReact_bool exit_status = TRUE;
+    unsigned int requisites_length = g_strv_length(requisites);
+
+    if(requisites_length > 0)
+    {
+        ValidPathsCache *cache = open_valid_paths_cache(interface, target);
+        gchar **unknown_paths;
+        unsigned int unknown_paths_length;
+
+        /* Only check the validity of the paths that are not known to be valid on the target */
+        if(cache == NULL)
+            unknown_paths = requisites;
+        else
+            unknown_paths = subtract_known_valid_paths(cache, requisites, requisites_length);
+
+        unknown_paths_length = g_strv_length(unknown_paths);
 
-            if(invalid_paths == NULL)
+        if(invalid_paths != NULL)
+            exit_status = transfer_invalid_paths_to(interface, target, tmpdir, invalid_paths, bulk_lane, stderr_fd);
+        else if(unknown_paths_length > 0)
+        {
+            char **queried_invalid_paths = remote_print_invalid(interface, target, unknown_paths, unknown_paths_length, bulk_lane);
+
+            if(queried_invalid_paths == NULL)
                 exit_status = FALSE;
             else
             {
-                unsigned int invalid_paths_length = g_strv_length(invalid_paths);
-
-                if(invalid_paths_length > 0)
-                {
-                    char *tempfile = pkgmgmt_export_closure_sync(tmpdir, invalid_paths, invalid_paths_length, stderr_fd);
+                exit_status = transfer_invalid_paths_to(interface, target, tmpdir, queried_invalid_paths, bulk_lane, stderr_fd);
+                procreact_free_string_array(queried_invalid_paths);
+            }
+        }
 
-                    if(tempfile == NULL)
-                        exit_status = FALSE;
-                    else
-                    {
-                        exit_status = pkgmgmt_import_local_closure_sync(interface, target, tempfile);
-                        unlink(tempfile);
-                        g_free(tempfile);
-                    }
-                }
+        /* After a successful transfer, all requisites are valid on the target */
+        if(cache != NULL)
+        {
+            if(exit_status)
+                record_valid_paths(cache, unknown_paths);
 
-                procreact_free_string_array(invalid_paths);
-            }
+            g_free(unknown_paths);
+            delete_valid_paths_cache(cache);
         }
+    }
 
-        procreact_free_string_array(requisites);
+    return exit_status;
+}
+
+ProcReact_bool copy_requisites_to_sync(gchar *interface, gchar *target, gchar *tmpdir, gchar **requisites, const ProcReact_Lane *bulk_lane, int stderr_fd)
+{
+    return copy_requisites_and_invalid_paths_to_sync(interface, target, tmpdir, requisites, NULL, bulk_lane, stderr_fd);
+}
+
+ProcReact_bool copy_invalid_requisites_to_sync(gchar *interface, gchar *target, gchar *tmpdir, gchar **requisites, gchar **invalid_paths, const ProcReact_Lane *bulk_lane, int stderr_fd)
+{
+    return copy_requisites_and_invalid_paths_to_sync(interface, target, tmpdir, requisites, invalid_paths, bulk_lane, stderr_fd);
+}
 
+ProcReact_bool copy_closure_to_sync(gchar *interface, gchar *target, gchar *tmpdir, gchar **paths, const ProcReact_Lane *bulk_lane, int stderr_fd)
+{
+    char **requisites = pkgmgmt_query_requisites_sync(paths, g_strv_length(paths), stderr_fd);
+
+    if(requisites == NULL)
+        return FALSE;
+    else
+    {
+        ProcReact_bool exit_status = copy_requisites_to_sync(interface, target, tmpdir, requisites, bulk_lane, stderr_fd);
+        procreact_free_string_array(requisites);
         return exit_status;
     }
 }
 
-pid_t copy_closure_to(gchar *interface, gchar *target, gchar *tmpdir, gchar **paths, int stderr_fd)
+pid_t copy_closure_to(gchar *interface, gchar *target, gchar *tmpdir, gchar **paths, const ProcReact_Lane *bulk_lane, int stderr_fd)
 {
     pid_t pid = fork();
 
     if(pid == 0)
-        _exit(!copy_closure_to_sync(interface, target, tmpdir, paths, stderr_fd));
+        _exit(!copy_closure_to_sync(interface, target, tmpdir, paths, bulk_lane, stderr_fd));
 
     return pid;
 }
 
-ProcReact_bool copy_closure_from_sync(gchar *interface, gchar *target, gchar **paths, int stdout_fd, int stderr_fd)
+pid_t copy_requisites_to(gchar *interface, gchar *target, gchar *tmpdir, gchar **requisites, const ProcReact_Lane *bulk_lane, int stderr_fd)
 {
-    char **requisites = pkgmgmt_remote_query_requisites_sync(interface, target, paths, g_strv_length(paths));
+    pid_t pid = fork();
 
-    if(requisites == NULL)
-        return FALSE;
-    else
+    if(pid == 0)
+        _exit(!copy_requisites_to_sync(interface, target, tmpdir, requisites, bulk_lane, stderr_fd));
+
+    return pid;
+}
+
+pid_t copy_invalid_requisites_to(gchar *interface, gchar *target, gchar *tmpdir, gchar **requisites, gchar **invalid_paths, const ProcReact_Lane *bulk_lane, int stderr_fd)
+{
+    pid_t pid = fork();
+
+    if(pid == 0)
+        _exit(!copy_invalid_requisites_to_sync(interface, target, tmpdir, requisites, invalid_paths, bulk_lane, stderr_fd));
+
+    return pid;
+}
+
+ProcReact_bool copy_requisites_from_sync(gchar *interface, gchar *target, gchar **requisites, const ProcReact_Lane *bulk_lane, int stdout_fd, int stderr_fd)
+{
+    ProcReact_bool exit_status = TRUE;
+    unsigned int requisites_length = g_strv_length(requisites);
+
+    if(requisites_length > 0)
     {
-        ProcReact_bool exit_status = TRUE;
-        unsigned int requisites_length = g_strv_length(requisites);
+        char **invalid_paths = pkgmgmt_print_invalid_packages_sync(requisites, requisites_length, stderr_fd);
 
-        if(requisites_length > 0)
+        if(invalid_paths == NULL)
+            exit_status = FALSE;
+        else
         {
-            char **invalid_paths = pkgmgmt_print_invalid_packages_sync(requisites, requisites_length, stderr_fd);
+            unsigned int invalid_paths_length = g_strv_length(invalid_paths);
 
-            if(invalid_paths == NULL)
-                exit_status = FALSE;
-            else
+            if(invalid_paths_length > 0)
             {
-                unsigned int invalid_paths_length = g_strv_length(invalid_paths);
-
-                if(invalid_paths_length > 0)
+                /* The export and import are bulk I/O and must share the bulk lane with other transfers */
+                if(!procreact_lane_acquire(bulk_lane))
+                    exit_status = FALSE;
+                else
                 {
                     char *tempfile = pkgmgmt_export_remote_closure_sync(interface, target, invalid_paths, invalid_paths_length);
 
@@ -110,24 +210,48 @@ ProcReact_bool copy_closure_from_sync(gchar *interface, gchar *target, gchar **p
                         unlink(tempfile);
                         free(tempfile);
                     }
-                }
 
-                procreact_free_string_array(invalid_paths);
+                    procreact_lane_release(bulk_lane);
+                }
             }
+
+            procreact_free_string_array(invalid_paths);
         }
+    }
 
-        procreact_free_string_array(requisites);
+    return exit_status;
+}
+
+pid_t copy_requisites_from(gchar *interface, gchar *target, gchar **requisites, const ProcReact_Lane *bulk_lane, int stdout_fd, int stderr_fd)
+{
+    pid_t pid = fork();
 
+    if(pid == 0)
+        _exit(!copy_requisites_from_sync(interface, target, requisites, bulk_lane, stdout_fd, stderr_fd));
+
+    return pid;
+}
+
+ProcReact_bool copy_closure_from_sync(gchar *interface, gchar *target, gchar **paths, const ProcReact_Lane *bulk_lane, int stdout_fd, int stderr_fd)
+{
+    char **requisites = remote_query_requisites(interface, target, paths, bulk_lane);
+
+    if(requisites == NULL)
+        return FALSE;
+    else
+    {
+        ProcReact_bool exit_status = copy_requisites_from_sync(interface, target, requisites, bulk_lane, stdout_fd, stderr_fd);
+        procreact_free_string_array(requisites);
         return exit_status;
     }
 }
 
-pid_t copy_closure_from(gchar *interface, gchar *target, gchar **paths, int stdout_fd, int stderr_fd)
+pid_t copy_closure_from(gchar *interface, gchar *target, gchar **paths, const ProcReact_Lane *bulk_lane, int stdout_fd, int stderr_fd)
 {
     pid_t pid = fork();
 
     if(pid == 0)
-        _exit(!copy_closure_from_sync(interface, target, paths, stdout_fd, stderr_fd));
+        _exit(!copy_closure_from_sync(interface, target, paths, bulk_lane, stdout_fd, stderr_fd));
 
     return pid;
 }
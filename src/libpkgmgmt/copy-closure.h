@@ -21,6 +21,7 @@
 #define __DISNIX_COPY_CLOSURE_H
 #include <glib.h>
 #include <procreact_util.h>
+#include <procreact_lane.h>
 
 /**
  * Copies a closure of a collection of a Nix store paths to a remote machine.
@@ -29,17 +30,64 @@
  * @param target Target Address of the remote interface
  * @param tmpdir Directory in which temp files are stored
  * @param paths An array of Nix store paths
+ * @param bulk_lane Lane from which a token is acquired during the bulk transfer, or NULL
  * @param stderr_fd File descriptor to attach to the process' standard error
  * @return TRUE if the operation succeeds, else FALSE
  */
-ProcReact_bool copy_closure_to_sync(gchar *interface, gchar *target, gchar *tmpdir, gchar **paths, int stderr_fd);
+ProcReact_bool copy_closure_to_sync(gchar *interface, gchar *target, gchar *tmpdir, gchar **paths, const ProcReact_Lane *bulk_lane, int stderr_fd);
 
 /**
  * Asynchronously copies a closure to a machine in a sub process.
  *
  * @see copy_closure_to_sync
  */
-pid_t copy_closure_to(gchar *interface, gchar *target, gchar *tmpdir, gchar **paths, int stderr_fd);
+pid_t copy_closure_to(gchar *interface, gchar *target, gchar *tmpdir, gchar **paths, const ProcReact_Lane *bulk_lane, int stderr_fd);
+
+/**
+ * Copies the paths of an already queried closure to a remote machine, only
+ * transferring the paths that are not valid on the remote machine.
+ *
+ * @param interface Path to the interface executable
+ * @param target Target Address of the remote interface
+ * @param tmpdir Directory in which temp files are stored
+ * @param requisites An array of Nix store paths containing all requisites of the closure
+ * @param bulk_lane Lane from which a token is acquired during the bulk transfer, or NULL
+ * @param stderr_fd File descriptor to attach to the process' standard error
+ * @return TRUE if the operation succeeds, else FALSE
+ */
+ProcReact_bool copy_requisites_to_sync(gchar *interface, gchar *target, gchar *tmpdir, gchar **requisites, const ProcReact_Lane *bulk_lane, int stderr_fd);
+
+/**
+ * Asynchronously copies the paths of an already queried closure to a machine
+ * in a sub process.
+ *
+ * @see copy_requisites_to_sync
+ */
+pid_t copy_requisites_to(gchar *interface, gchar *target, gchar *tmpdir, gchar **requisites, const ProcReact_Lane *bulk_lane, int stderr_fd);
+
+/**
+ * Copies the paths of an already queried closure to a remote machine, of which
+ * the paths that are not valid on the remote machine have already been
+ * queried as well. Only these invalid paths are transferred.
+ *
+ * @param interface Path to the interface executable
+ * @param target Target Address of the remote interface
+ * @param tmpdir Directory in which temp files are stored
+ * @param requisites An array of Nix store paths containing all requisites of the closure
+ * @param invalid_paths An array of the requisites that are not valid on the remote machine
+ * @param bulk_lane Lane from which a token is acquired during the bulk transfer, or NULL
+ * @param stderr_fd File descriptor to attach to the process' standard error
+ * @return TRUE if the operation succeeds, else FALSE
+ */
+ProcReact_bool copy_invalid_requisites_to_sync(gchar *interface, gchar *target, gchar *tmpdir, gchar **requisites, gchar **invalid_paths, const ProcReact_Lane *bulk_lane, int stderr_fd);
+
+/**
+ * Asynchronously copies the invalid paths of an already queried closure to a
+ * machine in a sub process.
+ *
+ * @see copy_invalid_requisites_to_sync
+ */
+pid_t copy_invalid_requisites_to(gchar *interface, gchar *target, gchar *tmpdir, gchar **requisites, gchar **invalid_paths, const ProcReact_Lane *bulk_lane, int stderr_fd);
 
 /**
  * Copies a closure of a collection of a Nix store paths from a remote machine.
@@ -47,17 +95,40 @@ pid_t copy_closure_to(gchar *interface, gchar *target, gchar *tmpdir, gchar **pa
  * @param interface Path to the interface executable
  * @param target Target Address of the remote interface
  * @param paths An array of Nix store paths
+ * @param bulk_lane Lane from which a token is acquired during the bulk transfer, or NULL
  * @param stdout_fd File descriptor to attach to the process' standard output
  * @param stderr_fd File descriptor to attach to the process' standard error
  * @return TRUE if the operation succeeds, else FALSE
  */
-ProcReact_bool copy_closure_from_sync(gchar *interface, gchar *target, gchar **paths, int stdout_fd, int stderr_fd);
+ProcReact_bool copy_closure_from_sync(gchar *interface, gchar *target, gchar **paths, const ProcReact_Lane *bulk_lane, int stdout_fd, int stderr_fd);
 
 /**
  * Asynchronously copies a closure from a machine in a sub process.
  *
  * @see copy_closure_from_sync
  */
-pid_t copy_closure_from(gchar *interface, gchar *target, gchar **paths, int stdout_fd, int stderr_fd);
+pid_t copy_closure_from(gchar *interface, gchar *target, gchar **paths, const ProcReact_Lane *bulk_lane, int stdout_fd, int stderr_fd);
+
+/**
+ * Copies the paths of an already queried closure from a remote machine, only
+ * transferring the paths that are not valid on the local machine.
+ *
+ * @param interface Path to the interface executable
+ * @param target Target Address of the remote interface
+ * @param requisites An array of Nix store paths containing all requisites of the closure
+ * @param bulk_lane Lane from which a token is acquired during the bulk transfer, or NULL
+ * @param stdout_fd File descriptor to attach to the process' standard output
+ * @param stderr_fd File descriptor to attach to the process' standard error
+ * @return TRUE if the operation succeeds, else FALSE
+ */
+ProcReact_bool copy_requisites_from_sync(gchar *interface, gchar *target, gchar **requisites, const ProcReact_Lane *bulk_lane, int stdout_fd, int stderr_fd);
+
+/**
+ * Asynchronously copies the paths of an already queried closure from a machine
+ * in a sub process.
+ *
+ * @see copy_requisites_from_sync
+ */
+pid_t copy_requisites_from(gchar *interface, gchar *target, gchar **requisites, const ProcReact_Lane *bulk_lane, int stdout_fd, int stderr_fd);
 
 #endif
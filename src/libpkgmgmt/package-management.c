@@ -288,6 +288,61 @@ char **pkgmgmt_query_requisites_sync(gchar **paths, const unsigned int paths_len
         return NULL;
 }
 
+ProcReact_Future pkgmgmt_query_derivation_outputs(gchar *derivation, int stderr_fd)
+{
+    ProcReact_Future future = procreact_initialize_future(procreact_create_string_array_type('\n'));
+
+    if(future.pid == 0)
+    {
+        char *const args[] = {NIX_STORE_CMD, "--query", "--outputs", derivation, NULL};
+        dup2(future.fd, 1);
+        dup2(stderr_fd, 2);
+        execvp(args[0], args);
+        _exit(1);
+    }
+
+    return future;
+}
+
+ProcReact_Future pkgmgmt_query_nar_sizes(gchar **paths, const unsigned int paths_length, int stderr_fd)
+{
+    ProcReact_Future future = procreact_initialize_future(procreact_create_string_array_type('\n'));
+
+    if(future.pid == 0)
+    {
+        unsigned int i;
+        char **args = (char**)g_malloc((4 + paths_length) * sizeof(char*));
+
+        args[0] = NIX_STORE_CMD;
+        args[1] = "--query";
+        args[2] = "--size";
+
+        for(i = 0; i < paths_length; i++)
+            args[i + 3] = paths[i];
+
+        args[i + 3] = NULL;
+
+        dup2(future.fd, 1);
+        dup2(stderr_fd, 2);
+        execvp(args[0], args);
+        _exit(1);
+    }
+
+    return future;
+}
+
+char **pkgmgmt_query_nar_sizes_sync(gchar **paths, const unsigned int paths_length, int stderr_fd)
+{
+    ProcReact_Future future = pkgmgmt_query_nar_sizes(paths, paths_length, stderr_fd);
+    ProcReact_Status status;
+    char **result = procreact_future_get(&future, &status);
+
+    if(status == PROCREACT_STATUS_OK)
+        return result;
+    else
+        return NULL;
+}
+
 pid_t pkgmgmt_collect_garbage(const ProcReact_bool delete_old, int stdout_fd, int stderr_fd)
 {
     pid_t pid = fork();
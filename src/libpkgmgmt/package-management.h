@@ -119,6 +119,32 @@ ProcReact_Future pkgmgmt_query_requisites(gchar **paths, const unsigned int path
  */
 char **pkgmgmt_query_requisites_sync(gchar **paths, const unsigned int paths_length, int stderr_fd);
 
+/**
+ * Queries the NAR sizes of a collection of valid Nix store paths.
+ *
+ * @param paths An array of Nix store paths
+ * @param paths_length The length of the paths array
+ * @param stderr_fd File descriptor to attach to the process' standard error
+ * @return A future that returns a string array with the NAR size of each path, in the same order as the paths array
+ */
+ProcReact_Future pkgmgmt_query_nar_sizes(gchar **paths, const unsigned int paths_length, int stderr_fd);
+
+/**
+ * Synchronously queries the NAR sizes of a collection of valid Nix store paths.
+ *
+ * @see pkgmgmt_query_nar_sizes
+ */
+char **pkgmgmt_query_nar_sizes_sync(gchar **paths, const unsigned int paths_length, int stderr_fd);
+
+/**
+ * Queries the output paths of a store derivation.
+ *
+ * @param derivation Path to a Nix store derivation
+ * @param stderr_fd File descriptor to attach to the process' standard error
+ * @return A future that returns a string array with the output paths of the derivation
+ */
+ProcReact_Future pkgmgmt_query_derivation_outputs(gchar *derivation, int stderr_fd);
+
 /**
  * Removes all packages that are no longer in use.
  *
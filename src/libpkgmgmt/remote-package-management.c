@@ -79,13 +79,24 @@ ProcReact_Future pkgmgmt_remote_query_installed(gchar *interface, gchar *target,
     return future;
 }
 
-ProcReact_Future pkgmgmt_remote_realise(gchar *interface, gchar *target, gchar *derivation)
+ProcReact_Future pkgmgmt_remote_realise(gchar *interface, gchar *target, gchar **derivations, const unsigned int derivations_length)
 {
     ProcReact_Future future = procreact_initialize_future(procreact_create_string_array_type('\n'));
 
     if(future.pid == 0)
     {
-        char *const args[] = {interface, "--realise", "--target", target, derivation, NULL};
+        unsigned int i;
+        char **args = (char**)malloc((5 + derivations_length) * sizeof(char*));
+        args[0] = interface;
+        args[1] = "--realise";
+        args[2] = "--target";
+        args[3] = target;
+
+        for(i = 0; i < derivations_length; i++)
+            args[i + 4] = derivations[i];
+
+        args[i + 4] = NULL;
+
         dup2(future.fd, 1); /* Attach pipe to the stdout */
         execvp(interface, args); /* Run process */
         _exit(1);
@@ -94,6 +105,18 @@ ProcReact_Future pkgmgmt_remote_realise(gchar *interface, gchar *target, gchar *
     return future;
 }
 
+char **pkgmgmt_remote_realise_sync(gchar *interface, gchar *target, gchar **derivations, const unsigned int derivations_length)
+{
+    ProcReact_Status status;
+    ProcReact_Future future = pkgmgmt_remote_realise(interface, target, derivations, derivations_length);
+    char **result = procreact_future_get(&future, &status);
+
+    if(status == PROCREACT_STATUS_OK)
+        return result;
+    else
+        return NULL;
+}
+
 ProcReact_Future pkgmgmt_remote_query_requisites(gchar *interface, gchar *target, gchar **paths, const unsigned int paths_length)
 {
     ProcReact_Future future = procreact_initialize_future(procreact_create_string_array_type('\n'));
@@ -59,10 +59,19 @@ ProcReact_Future pkgmgmt_remote_query_installed(gchar *interface, gchar *target,
  *
  * @param interface Path to the interface executable
  * @param target Target Address of the remote interface
- * @param derivation Derivation to build
+ * @param derivations An array of derivations to build
+ * @param derivations_length Length of the derivations array
  * @return Future struct of the client interface process performing the operation
  */
-ProcReact_Future pkgmgmt_remote_realise(gchar *interface, gchar *target, gchar *derivation);
+ProcReact_Future pkgmgmt_remote_realise(gchar *interface, gchar *target, gchar **derivations, const unsigned int derivations_length);
+
+/**
+ * Synchronously realises a derivation through a Disnix client interface.
+ *
+ * @see pkgmgmt_remote_realise
+ * @return A string vector with the resulting output paths or NULL if the operation failed
+ */
+char **pkgmgmt_remote_realise_sync(gchar *interface, gchar *target, gchar **derivations, const unsigned int derivations_length);
 
 /**
  * Queries the requisites of a given derivation through a Disnix client interface
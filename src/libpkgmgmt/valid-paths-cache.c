@@ -0,0 +1,237 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "valid-paths-cache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <glib/gstdio.h>
+
+static gchar *compose_valid_paths_cache_dir(void)
+{
+    char *cache_dir = getenv("DISNIX_VALID_PATHS_CACHE_DIR");
+
+    if(cache_dir == NULL)
+        return g_strconcat(g_get_user_cache_dir(), "/disnix/valid-paths", NULL);
+    else
+        return g_strdup(cache_dir);
+}
+
+static gchar *compose_valid_paths_cache_file(const gchar *interface, const gchar *target)
+{
+    /* The target address may contain characters that are not allowed in file names, so we use a hash of the interface and target instead */
+    gchar *key = g_strconcat(interface, "\n", target, NULL);
+    gchar *hash = g_compute_checksum_for_string(G_CHECKSUM_SHA256, key, -1);
+    gchar *cache_dir = compose_valid_paths_cache_dir();
+    gchar *cache_file = g_strconcat(cache_dir, "/", hash, NULL);
+
+    g_free(cache_dir);
+    g_free(hash);
+    g_free(key);
+
+    return cache_file;
+}
+
+static time_t determine_max_age(void)
+{
+    char *max_age = getenv("DISNIX_VALID_PATHS_CACHE_MAX_AGE");
+
+    if(max_age == NULL)
+        return DISNIX_DEFAULT_VALID_PATHS_CACHE_MAX_AGE;
+    else
+        return atol(max_age);
+}
+
+static ProcReact_bool full_verification_requested(void)
+{
+    char *full_verify = getenv("DISNIX_FULL_VERIFY");
+    return (full_verify != NULL && strcmp(full_verify, "1") == 0);
+}
+
+static void read_valid_paths_cache_file(ValidPathsCache *cache, ProcReact_bool merge)
+{
+    gchar *contents;
+
+    /* The first line contains the timestamp of the last full verification, the remaining lines the valid paths */
+    if(g_file_get_contents(cache->cache_file, &contents, NULL, NULL))
+    {
+        gchar **lines = g_strsplit(contents, "\n", -1);
+
+        if(lines[0] != NULL)
+        {
+            time_t verified = atol(lines[0]);
+
+            /* When merging, paths that were recorded before our own full verification cannot be trusted */
+            if(!merge || verified >= cache->verified)
+            {
+                unsigned int i;
+
+                if(verified > cache->verified)
+                    cache->verified = verified;
+
+                for(i = 1; lines[i] != NULL; i++)
+                {
+                    if(strlen(lines[i]) > 0)
+                        g_hash_table_add(cache->valid_paths_table, g_strdup(lines[i]));
+                }
+            }
+        }
+
+        g_strfreev(lines);
+        g_free(contents);
+    }
+}
+
+ValidPathsCache *open_valid_paths_cache(const gchar *interface, const gchar *target)
+{
+    time_t max_age = determine_max_age();
+
+    if(max_age <= 0)
+        return NULL;
+    else
+    {
+        ValidPathsCache *cache = (ValidPathsCache*)g_malloc(sizeof(ValidPathsCache));
+        cache->cache_file = compose_valid_paths_cache_file(interface, target);
+        cache->valid_paths_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        cache->verified = 0;
+
+        read_valid_paths_cache_file(cache, FALSE);
+
+        /* Discard the known paths if they have not been fully verified for a while, or if a full verification was requested */
+        cache->full_verification = full_verification_requested() || (time(NULL) - cache->verified) >= max_age;
+
+        if(cache->full_verification)
+        {
+            g_hash_table_remove_all(cache->valid_paths_table);
+            cache->verified = time(NULL);
+        }
+
+        return cache;
+    }
+}
+
+void delete_valid_paths_cache(ValidPathsCache *cache)
+{
+    if(cache != NULL)
+    {
+        g_hash_table_destroy(cache->valid_paths_table);
+        g_free(cache->cache_file);
+        g_free(cache);
+    }
+}
+
+gchar **subtract_known_valid_paths(const ValidPathsCache *cache, gchar **paths, const unsigned int paths_length)
+{
+    unsigned int i, count = 0;
+    gchar **unknown_paths = (gchar**)g_malloc((paths_length + 1) * sizeof(gchar*));
+
+    for(i = 0; i < paths_length; i++)
+    {
+        if(!g_hash_table_contains(cache->valid_paths_table, paths[i]))
+        {
+            unknown_paths[count] = paths[i];
+            count++;
+        }
+    }
+
+    unknown_paths[count] = NULL;
+    return unknown_paths;
+}
+
+static ProcReact_bool write_valid_paths_cache_file(ValidPathsCache *cache)
+{
+    ProcReact_bool status;
+    gchar *cache_dir = g_path_get_dirname(cache->cache_file);
+
+    if(g_mkdir_with_parents(cache_dir, 0755) == -1)
+    {
+        g_printerr("[coordinator]: Cannot create valid paths cache directory: %s\n", cache_dir);
+        status = FALSE;
+    }
+    else
+    {
+        GHashTableIter iter;
+        gpointer key;
+        GString *contents;
+        gchar *lock_file = g_strconcat(cache->cache_file, ".lock", NULL);
+        int lock_fd = open(lock_file, O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+
+        /* Concurrent transfers to the same target update the same file, so we must read and write it exclusively */
+        if(lock_fd != -1)
+            flock(lock_fd, LOCK_EX);
+
+        read_valid_paths_cache_file(cache, TRUE);
+
+        contents = g_string_new(NULL);
+
+        g_string_append_printf(contents, "%ld\n", (long)cache->verified);
+
+        g_hash_table_iter_init(&iter, cache->valid_paths_table);
+        while(g_hash_table_iter_next(&iter, &key, NULL))
+        {
+            g_string_append(contents, (gchar*)key);
+            g_string_append_c(contents, '\n');
+        }
+
+        /* g_file_set_contents() writes to a temp file first, so that concurrent transfers to the same target never observe a partial cache */
+        status = g_file_set_contents(cache->cache_file, contents->str, contents->len, NULL);
+
+        if(!status)
+            g_printerr("[coordinator]: Cannot write valid paths cache: %s\n", cache->cache_file);
+
+        g_string_free(contents, TRUE);
+
+        if(lock_fd != -1)
+            close(lock_fd); /* Also releases the lock */
+
+        g_free(lock_file);
+    }
+
+    g_free(cache_dir);
+    return status;
+}
+
+ProcReact_bool record_valid_paths(ValidPathsCache *cache, gchar **paths)
+{
+    unsigned int i;
+    ProcReact_bool changed = cache->full_verification;
+
+    for(i = 0; paths[i] != NULL; i++)
+    {
+        if(!g_hash_table_contains(cache->valid_paths_table, paths[i]))
+        {
+            g_hash_table_add(cache->valid_paths_table, g_strdup(paths[i]));
+            changed = TRUE;
+        }
+    }
+
+    if(changed)
+        return write_valid_paths_cache_file(cache);
+    else
+        return TRUE;
+}
+
+void invalidate_valid_paths_cache(const gchar *interface, const gchar *target)
+{
+    gchar *cache_file = compose_valid_paths_cache_file(interface, target);
+    g_unlink(cache_file);
+    g_free(cache_file);
+}
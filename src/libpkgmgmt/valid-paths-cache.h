@@ -0,0 +1,106 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __DISNIX_VALID_PATHS_CACHE_H
+#define __DISNIX_VALID_PATHS_CACHE_H
+#include <time.h>
+#include <glib.h>
+#include <procreact_util.h>
+
+/**
+ * Default amount of seconds after which the valid paths of a target must be
+ * fully verified again. The cache is disabled by default, because it cannot
+ * notice paths that are removed from a target by other means than
+ * disnix-collect-garbage, such as an automatic garbage collection.
+ */
+#define DISNIX_DEFAULT_VALID_PATHS_CACHE_MAX_AGE 0
+
+/**
+ * @brief Records which Nix store paths are known to be valid on a target machine.
+ *
+ * The record is derived from previous successful closure transfers and allows
+ * the coordinator to only check the validity of paths it has not seen before.
+ */
+typedef struct
+{
+    /** Path to the file in which the known valid paths are stored */
+    gchar *cache_file;
+
+    /** Hash table used as a set of Nix store paths that are known to be valid */
+    GHashTable *valid_paths_table;
+
+    /** Timestamp of the last time all paths were verified on the target */
+    time_t verified;
+
+    /** Indicates whether the cache was discarded and all paths must be verified */
+    ProcReact_bool full_verification;
+}
+ValidPathsCache;
+
+/**
+ * Opens the valid paths cache for a target machine. If the cache is expired
+ * (its last full verification is older than the value of the
+ * DISNIX_VALID_PATHS_CACHE_MAX_AGE environment variable) or the
+ * DISNIX_FULL_VERIFY environment variable has been set, then the cached paths
+ * are discarded so that all paths will be verified again.
+ *
+ * @param interface Path to the interface executable
+ * @param target Target Address of the remote interface
+ * @return A valid paths cache or NULL if caching has been disabled (DISNIX_VALID_PATHS_CACHE_MAX_AGE is not set or 0)
+ */
+ValidPathsCache *open_valid_paths_cache(const gchar *interface, const gchar *target);
+
+/**
+ * Deletes a valid paths cache from memory. It does not remove the file.
+ *
+ * @param cache A valid paths cache
+ */
+void delete_valid_paths_cache(ValidPathsCache *cache);
+
+/**
+ * Composes an array of paths that are not known to be valid on the target machine.
+ *
+ * @param cache A valid paths cache
+ * @param paths An array of Nix store paths
+ * @param paths_length Length of the paths array
+ * @return A NULL-terminated array of paths of which the validity is unknown. The array should be freed with g_free(), but its elements refer to the elements of the given paths array.
+ */
+gchar **subtract_known_valid_paths(const ValidPathsCache *cache, gchar **paths, const unsigned int paths_length);
+
+/**
+ * Records that the given paths are valid on the target machine and writes the
+ * updated cache to disk. The cache file is locked while it is updated and the
+ * paths that concurrent transfers have recorded in the meantime are retained.
+ *
+ * @param cache A valid paths cache
+ * @param paths A NULL-terminated array of Nix store paths that are known to be valid
+ * @return TRUE if the cache was successfully written, else FALSE
+ */
+ProcReact_bool record_valid_paths(ValidPathsCache *cache, gchar **paths);
+
+/**
+ * Removes the valid paths cache of a target machine, for example, because the
+ * garbage collector may have removed paths from it.
+ *
+ * @param interface Path to the interface executable
+ * @param target Target Address of the remote interface
+ */
+void invalidate_valid_paths_cache(const gchar *interface, const gchar *target);
+
+#endif
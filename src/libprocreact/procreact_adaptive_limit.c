@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2016-2022 Sander van der Burg
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "procreact_adaptive_limit.h"
+
+/* Throughput must improve by at least 5% to increase the limit */
+#define INCREASE_THRESHOLD 1.05
+
+/* A throughput drop of more than 10% is considered saturation */
+#define SATURATION_THRESHOLD 0.90
+
+static double elapsed_seconds(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1000000000.0;
+}
+
+static void start_window(ProcReact_AdaptiveLimit *limit)
+{
+    clock_gettime(CLOCK_MONOTONIC, &limit->window_start);
+    limit->window_completed = 0;
+    limit->window_failed = 0;
+    limit->window_units = 0;
+}
+
+static unsigned int clamp_limit(const ProcReact_AdaptiveLimit *limit, unsigned int value)
+{
+    if(value < limit->min_limit)
+        return limit->min_limit;
+    else if(value > limit->max_limit)
+        return limit->max_limit;
+    else
+        return value;
+}
+
+ProcReact_AdaptiveLimit procreact_initialize_adaptive_limit(unsigned int initial_limit, unsigned int min_limit, unsigned int max_limit, ProcReact_bool measure_units)
+{
+    ProcReact_AdaptiveLimit limit;
+
+    if(min_limit == 0)
+        min_limit = 1;
+
+    if(max_limit < min_limit)
+        max_limit = min_limit;
+
+    limit.min_limit = min_limit;
+    limit.max_limit = max_limit;
+    limit.limit = clamp_limit(&limit, initial_limit);
+    limit.measure_units = measure_units;
+    limit.peak_limit = limit.limit;
+    limit.previous_throughput = 0;
+    limit.total_completed = 0;
+    limit.total_failed = 0;
+    start_window(&limit);
+
+    return limit;
+}
+
+void procreact_adaptive_limit_add_units(ProcReact_AdaptiveLimit *limit, double units)
+{
+    limit->window_units += units;
+}
+
+static void adjust_limit(ProcReact_AdaptiveLimit *limit)
+{
+    double elapsed = elapsed_seconds(&limit->window_start);
+    double throughput;
+
+    if(elapsed <= 0)
+        elapsed = 1e-9;
+
+    throughput = limit->window_units / elapsed;
+
+    if(limit->window_failed == 0 && limit->measure_units && limit->window_units == 0)
+    {
+        /* No units were processed (e.g. all paths were already present), so the window tells nothing about the throughput */
+        start_window(limit);
+        return;
+    }
+
+    if(limit->window_failed > 0)
+        limit->limit = clamp_limit(limit, limit->limit / 2); /* Errors climb: back off multiplicatively */
+    else if(limit->previous_throughput == 0 || throughput >= limit->previous_throughput * INCREASE_THRESHOLD)
+        limit->limit = clamp_limit(limit, limit->limit + 1); /* Throughput improves: increase additively */
+    else if(throughput < limit->previous_throughput * SATURATION_THRESHOLD)
+        limit->limit = clamp_limit(limit, limit->limit * 3 / 4); /* Saturated: decrease multiplicatively */
+
+    if(limit->limit > limit->peak_limit)
+        limit->peak_limit = limit->limit;
+
+    limit->previous_throughput = throughput;
+    start_window(limit);
+}
+
+void procreact_adaptive_limit_record_completion(ProcReact_AdaptiveLimit *limit, ProcReact_bool success)
+{
+    limit->window_completed++;
+
+    if(!limit->measure_units)
+        limit->window_units++;
+
+    limit->total_completed++;
+
+    if(!success)
+    {
+        limit->window_failed++;
+        limit->total_failed++;
+    }
+
+    if(limit->window_completed >= limit->limit)
+        adjust_limit(limit);
+}
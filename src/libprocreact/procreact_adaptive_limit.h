@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2016-2022 Sander van der Burg
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief Adaptive limit module
+ * @defgroup AdaptiveLimit
+ * @{
+ */
+
+#ifndef __PROCREACT_ADAPTIVE_LIMIT_H
+#define __PROCREACT_ADAPTIVE_LIMIT_H
+#include <time.h>
+#include "procreact_util.h"
+
+/**
+ * @brief Encapsulates an additive-increase/multiplicative-decrease (AIMD)
+ * controller that adjusts the amount of processes that are allowed to run
+ * concurrently based on the measured throughput.
+ *
+ * The throughput is measured in windows that each span as many process
+ * completions as the current limit. By default each completion accounts for
+ * one unit of work. When the limit measures units, only the units that are
+ * reported with procreact_adaptive_limit_add_units() (e.g. the amount of bytes
+ * that a process has transferred) are counted, so that the controller reacts
+ * to the actual throughput rather than the amount of completed processes.
+ */
+typedef struct
+{
+    /** Amount of processes that are currently allowed to run concurrently */
+    unsigned int limit;
+
+    /** Lower bound of the limit */
+    unsigned int min_limit;
+
+    /** Upper bound of the limit */
+    unsigned int max_limit;
+
+    /** Indicates whether the throughput is measured in reported units rather than in completions */
+    ProcReact_bool measure_units;
+
+    /** Highest limit that has been used */
+    unsigned int peak_limit;
+
+    /** Throughput (units per second) that was measured in the previous window */
+    double previous_throughput;
+
+    /** Start time of the current window */
+    struct timespec window_start;
+
+    /** Amount of processes that completed in the current window */
+    unsigned int window_completed;
+
+    /** Amount of processes that failed in the current window */
+    unsigned int window_failed;
+
+    /** Amount of units of work that were processed in the current window */
+    double window_units;
+
+    /** Total amount of processes that completed */
+    unsigned int total_completed;
+
+    /** Total amount of processes that failed */
+    unsigned int total_failed;
+}
+ProcReact_AdaptiveLimit;
+
+/**
+ * Initializes an adaptive limit.
+ *
+ * @param initial_limit Limit to start with
+ * @param min_limit Lower bound of the limit
+ * @param max_limit Upper bound of the limit
+ * @param measure_units TRUE to measure the throughput in the units reported with procreact_adaptive_limit_add_units(), FALSE to measure it in completions
+ * @return An adaptive limit struct
+ */
+ProcReact_AdaptiveLimit procreact_initialize_adaptive_limit(unsigned int initial_limit, unsigned int min_limit, unsigned int max_limit, ProcReact_bool measure_units);
+
+/**
+ * Adds units of work (e.g. bytes) that were processed by a completed process
+ * to the throughput measurement of the current window. It should be invoked
+ * before the completion of the process is recorded.
+ *
+ * @param limit Adaptive limit
+ * @param units Amount of units that were processed
+ */
+void procreact_adaptive_limit_add_units(ProcReact_AdaptiveLimit *limit, double units);
+
+/**
+ * Records the completion of a process. When the current window is full, the
+ * limit is increased by one if the throughput improved, decreased
+ * multiplicatively if the throughput dropped, or halved if any of the
+ * processes in the window failed.
+ *
+ * @param limit Adaptive limit
+ * @param success TRUE if the process succeeded, else FALSE
+ */
+void procreact_adaptive_limit_record_completion(ProcReact_AdaptiveLimit *limit, ProcReact_bool success);
+
+#endif
+
+/**
+ * @}
+ */
@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2016-2022 Sander van der Burg
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE /* For pipe2() */
+#include "procreact_lane.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+
+#define TRUE 1
+#define FALSE 0
+
+/* Interval in milliseconds after which a waiting process checks for tokens of terminated holders */
+#define RECLAIM_INTERVAL 1000
+
+static void write_token(int write_fd)
+{
+    char token = '+';
+    ssize_t bytes_written;
+
+    do
+        bytes_written = write(write_fd, &token, 1);
+    while(bytes_written == -1 && errno == EINTR);
+}
+
+ProcReact_Lane procreact_create_lane(const unsigned int capacity)
+{
+    return procreact_create_lane_with_reserve(capacity, 0);
+}
+
+ProcReact_Lane procreact_create_lane_with_reserve(const unsigned int capacity, const unsigned int reserved)
+{
+    ProcReact_Lane lane;
+    int pipefd[2];
+    int reserved_pipefd[2] = { -1, -1 };
+
+    lane.capacity = capacity;
+    lane.reserved = (reserved > capacity) ? capacity : reserved;
+    lane.read_fd = -1;
+    lane.write_fd = -1;
+    lane.reserved_read_fd = -1;
+    lane.reserved_write_fd = -1;
+    lane.holders = NULL;
+
+    /* The read ends are non-blocking, so that multiple waiting processes can poll them without getting stuck in read() */
+    if(capacity > 0 && pipe2(pipefd, O_CLOEXEC | O_NONBLOCK) == 0)
+    {
+        void *holders;
+
+        if(lane.reserved > 0 && pipe2(reserved_pipefd, O_CLOEXEC | O_NONBLOCK) == -1)
+        {
+            close(pipefd[0]);
+            close(pipefd[1]);
+            return lane;
+        }
+
+        holders = mmap(NULL, capacity * sizeof(pid_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+        if(holders == MAP_FAILED)
+        {
+            close(pipefd[0]);
+            close(pipefd[1]);
+
+            if(reserved_pipefd[0] != -1)
+            {
+                close(reserved_pipefd[0]);
+                close(reserved_pipefd[1]);
+            }
+        }
+        else
+        {
+            unsigned int i;
+
+            lane.read_fd = pipefd[0];
+            lane.write_fd = pipefd[1];
+            lane.reserved_read_fd = reserved_pipefd[0];
+            lane.reserved_write_fd = reserved_pipefd[1];
+            lane.holders = (pid_t*)holders; /* Anonymous mappings are zero filled, so no token is held */
+
+            /* Fill the pipes with a token for each slot in the lane */
+            for(i = 0; i < capacity - lane.reserved; i++)
+                write_token(lane.write_fd);
+
+            for(i = 0; i < lane.reserved; i++)
+                write_token(lane.reserved_write_fd);
+        }
+    }
+
+    return lane;
+}
+
+void procreact_destroy_lane(ProcReact_Lane *lane)
+{
+    if(lane->read_fd != -1)
+    {
+        close(lane->read_fd);
+        close(lane->write_fd);
+
+        if(lane->reserved_read_fd != -1)
+        {
+            close(lane->reserved_read_fd);
+            close(lane->reserved_write_fd);
+        }
+
+        munmap(lane->holders, lane->capacity * sizeof(pid_t));
+        lane->read_fd = -1;
+        lane->write_fd = -1;
+        lane->reserved_read_fd = -1;
+        lane->reserved_write_fd = -1;
+        lane->holders = NULL;
+    }
+}
+
+/* The reserved tokens occupy the last slots of the holders table */
+static int token_write_fd_of_slot(const ProcReact_Lane *lane, unsigned int slot)
+{
+    if(slot < lane->capacity - lane->reserved)
+        return lane->write_fd;
+    else
+        return lane->reserved_write_fd;
+}
+
+static void reclaim_tokens_of_terminated_holders(const ProcReact_Lane *lane)
+{
+    unsigned int i;
+
+    for(i = 0; i < lane->capacity; i++)
+    {
+        pid_t holder = lane->holders[i];
+
+        /* Only the process that manages to clear the slot returns the token, so that it is returned exactly once */
+        if(holder != 0 && kill(holder, 0) == -1 && errno == ESRCH && __sync_bool_compare_and_swap(&lane->holders[i], holder, 0))
+            write_token(token_write_fd_of_slot(lane, i));
+    }
+}
+
+static void register_holder(const ProcReact_Lane *lane, unsigned int first_slot, unsigned int last_slot)
+{
+    pid_t pid = getpid();
+    unsigned int i;
+
+    for(i = first_slot; i < last_slot; i++)
+    {
+        if(__sync_bool_compare_and_swap(&lane->holders[i], 0, pid))
+            break;
+    }
+}
+
+/* Returns 1 if a token was taken, 0 if the pipe is empty and -1 in case of an error */
+static int take_token(int read_fd)
+{
+    while(TRUE)
+    {
+        char token;
+        ssize_t bytes_read = read(read_fd, &token, 1);
+
+        if(bytes_read == 1)
+            return 1;
+        else if(bytes_read == -1 && errno == EAGAIN)
+            return 0;
+        else if(!(bytes_read == -1 && errno == EINTR))
+            return -1;
+    }
+}
+
+static ProcReact_bool acquire_token(const ProcReact_Lane *lane, ProcReact_bool priority)
+{
+    unsigned int ordinary_slots = lane->capacity - lane->reserved;
+    ProcReact_bool use_reserved = priority && lane->reserved_read_fd != -1;
+
+    while(TRUE)
+    {
+        int status;
+
+        if(use_reserved)
+        {
+            status = take_token(lane->reserved_read_fd);
+
+            if(status == 1)
+            {
+                register_holder(lane, ordinary_slots, lane->capacity);
+                return TRUE;
+            }
+            else if(status == -1)
+                return FALSE;
+        }
+
+        status = take_token(lane->read_fd);
+
+        if(status == 1)
+        {
+            register_holder(lane, 0, ordinary_slots);
+            return TRUE;
+        }
+        else if(status == -1)
+            return FALSE;
+        else
+        {
+            struct pollfd pollfds[2] = { { lane->read_fd, POLLIN, 0 }, { lane->reserved_read_fd, POLLIN, 0 } };
+            int poll_status = poll(pollfds, use_reserved ? 2 : 1, RECLAIM_INTERVAL);
+
+            if(poll_status == 0)
+                reclaim_tokens_of_terminated_holders(lane);
+            else if(poll_status == -1 && errno != EINTR)
+                return FALSE;
+        }
+    }
+}
+
+ProcReact_bool procreact_lane_acquire(const ProcReact_Lane *lane)
+{
+    if(lane == NULL || lane->read_fd == -1)
+        return TRUE;
+    else
+        return acquire_token(lane, FALSE);
+}
+
+ProcReact_bool procreact_lane_acquire_priority(const ProcReact_Lane *lane)
+{
+    if(lane == NULL || lane->read_fd == -1)
+        return TRUE;
+    else
+        return acquire_token(lane, TRUE);
+}
+
+void procreact_lane_release(const ProcReact_Lane *lane)
+{
+    if(lane != NULL && lane->write_fd != -1)
+    {
+        pid_t pid = getpid();
+        unsigned int i;
+
+        for(i = 0; i < lane->capacity; i++)
+        {
+            if(__sync_bool_compare_and_swap(&lane->holders[i], pid, 0))
+            {
+                write_token(token_write_fd_of_slot(lane, i));
+                break;
+            }
+        }
+    }
+}
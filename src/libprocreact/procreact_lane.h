@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2016-2022 Sander van der Burg
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief Lane module
+ * @defgroup Lane
+ * @{
+ */
+
+#ifndef __PROCREACT_LANE_H
+#define __PROCREACT_LANE_H
+#include <sys/types.h>
+#include "procreact_util.h"
+
+/**
+ * @brief Encapsulates a lane: a pool of tokens that bounds how many processes
+ * may perform a certain class of work (e.g. bulk I/O) at the same time.
+ *
+ * The tokens are stored in a pipe, so that a lane can be shared by all child
+ * processes that are forked after it has been created. Work that does not
+ * acquire a token is not bounded by the lane.
+ *
+ * A lane may reserve some of its tokens for priority work (e.g. small metadata
+ * queries). Reserved tokens are kept in a separate pipe that only priority work
+ * acquires from, so that priority work never has to wait until ordinary work
+ * releases its tokens.
+ *
+ * Each process that holds a token is recorded in a table that is shared with
+ * the child processes. If a holder terminates without releasing its token,
+ * e.g. because it was killed by a signal, then a waiting process returns the
+ * token to the lane, so that the lane never runs out of tokens.
+ */
+typedef struct
+{
+    /** File descriptor from which ordinary tokens are acquired */
+    int read_fd;
+
+    /** File descriptor to which ordinary tokens are released */
+    int write_fd;
+
+    /** File descriptor from which reserved tokens are acquired, or -1 if no tokens are reserved */
+    int reserved_read_fd;
+
+    /** File descriptor to which reserved tokens are released, or -1 if no tokens are reserved */
+    int reserved_write_fd;
+
+    /** Amount of tokens in the lane, including the reserved tokens */
+    unsigned int capacity;
+
+    /** Amount of tokens that are reserved for priority work */
+    unsigned int reserved;
+
+    /** Shared table with a slot for each token, containing the PID of its holder or 0 if the token is not held. The reserved tokens occupy the last slots. */
+    pid_t *holders;
+}
+ProcReact_Lane;
+
+/**
+ * Creates a new lane with the given amount of tokens.
+ *
+ * @param capacity Amount of processes that may hold a token at the same time
+ * @return A lane struct. If the lane cannot be created or the capacity is 0, its read_fd is -1 and the lane does not bound anything.
+ */
+ProcReact_Lane procreact_create_lane(const unsigned int capacity);
+
+/**
+ * Creates a new lane with the given amount of tokens, of which a number is
+ * reserved for priority work. Ordinary work can hold at most
+ * capacity - reserved tokens at the same time.
+ *
+ * @param capacity Amount of processes that may hold a token at the same time
+ * @param reserved Amount of tokens that only priority work may acquire. It must not exceed the capacity.
+ * @return A lane struct. If the lane cannot be created or the capacity is 0, its read_fd is -1 and the lane does not bound anything.
+ */
+ProcReact_Lane procreact_create_lane_with_reserve(const unsigned int capacity, const unsigned int reserved);
+
+/**
+ * Destroys the resources of a lane in the current process.
+ *
+ * @param lane Lane to destroy
+ */
+void procreact_destroy_lane(ProcReact_Lane *lane);
+
+/**
+ * Acquires a token from a lane, blocking until one becomes available. While
+ * waiting, the tokens of holders that have terminated without releasing them
+ * are returned to the lane. If the lane is NULL or invalid, this function
+ * returns immediately.
+ *
+ * @param lane Lane to acquire a token from
+ * @return TRUE if a token was acquired or no lane is used, FALSE in case of an error
+ */
+ProcReact_bool procreact_lane_acquire(const ProcReact_Lane *lane);
+
+/**
+ * Acquires a token from a lane for priority work. A reserved token is
+ * preferred, but an ordinary token is taken if all reserved tokens are in use.
+ * It blocks until either becomes available. If the lane is NULL or invalid,
+ * this function returns immediately.
+ *
+ * @param lane Lane to acquire a token from
+ * @return TRUE if a token was acquired or no lane is used, FALSE in case of an error
+ */
+ProcReact_bool procreact_lane_acquire_priority(const ProcReact_Lane *lane);
+
+/**
+ * Releases a token that the current process has acquired back to a lane. If
+ * the lane is NULL or invalid, this function does nothing.
+ *
+ * @param lane Lane to release the token to
+ */
+void procreact_lane_release(const ProcReact_Lane *lane);
+
+#endif
+
+/**
+ * @}
+ */
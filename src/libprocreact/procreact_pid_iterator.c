@@ -49,28 +49,27 @@ ProcReact_bool procreact_spawn_next_pid(ProcReact_PidIterator *iterator)
         return FALSE;
 }
 
-ProcReact_bool procreact_wait_for_process_to_complete(ProcReact_PidIterator *iterator)
+static ProcReact_bool wait_for_process_to_complete(ProcReact_PidIterator *iterator, ProcReact_Status *status, int *result)
 {
     if(iterator->running_processes > 0)
     {
-        int wstatus, result;
-        ProcReact_Status status;
+        int wstatus;
 
         /* Wait for one of the processes to finish */
         pid_t pid = wait(&wstatus);
 
         if(pid > 0)
         {
-            result = iterator->retrieve(pid, wstatus, &status);
+            *result = iterator->retrieve(pid, wstatus, status);
             iterator->running_processes--;
         }
         else
         {
-            status = PROCREACT_STATUS_WAIT_FAIL;
-            result = 1;
+            *status = PROCREACT_STATUS_WAIT_FAIL;
+            *result = 1;
         }
 
-        iterator->complete(iterator->data, pid, status, result);
+        iterator->complete(iterator->data, pid, *status, *result);
 
         return TRUE;
     }
@@ -78,6 +77,13 @@ ProcReact_bool procreact_wait_for_process_to_complete(ProcReact_PidIterator *ite
         return FALSE;
 }
 
+ProcReact_bool procreact_wait_for_process_to_complete(ProcReact_PidIterator *iterator)
+{
+    ProcReact_Status status;
+    int result;
+    return wait_for_process_to_complete(iterator, &status, &result);
+}
+
 void procreact_fork_in_parallel_and_wait(ProcReact_PidIterator *iterator)
 {
     /* Fork all processes in parallel */
@@ -104,3 +110,25 @@ void procreact_fork_and_wait_in_parallel_limit(ProcReact_PidIterator *iterator,
         has_running_processes = procreact_wait_for_process_to_complete(iterator);
     }
 }
+
+void procreact_fork_and_wait_in_parallel_adaptive_limit(ProcReact_PidIterator *iterator, ProcReact_AdaptiveLimit *limit)
+{
+    /* Repeat this until all processes have been spawned and finished */
+    int has_running_processes = FALSE;
+
+    while(has_running_processes || iterator->has_next(iterator->data))
+    {
+        ProcReact_Status status;
+        int result;
+
+        /* Fork at most the amount of processes that the controller currently allows */
+        while(iterator->running_processes < limit->limit && procreact_spawn_next_pid(iterator))
+            ;
+
+        /* Wait for one of the processes to finish and feed its outcome to the controller */
+        has_running_processes = wait_for_process_to_complete(iterator, &status, &result);
+
+        if(has_running_processes)
+            procreact_adaptive_limit_record_completion(limit, status == PROCREACT_STATUS_OK && result);
+    }
+}
@@ -30,6 +30,7 @@
 #define __PROCREACT_PID_ITERATOR_H
 #include "procreact_pid.h"
 #include "procreact_util.h"
+#include "procreact_adaptive_limit.h"
 
 /** Pointer to a function that determines whether there is a next element in the collection */
 typedef ProcReact_bool (*ProcReact_PidIteratorHasNext) (void *data);
@@ -137,6 +138,16 @@ void procreact_fork_in_parallel_and_wait(ProcReact_PidIterator *iterator);
  */
 void procreact_fork_and_wait_in_parallel_limit(ProcReact_PidIterator *iterator, const unsigned int limit);
 
+/**
+ * Spawns processes in a collection in parallel and waits for their completion.
+ * The amount of processes that are allowed to run concurrently is adjusted by
+ * an adaptive limit, based on the throughput and failures it observes.
+ *
+ * @param iterator PID iterator
+ * @param limit Adaptive limit that controls the amount of concurrent processes
+ */
+void procreact_fork_and_wait_in_parallel_adaptive_limit(ProcReact_PidIterator *iterator, ProcReact_AdaptiveLimit *limit);
+
 #endif
 
 /**
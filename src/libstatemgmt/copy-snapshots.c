@@ -24,38 +24,324 @@
 #include <libgen.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <procreact_types.h>
 #include "snapshot-management.h"
 #include "remote-snapshot-management.h"
+#include "snapshot-dedup.h"
+#include "snapshot-digest.h"
 
-static ProcReact_bool order_snapshots_remotely(gchar *interface, gchar *target, gchar *container, gchar *component, char **snapshot_array, const unsigned int snapshot_array_length)
+ProcReact_bool check_fetch_snapshots_interface(const gchar *interface)
 {
-    char **resolved_snapshots = statemgmt_remote_resolve_snapshots_sync(interface, target, snapshot_array, snapshot_array_length);
-    ProcReact_bool exit_status = statemgmt_import_remote_snapshots_sync(interface, target, container, component, resolved_snapshots, g_strv_length(resolved_snapshots));
-    procreact_free_string_array(resolved_snapshots);
-    return exit_status;
+    /* A path would let a caller pick any executable, so only names that are looked up in the PATH are accepted */
+    if(strchr(interface, '/') != NULL)
+        return FALSE;
+    else
+    {
+        char *permitted_interfaces = getenv("DISNIX_FETCH_SNAPSHOTS_INTERFACES");
+        gchar **interfaces = g_strsplit(permitted_interfaces == NULL ? DISNIX_FETCH_SNAPSHOTS_INTERFACES : permitted_interfaces, ":", -1);
+        ProcReact_bool result = FALSE;
+        unsigned int i;
+
+        for(i = 0; interfaces[i] != NULL; i++)
+        {
+            if(strcmp(interfaces[i], "") != 0 && strcmp(interfaces[i], interface) == 0)
+            {
+                result = TRUE;
+                break;
+            }
+        }
+
+        g_strfreev(interfaces);
+        return result;
+    }
 }
 
-static ProcReact_bool send_missing_snapshots(gchar *interface, gchar *target, gchar *container, gchar *component, char **missing_snapshots, const unsigned int missing_snapshots_length, int stderr_fd)
+ProcReact_bool check_fetch_snapshots_source_target(const gchar *source_target)
 {
-    char **resolved_snapshots = statemgmt_resolve_snapshots_sync(missing_snapshots, missing_snapshots_length, stderr_fd);
+    unsigned int i;
 
-    if(resolved_snapshots == NULL)
+    if(source_target[0] == '\0' || source_target[0] == '-')
         return FALSE;
+
+    for(i = 0; source_target[i] != '\0'; i++)
+    {
+        if(g_ascii_isspace(source_target[i]))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static ProcReact_bool delta_transfers_enabled(void)
+{
+    char *delta_snapshots = getenv("DISNIX_DELTA_SNAPSHOTS");
+    return (delta_snapshots != NULL && strcmp(delta_snapshots, "1") == 0);
+}
+
+static gchar *select_basis(char **latest_snapshot, char **resolved_latest_snapshot)
+{
+    gchar *basis;
+
+    if(resolved_latest_snapshot != NULL && resolved_latest_snapshot[0] != NULL)
+        basis = g_strdup(resolved_latest_snapshot[0]);
+    else
+        basis = NULL;
+
+    procreact_free_string_array(resolved_latest_snapshot);
+    procreact_free_string_array(latest_snapshot);
+    return basis;
+}
+
+static gchar *determine_remote_basis(gchar *interface, gchar *target, gchar *container, gchar *component, const ProcReact_Lane *bulk_lane)
+{
+    if(!procreact_lane_acquire_priority(bulk_lane))
+        return NULL;
     else
     {
-        const unsigned int resolved_snapshots_length = g_strv_length(resolved_snapshots);
-        ProcReact_bool exit_status;
+        /* The newest generation on the receiving machine is the most likely to resemble the generations that are transferred */
+        char **latest_snapshot = statemgmt_remote_query_latest_snapshot_sync(interface, target, container, component);
+        gchar *basis;
 
-        if(resolved_snapshots_length == 0)
-            exit_status = FALSE;
+        if(latest_snapshot == NULL || latest_snapshot[0] == NULL)
+            basis = select_basis(latest_snapshot, NULL);
         else
-            exit_status = statemgmt_import_local_snapshots_sync(interface, target, container, component, resolved_snapshots, resolved_snapshots_length);
+            basis = select_basis(latest_snapshot, statemgmt_remote_resolve_snapshots_sync(interface, target, latest_snapshot, 1));
+
+        procreact_lane_release(bulk_lane);
+        return basis;
+    }
+}
+
+static gchar *determine_local_basis(gchar *container, gchar *component, int stderr_fd)
+{
+    char **latest_snapshot = statemgmt_query_latest_snapshot_sync(container, component, stderr_fd);
+
+    if(latest_snapshot == NULL || latest_snapshot[0] == NULL)
+        return select_basis(latest_snapshot, NULL);
+    else
+        return select_basis(latest_snapshot, statemgmt_resolve_snapshots_sync(latest_snapshot, 1, stderr_fd));
+}
+
+static ProcReact_bool verify_snapshot_digests(gchar *target, char **snapshots, const unsigned int snapshots_length, char **original_digests, char **copied_digests)
+{
+    if(original_digests == NULL || copied_digests == NULL || g_strv_length(original_digests) != snapshots_length || g_strv_length(copied_digests) != snapshots_length)
+    {
+        g_printerr("[target: %s]: Cannot determine the digests of the transferred snapshots!\n", target);
+        return FALSE;
+    }
+    else
+    {
+        ProcReact_bool status = TRUE;
+        unsigned int i;
+
+        for(i = 0; i < snapshots_length; i++)
+        {
+            if(strcmp(original_digests[i], copied_digests[i]) != 0)
+            {
+                g_printerr("[target: %s]: Snapshot: %s is corrupted, its digest: %s differs from the digest of the original: %s\n", target, snapshots[i], copied_digests[i], original_digests[i]);
+                status = FALSE;
+            }
+        }
+
+        return status;
+    }
+}
+
+static char **get_snapshot_digests(ProcReact_Future *future)
+{
+    ProcReact_Status status;
+    char **digests = procreact_future_get(future, &status);
+
+    if(status == PROCREACT_STATUS_OK)
+        return digests;
+    else
+    {
+        procreact_free_string_array(digests);
+        return NULL;
+    }
+}
+
+static GHashTable *create_snapshot_index_table(char **snapshots)
+{
+    GHashTable *snapshot_index_table = g_hash_table_new(g_str_hash, g_str_equal);
+    unsigned int i;
+
+    for(i = 0; snapshots[i] != NULL; i++)
+        g_hash_table_insert(snapshot_index_table, snapshots[i], GUINT_TO_POINTER(i + 1)); /* Offset by one, so that the first index is not NULL */
+
+    return snapshot_index_table;
+}
+
+static char **resolve_snapshots_remotely(gchar *interface, gchar *target, char **snapshots, GHashTable *missing_snapshots_table, const ProcReact_Lane *bulk_lane)
+{
+    GPtrArray *present_snapshots_array = g_ptr_array_new();
+    char **resolved_snapshots;
+    unsigned int i;
 
+    for(i = 0; snapshots[i] != NULL; i++)
+    {
+        if(!g_hash_table_contains(missing_snapshots_table, snapshots[i]))
+            g_ptr_array_add(present_snapshots_array, snapshots[i]);
+    }
+
+    if(present_snapshots_array->len == 0)
+        resolved_snapshots = (char**)calloc(1, sizeof(char*)); /* Nothing to resolve */
+    else if(!procreact_lane_acquire_priority(bulk_lane))
+        resolved_snapshots = NULL;
+    else
+    {
+        resolved_snapshots = statemgmt_remote_resolve_snapshots_sync(interface, target, (gchar**)present_snapshots_array->pdata, present_snapshots_array->len);
+        procreact_lane_release(bulk_lane);
+    }
+
+    if(resolved_snapshots != NULL && g_strv_length(resolved_snapshots) != present_snapshots_array->len)
+    {
         procreact_free_string_array(resolved_snapshots);
+        resolved_snapshots = NULL;
+    }
 
-        return exit_status;
+    g_ptr_array_free(present_snapshots_array, TRUE);
+    return resolved_snapshots;
+}
+
+static ProcReact_bool import_snapshot_run(gchar *interface, gchar *target, gchar *container, gchar *component, GPtrArray *run_array, GPtrArray *run_digests_array, ProcReact_bool local, gchar *basis, const ProcReact_Lane *bulk_lane)
+{
+    ProcReact_bool exit_status;
+
+    if(local)
+    {
+        /* Only importing local snapshots transfers snapshot data, so that is the only part that takes a bulk token */
+        if(!procreact_lane_acquire(bulk_lane))
+            exit_status = FALSE;
+        else
+        {
+            gchar **digests;
+
+            if(run_digests_array == NULL)
+                digests = NULL;
+            else
+            {
+                g_ptr_array_add(run_digests_array, NULL); /* The digests are passed as a NULL-terminated string vector */
+                digests = (gchar**)run_digests_array->pdata;
+            }
+
+            exit_status = statemgmt_import_local_snapshots_sync(interface, target, container, component, (gchar**)run_array->pdata, run_array->len, basis, digests);
+            procreact_lane_release(bulk_lane);
+        }
+    }
+    else
+        exit_status = statemgmt_import_remote_snapshots_sync(interface, target, container, component, (gchar**)run_array->pdata, run_array->len);
+
+    g_ptr_array_set_size(run_array, 0);
+
+    if(run_digests_array != NULL)
+        g_ptr_array_set_size(run_digests_array, 0);
+
+    return exit_status;
+}
+
+static ProcReact_bool import_snapshots_in_order(gchar *interface, gchar *target, gchar *container, gchar *component, char **snapshots, GHashTable *missing_snapshots_table, char **resolved_missing_snapshots, char **resolved_present_snapshots, char **missing_digests, gchar *basis, const ProcReact_Lane *bulk_lane)
+{
+    ProcReact_bool exit_status = TRUE;
+    ProcReact_bool run_is_local = FALSE;
+    GPtrArray *run_array = g_ptr_array_new();
+    GPtrArray *run_digests_array = (missing_digests == NULL) ? NULL : g_ptr_array_new();
+    unsigned int i, present_index = 0;
+
+    /*
+     * Missing snapshots must be transferred and already present snapshots must
+     * be imported again to give them the right generation order. Because an
+     * import either transfers or not, consecutive snapshots of the same kind are
+     * imported in one operation, preserving the order of the generations.
+     */
+    for(i = 0; exit_status && snapshots[i] != NULL; i++)
+    {
+        gpointer missing_index = g_hash_table_lookup(missing_snapshots_table, snapshots[i]);
+        ProcReact_bool is_local = (missing_index != NULL);
+
+        if(run_array->len > 0 && is_local != run_is_local)
+            exit_status = import_snapshot_run(interface, target, container, component, run_array, run_digests_array, run_is_local, basis, bulk_lane);
+
+        if(is_local)
+        {
+            g_ptr_array_add(run_array, resolved_missing_snapshots[GPOINTER_TO_UINT(missing_index) - 1]);
+
+            if(run_digests_array != NULL)
+                g_ptr_array_add(run_digests_array, missing_digests[GPOINTER_TO_UINT(missing_index) - 1]);
+        }
+        else
+        {
+            g_ptr_array_add(run_array, resolved_present_snapshots[present_index]);
+            present_index++;
+        }
+
+        run_is_local = is_local;
+    }
+
+    if(exit_status && run_array->len > 0)
+        exit_status = import_snapshot_run(interface, target, container, component, run_array, run_digests_array, run_is_local, basis, bulk_lane);
+
+    if(run_digests_array != NULL)
+        g_ptr_array_free(run_digests_array, TRUE);
+
+    g_ptr_array_free(run_array, TRUE);
+    return exit_status;
+}
+
+static ProcReact_bool send_and_import_snapshots(gchar *interface, gchar *target, gchar *container, gchar *component, char **snapshots, char **missing_snapshots, const ProcReact_Lane *bulk_lane, int stderr_fd)
+{
+    ProcReact_bool exit_status;
+    const unsigned int missing_snapshots_length = g_strv_length(missing_snapshots);
+    GHashTable *missing_snapshots_table = create_snapshot_index_table(missing_snapshots);
+    char **resolved_missing_snapshots;
+
+    if(missing_snapshots_length == 0)
+        resolved_missing_snapshots = (char**)calloc(1, sizeof(char*)); /* Nothing to resolve */
+    else
+        resolved_missing_snapshots = statemgmt_resolve_snapshots_sync(missing_snapshots, missing_snapshots_length, stderr_fd);
+
+    if(resolved_missing_snapshots == NULL || g_strv_length(resolved_missing_snapshots) != missing_snapshots_length)
+        exit_status = FALSE;
+    else
+    {
+        char **resolved_present_snapshots = resolve_snapshots_remotely(interface, target, snapshots, missing_snapshots_table, bulk_lane);
+
+        if(resolved_present_snapshots == NULL)
+            exit_status = FALSE;
+        else
+        {
+            ProcReact_bool verify = (missing_snapshots_length > 0 && statemgmt_snapshot_verification_enabled());
+            char **original_digests;
+
+            /* The receiver checks its copies against the digests of the originals before it imports them, so that a corrupted copy never ends up in its snapshot store */
+            if(verify)
+                original_digests = statemgmt_query_snapshot_digests_sync(missing_snapshots, missing_snapshots_length, stderr_fd);
+            else
+                original_digests = NULL;
+
+            if(verify && (original_digests == NULL || g_strv_length(original_digests) != missing_snapshots_length))
+            {
+                g_printerr("[coordinator]: Cannot determine the digests of the snapshots to be transferred to: %s\n", target);
+                exit_status = FALSE;
+            }
+            else
+            {
+                gchar *basis = (missing_snapshots_length > 0 && delta_transfers_enabled()) ? determine_remote_basis(interface, target, container, component, bulk_lane) : NULL;
+                exit_status = import_snapshots_in_order(interface, target, container, component, snapshots, missing_snapshots_table, resolved_missing_snapshots, resolved_present_snapshots, original_digests, basis, bulk_lane);
+                g_free(basis);
+            }
+
+            procreact_free_string_array(original_digests);
+            procreact_free_string_array(resolved_present_snapshots);
+        }
     }
+
+    procreact_free_string_array(resolved_missing_snapshots);
+    g_hash_table_destroy(missing_snapshots_table);
+
+    return exit_status;
 }
 
 static char **query_local_snapshots(gchar *container, gchar *component, ProcReact_bool all, int stderr_fd)
@@ -66,38 +352,43 @@ static char **query_local_snapshots(gchar *container, gchar *component, ProcReac
         return statemgmt_query_latest_snapshot_sync(container, component, stderr_fd);
 }
 
-ProcReact_bool copy_snapshots_to_sync(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, int stderr_fd)
+/* Remote metadata queries take a token that the lane reserves for them, so that they do not queue behind bulk transfers */
+static char **remote_print_missing_snapshots(gchar *interface, gchar *target, char **snapshots, const ProcReact_Lane *bulk_lane)
+{
+    if(!procreact_lane_acquire_priority(bulk_lane))
+        return NULL;
+    else
+    {
+        char **missing_snapshots = statemgmt_remote_print_missing_snapshots_sync(interface, target, snapshots, g_strv_length(snapshots));
+        procreact_lane_release(bulk_lane);
+        return missing_snapshots;
+    }
+}
+
+ProcReact_bool copy_snapshots_to_sync(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, const ProcReact_Lane *bulk_lane, int stderr_fd)
 {
     char **snapshots = query_local_snapshots(container, component, all, stderr_fd);
 
     if(snapshots == NULL)
         return FALSE;
+    else if(snapshots[0] == NULL)
+    {
+        procreact_free_string_array(snapshots);
+        return TRUE; /* Nothing to copy */
+    }
     else
     {
-        ProcReact_bool exit_status = TRUE;
-        unsigned int i;
-
-        for(i = 0; i < g_strv_length(snapshots); i++) // We need to traverse the snapshots in the right order, one by one, to ensure that the generations are imported in the right order
-        {
-            char *snapshot = snapshots[i];
-            char *snapshot_array[] = { snapshot, NULL };
-            unsigned int snapshot_array_length = 1; // Length of the above array
-
-            char **missing_snapshots = statemgmt_remote_print_missing_snapshots_sync(interface, target, snapshot_array, snapshot_array_length);
-
-            if(missing_snapshots == NULL)
-                exit_status = FALSE;
-            else
-            {
-                unsigned int missing_snapshots_length = g_strv_length(missing_snapshots);
+        ProcReact_bool exit_status;
 
-                if(missing_snapshots_length == 0) // If no snapshots need to be transferred, we still have to order them
-                     exit_status = order_snapshots_remotely(interface, target, container, component, snapshot_array, snapshot_array_length);
-                else
-                     exit_status = send_missing_snapshots(interface, target, container, component, missing_snapshots, missing_snapshots_length, stderr_fd);
+        /* Determine the missing generations with a single round trip, instead of one for each generation */
+        char **missing_snapshots = remote_print_missing_snapshots(interface, target, snapshots, bulk_lane);
 
-                procreact_free_string_array(missing_snapshots);
-            }
+        if(missing_snapshots == NULL)
+            exit_status = FALSE;
+        else
+        {
+            exit_status = send_and_import_snapshots(interface, target, container, component, snapshots, missing_snapshots, bulk_lane, stderr_fd);
+            procreact_free_string_array(missing_snapshots);
         }
 
         procreact_free_string_array(snapshots);
@@ -106,12 +397,12 @@ ProcReact_bool copy_snapshots_to_sync(gchar *interface, gchar *target, gchar *co
     }
 }
 
-pid_t copy_snapshots_to(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, int stderr_fd)
+pid_t copy_snapshots_to(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, const ProcReact_Lane *bulk_lane, int stderr_fd)
 {
     pid_t pid = fork();
 
     if(pid == 0)
-        _exit(!copy_snapshots_to_sync(interface, target, container, component, all, stderr_fd));
+        _exit(!copy_snapshots_to_sync(interface, target, container, component, all, bulk_lane, stderr_fd));
 
     return pid;
 }
@@ -131,108 +422,257 @@ static ProcReact_bool remove_directory_and_contents(char *path)
     return (nftw(path, unlink_cb, 64, FTW_DEPTH | FTW_PHYS) == 0);
 }
 
-static ProcReact_bool order_local_snapshot(gchar *container, gchar *component, char *snapshot, int stdout_fd, int stderr_fd)
+static void remove_retrieved_snapshots(char **tmpdirs)
 {
-    char *snapshot_array[] = { snapshot, NULL };
-    char **resolved_snapshots = statemgmt_resolve_snapshots_sync(snapshot_array, g_strv_length(snapshot_array), stderr_fd);
+    if(tmpdirs != NULL)
+    {
+        unsigned int i;
 
-    if(resolved_snapshots == NULL)
-        return FALSE;
+        for(i = 0; tmpdirs[i] != NULL; i++)
+            remove_directory_and_contents(tmpdirs[i]);
+
+        g_strfreev(tmpdirs);
+    }
+}
+
+static char **retrieve_missing_snapshots(gchar *interface, gchar *target, char **missing_snapshots, const unsigned int missing_snapshots_length, gchar *basis, const ProcReact_Lane *bulk_lane, char ***resolved_snapshots)
+{
+    char **tmpdirs = NULL;
+
+    if(procreact_lane_acquire_priority(bulk_lane))
+    {
+        *resolved_snapshots = statemgmt_remote_resolve_snapshots_sync(interface, target, missing_snapshots, missing_snapshots_length);
+        procreact_lane_release(bulk_lane);
+    }
     else
+        *resolved_snapshots = NULL;
+
+    if(*resolved_snapshots != NULL && g_strv_length(*resolved_snapshots) == missing_snapshots_length && procreact_lane_acquire(bulk_lane))
     {
-        ProcReact_bool exit_status = statemgmt_import_snapshots_sync(container, component, resolved_snapshots, g_strv_length(resolved_snapshots), stdout_fd, stderr_fd);
-        procreact_free_string_array(resolved_snapshots);
-        return exit_status;
+        /* Only the export transfers the snapshot data, so that is the only part that takes a bulk token */
+        tmpdirs = statemgmt_export_remote_snapshots_sync(interface, target, *resolved_snapshots, missing_snapshots_length, basis);
+        procreact_lane_release(bulk_lane);
+
+        if(tmpdirs != NULL && g_strv_length(tmpdirs) != missing_snapshots_length)
+        {
+            g_strfreev(tmpdirs);
+            tmpdirs = NULL;
+        }
     }
+
+    return tmpdirs;
 }
 
-static ProcReact_bool retrieve_missing_snapshots(gchar *interface, gchar *target, gchar *container, gchar *component, char **missing_snapshots, int stdout_fd, int stderr_fd)
+static char **resolve_present_snapshots(char **snapshots, GHashTable *missing_snapshots_table, int stderr_fd)
 {
-    char **resolved_snapshots = statemgmt_remote_resolve_snapshots_sync(interface, target, missing_snapshots, g_strv_length(missing_snapshots));
+    GPtrArray *present_snapshots_array = g_ptr_array_new();
+    char **resolved_snapshots;
+    unsigned int i;
 
-    if(resolved_snapshots == NULL)
-        return FALSE;
+    for(i = 0; snapshots[i] != NULL; i++)
+    {
+        if(!g_hash_table_contains(missing_snapshots_table, snapshots[i]))
+            g_ptr_array_add(present_snapshots_array, snapshots[i]);
+    }
+
+    if(present_snapshots_array->len == 0)
+        resolved_snapshots = (char**)calloc(1, sizeof(char*)); /* Nothing to resolve */
     else
+        resolved_snapshots = statemgmt_resolve_snapshots_sync((gchar**)present_snapshots_array->pdata, present_snapshots_array->len, stderr_fd);
+
+    if(resolved_snapshots != NULL && g_strv_length(resolved_snapshots) != present_snapshots_array->len)
     {
-        ProcReact_bool exit_status = TRUE;
-        unsigned int resolved_snapshots_length = g_strv_length(resolved_snapshots);
+        procreact_free_string_array(resolved_snapshots);
+        resolved_snapshots = NULL;
+    }
 
-        if(resolved_snapshots_length == 0)
-            exit_status = FALSE;
+    g_ptr_array_free(present_snapshots_array, TRUE);
+    return resolved_snapshots;
+}
+
+static gchar **compose_ordered_import_paths(char **snapshots, GHashTable *missing_snapshots_table, char **resolved_missing_snapshots, char **tmpdirs, char **resolved_present_snapshots)
+{
+    unsigned int i, present_index = 0;
+    gchar **import_paths = (gchar**)g_malloc((g_strv_length(snapshots) + 1) * sizeof(gchar*));
+
+    for(i = 0; snapshots[i] != NULL; i++)
+    {
+        gpointer missing_index = g_hash_table_lookup(missing_snapshots_table, snapshots[i]);
+
+        if(missing_index == NULL)
+        {
+            /* Already present snapshots must be imported again to give them the right generation order */
+            import_paths[i] = g_strdup(resolved_present_snapshots[present_index]);
+            present_index++;
+        }
         else
         {
-            char **tmpdirs = statemgmt_export_remote_snapshots_sync(interface, target, resolved_snapshots, resolved_snapshots_length);
+            unsigned int index = GPOINTER_TO_UINT(missing_index) - 1;
+            import_paths[i] = g_strconcat(tmpdirs[index], "/", basename(resolved_missing_snapshots[index]), NULL);
+        }
+    }
 
-            if(tmpdirs == NULL)
-                exit_status = FALSE;
-            else
-            {
-                if(g_strv_length(tmpdirs) == 0)
-                    exit_status = FALSE;
-                else
-                {
-                    char *tmpdir = tmpdirs[0];
-                    gchar *tmp_snapshot = g_strconcat(tmpdir, "/", basename(resolved_snapshots[0]), NULL);
-                    char *tmp_snapshots[] = { tmp_snapshot, NULL };
-                    const unsigned int tmp_snapshots_length = 1; // Length of the array above
-
-                    exit_status = statemgmt_import_snapshots_sync(container, component, tmp_snapshots, tmp_snapshots_length, stdout_fd, stderr_fd);
-
-                    if(exit_status == 0)
-                        rmdir(tmpdir);
-                    else
-                        remove_directory_and_contents(tmpdir);
-
-                    g_free(tmp_snapshot);
-                }
-
-                g_strfreev(tmpdirs);
-            }
+    import_paths[i] = NULL;
+    return import_paths;
+}
+
+static char **compute_retrieved_snapshot_digests(char **resolved_missing_snapshots, char **tmpdirs)
+{
+    unsigned int i;
+    char **digests = (char**)calloc(g_strv_length(tmpdirs) + 1, sizeof(char*));
+
+    for(i = 0; tmpdirs[i] != NULL; i++)
+    {
+        gchar *path = g_strconcat(tmpdirs[i], "/", basename(resolved_missing_snapshots[i]), NULL);
+        gchar *digest = statemgmt_compute_snapshot_digest(path);
+        g_free(path);
+
+        if(digest == NULL)
+        {
+            procreact_free_string_array(digests);
+            return NULL;
         }
 
-        procreact_free_string_array(resolved_snapshots);
+        digests[i] = strdup(digest);
+        g_free(digest);
+    }
 
-        return exit_status;
+    return digests;
+}
+
+static ProcReact_bool verify_retrieved_snapshots(gchar *target, char **missing_snapshots, const unsigned int missing_snapshots_length, ProcReact_Future *digests_future, char **resolved_missing_snapshots, char **tmpdirs)
+{
+    char **original_digests = get_snapshot_digests(digests_future);
+    char **copied_digests = compute_retrieved_snapshot_digests(resolved_missing_snapshots, tmpdirs);
+    ProcReact_bool status = verify_snapshot_digests(target, missing_snapshots, missing_snapshots_length, original_digests, copied_digests);
+
+    procreact_free_string_array(copied_digests);
+    procreact_free_string_array(original_digests);
+
+    return status;
+}
+
+static void deduplicate_imported_snapshots(char **snapshots, const unsigned int snapshots_length, int stderr_fd)
+{
+    char **resolved_snapshots = statemgmt_resolve_snapshots_sync(snapshots, snapshots_length, stderr_fd);
+
+    /* Deduplication only saves space, so the retrieved snapshots remain usable if it fails */
+    if(resolved_snapshots == NULL || !statemgmt_deduplicate_snapshots(resolved_snapshots, g_strv_length(resolved_snapshots)))
+        g_printerr("[coordinator]: Cannot deduplicate the retrieved snapshots of: %s\n", snapshots[0]);
+
+    procreact_free_string_array(resolved_snapshots);
+}
+
+static ProcReact_bool retrieve_and_import_snapshots(gchar *interface, gchar *target, gchar *container, gchar *component, char **snapshots, char **missing_snapshots, const ProcReact_Lane *bulk_lane, int stdout_fd, int stderr_fd)
+{
+    ProcReact_bool exit_status;
+    const unsigned int missing_snapshots_length = g_strv_length(missing_snapshots);
+    GHashTable *missing_snapshots_table = create_snapshot_index_table(missing_snapshots);
+    char **resolved_missing_snapshots = NULL;
+    char **tmpdirs = NULL;
+    char **resolved_present_snapshots;
+
+    /* Retrieve all missing generations in one go */
+    if(missing_snapshots_length > 0)
+    {
+        gchar *basis = delta_transfers_enabled() ? determine_local_basis(container, component, stderr_fd) : NULL;
+        ProcReact_bool verify = statemgmt_snapshot_verification_enabled();
+        ProcReact_Future digests_future;
+
+        /* Let the target compute the digests of the originals while their snapshots are being transferred */
+        if(verify)
+            digests_future = statemgmt_remote_query_snapshot_digests(interface, target, missing_snapshots, missing_snapshots_length);
+
+        tmpdirs = retrieve_missing_snapshots(interface, target, missing_snapshots, missing_snapshots_length, basis, bulk_lane, &resolved_missing_snapshots);
+        g_free(basis);
+
+        if(tmpdirs == NULL)
+        {
+            if(verify)
+                procreact_free_string_array(get_snapshot_digests(&digests_future));
+
+            exit_status = FALSE;
+        }
+        else if(verify)
+            exit_status = verify_retrieved_snapshots(target, missing_snapshots, missing_snapshots_length, &digests_future, resolved_missing_snapshots, tmpdirs); /* Verify the retrieved copies before they are imported, so that a corrupted copy never ends up in the snapshot store */
+        else
+            exit_status = TRUE;
+
+        if(!exit_status)
+        {
+            remove_retrieved_snapshots(tmpdirs);
+            procreact_free_string_array(resolved_missing_snapshots);
+            g_hash_table_destroy(missing_snapshots_table);
+            return FALSE;
+        }
     }
+
+    resolved_present_snapshots = resolve_present_snapshots(snapshots, missing_snapshots_table, stderr_fd);
+
+    if(resolved_present_snapshots == NULL)
+        exit_status = FALSE;
+    else
+    {
+        /* Import all generations in a single operation, in the order in which they appear on the target */
+        gchar **import_paths = compose_ordered_import_paths(snapshots, missing_snapshots_table, resolved_missing_snapshots, tmpdirs, resolved_present_snapshots);
+        exit_status = statemgmt_import_snapshots_sync(container, component, import_paths, g_strv_length(import_paths), NULL, stdout_fd, stderr_fd);
+
+        if(exit_status && missing_snapshots_length > 0 && statemgmt_snapshot_deduplication_enabled())
+            deduplicate_imported_snapshots(missing_snapshots, missing_snapshots_length, stderr_fd);
+
+        g_strfreev(import_paths);
+        procreact_free_string_array(resolved_present_snapshots);
+    }
+
+    remove_retrieved_snapshots(tmpdirs);
+    procreact_free_string_array(resolved_missing_snapshots);
+    g_hash_table_destroy(missing_snapshots_table);
+
+    return exit_status;
 }
 
-static char **query_remote_snapshots(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all)
+static char **query_remote_snapshots(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, const ProcReact_Lane *bulk_lane)
 {
-    if(all)
-        return statemgmt_remote_query_all_snapshots_sync(interface, target, container, component);
+    if(!procreact_lane_acquire_priority(bulk_lane))
+        return NULL;
     else
-        return statemgmt_remote_query_latest_snapshot_sync(interface, target, container, component);
+    {
+        char **snapshots;
+
+        if(all)
+            snapshots = statemgmt_remote_query_all_snapshots_sync(interface, target, container, component);
+        else
+            snapshots = statemgmt_remote_query_latest_snapshot_sync(interface, target, container, component);
+
+        procreact_lane_release(bulk_lane);
+        return snapshots;
+    }
 }
 
-ProcReact_bool copy_snapshots_from_sync(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, int stdout_fd, int stderr_fd)
+ProcReact_bool copy_snapshots_from_sync(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, const ProcReact_Lane *bulk_lane, int stdout_fd, int stderr_fd)
 {
-    char **snapshots = query_remote_snapshots(interface, target, container, component, all);
+    char **snapshots = query_remote_snapshots(interface, target, container, component, all, bulk_lane);
 
     if(snapshots == NULL)
         return FALSE;
+    else if(snapshots[0] == NULL)
+    {
+        procreact_free_string_array(snapshots);
+        return TRUE; /* Nothing to copy */
+    }
     else
     {
-        ProcReact_bool exit_status = TRUE;
-        unsigned int i;
-        unsigned int snapshots_length = g_strv_length(snapshots);
-
-        for(i = 0; i < snapshots_length; i++) // We need to traverse the snapshots in the right order, one by one, to ensure that the generations are imported in the right order
-        {
-            char *snapshot = snapshots[i];
-
-            char **missing_snapshots = statemgmt_print_missing_snapshots_sync(snapshots, snapshots_length, stderr_fd);
+        ProcReact_bool exit_status;
 
-            if(missing_snapshots == NULL)
-                exit_status = FALSE;
-            else
-            {
-                if(g_strv_length(missing_snapshots) == 0) // If no snapshots need to be transferred, we still have to order them
-                    exit_status = order_local_snapshot(container, component, snapshot, stdout_fd, stderr_fd);
-                else
-                    exit_status = retrieve_missing_snapshots(interface, target, container, component, missing_snapshots, stdout_fd, stderr_fd);
+        /* Determine the missing generations once, instead of checking all of them for every generation */
+        char **missing_snapshots = statemgmt_print_missing_snapshots_sync(snapshots, g_strv_length(snapshots), stderr_fd);
 
-                procreact_free_string_array(missing_snapshots);
-            }
+        if(missing_snapshots == NULL)
+            exit_status = FALSE;
+        else
+        {
+            exit_status = retrieve_and_import_snapshots(interface, target, container, component, snapshots, missing_snapshots, bulk_lane, stdout_fd, stderr_fd);
+            procreact_free_string_array(missing_snapshots);
         }
 
         procreact_free_string_array(snapshots);
@@ -241,12 +681,12 @@ ProcReact_bool copy_snapshots_from_sync(gchar *interface, gchar *target, gchar *
     }
 }
 
-pid_t copy_snapshots_from(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, int stdout_fd, int stderr_fd)
+pid_t copy_snapshots_from(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, const ProcReact_Lane *bulk_lane, int stdout_fd, int stderr_fd)
 {
     pid_t pid = fork();
 
     if(pid == 0)
-        _exit(!copy_snapshots_from_sync(interface, target, container, component, all, stdout_fd, stderr_fd));
+        _exit(!copy_snapshots_from_sync(interface, target, container, component, all, bulk_lane, stdout_fd, stderr_fd));
 
     return pid;
 }
@@ -22,46 +22,92 @@
 #include <glib.h>
 #include <sys/types.h>
 #include <procreact_util.h>
+#include <procreact_lane.h>
 
 /**
- * Copies generations of snapshots to a remote machine.
+ * Colon separated list of client interfaces that a target machine may use to
+ * fetch snapshots directly from another target machine, unless the
+ * DISNIX_FETCH_SNAPSHOTS_INTERFACES environment variable overrides it.
+ */
+#define DISNIX_FETCH_SNAPSHOTS_INTERFACES "disnix-ssh-client:disnix-client:disnix-soap-client"
+
+/**
+ * Checks whether a target machine may use a client interface to fetch snapshots
+ * directly from another target machine. Only the executable names in the
+ * DISNIX_FETCH_SNAPSHOTS_INTERFACES environment variable of the receiving
+ * machine (or in DISNIX_FETCH_SNAPSHOTS_INTERFACES if it is not set) are
+ * permitted, and never a path, so that a caller of the Disnix service cannot
+ * make it execute an arbitrary program.
+ *
+ * @param interface Name of the interface executable
+ * @return TRUE if the interface is permitted, else FALSE
+ */
+ProcReact_bool check_fetch_snapshots_interface(const gchar *interface);
+
+/**
+ * Checks whether a target address can be passed to a client interface to fetch
+ * snapshots from it. The client interfaces pass the address to programs such
+ * as ssh, so an address that is empty, starts with a dash (and could be taken
+ * for an option) or contains whitespace (and could be split into multiple
+ * arguments) is refused.
+ *
+ * @param source_target Target address of the machine that provides the snapshots
+ * @return TRUE if the address is valid, else FALSE
+ */
+ProcReact_bool check_fetch_snapshots_source_target(const gchar *source_target);
+
+/**
+ * Copies generations of snapshots to a remote machine. If the
+ * DISNIX_DELTA_SNAPSHOTS environment variable is set to 1, then the newest
+ * generation on the remote machine is used as a basis, so that only the blocks
+ * that differ from it are transferred. If the DISNIX_VERIFY_SNAPSHOTS
+ * environment variable is set to 1, then the remote machine computes digests of
+ * the transferred generations that must match the digests of the originals
+ * before it imports them.
  *
  * @param interface Path to the interface executable
  * @param target Target Address of the remote interface
  * @param container Name of the container to deploy the snapshots to
  * @param component Name of the component to deploy the snapshots to
  * @param all TRUE to copy all snapshot generations, FALSE to only copy the latest
+ * @param bulk_lane Lane from which a token is acquired while transferring a snapshot, or NULL
  * @param stderr_fd File descriptor to attach to the process' standard error
  * @return TRUE if the operation succeeded, else FALSE
  */
-ProcReact_bool copy_snapshots_to_sync(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, int stderr_fd);
+ProcReact_bool copy_snapshots_to_sync(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, const ProcReact_Lane *bulk_lane, int stderr_fd);
 
 /**
  * Asynchronously copies snapshots to a remote machine.
  *
  * @see copy_snapshots_to_sync
  */
-pid_t copy_snapshots_to(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, int stderr_fd);
+pid_t copy_snapshots_to(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, const ProcReact_Lane *bulk_lane, int stderr_fd);
 
 /**
- * Copies generations of snapshots from a remote machine.
+ * Copies generations of snapshots from a remote machine. If the
+ * DISNIX_DELTA_SNAPSHOTS environment variable is set to 1, then the newest
+ * local generation is used as a basis for a delta transfer. If the
+ * DISNIX_VERIFY_SNAPSHOTS environment variable is set to 1, then the retrieved
+ * generations are only imported if their digests match the digests that the
+ * remote machine computes of the originals.
  *
  * @param interface Path to the interface executable
  * @param target Target Address of the remote interface
  * @param container Name of the container to deploy the snapshots to
  * @param component Name of the component to deploy the snapshots to
  * @param all TRUE to copy all snapshot generations, FALSE to only copy the latest
+ * @param bulk_lane Lane from which a token is acquired while transferring a snapshot, or NULL
  * @param stdout_fd File descriptor to attach to the process' standard output
  * @param stderr_fd File descriptor to attach to the process' standard error
  * @return TRUE if the operation succeeded, else FALSE
  */
-ProcReact_bool copy_snapshots_from_sync(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, int stdout_fd, int stderr_fd);
+ProcReact_bool copy_snapshots_from_sync(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, const ProcReact_Lane *bulk_lane, int stdout_fd, int stderr_fd);
 
 /**
  * Asynchronously copies snapshots from a remote machine.
  *
  * @see copy_snapshots_from_sync
  */
-pid_t copy_snapshots_from(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, int stdout_fd, int stderr_fd);
+pid_t copy_snapshots_from(gchar *interface, gchar *target, gchar *container, gchar *component, ProcReact_bool all, const ProcReact_Lane *bulk_lane, int stdout_fd, int stderr_fd);
 
 #endif
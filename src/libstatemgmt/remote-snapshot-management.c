@@ -64,6 +64,37 @@ pid_t statemgmt_remote_clean_snapshots(gchar *interface, gchar *target, int keep
     return pid;
 }
 
+pid_t statemgmt_remote_clean_snapshots_of_components(gchar *interface, gchar *target, int keep, gchar **components, const unsigned int components_length)
+{
+    pid_t pid = fork();
+
+    if(pid == 0)
+    {
+        unsigned int i;
+        char **args = (char**)g_malloc((7 + components_length) * sizeof(char*));
+        char keepStr[15];
+
+        sprintf(keepStr, "%d", keep);
+
+        args[0] = interface;
+        args[1] = "--target";
+        args[2] = target;
+        args[3] = "--clean-snapshots";
+        args[4] = "--keep";
+        args[5] = keepStr;
+
+        for(i = 0; i < components_length; i++)
+            args[i + 6] = components[i];
+
+        args[i + 6] = NULL;
+
+        execvp(interface, args);
+        _exit(1);
+    }
+
+    return pid;
+}
+
 ProcReact_Future statemgmt_remote_query_all_snapshots(gchar *interface, gchar *target, gchar *container, gchar *component)
 {
     ProcReact_Future future = procreact_initialize_future(procreact_create_string_array_type('\n'));
@@ -254,14 +285,90 @@ char **statemgmt_remote_resolve_snapshots_sync(gchar *interface, gchar *target,
         return NULL;
 }
 
-pid_t statemgmt_import_local_snapshots(gchar *interface, gchar *target, gchar *container, gchar *component, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length)
+ProcReact_Future statemgmt_remote_query_snapshot_sizes(gchar *interface, gchar *target, gchar **snapshots, const unsigned int snapshots_length)
+{
+    ProcReact_Future future = procreact_initialize_future(procreact_create_string_array_type('\n'));
+
+    if(future.pid == 0)
+    {
+        unsigned int i;
+        char **args = (char**)malloc((5 + snapshots_length) * sizeof(char*));
+        args[0] = interface;
+        args[1] = "--target";
+        args[2] = target;
+        args[3] = "--query-snapshot-sizes";
+
+        for(i = 0; i < snapshots_length; i++)
+            args[i + 4] = snapshots[i];
+
+        args[i + 4] = NULL;
+
+        dup2(future.fd, 1);
+        execvp(args[0], args);
+        _exit(1);
+    }
+
+    return future;
+}
+
+char **statemgmt_remote_query_snapshot_sizes_sync(gchar *interface, gchar *target, gchar **snapshots, const unsigned int snapshots_length)
+{
+    ProcReact_Status status;
+    ProcReact_Future future = statemgmt_remote_query_snapshot_sizes(interface, target, snapshots, snapshots_length);
+    char **result = procreact_future_get(&future, &status);
+
+    if(status == PROCREACT_STATUS_OK)
+        return result;
+    else
+        return NULL;
+}
+
+ProcReact_Future statemgmt_remote_query_snapshot_digests(gchar *interface, gchar *target, gchar **snapshots, const unsigned int snapshots_length)
+{
+    ProcReact_Future future = procreact_initialize_future(procreact_create_string_array_type('\n'));
+
+    if(future.pid == 0)
+    {
+        unsigned int i;
+        char **args = (char**)malloc((5 + snapshots_length) * sizeof(char*));
+        args[0] = interface;
+        args[1] = "--target";
+        args[2] = target;
+        args[3] = "--query-snapshot-digests";
+
+        for(i = 0; i < snapshots_length; i++)
+            args[i + 4] = snapshots[i];
+
+        args[i + 4] = NULL;
+
+        dup2(future.fd, 1);
+        execvp(args[0], args);
+        _exit(1);
+    }
+
+    return future;
+}
+
+char **statemgmt_remote_query_snapshot_digests_sync(gchar *interface, gchar *target, gchar **snapshots, const unsigned int snapshots_length)
+{
+    ProcReact_Status status;
+    ProcReact_Future future = statemgmt_remote_query_snapshot_digests(interface, target, snapshots, snapshots_length);
+    char **result = procreact_future_get(&future, &status);
+
+    if(status == PROCREACT_STATUS_OK)
+        return result;
+    else
+        return NULL;
+}
+
+pid_t statemgmt_import_local_snapshots(gchar *interface, gchar *target, gchar *container, gchar *component, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length, gchar *basis, gchar **digests)
 {
     pid_t pid = fork();
 
     if(pid == 0)
     {
-        unsigned int i;
-        char **args = (char**)malloc((10 + resolved_snapshots_length) * sizeof(char*));
+        unsigned int i, count = 9;
+        char **args = (char**)malloc((14 + resolved_snapshots_length) * sizeof(char*));
         args[0] = interface;
         args[1] = "--target";
         args[2] = target;
@@ -272,10 +379,26 @@ pid_t statemgmt_import_local_snapshots(gchar *interface, gchar *target, gchar *c
         args[7] = "--component";
         args[8] = component;
 
+        if(basis != NULL)
+        {
+            args[count] = "--basis";
+            count++;
+            args[count] = basis;
+            count++;
+        }
+
+        if(digests != NULL)
+        {
+            args[count] = "--digests";
+            count++;
+            args[count] = g_strjoinv(",", digests);
+            count++;
+        }
+
         for(i = 0; i < resolved_snapshots_length; i++)
-            args[i + 9] = resolved_snapshots[i];
+            args[i + count] = resolved_snapshots[i];
 
-        args[i + 9] = NULL;
+        args[i + count] = NULL;
 
         execvp(args[0], args);
         _exit(1);
@@ -284,10 +407,10 @@ pid_t statemgmt_import_local_snapshots(gchar *interface, gchar *target, gchar *c
     return pid;
 }
 
-ProcReact_bool statemgmt_import_local_snapshots_sync(gchar *interface, gchar *target, gchar *container, gchar *component, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length)
+ProcReact_bool statemgmt_import_local_snapshots_sync(gchar *interface, gchar *target, gchar *container, gchar *component, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length, gchar *basis, gchar **digests)
 {
     ProcReact_Status status;
-    pid_t pid = statemgmt_import_local_snapshots(interface, target, container, component, resolved_snapshots, resolved_snapshots_length);
+    pid_t pid = statemgmt_import_local_snapshots(interface, target, container, component, resolved_snapshots, resolved_snapshots_length, basis, digests);
     int exit_status = procreact_wait_for_boolean(pid, &status);
     return(status == PROCREACT_STATUS_OK && exit_status);
 }
@@ -330,23 +453,31 @@ ProcReact_bool statemgmt_import_remote_snapshots_sync(gchar *interface, gchar *t
     return(status == PROCREACT_STATUS_OK && exit_status);
 }
 
-ProcReact_Future statemgmt_export_remote_snapshots(gchar *interface, gchar *target, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length)
+ProcReact_Future statemgmt_export_remote_snapshots(gchar *interface, gchar *target, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length, gchar *basis)
 {
     ProcReact_Future future = procreact_initialize_future(procreact_create_string_array_type('\n'));
 
     if(future.pid == 0)
     {
-        unsigned int i;
-        char **args = (char**)malloc((5 + resolved_snapshots_length) * sizeof(char*));
+        unsigned int i, count = 4;
+        char **args = (char**)malloc((7 + resolved_snapshots_length) * sizeof(char*));
         args[0] = interface;
         args[1] = "--target";
         args[2] = target;
         args[3] = "--export-snapshots";
 
+        if(basis != NULL)
+        {
+            args[count] = "--basis";
+            count++;
+            args[count] = basis;
+            count++;
+        }
+
         for(i = 0; i < resolved_snapshots_length; i++)
-            args[i + 4] = resolved_snapshots[i];
+            args[i + count] = resolved_snapshots[i];
 
-        args[i + 4] = NULL;
+        args[i + count] = NULL;
 
         dup2(future.fd, 1);
         execvp(args[0], args);
@@ -356,10 +487,10 @@ ProcReact_Future statemgmt_export_remote_snapshots(gchar *interface, gchar *targ
     return future;
 }
 
-char **statemgmt_export_remote_snapshots_sync(gchar *interface, gchar *target, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length)
+char **statemgmt_export_remote_snapshots_sync(gchar *interface, gchar *target, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length, gchar *basis)
 {
     ProcReact_Status status;
-    ProcReact_Future future = statemgmt_export_remote_snapshots(interface, target, resolved_snapshots, resolved_snapshots_length);
+    ProcReact_Future future = statemgmt_export_remote_snapshots(interface, target, resolved_snapshots, resolved_snapshots_length, basis);
     char **result = procreact_future_get(&future, &status);
 
     if(status == PROCREACT_STATUS_OK)
@@ -367,3 +498,29 @@ char **statemgmt_export_remote_snapshots_sync(gchar *interface, gchar *target, g
     else
         return NULL;
 }
+
+pid_t statemgmt_remote_fetch_snapshots(gchar *interface, gchar *target, gchar *source_interface, gchar *source_target, gchar *container, gchar *component, ProcReact_bool all)
+{
+    pid_t pid = fork();
+
+    if(pid == 0)
+    {
+        char *args[] = { interface, "--target", target, "--fetch-snapshots", "--source-interface", source_interface, "--source-target", source_target, "--container", container, "--component", component, NULL, NULL };
+
+        if(all)
+            args[12] = "--all";
+
+        execvp(interface, args);
+        _exit(1);
+    }
+
+    return pid;
+}
+
+ProcReact_bool statemgmt_remote_fetch_snapshots_sync(gchar *interface, gchar *target, gchar *source_interface, gchar *source_target, gchar *container, gchar *component, ProcReact_bool all)
+{
+    ProcReact_Status status;
+    pid_t pid = statemgmt_remote_fetch_snapshots(interface, target, source_interface, source_target, container, component, all);
+    int exit_status = procreact_wait_for_boolean(pid, &status);
+    return(status == PROCREACT_STATUS_OK && exit_status);
+}
@@ -36,6 +36,19 @@
  */
 pid_t statemgmt_remote_clean_snapshots(gchar *interface, gchar *target, int keep, char *container, char *component);
 
+/**
+ * Invokes the Dysnomia snapshot garbage collect operation for many components
+ * at once through a Disnix client interface
+ *
+ * @param interface Path to the interface executable
+ * @param target Target Address of the remote interface
+ * @param keep Number of snapshot generations to keep
+ * @param components An array of components in the format: container/component
+ * @param components_length Length of the components array
+ * @return PID of the client interface process performing the operation, or -1 in case of a failure
+ */
+pid_t statemgmt_remote_clean_snapshots_of_components(gchar *interface, gchar *target, int keep, gchar **components, const unsigned int components_length);
+
 /**
  * Invokes the Dysnomia query all snapshots operation through a Disnix client interface
  *
@@ -108,6 +121,42 @@ ProcReact_Future statemgmt_remote_resolve_snapshots(gchar *interface, gchar *tar
  */
 char **statemgmt_remote_resolve_snapshots_sync(gchar *interface, gchar *target, gchar **snapshots, const unsigned int snapshots_length);
 
+/**
+ * Invokes the query snapshot sizes operation through a Disnix client interface
+ *
+ * @param interface Path to the interface executable
+ * @param target Target Address of the remote interface
+ * @param snapshots An array of snapshots
+ * @param snapshots_length Length of the snapshots array
+ * @return A future that returns the sizes of the snapshots in bytes
+ */
+ProcReact_Future statemgmt_remote_query_snapshot_sizes(gchar *interface, gchar *target, gchar **snapshots, const unsigned int snapshots_length);
+
+/**
+ * Synchronously invokes the query snapshot sizes operation through a Disnix client interface
+ *
+ * @see statemgmt_remote_query_snapshot_sizes
+ */
+char **statemgmt_remote_query_snapshot_sizes_sync(gchar *interface, gchar *target, gchar **snapshots, const unsigned int snapshots_length);
+
+/**
+ * Invokes the query snapshot digests operation through a Disnix client interface
+ *
+ * @param interface Path to the interface executable
+ * @param target Target Address of the remote interface
+ * @param snapshots An array of snapshots
+ * @param snapshots_length Length of the snapshots array
+ * @return A future that returns the digests of the snapshots
+ */
+ProcReact_Future statemgmt_remote_query_snapshot_digests(gchar *interface, gchar *target, gchar **snapshots, const unsigned int snapshots_length);
+
+/**
+ * Synchronously invokes the query snapshot digests operation through a Disnix client interface
+ *
+ * @see statemgmt_remote_query_snapshot_digests
+ */
+char **statemgmt_remote_query_snapshot_digests_sync(gchar *interface, gchar *target, gchar **snapshots, const unsigned int snapshots_length);
+
 /**
  * Transfers snapshots and remotely imports them into the snapshot store.
  *
@@ -117,16 +166,18 @@ char **statemgmt_remote_resolve_snapshots_sync(gchar *interface, gchar *target,
  * @param component Name of the component to filter on, or NULL to consult all components
  * @param resolved_snapshots Absolute paths to snapshots to be imported
  * @param resolved_snapshots_length Length of the resolved snapshots array
+ * @param basis Absolute path to a snapshot on the remote machine that is used as a basis for a delta transfer, or NULL to transfer the snapshots as a whole
+ * @param digests Digests of the snapshots that the receiver verifies the transferred copies against before it imports them, or NULL to import them unverified
  * @return PID of the client interface process performing the operation, or -1 in case of a failure
  */
-pid_t statemgmt_import_local_snapshots(gchar *interface, gchar *target, gchar *container, gchar *component, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length);
+pid_t statemgmt_import_local_snapshots(gchar *interface, gchar *target, gchar *container, gchar *component, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length, gchar *basis, gchar **digests);
 
 /**
  * Synchronously transfers snapshots and remotely imports them into the snapshot store.
  *
  * @see statemgmt_import_local_snapshots
  */
-ProcReact_bool statemgmt_import_local_snapshots_sync(gchar *interface, gchar *target, gchar *container, gchar *component, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length);
+ProcReact_bool statemgmt_import_local_snapshots_sync(gchar *interface, gchar *target, gchar *container, gchar *component, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length, gchar *basis, gchar **digests);
 
 /**
  * Invokes the Dysnomia import remote snapshots operation through a Disnix client interface
@@ -155,15 +206,41 @@ ProcReact_bool statemgmt_import_remote_snapshots_sync(gchar *interface, gchar *t
  * @param target Target Address of the remote interface
  * @param resolved_snapshots Absolute paths to snapshots to be imported
  * @param resolved_snapshots_length Length of the resolved snapshots array
+ * @param basis Absolute path to a snapshot on the coordinator machine that is used as a basis for a delta transfer, or NULL to transfer the snapshots as a whole
  * @return A future that returns an array of temp directories
  */
-ProcReact_Future statemgmt_export_remote_snapshots(gchar *interface, gchar *target, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length);
+ProcReact_Future statemgmt_export_remote_snapshots(gchar *interface, gchar *target, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length, gchar *basis);
 
 /**
  * Synchronously exports remote snapshots.
  *
  * @see statemgmt_export_remote_snapshots
  */
-char **statemgmt_export_remote_snapshots_sync(gchar *interface, gchar *target, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length);
+char **statemgmt_export_remote_snapshots_sync(gchar *interface, gchar *target, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length, gchar *basis);
+
+
+/**
+ * Instructs a target machine to fetch snapshots directly from another target
+ * machine, so that the snapshots do not have to be staged on the coordinator
+ * machine. The receiving machine only accepts a source interface that
+ * check_fetch_snapshots_interface() permits.
+ *
+ * @param interface Path to the interface executable
+ * @param target Target Address of the remote interface that receives the snapshots
+ * @param source_interface Name of the interface executable that the receiving machine uses to connect to the source machine
+ * @param source_target Target Address of the machine that provides the snapshots
+ * @param container Name of the container in which the component is hosted
+ * @param component Name of the component of which the snapshots must be fetched
+ * @param all TRUE to fetch all snapshot generations, FALSE to only fetch the latest
+ * @return PID of the client interface process performing the operation, or -1 in case of a failure
+ */
+pid_t statemgmt_remote_fetch_snapshots(gchar *interface, gchar *target, gchar *source_interface, gchar *source_target, gchar *container, gchar *component, ProcReact_bool all);
+
+/**
+ * Synchronously instructs a target machine to fetch snapshots directly from another target machine.
+ *
+ * @see statemgmt_remote_fetch_snapshots
+ */
+ProcReact_bool statemgmt_remote_fetch_snapshots_sync(gchar *interface, gchar *target, gchar *source_interface, gchar *source_target, gchar *container, gchar *component, ProcReact_bool all);
 
 #endif
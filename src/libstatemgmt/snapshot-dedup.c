@@ -0,0 +1,242 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "snapshot-dedup.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
+#define BUFFER_SIZE 65536
+
+ProcReact_bool statemgmt_snapshot_deduplication_enabled(void)
+{
+    char *deduplicate_snapshots = getenv("DISNIX_DEDUPLICATE_SNAPSHOTS");
+    return (deduplicate_snapshots != NULL && strcmp(deduplicate_snapshots, "1") == 0);
+}
+
+static gchar *compose_chunks_dir(void)
+{
+    char *chunks_dir = getenv("DISNIX_SNAPSHOT_CHUNKS_DIR");
+
+    if(chunks_dir == NULL)
+    {
+        char *state_dir = getenv("DYSNOMIA_STATEDIR");
+
+        if(state_dir == NULL)
+            state_dir = "/var/state/dysnomia";
+
+        return g_strconcat(state_dir, "/chunks", NULL);
+    }
+    else
+        return g_strdup(chunks_dir);
+}
+
+static gchar *compute_file_hash(const gchar *path)
+{
+    FILE *file = fopen(path, "rb");
+
+    if(file == NULL)
+        return NULL;
+    else
+    {
+        GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA256);
+        guchar buffer[BUFFER_SIZE];
+        size_t bytes_read;
+        gchar *hash;
+
+        while((bytes_read = fread(buffer, 1, BUFFER_SIZE, file)) > 0)
+            g_checksum_update(checksum, buffer, bytes_read);
+
+        if(ferror(file))
+            hash = NULL;
+        else
+            hash = g_strdup(g_checksum_get_string(checksum));
+
+        g_checksum_free(checksum);
+        fclose(file);
+
+        return hash;
+    }
+}
+
+/* Files that share a chunk share their inode, so the chunk key covers the metadata that a restored snapshot must keep as well */
+static gchar *compose_chunk_path(const gchar *chunks_dir, const gchar *hash, const struct stat *file_stat)
+{
+    return g_strdup_printf("%s/%s-%o-%u-%u-%lld.%09ld", chunks_dir, hash, (unsigned int)(file_stat->st_mode & 07777), (unsigned int)file_stat->st_uid, (unsigned int)file_stat->st_gid, (long long)file_stat->st_mtim.tv_sec, (long)file_stat->st_mtim.tv_nsec);
+}
+
+static ProcReact_bool has_same_metadata(const struct stat *chunk_stat, const struct stat *file_stat)
+{
+    return (chunk_stat->st_size == file_stat->st_size
+      && (chunk_stat->st_mode & 07777) == (file_stat->st_mode & 07777)
+      && chunk_stat->st_uid == file_stat->st_uid
+      && chunk_stat->st_gid == file_stat->st_gid
+      && chunk_stat->st_mtim.tv_sec == file_stat->st_mtim.tv_sec
+      && chunk_stat->st_mtim.tv_nsec == file_stat->st_mtim.tv_nsec);
+}
+
+static ProcReact_bool replace_by_chunk(const gchar *path, const gchar *chunk_path)
+{
+    gchar *tmp_path = g_strconcat(path, ".dedup", NULL);
+    ProcReact_bool status;
+
+    /* Link to a temp file first, so that the snapshot file is atomically replaced and never missing */
+    if(link(chunk_path, tmp_path) == -1)
+        status = FALSE;
+    else if(g_rename(tmp_path, path) == -1)
+    {
+        g_unlink(tmp_path);
+        status = FALSE;
+    }
+    else
+        status = TRUE;
+
+    g_free(tmp_path);
+    return status;
+}
+
+static ProcReact_bool deduplicate_file(const gchar *path, const struct stat *file_stat, const gchar *chunks_dir)
+{
+    gchar *hash = compute_file_hash(path);
+
+    if(hash == NULL)
+    {
+        g_printerr("Cannot compute the hash of snapshot file: %s\n", path);
+        return FALSE;
+    }
+    else
+    {
+        gchar *chunk_path = compose_chunk_path(chunks_dir, hash, file_stat);
+        struct stat chunk_stat;
+        ProcReact_bool status;
+
+        if(g_stat(chunk_path, &chunk_stat) == 0)
+        {
+            if(chunk_stat.st_dev == file_stat->st_dev && chunk_stat.st_ino == file_stat->st_ino)
+                status = TRUE; /* Already deduplicated */
+            else if(!has_same_metadata(&chunk_stat, file_stat))
+                status = TRUE; /* The chunk's inode has been modified since it was stored, so linking would change this file. Keep it as it is. */
+            else
+                status = replace_by_chunk(path, chunk_path);
+        }
+        else if(link(path, chunk_path) == 0)
+            status = TRUE; /* The file itself becomes the chunk */
+        else if(errno == EEXIST)
+            status = replace_by_chunk(path, chunk_path); /* Another process stored the same chunk first, so refer to that one */
+        else
+            status = FALSE;
+
+        if(!status)
+            g_printerr("Cannot deduplicate snapshot file: %s\n", path);
+
+        g_free(chunk_path);
+        g_free(hash);
+
+        return status;
+    }
+}
+
+static ProcReact_bool deduplicate_directory(const gchar *path, const gchar *chunks_dir)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+
+    if(dir == NULL)
+    {
+        g_printerr("Cannot open snapshot directory: %s\n", path);
+        return FALSE;
+    }
+    else
+    {
+        ProcReact_bool status = TRUE;
+        const gchar *filename;
+
+        while((filename = g_dir_read_name(dir)) != NULL)
+        {
+            gchar *file_path = g_strconcat(path, "/", filename, NULL);
+            struct stat file_stat;
+
+            if(g_lstat(file_path, &file_stat) == -1)
+                status = FALSE;
+            else if(S_ISDIR(file_stat.st_mode))
+                status = deduplicate_directory(file_path, chunks_dir) && status;
+            else if(S_ISREG(file_stat.st_mode))
+                status = deduplicate_file(file_path, &file_stat, chunks_dir) && status;
+
+            g_free(file_path);
+        }
+
+        g_dir_close(dir);
+        return status;
+    }
+}
+
+static void remove_unreferenced_chunks(const gchar *chunks_dir)
+{
+    GDir *dir = g_dir_open(chunks_dir, 0, NULL);
+
+    if(dir != NULL)
+    {
+        const gchar *filename;
+
+        while((filename = g_dir_read_name(dir)) != NULL)
+        {
+            gchar *chunk_path = g_strconcat(chunks_dir, "/", filename, NULL);
+            struct stat chunk_stat;
+
+            /* A chunk that only has the link of the chunk store is no longer used by any snapshot */
+            if(g_lstat(chunk_path, &chunk_stat) == 0 && S_ISREG(chunk_stat.st_mode) && chunk_stat.st_nlink == 1)
+                g_unlink(chunk_path);
+
+            g_free(chunk_path);
+        }
+
+        g_dir_close(dir);
+    }
+}
+
+ProcReact_bool statemgmt_deduplicate_snapshots(gchar **resolved_snapshots, const unsigned int resolved_snapshots_length)
+{
+    gchar *chunks_dir = compose_chunks_dir();
+    ProcReact_bool status;
+
+    if(g_mkdir_with_parents(chunks_dir, 0755) == -1)
+    {
+        g_printerr("Cannot create snapshot chunks directory: %s\n", chunks_dir);
+        status = FALSE;
+    }
+    else
+    {
+        unsigned int i;
+
+        remove_unreferenced_chunks(chunks_dir);
+
+        status = TRUE;
+
+        for(i = 0; i < resolved_snapshots_length; i++)
+            status = deduplicate_directory(resolved_snapshots[i], chunks_dir) && status;
+    }
+
+    g_free(chunks_dir);
+    return status;
+}
@@ -0,0 +1,60 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __DISNIX_SNAPSHOT_DEDUP_H
+#define __DISNIX_SNAPSHOT_DEDUP_H
+#include <glib.h>
+#include <procreact_types.h>
+
+/**
+ * Checks whether snapshots in the local snapshot store must be deduplicated,
+ * by setting the DISNIX_DEDUPLICATE_SNAPSHOTS environment variable to 1.
+ *
+ * @return TRUE if deduplication is enabled, else FALSE
+ */
+ProcReact_bool statemgmt_snapshot_deduplication_enabled(void);
+
+/**
+ * Deduplicates the files of the given snapshots in the local snapshot store.
+ * Every file is stored once in a content-addressed chunk store, named after
+ * the SHA-256 hash of its contents together with its permissions, ownership
+ * and modification time, and the snapshot refers to it with a hard link, so
+ * that identical files of different generations and components share their
+ * storage. Because linked files share their inode, files that only differ in
+ * their metadata are never linked to each other, and restored snapshots keep
+ * the metadata of their originals.
+ *
+ * Deduplication only reduces the storage that the snapshots occupy after they
+ * have been imported. It does not reduce the amount of data that is
+ * transferred. The chunk store resides in the directory that the
+ * DISNIX_SNAPSHOT_CHUNKS_DIR environment variable specifies, which defaults to
+ * the chunks/ sub directory of the Dysnomia state directory and must be on the
+ * same file system as the snapshots.
+ *
+ * Chunks that are no longer referenced by any snapshot, for example because
+ * older generations have been cleaned, are removed as well.
+ *
+ * @param resolved_snapshots Absolute paths to the snapshots to deduplicate
+ * @param resolved_snapshots_length Length of the resolved snapshots array
+ * @return TRUE if all snapshots were deduplicated, else FALSE. A failure leaves the affected files intact.
+ */
+ProcReact_bool statemgmt_deduplicate_snapshots(gchar **resolved_snapshots, const unsigned int resolved_snapshots_length);
+
+#endif
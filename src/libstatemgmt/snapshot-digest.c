@@ -0,0 +1,333 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "snapshot-digest.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
+#define BUFFER_SIZE 65536
+
+/* Size of the pieces of a file that are hashed independently */
+#define CHUNK_SIZE (8 * 1024 * 1024)
+
+typedef struct
+{
+    /** Absolute path to the file that contains the chunk */
+    gchar *path;
+
+    /** Offset of the chunk in the file */
+    off_t offset;
+
+    /** Size of the chunk in bytes */
+    size_t size;
+
+    /** Hexadecimal SHA-256 hash of the chunk or NULL if it cannot be read */
+    gchar *hash;
+}
+DigestChunk;
+
+typedef struct
+{
+    /** Describes the relative paths, types and sizes of all files in a canonical order */
+    GString *manifest;
+
+    /** Array of DigestChunk structs covering the contents of all regular files in the same order */
+    GPtrArray *chunks_array;
+
+    /** Index of the next chunk that a worker thread must hash */
+    volatile gint next_chunk;
+}
+DigestData;
+
+ProcReact_bool statemgmt_snapshot_verification_enabled(void)
+{
+    char *verify_snapshots = getenv("DISNIX_VERIFY_SNAPSHOTS");
+    return (verify_snapshots != NULL && strcmp(verify_snapshots, "1") == 0);
+}
+
+static void delete_digest_chunk(gpointer data)
+{
+    DigestChunk *chunk = (DigestChunk*)data;
+    g_free(chunk->path);
+    g_free(chunk->hash);
+    g_free(chunk);
+}
+
+static void add_file_chunks(DigestData *digest_data, const gchar *path, off_t size)
+{
+    off_t offset = 0;
+
+    do
+    {
+        DigestChunk *chunk = (DigestChunk*)g_malloc(sizeof(DigestChunk));
+        chunk->path = g_strdup(path);
+        chunk->offset = offset;
+        chunk->size = (size - offset) > CHUNK_SIZE ? CHUNK_SIZE : (size - offset);
+        chunk->hash = NULL;
+        g_ptr_array_add(digest_data->chunks_array, chunk);
+
+        offset += CHUNK_SIZE;
+    }
+    while(offset < size);
+}
+
+static gint compare_filenames(gconstpointer a, gconstpointer b)
+{
+    return strcmp(*((const gchar**)a), *((const gchar**)b));
+}
+
+static ProcReact_bool collect_directory(DigestData *digest_data, const gchar *path, const gchar *relative_path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+
+    if(dir == NULL)
+    {
+        g_printerr("Cannot open snapshot directory: %s\n", path);
+        return FALSE;
+    }
+    else
+    {
+        ProcReact_bool status = TRUE;
+        GPtrArray *filenames_array = g_ptr_array_new_with_free_func(g_free);
+        const gchar *filename;
+        unsigned int i;
+
+        while((filename = g_dir_read_name(dir)) != NULL)
+            g_ptr_array_add(filenames_array, g_strdup(filename));
+
+        g_dir_close(dir);
+
+        /* Directory entries are returned in an arbitrary order, so sort them to make the digest independent of the file system */
+        g_ptr_array_sort(filenames_array, compare_filenames);
+
+        for(i = 0; status && i < filenames_array->len; i++)
+        {
+            gchar *filename = g_ptr_array_index(filenames_array, i);
+            gchar *file_path = g_strconcat(path, "/", filename, NULL);
+            gchar *relative_file_path = g_strconcat(relative_path, "/", filename, NULL);
+            struct stat file_stat;
+
+            if(g_lstat(file_path, &file_stat) == -1)
+            {
+                g_printerr("Cannot stat snapshot file: %s\n", file_path);
+                status = FALSE;
+            }
+            else if(S_ISDIR(file_stat.st_mode))
+            {
+                g_string_append_printf(digest_data->manifest, "d %s\n", relative_file_path);
+                status = collect_directory(digest_data, file_path, relative_file_path);
+            }
+            else if(S_ISLNK(file_stat.st_mode))
+            {
+                gchar *link_target = g_file_read_link(file_path, NULL);
+
+                if(link_target == NULL)
+                    status = FALSE;
+                else
+                {
+                    g_string_append_printf(digest_data->manifest, "l %s %s\n", relative_file_path, link_target);
+                    g_free(link_target);
+                }
+            }
+            else if(S_ISREG(file_stat.st_mode))
+            {
+                g_string_append_printf(digest_data->manifest, "f %s %ld\n", relative_file_path, (long)file_stat.st_size);
+                add_file_chunks(digest_data, file_path, file_stat.st_size);
+            }
+
+            g_free(relative_file_path);
+            g_free(file_path);
+        }
+
+        g_ptr_array_free(filenames_array, TRUE);
+        return status;
+    }
+}
+
+static gchar *compute_chunk_hash(const DigestChunk *chunk)
+{
+    int fd = g_open(chunk->path, O_RDONLY, 0);
+
+    if(fd == -1)
+        return NULL;
+    else
+    {
+        GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA256);
+        guchar buffer[BUFFER_SIZE];
+        size_t remaining = chunk->size;
+        off_t offset = chunk->offset;
+        gchar *hash;
+
+        while(remaining > 0)
+        {
+            ssize_t bytes_read = pread(fd, buffer, remaining > BUFFER_SIZE ? BUFFER_SIZE : remaining, offset);
+
+            if(bytes_read <= 0)
+                break;
+
+            g_checksum_update(checksum, buffer, bytes_read);
+            remaining -= bytes_read;
+            offset += bytes_read;
+        }
+
+        /* A file that shrunk while it was hashed yields no hash */
+        if(remaining > 0)
+            hash = NULL;
+        else
+            hash = g_strdup(g_checksum_get_string(checksum));
+
+        g_checksum_free(checksum);
+        close(fd);
+
+        return hash;
+    }
+}
+
+static gpointer hash_chunks_thread_func(gpointer data)
+{
+    DigestData *digest_data = (DigestData*)data;
+    guint index;
+
+    /* Each worker claims the next chunk that has not been hashed yet, until all chunks are done */
+    while((index = (guint)g_atomic_int_add(&digest_data->next_chunk, 1)) < digest_data->chunks_array->len)
+    {
+        DigestChunk *chunk = g_ptr_array_index(digest_data->chunks_array, index);
+        chunk->hash = compute_chunk_hash(chunk);
+    }
+
+    return NULL;
+}
+
+static void hash_chunks_in_parallel(DigestData *digest_data)
+{
+    long num_of_processors = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int i, num_of_threads;
+    GThread **threads;
+
+    if(num_of_processors < 1)
+        num_of_threads = 1;
+    else if(num_of_processors > digest_data->chunks_array->len)
+        num_of_threads = digest_data->chunks_array->len;
+    else
+        num_of_threads = num_of_processors;
+
+    threads = (GThread**)g_malloc(num_of_threads * sizeof(GThread*));
+
+    for(i = 0; i < num_of_threads; i++)
+        threads[i] = g_thread_new("hash-snapshot-chunks", hash_chunks_thread_func, digest_data);
+
+    for(i = 0; i < num_of_threads; i++)
+        g_thread_join(threads[i]);
+
+    g_free(threads);
+}
+
+static gchar *combine_hashes(const DigestData *digest_data)
+{
+    GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA256);
+    gchar *digest;
+    unsigned int i;
+
+    g_checksum_update(checksum, (guchar*)digest_data->manifest->str, digest_data->manifest->len);
+
+    for(i = 0; i < digest_data->chunks_array->len; i++)
+    {
+        DigestChunk *chunk = g_ptr_array_index(digest_data->chunks_array, i);
+
+        if(chunk->hash == NULL)
+        {
+            g_printerr("Cannot read snapshot file: %s\n", chunk->path);
+            g_checksum_free(checksum);
+            return NULL;
+        }
+
+        g_checksum_update(checksum, (guchar*)chunk->hash, strlen(chunk->hash));
+        g_checksum_update(checksum, (guchar*)"\n", 1);
+    }
+
+    digest = g_strdup(g_checksum_get_string(checksum));
+    g_checksum_free(checksum);
+    return digest;
+}
+
+gchar *statemgmt_compute_snapshot_digest(const gchar *path)
+{
+    DigestData digest_data;
+    gchar *digest;
+
+    digest_data.manifest = g_string_new(NULL);
+    digest_data.chunks_array = g_ptr_array_new_with_free_func(delete_digest_chunk);
+    digest_data.next_chunk = 0;
+
+    if(!collect_directory(&digest_data, path, "."))
+        digest = NULL;
+    else
+    {
+        if(digest_data.chunks_array->len > 0)
+            hash_chunks_in_parallel(&digest_data);
+
+        digest = combine_hashes(&digest_data);
+    }
+
+    g_ptr_array_free(digest_data.chunks_array, TRUE);
+    g_string_free(digest_data.manifest, TRUE);
+
+    return digest;
+}
+
+ProcReact_bool statemgmt_verify_snapshot_digests(gchar **snapshots, const unsigned int snapshots_length, gchar **digests)
+{
+    if(digests == NULL)
+        return TRUE;
+    else if(g_strv_length(digests) != snapshots_length)
+    {
+        g_printerr("The number of digests does not match the number of snapshots!\n");
+        return FALSE;
+    }
+    else
+    {
+        ProcReact_bool status = TRUE;
+        unsigned int i;
+
+        for(i = 0; i < snapshots_length; i++)
+        {
+            gchar *digest = statemgmt_compute_snapshot_digest(snapshots[i]);
+
+            if(digest == NULL)
+            {
+                g_printerr("Cannot compute the digest of snapshot: %s\n", snapshots[i]);
+                status = FALSE;
+            }
+            else if(strcmp(digest, digests[i]) != 0)
+            {
+                g_printerr("Snapshot: %s is corrupted, its digest: %s differs from the digest of the original: %s\n", snapshots[i], digest, digests[i]);
+                status = FALSE;
+            }
+
+            g_free(digest);
+        }
+
+        return status;
+    }
+}
@@ -0,0 +1,59 @@
+/*
+ * Disnix - A Nix-based distributed service deployment tool
+ * Copyright (C) 2008-2022  Sander van der Burg
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __DISNIX_SNAPSHOT_DIGEST_H
+#define __DISNIX_SNAPSHOT_DIGEST_H
+#include <glib.h>
+#include <procreact_types.h>
+
+/**
+ * Checks whether transferred snapshots must be verified, by setting the
+ * DISNIX_VERIFY_SNAPSHOTS environment variable to 1.
+ *
+ * @return TRUE if verification is enabled, else FALSE
+ */
+ProcReact_bool statemgmt_snapshot_verification_enabled(void);
+
+/**
+ * Computes a digest of the contents of a snapshot that can be compared with
+ * the digest of a copy of the snapshot on another machine. The digest covers
+ * the relative paths and types of all files, the targets of symlinks and the
+ * contents of regular files. The contents of the files are split into chunks
+ * that are hashed with SHA-256 by a thread per CPU core, so that large
+ * snapshots, and even large single files, are hashed in parallel.
+ *
+ * @param path Absolute path to a snapshot
+ * @return A hexadecimal digest of the snapshot or NULL if it cannot be read. It should be freed with g_free()
+ */
+gchar *statemgmt_compute_snapshot_digest(const gchar *path);
+
+/**
+ * Checks whether the contents of the given snapshots match the digests of
+ * their originals, so that corrupted copies can be rejected before they are
+ * imported into the snapshot store.
+ *
+ * @param snapshots Absolute paths to copies of snapshots
+ * @param snapshots_length Length of the snapshots array
+ * @param digests Expected digests of the snapshots in the same order, or NULL to skip the verification
+ * @return TRUE if all digests match, else FALSE
+ */
+ProcReact_bool statemgmt_verify_snapshot_digests(gchar **snapshots, const unsigned int snapshots_length, gchar **digests);
+
+#endif
@@ -19,6 +19,10 @@
 
 #include "snapshot-management.h"
 #include <stdio.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include <procreact_pid.h>
+#include "snapshot-digest.h"
 
 ProcReact_Future statemgmt_query_all_snapshots(gchar *container, gchar *component, int stderr_fd)
 {
@@ -154,6 +158,119 @@ char **statemgmt_resolve_snapshots_sync(gchar **snapshots, const unsigned int sn
         return NULL;
 }
 
+static guint64 determine_path_size(const gchar *path)
+{
+    struct stat st;
+
+    if(g_lstat(path, &st) == -1)
+        return 0;
+    else if(S_ISDIR(st.st_mode))
+    {
+        guint64 size = 0;
+        GDir *dir = g_dir_open(path, 0, NULL);
+
+        if(dir != NULL)
+        {
+            const gchar *filename;
+
+            while((filename = g_dir_read_name(dir)) != NULL)
+            {
+                gchar *child_path = g_build_filename(path, filename, NULL);
+                size += determine_path_size(child_path);
+                g_free(child_path);
+            }
+
+            g_dir_close(dir);
+        }
+
+        return size;
+    }
+    else
+        return st.st_size;
+}
+
+ProcReact_Future statemgmt_query_snapshot_sizes(gchar **snapshots, const unsigned int snapshots_length, int stderr_fd)
+{
+    ProcReact_Future future = procreact_initialize_future(procreact_create_string_array_type('\n'));
+
+    if(future.pid == 0)
+    {
+        char **resolved_snapshots = statemgmt_resolve_snapshots_sync(snapshots, snapshots_length, stderr_fd);
+
+        if(resolved_snapshots == NULL)
+            _exit(1);
+        else
+        {
+            unsigned int i;
+
+            for(i = 0; resolved_snapshots[i] != NULL; i++)
+                dprintf(future.fd, "%" G_GUINT64_FORMAT "\n", determine_path_size(resolved_snapshots[i]));
+
+            _exit(0);
+        }
+    }
+
+    return future;
+}
+
+char **statemgmt_query_snapshot_sizes_sync(gchar **snapshots, const unsigned int snapshots_length, int stderr_fd)
+{
+    ProcReact_Status status;
+    ProcReact_Future future = statemgmt_query_snapshot_sizes(snapshots, snapshots_length, stderr_fd);
+    char **result = procreact_future_get(&future, &status);
+
+    if(status == PROCREACT_STATUS_OK)
+        return result;
+    else
+        return NULL;
+}
+
+ProcReact_Future statemgmt_query_snapshot_digests(gchar **snapshots, const unsigned int snapshots_length, int stderr_fd)
+{
+    ProcReact_Future future = procreact_initialize_future(procreact_create_string_array_type('\n'));
+
+    if(future.pid == 0)
+    {
+        char **resolved_snapshots = statemgmt_resolve_snapshots_sync(snapshots, snapshots_length, stderr_fd);
+
+        if(resolved_snapshots == NULL)
+            _exit(1);
+        else
+        {
+            unsigned int i;
+
+            dup2(stderr_fd, 2);
+
+            for(i = 0; resolved_snapshots[i] != NULL; i++)
+            {
+                gchar *digest = statemgmt_compute_snapshot_digest(resolved_snapshots[i]);
+
+                if(digest == NULL)
+                    _exit(1);
+
+                dprintf(future.fd, "%s\n", digest);
+                g_free(digest);
+            }
+
+            _exit(0);
+        }
+    }
+
+    return future;
+}
+
+char **statemgmt_query_snapshot_digests_sync(gchar **snapshots, const unsigned int snapshots_length, int stderr_fd)
+{
+    ProcReact_Status status;
+    ProcReact_Future future = statemgmt_query_snapshot_digests(snapshots, snapshots_length, stderr_fd);
+    char **result = procreact_future_get(&future, &status);
+
+    if(status == PROCREACT_STATUS_OK)
+        return result;
+    else
+        return NULL;
+}
+
 pid_t statemgmt_clean_snapshots(int keep, gchar *container, gchar *component, int stdout_fd, int stderr_fd)
 {
     pid_t pid = fork();
@@ -200,7 +317,43 @@ pid_t statemgmt_clean_snapshots(int keep, gchar *container, gchar *component, in
     return pid;
 }
 
-pid_t statemgmt_import_snapshots(gchar *container, gchar *component, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length, int stdout_fd, int stderr_fd)
+pid_t statemgmt_clean_snapshots_of_components(int keep, gchar **components, const unsigned int components_length, int stdout_fd, int stderr_fd)
+{
+    pid_t pid = fork();
+
+    if(pid == 0)
+    {
+        unsigned int i;
+        int exit_status = 0;
+
+        for(i = 0; i < components_length; i++)
+        {
+            gchar **container_and_component = g_strsplit(components[i], "/", 2);
+
+            /* An empty container or component would turn into a wildcard, so reject it */
+            if(container_and_component[0] == NULL || container_and_component[1] == NULL || g_strcmp0(container_and_component[0], "") == 0 || g_strcmp0(container_and_component[1], "") == 0)
+            {
+                dprintf(stderr_fd, "Invalid component: %s, expected format: container/component\n", components[i]);
+                exit_status = 1;
+            }
+            else
+            {
+                ProcReact_Status status;
+
+                if(!procreact_wait_for_boolean(statemgmt_clean_snapshots(keep, container_and_component[0], container_and_component[1], stdout_fd, stderr_fd), &status) || status != PROCREACT_STATUS_OK)
+                    exit_status = 1;
+            }
+
+            g_strfreev(container_and_component);
+        }
+
+        _exit(exit_status);
+    }
+
+    return pid;
+}
+
+pid_t statemgmt_import_snapshots(gchar *container, gchar *component, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length, gchar **digests, int stdout_fd, int stderr_fd)
 {
     pid_t pid = fork();
 
@@ -223,6 +376,11 @@ pid_t statemgmt_import_snapshots(gchar *container, gchar *component, gchar **res
 
         dup2(stdout_fd, 1);
         dup2(stderr_fd, 2);
+
+        /* Reject corrupted copies before any of them ends up in the snapshot store */
+        if(!statemgmt_verify_snapshot_digests(resolved_snapshots, resolved_snapshots_length, digests))
+            _exit(1);
+
         execvp(args[0], args);
         _exit(1);
     }
@@ -230,10 +388,10 @@ pid_t statemgmt_import_snapshots(gchar *container, gchar *component, gchar **res
     return pid;
 }
 
-ProcReact_bool statemgmt_import_snapshots_sync(gchar *container, gchar *component, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length, int stdout_fd, int stderr_fd)
+ProcReact_bool statemgmt_import_snapshots_sync(gchar *container, gchar *component, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length, gchar **digests, int stdout_fd, int stderr_fd)
 {
     ProcReact_Status status;
-    pid_t pid = statemgmt_import_snapshots(container, component, resolved_snapshots, resolved_snapshots_length, stdout_fd, stderr_fd);
+    pid_t pid = statemgmt_import_snapshots(container, component, resolved_snapshots, resolved_snapshots_length, digests, stdout_fd, stderr_fd);
     int exit_status = procreact_wait_for_boolean(pid, &status);
     return (status == PROCREACT_STATUS_OK && exit_status);
 }
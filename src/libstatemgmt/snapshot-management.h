@@ -92,6 +92,46 @@ ProcReact_Future statemgmt_resolve_snapshots(gchar **snapshots, const unsigned i
  */
 char **statemgmt_resolve_snapshots_sync(gchar **snapshots, const unsigned int snapshots_length, int stderr_fd);
 
+/**
+ * Determines the disk space that the given snapshots occupy in the snapshot
+ * store. For each snapshot, it returns its size in bytes in the same order.
+ *
+ * @param snapshots An array of snapshot names
+ * @param snapshots_length Length of the snapshots array
+ * @param stderr_fd File descriptor to attach to the process' standard error
+ * @return A future that returns the sizes of the snapshots in bytes
+ */
+ProcReact_Future statemgmt_query_snapshot_sizes(gchar **snapshots, const unsigned int snapshots_length, int stderr_fd);
+
+/**
+ * Synchronously determines the disk space that the given snapshots occupy in
+ * the snapshot store.
+ *
+ * @see statemgmt_query_snapshot_sizes
+ */
+char **statemgmt_query_snapshot_sizes_sync(gchar **snapshots, const unsigned int snapshots_length, int stderr_fd);
+
+/**
+ * Computes digests of the contents of the given snapshots in the snapshot
+ * store, so that they can be compared with the digests of their copies on
+ * another machine. For each snapshot, it returns its digest in the same order.
+ *
+ * @param snapshots An array of snapshot names
+ * @param snapshots_length Length of the snapshots array
+ * @param stderr_fd File descriptor to attach to the process' standard error
+ * @return A future that returns the digests of the snapshots
+ * @see statemgmt_compute_snapshot_digest
+ */
+ProcReact_Future statemgmt_query_snapshot_digests(gchar **snapshots, const unsigned int snapshots_length, int stderr_fd);
+
+/**
+ * Synchronously computes digests of the contents of the given snapshots in the
+ * snapshot store.
+ *
+ * @see statemgmt_query_snapshot_digests
+ */
+char **statemgmt_query_snapshot_digests_sync(gchar **snapshots, const unsigned int snapshots_length, int stderr_fd);
+
 /**
  * Cleans obsolete snapshot generations.
  *
@@ -104,6 +144,18 @@ char **statemgmt_resolve_snapshots_sync(gchar **snapshots, const unsigned int sn
  */
 pid_t statemgmt_clean_snapshots(int keep, gchar *container, gchar *component, int stdout_fd, int stderr_fd);
 
+/**
+ * Cleans obsolete snapshot generations of many components in one operation.
+ *
+ * @param keep Number of snapshot generations to keep
+ * @param components An array of components in the format: container/component
+ * @param components_length Length of the components array
+ * @param stdout_fd File descriptor to attach to the process' standard output
+ * @param stderr_fd File descriptor to attach to the process' standard error
+ * @return Process id of the process that executes the task or -1 in case of a failure
+ */
+pid_t statemgmt_clean_snapshots_of_components(int keep, gchar **components, const unsigned int components_length, int stdout_fd, int stderr_fd);
+
 /**
  * Imports all resolved snapshots into the local snapshot store.
  *
@@ -111,17 +163,18 @@ pid_t statemgmt_clean_snapshots(int keep, gchar *container, gchar *component, in
  * @param component Name of the component to filter on, or NULL to consult all components
  * @param resolved_snapshots Absolute paths to snapshots to be imported
  * @param resolved_snapshots_length Length of the resolved snapshots array
+ * @param digests Digests of the originals of the snapshots that the copies must match before they are imported, or NULL to import them unverified
  * @param stdout_fd File descriptor to attach to the process' standard output
  * @param stderr_fd File descriptor to attach to the process' standard error
  * @return Process id of the process that executes the task or -1 in case of a failure
  */
-pid_t statemgmt_import_snapshots(gchar *container, gchar *component, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length, int stdout_fd, int stderr_fd);
+pid_t statemgmt_import_snapshots(gchar *container, gchar *component, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length, gchar **digests, int stdout_fd, int stderr_fd);
 
 /**
  * Synchronously imports all resolved snapshots into the local snapshot store.
  *
  * @see statemgmt_import_snapshots
  */
-ProcReact_bool statemgmt_import_snapshots_sync(gchar *container, gchar *component, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length, int stdout_fd, int stderr_fd);
+ProcReact_bool statemgmt_import_snapshots_sync(gchar *container, gchar *component, gchar **resolved_snapshots, const unsigned int resolved_snapshots_length, gchar **digests, int stdout_fd, int stderr_fd);
 
 #endif
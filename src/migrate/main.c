@@ -56,6 +56,22 @@ static void print_usage(const char *command)
     "      --depth-first                    Snapshots components depth-first as\n"
     "                                       opposed to breadth-first. This approach\n"
     "                                       is more space efficient, but slower.\n"
+    "      --direct                         Lets the new machines fetch the snapshots\n"
+    "                                       of moved components directly from their\n"
+    "                                       previous machines, instead of staging them\n"
+    "                                       on the coordinator. The new machines must\n"
+    "                                       be able to connect to the previous\n"
+    "                                       machines with disnix-ssh-client. Combined\n"
+    "                                       with --depth-first, the snapshots are\n"
+    "                                       cleaned on the previous and new machines\n"
+    "                                       afterwards.\n"
+    "      --pipeline                       Snapshots, transfers and restores each\n"
+    "                                       component independently, instead of\n"
+    "                                       running each step for all components\n"
+    "                                       first. The snapshots of delivered\n"
+    "                                       components are cleaned up on the\n"
+    "                                       coordinator, keeping the amount of\n"
+    "                                       generations specified by --keep.\n"
     "      --all                            Transfers all snapshot generations of the\n"
     "                                       target machines, not the latest\n"
     "      --keep=NUM                       Amount of snapshot generations to keep.\n"
@@ -81,6 +97,45 @@ static void print_usage(const char *command)
     "                       state after upgrading. (defaults to: 0)\n"
     "  DYSNOMIA_STATEDIR    Specifies where the snapshots must be stored on the\n"
     "                       coordinator machine (defaults to: /var/state/dysnomia)\n"
+    "  DISNIX_ADAPTIVE_TRANSFERS\n"
+    "                       If set to a number, the amount of concurrent\n"
+    "                       transfers is adapted to the measured throughput,\n"
+    "                       up to the given number\n"
+    "  DISNIX_MAX_TRANSFERS_PER_TARGET\n"
+    "                       Maximum amount of components of the same target\n"
+    "                       whose snapshots are transferred concurrently\n"
+    "                       (defaults to: the maximum amount of concurrent\n"
+    "                       transfers)\n"
+    "  DISNIX_DELTA_SNAPSHOTS\n"
+    "                       If set to 1, only the blocks of the snapshots\n"
+    "                       that differ from the newest generation on the\n"
+    "                       receiving machine are transferred. Requires\n"
+    "                       rsync on both machines.\n"
+    "  DISNIX_VERIFY_SNAPSHOTS\n"
+    "                       If set to 1, the digests of transferred snapshots\n"
+    "                       are compared with the digests of the originals\n"
+    "                       to detect corruption in transit\n"
+    "  DISNIX_DEDUPLICATE_SNAPSHOTS\n"
+    "                       If set to 1, files of retrieved snapshots with\n"
+    "                       identical contents, permissions, ownership and\n"
+    "                       modification time are stored once on the\n"
+    "                       coordinator\n"
+    "  DISNIX_SNAPSHOT_CHUNKS_DIR\n"
+    "                       Directory in which the deduplicated files are\n"
+    "                       stored (defaults to: $DYSNOMIA_STATEDIR/chunks)\n"
+    "  DISNIX_MAX_STAGED_SNAPSHOTS\n"
+    "                       Maximum amount of components whose snapshots are\n"
+    "                       staged on the coordinator at the same time in\n"
+    "                       pipeline mode (defaults to: twice the maximum\n"
+    "                       amount of concurrent transfers)\n"
+    "  DISNIX_MAX_SNAPSHOT_BYTES\n"
+    "                       Maximum amount of snapshot data in bytes that is\n"
+    "                       staged on the coordinator. The components are\n"
+    "                       migrated in batches that fit in this budget and\n"
+    "                       the staged snapshots of a batch are removed once\n"
+    "                       it has been restored. The snapshot generations\n"
+    "                       that the coordinator already had are kept\n"
+    "                       (defaults to: no limit)\n"
     );
 }
 
@@ -99,6 +154,8 @@ int main(int argc, char *argv[])
         {"delete-state", no_argument, 0, DISNIX_OPTION_DELETE_STATE},
         {"transfer-only", no_argument, 0, DISNIX_OPTION_TRANSFER_ONLY},
         {"depth-first", no_argument, 0, DISNIX_OPTION_DEPTH_FIRST},
+        {"direct", no_argument, 0, DISNIX_OPTION_DIRECT},
+        {"pipeline", no_argument, 0, DISNIX_OPTION_PIPELINE},
         {"all", no_argument, 0, DISNIX_OPTION_ALL},
         {"keep", required_argument, 0, DISNIX_OPTION_KEEP},
         {"max-concurrent-transfers", required_argument, 0, DISNIX_OPTION_MAX_CONCURRENT_TRANSFERS},
@@ -155,6 +212,12 @@ int main(int argc, char *argv[])
             case DISNIX_OPTION_DEPTH_FIRST:
                 flags |= FLAG_DEPTH_FIRST;
                 break;
+            case DISNIX_OPTION_DIRECT:
+                flags |= FLAG_DIRECT;
+                break;
+            case DISNIX_OPTION_PIPELINE:
+                flags |= FLAG_PIPELINE;
+                break;
             case DISNIX_OPTION_MAX_CONCURRENT_TRANSFERS:
                 max_concurrent_transfers = atoi(optarg);
                 break;
@@ -2,6 +2,7 @@
 #include <migrate.h>
 #include <manifest.h>
 #include <snapshotmappingarray.h>
+#include <snapshot-budget.h>
 
 int run_migrate(const gchar *manifest_file, const unsigned int max_concurrent_transfers, const unsigned int flags, const int keep, const gchar *old_manifest, const gchar *coordinator_profile_path, gchar *profile, const gchar *container_filter, const gchar *component_filter)
 {
@@ -27,7 +28,7 @@ int run_migrate(const gchar *manifest_file, const unsigned int max_concurrent_tr
                 previous_manifest = open_provided_or_previous_manifest_file(old_manifest, coordinator_profile_path, profile, MANIFEST_SNAPSHOT_MAPPINGS_FLAG, container_filter, component_filter);
 
             if(previous_manifest == NULL || check_manifest(previous_manifest))
-                exit_status = !migrate(manifest, previous_manifest, max_concurrent_transfers, flags, keep);
+                exit_status = !migrate(manifest, previous_manifest, max_concurrent_transfers, flags, keep, determine_max_snapshot_bytes());
             else
                 exit_status = 1;
 
@@ -80,6 +80,29 @@ static void print_usage(const char *command)
     "  DISNIX_PROFILE    Sets the name of the profile that stores the manifest on the\n"
     "                    coordinator machine and the deployed services per machine on\n"
     "                    each target (Defaults to: default)\n"
+    "  DISNIX_ADAPTIVE_TRANSFERS\n"
+    "                    If set to a number, the amount of concurrent\n"
+    "                    transfers is adapted to the measured throughput,\n"
+    "                    up to the given number\n"
+    "  DISNIX_MAX_TRANSFERS_PER_TARGET\n"
+    "                    Maximum amount of components of the same target\n"
+    "                    whose snapshots are transferred concurrently\n"
+    "                    (defaults to: the maximum amount of concurrent\n"
+    "                    transfers)\n"
+    "  DISNIX_DELTA_SNAPSHOTS\n"
+    "                    If set to 1, only the blocks of the snapshots\n"
+    "                    that differ from the newest generation on the\n"
+    "                    receiving machine are transferred. Requires\n"
+    "                    rsync on both machines.\n"
+    "  DISNIX_VERIFY_SNAPSHOTS\n"
+    "                    If set to 1, the digests of transferred snapshots\n"
+    "                    are compared with the digests of the originals\n"
+    "                    to detect corruption in transit\n"
+    "  DISNIX_MAX_SNAPSHOT_BYTES\n"
+    "                    Maximum amount of snapshot data in bytes that\n"
+    "                    is sent in one batch. Each batch is restored and\n"
+    "                    cleaned on the targets before the next batch is\n"
+    "                    sent (defaults to: no limit)\n"
     );
 }
 
@@ -75,7 +75,13 @@ static void print_usage(const char *command)
     "                             snapshot store\n"
     "      --resolve-snapshots    Converts the relative paths to the snapshots to\n"
     "                             absolute paths\n"
+    "      --query-snapshot-sizes Prints the sizes in bytes of the given snapshots\n"
+    "      --query-snapshot-digests\n"
+    "                             Prints digests of the contents of the given\n"
+    "                             snapshots\n"
     "      --clean-snapshots      Removes older snapshots from the snapshot store\n"
+    "      --fetch-snapshots      Fetches the snapshots of a component directly from\n"
+    "                             another machine into the local snapshot store\n"
     "      --capture-config       Captures the configuration of the machine from the\n"
     "                             Dysnomia container properties in a Nix expression\n"
     "      --shell                Spawns a Dysnomia shell to run arbitrary\n"
@@ -95,6 +101,13 @@ static void print_usage(const char *command)
     "      --remotefile           Specifies that the given paths are stored remotely\n"
     "                             and must transferred from the remote machine if\n"
     "                             needed\n"
+    "      --basis=PATH           Path to a snapshot that is used as a basis for\n"
+    "                             delta transfers. This property is ignored by this\n"
+    "                             client because it only supports loopback\n"
+    "                             connections.\n"
+    "      --digests=DIGESTS      Comma separated digests of the originals of the\n"
+    "                             snapshots that must match the given snapshots\n"
+    "                             before they are imported\n"
 
     "\nSet/Query installed/Lock/Unlock options:\n"
     "  -p, --profile=PROFILE      Name of the Disnix profile. Defaults to: default\n"
@@ -119,11 +132,27 @@ static void print_usage(const char *command)
     "  -C, --container=CONTAINER  Name of the container in which the component is managed\n"
     "  -c, --component=COMPONENT  Name of the component hosted in a container\n"
 
+    "\nFetch snapshots options:\n"
+    "      --source-interface=INTERFACE\n"
+    "                             Name of the executable that must be used to\n"
+    "                             connect to the machine providing the snapshots.\n"
+    "                             It must be listed in the\n"
+    "                             DISNIX_FETCH_SNAPSHOTS_INTERFACES environment\n"
+    "                             variable. Defaults to: disnix-ssh-client\n"
+    "      --source-target=TARGET Address of the machine providing the snapshots\n"
+    "  -C, --container=CONTAINER  Name of the container in which the component is managed\n"
+    "  -c, --component=COMPONENT  Name of the component hosted in a container\n"
+    "      --all                  Fetches all snapshot generations, instead of the\n"
+    "                             latest only\n"
+
     "\nClean snapshots options:\n"
     "      --keep=NUM             Amount of snapshot generations to keep. Defaults\n"
     "                             to: 1\n"
     "  -C, --container=CONTAINER  Name of the container to filter on\n"
     "  -c, --component=COMPONENT  Name of the component to filter on\n"
+    "                             When container/component pairs are given as\n"
+    "                             arguments, the snapshots of each of these\n"
+    "                             components are cleaned in one operation\n"
 
     "\nEnvironment:\n"
     "  DISNIX_PROFILE    Sets the name of the profile that stores the manifest on the\n"
@@ -158,12 +187,17 @@ int main(int argc, char *argv[])
         {"print-missing-snapshots", no_argument, 0, 'M'},
         {"import-snapshots", no_argument, 0, 'Y'},
         {"resolve-snapshots", no_argument, 0, 'Z'},
+        {"query-snapshot-sizes", no_argument, 0, '8'},
+        {"query-snapshot-digests", no_argument, 0, '9'},
         {"clean-snapshots", no_argument, 0, 'e'},
         {"capture-config", no_argument, 0, '1'},
         {"shell", no_argument, 0, '2'},
+        {"fetch-snapshots", no_argument, 0, '4'},
         {"target", required_argument, 0, 't'},
         {"localfile", no_argument, 0, 'l'},
         {"remotefile", no_argument, 0, 'R'},
+        {"basis", required_argument, 0, 'b'},
+        {"digests", required_argument, 0, '5'},
         {"profile", required_argument, 0, 'p'},
         {"delete-old", no_argument, 0, 'd'},
         {"type", required_argument, 0, 'T'},
@@ -172,6 +206,9 @@ int main(int argc, char *argv[])
         {"component", required_argument, 0, 'c'},
         {"keep", required_argument, 0, 'z'},
         {"command", required_argument, 0, '3'},
+        {"source-interface", required_argument, 0, '0'},
+        {"source-target", required_argument, 0, '6'},
+        {"all", no_argument, 0, '7'},
         {"help", no_argument, 0, 'h'},
         {"version", no_argument, 0, 'v'},
         {0, 0, 0, 0}
@@ -179,7 +216,7 @@ int main(int argc, char *argv[])
 
     /* Option value declarations */
     Operation operation = OP_NONE;
-    char *profile = NULL, *type = NULL, *container = NULL, *component = NULL, *command = NULL;
+    char *profile = NULL, *type = NULL, *container = NULL, *component = NULL, *command = NULL, *source_interface = "disnix-ssh-client", *source_target = NULL, *digests = NULL;
     gchar **derivation = NULL, **arguments = NULL;
     unsigned int derivation_size = 0, arguments_size = 0, flags = 0;
     int keep = 1;
@@ -249,6 +286,12 @@ int main(int argc, char *argv[])
             case 'Z':
                 operation = OP_RESOLVE_SNAPSHOTS;
                 break;
+            case '8':
+                operation = OP_QUERY_SNAPSHOT_SIZES;
+                break;
+            case '9':
+                operation = OP_QUERY_SNAPSHOT_DIGESTS;
+                break;
             case 'e':
                 operation = OP_CLEAN_SNAPSHOTS;
                 break;
@@ -258,12 +301,20 @@ int main(int argc, char *argv[])
             case '2':
                 operation = OP_SHELL;
                 break;
+            case '4':
+                operation = OP_FETCH_SNAPSHOTS;
+                break;
             case 't':
                 break;
             case 'l':
                 break;
             case 'R':
                 break;
+            case 'b':
+                break;
+            case '5':
+                digests = optarg;
+                break;
             case 'p':
                 profile = optarg;
                 break;
@@ -290,6 +341,15 @@ int main(int argc, char *argv[])
             case '3':
                 command = optarg;
                 break;
+            case '0':
+                source_interface = optarg;
+                break;
+            case '6':
+                source_target = optarg;
+                break;
+            case '7':
+                flags |= FLAG_ALL;
+                break;
             case 'h':
                 print_usage(argv[0]);
                 return 0;
@@ -322,5 +382,5 @@ int main(int argc, char *argv[])
     arguments[arguments_size] = NULL;
 
     /* Execute Disnix activity */
-    return run_disnix_activity(operation, derivation, flags, profile, arguments, type, container, component, keep, command);
+    return run_disnix_activity(operation, derivation, flags, profile, arguments, type, container, component, keep, command, source_interface, source_target, digests);
 }
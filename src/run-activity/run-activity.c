@@ -27,6 +27,7 @@
 #include <package-management.h>
 #include <state-management.h>
 #include <snapshot-management.h>
+#include <copy-snapshots.h>
 #include <profilemanifest.h>
 #include <profilelocking.h>
 
@@ -100,7 +101,7 @@ static int return_tempfile(pid_t pid, gchar *tempfilename, int temp_fd)
     return exit_status;
 }
 
-int run_disnix_activity(Operation operation, gchar **paths, const unsigned int flags, char *profile, gchar **arguments, char *type, char *container, char *component, int keep, char *command)
+int run_disnix_activity(Operation operation, gchar **paths, const unsigned int flags, char *profile, gchar **arguments, char *type, char *container, char *component, int keep, char *command, char *source_interface, char *source_target, char *digests)
 {
     int exit_status = 0;
     ProcReact_Status status;
@@ -261,7 +262,11 @@ int run_disnix_activity(Operation operation, gchar **paths, const unsigned int f
                 exit_status = 1;
             }
             else
-                exit_status = procreact_wait_for_exit_status(statemgmt_import_snapshots((gchar*)container, (gchar*)component, paths, g_strv_length(paths), 1, 2), &status);
+            {
+                gchar **digests_array = (digests == NULL) ? NULL : g_strsplit(digests, ",", -1);
+                exit_status = procreact_wait_for_exit_status(statemgmt_import_snapshots((gchar*)container, (gchar*)component, paths, g_strv_length(paths), digests_array, 1, 2), &status);
+                g_strfreev(digests_array);
+            }
 
             break;
         case OP_RESOLVE_SNAPSHOTS:
@@ -273,6 +278,26 @@ int run_disnix_activity(Operation operation, gchar **paths, const unsigned int f
             else
                 exit_status = print_strv(statemgmt_resolve_snapshots(paths, g_strv_length(paths), 2));
 
+            break;
+        case OP_QUERY_SNAPSHOT_SIZES:
+            if(paths[0] == NULL)
+            {
+                g_printerr("ERROR: A Dysnomia snapshot has to be specified!\n");
+                exit_status = 1;
+            }
+            else
+                exit_status = print_strv(statemgmt_query_snapshot_sizes(paths, g_strv_length(paths), 2));
+
+            break;
+        case OP_QUERY_SNAPSHOT_DIGESTS:
+            if(paths[0] == NULL)
+            {
+                g_printerr("ERROR: A Dysnomia snapshot has to be specified!\n");
+                exit_status = 1;
+            }
+            else
+                exit_status = print_strv(statemgmt_query_snapshot_digests(paths, g_strv_length(paths), 2));
+
             break;
         case OP_CLEAN_SNAPSHOTS:
             if(container == NULL)
@@ -281,7 +306,10 @@ int run_disnix_activity(Operation operation, gchar **paths, const unsigned int f
             if(component == NULL)
                 component = "";
 
-            exit_status = procreact_wait_for_exit_status(statemgmt_clean_snapshots(keep, container, component, 1, 2), &status);
+            if(paths[0] == NULL)
+                exit_status = procreact_wait_for_exit_status(statemgmt_clean_snapshots(keep, container, component, 1, 2), &status);
+            else
+                exit_status = procreact_wait_for_exit_status(statemgmt_clean_snapshots_of_components(keep, paths, g_strv_length(paths), 1, 2), &status); /* Clean the given container/component pairs in one go */
             break;
         case OP_CAPTURE_CONFIG:
             tempfilename = statemgmt_capture_config(tmpdir, 2, &pid, &temp_fd);
@@ -295,6 +323,30 @@ int run_disnix_activity(Operation operation, gchar **paths, const unsigned int f
             else
                 exit_status = procreact_wait_for_exit_status(statemgmt_shell((gchar*)type, paths[0], (gchar*)container, arguments, command), &status);
             break;
+        case OP_FETCH_SNAPSHOTS:
+            if(source_target == NULL)
+            {
+                g_printerr("ERROR: A source target must be specified!\n");
+                exit_status = 1;
+            }
+            else if(container == NULL || component == NULL)
+            {
+                g_printerr("ERROR: A container and component must be specified!\n");
+                exit_status = 1;
+            }
+            else if(!check_fetch_snapshots_source_target(source_target))
+            {
+                g_printerr("ERROR: Invalid source target: %s\n", source_target);
+                exit_status = 1;
+            }
+            else if(!check_fetch_snapshots_interface(source_interface))
+            {
+                g_printerr("ERROR: Client interface: %s is not permitted for fetching snapshots!\n", source_interface);
+                exit_status = 1;
+            }
+            else
+                exit_status = !copy_snapshots_from_sync((gchar*)source_interface, (gchar*)source_target, (gchar*)container, (gchar*)component, flags & FLAG_ALL, NULL, 2, 2);
+            break;
         case OP_NONE:
             g_printerr("ERROR: No operation specified!\n");
             exit_status = 1;
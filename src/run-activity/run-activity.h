@@ -21,6 +21,7 @@
 #define __DISNIX_RUN_ACTIVITY_H
 
 #define FLAG_DELETE_OLD 0x1
+#define FLAG_ALL 0x2
 
 #include <glib.h>
 
@@ -49,10 +50,13 @@ typedef enum
     OP_PRINT_MISSING_SNAPSHOTS,
     OP_IMPORT_SNAPSHOTS,
     OP_RESOLVE_SNAPSHOTS,
+    OP_QUERY_SNAPSHOT_SIZES,
+    OP_QUERY_SNAPSHOT_DIGESTS,
     OP_CLEAN_SNAPSHOTS,
     OP_DELETE_STATE,
     OP_CAPTURE_CONFIG,
-    OP_SHELL
+    OP_SHELL,
+    OP_FETCH_SNAPSHOTS
 }
 Operation;
 
@@ -69,8 +73,11 @@ Operation;
  * @param component Name of a mutable component in a container
  * @param keep Amount of snapshot generations to keep
  * @param command Shell command to execute
+ * @param source_interface Name of the interface executable that connects to the machine providing the snapshots
+ * @param source_target Target address of the machine providing the snapshots
+ * @param digests Comma separated digests that the snapshots to import must match, or NULL to import them unverified
  * @return 0 if the operation succeeds, else a non-zero exit value
  */
-int run_disnix_activity(Operation operation, gchar **paths, const unsigned int flags, char *profile, gchar **arguments, char *type, char *container, char *component, int keep, char *command);
+int run_disnix_activity(Operation operation, gchar **paths, const unsigned int flags, char *profile, gchar **arguments, char *type, char *container, char *component, int keep, char *command, char *source_interface, char *source_target, char *digests);
 
 #endif
@@ -20,6 +20,7 @@
 #include "run-snapshot.h"
 #include <manifest.h>
 #include <snapshotmappingarray.h>
+#include <snapshot-budget.h>
 
 int run_snapshot(const gchar *manifest_file, const unsigned int max_concurrent_transfers, const unsigned int flags, const int keep, const gchar *old_manifest, const gchar *coordinator_profile_path, gchar *profile, const gchar *container_filter, const gchar *component_filter)
 {
@@ -38,7 +39,7 @@ int run_snapshot(const gchar *manifest_file, const unsigned int max_concurrent_t
         if(check_manifest(manifest))
         {
             if(manifest_file == NULL) /* When no manifest file is provided as a parameter -> always snapshot the entire environment */
-                exit_status = !snapshot(manifest, NULL, max_concurrent_transfers, flags | FLAG_NO_UPGRADE, keep);
+                exit_status = !snapshot(manifest, NULL, max_concurrent_transfers, flags | FLAG_NO_UPGRADE, keep, determine_max_snapshot_bytes());
             else
             {
                 Manifest *previous_manifest;
@@ -49,7 +50,7 @@ int run_snapshot(const gchar *manifest_file, const unsigned int max_concurrent_t
                     previous_manifest = open_provided_or_previous_manifest_file(old_manifest, coordinator_profile_path, profile, MANIFEST_SNAPSHOT_MAPPINGS_FLAG, container_filter, component_filter);
 
                 if(previous_manifest == NULL || check_manifest(previous_manifest))
-                    exit_status = !snapshot(manifest, previous_manifest, max_concurrent_transfers, flags, keep); /* Take snapshots and transfer them */
+                    exit_status = !snapshot(manifest, previous_manifest, max_concurrent_transfers, flags, keep, determine_max_snapshot_bytes()); /* Take snapshots and transfer them */
                 else
                     exit_status = 1;
 
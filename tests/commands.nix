@@ -54,6 +54,36 @@ simpleTest {
 
       testtarget1.succeed('[ "$(cat /var/log/disnix/2 | grep "\\-testService1.drv")" != "" ]')
 
+      # Delegate the builds of the reversed distribution in pipelined mode
+      # with at most one build at the same time. testtarget2 should now build
+      # testService1, and because the coordinator already has the results of
+      # both services, they should not be retrieved again.
+
+      distderivation = coordinator.succeed(
+          "${env} disnix-instantiate -s ${snapshotTests}/services-state.nix -i ${snapshotTests}/infrastructure.nix -d ${snapshotTests}/distribution-reverse.nix"
+      )
+      result = coordinator.succeed(
+          "${env} disnix-build --pipeline --max-concurrent-builds 1 {}".format(
+              distderivation
+          )
+      )
+
+      testtarget2.succeed('[ "$(cat /var/log/disnix/* | grep "\\-testService1.drv")" != "" ]')
+
+      if any(
+          line.startswith("[target: testtarget2]: Realising derivation:")
+          and line.endswith("-testService1.drv")
+          for line in result.split("\n")
+      ):
+          print("testService1 has been realised on testtarget2")
+      else:
+          raise Exception("testService1 should have been realised on testtarget2!")
+
+      if result.count("are already present on the coordinator") == 2:
+          print("The build results were already present on the coordinator")
+      else:
+          raise Exception("The build results of both services should already be present on the coordinator!")
+
       # Create a manifest
       manifest = coordinator.succeed(
           "${env} disnix-manifest -s ${snapshotTests}/services-state.nix -i ${snapshotTests}/infrastructure.nix -d ${snapshotTests}/distribution-simple.nix"
@@ -358,5 +358,214 @@ simpleTest {
       coordinator.succeed(
           "${env} disnix-env -s ${snapshotTests}/services-state.nix -i ${snapshotTests}/infrastructure-single.nix -d ${snapshotTests}/distribution-single.nix"
       )
+
+      #### Test direct migrations
+
+      # Allow the target machines to connect to each other, so that they can
+      # fetch snapshots from each other
+
+      for target in [testtarget1, testtarget2]:
+          target.copy_from_host("key", "/root/.ssh/id_dsa")
+          target.succeed("chmod 600 /root/.ssh/id_dsa")
+          target.succeed("echo 'StrictHostKeyChecking no' > /root/.ssh/config")
+          target.succeed("echo 'UserKnownHostsFile /dev/null' >> /root/.ssh/config")
+
+      # Deploy each service to its own machine again and give them a
+      # distinct state
+
+      coordinator.succeed(
+          "${env} disnix-env -s ${snapshotTests}/services-state.nix -i ${snapshotTests}/infrastructure.nix -d ${snapshotTests}/distribution-simple.nix"
+      )
+
+      testtarget1.succeed("echo 7 > /var/db/testService1/state")
+      testtarget2.succeed("echo 8 > /var/db/testService2/state")
+
+      # Reverse the location of the services and let the new machines fetch
+      # the snapshots directly from the previous machines. The state should
+      # be moved, without staging any snapshots on the coordinator.
+
+      coordinator.succeed("rm -Rf /root/dysnomia")
+
+      manifest = coordinator.succeed(
+          "${env} disnix-manifest -s ${snapshotTests}/services-state.nix -i ${snapshotTests}/infrastructure.nix -d ${snapshotTests}/distribution-reverse.nix"
+      )
+      coordinator.succeed("${env} disnix-distribute {}".format(manifest))
+      coordinator.succeed("${env} disnix-activate {}".format(manifest))
+      coordinator.succeed("${env} disnix-migrate --direct {}".format(manifest))
+      coordinator.succeed("${env} disnix-set {}".format(manifest))
+
+      result = testtarget1.succeed("cat /var/db/testService2/state")
+
+      if result[:-1] == "8":
+          print("result is: 8")
+      else:
+          raise Exception("result should be: 8, but it is: {}".format(result[:-1]))
+
+      result = testtarget2.succeed("cat /var/db/testService1/state")
+
+      if result[:-1] == "7":
+          print("result is: 7")
+      else:
+          raise Exception("result should be: 7, but it is: {}".format(result[:-1]))
+
+      result = coordinator.succeed(
+          "${env} dysnomia-snapshots --query-all --container wrapper 2> /dev/null | wc -l"
+      )
+
+      if int(result) == 0:
+          print("The coordinator has not staged any snapshots!")
+      else:
+          raise Exception(
+              "The coordinator should not stage any snapshots, but it has: {}".format(result)
+          )
+
+      # Move the services back directly and depth-first without keeping any
+      # snapshot generations. The state should be moved and the snapshots
+      # should be removed from the previous and new machines.
+
+      testtarget1.succeed("echo 9 > /var/db/testService2/state")
+      testtarget2.succeed("echo 10 > /var/db/testService1/state")
+
+      manifest = coordinator.succeed(
+          "${env} disnix-manifest -s ${snapshotTests}/services-state.nix -i ${snapshotTests}/infrastructure.nix -d ${snapshotTests}/distribution-simple.nix"
+      )
+      coordinator.succeed("${env} disnix-distribute {}".format(manifest))
+      coordinator.succeed("${env} disnix-activate {}".format(manifest))
+      coordinator.succeed(
+          "${env} disnix-migrate --direct --depth-first --keep 0 {}".format(manifest)
+      )
+      coordinator.succeed("${env} disnix-set {}".format(manifest))
+
+      result = testtarget1.succeed("cat /var/db/testService1/state")
+
+      if result[:-1] == "10":
+          print("result is: 10")
+      else:
+          raise Exception("result should be: 10, but it is: {}".format(result[:-1]))
+
+      result = testtarget2.succeed("cat /var/db/testService2/state")
+
+      if result[:-1] == "9":
+          print("result is: 9")
+      else:
+          raise Exception("result should be: 9, but it is: {}".format(result[:-1]))
+
+      for target in [testtarget1, testtarget2]:
+          result = target.succeed(
+              "dysnomia-snapshots --query-all --container wrapper | wc -l"
+          )
+
+          if int(result) == 0:
+              print("We have no remaining snapshots left!")
+          else:
+              raise Exception("Expecting no remaining snapshots, but we have: {}".format(result))
+
+      #### Test pipelined migrations
+
+      # Reverse the location of the services again, but now migrate each
+      # service on its own, staging the snapshots of at most one service on
+      # the coordinator at the same time. The state should be moved and the
+      # coordinator should not keep any of the delivered snapshots.
+
+      coordinator.succeed("rm -Rf /root/dysnomia")
+
+      manifest = coordinator.succeed(
+          "${env} disnix-manifest -s ${snapshotTests}/services-state.nix -i ${snapshotTests}/infrastructure.nix -d ${snapshotTests}/distribution-reverse.nix"
+      )
+      coordinator.succeed("${env} disnix-distribute {}".format(manifest))
+      coordinator.succeed("${env} disnix-activate {}".format(manifest))
+      coordinator.succeed(
+          "${env} DISNIX_MAX_STAGED_SNAPSHOTS=1 disnix-migrate --pipeline --keep 0 {}".format(
+              manifest
+          )
+      )
+      coordinator.succeed("${env} disnix-set {}".format(manifest))
+
+      result = testtarget1.succeed("cat /var/db/testService2/state")
+
+      if result[:-1] == "9":
+          print("result is: 9")
+      else:
+          raise Exception("result should be: 9, but it is: {}".format(result[:-1]))
+
+      result = testtarget2.succeed("cat /var/db/testService1/state")
+
+      if result[:-1] == "10":
+          print("result is: 10")
+      else:
+          raise Exception("result should be: 10, but it is: {}".format(result[:-1]))
+
+      result = coordinator.succeed(
+          "${env} dysnomia-snapshots --query-all --container wrapper | wc -l"
+      )
+
+      if int(result) == 0:
+          print("The coordinator has no remaining snapshots!")
+      else:
+          raise Exception(
+              "The coordinator should not keep any snapshots, but it has: {}".format(result)
+          )
+
+      #### Test migrations within a snapshot budget
+
+      # Move the services back with a budget of one byte on the coordinator and
+      # the default amount of generations to keep. Because the snapshots of
+      # each service exceed it, every service should be migrated in a batch of
+      # its own. The state should be moved and the coordinator should neither
+      # keep any snapshots of the restored batches nor their staging stores.
+
+      testtarget1.succeed("echo 11 > /var/db/testService2/state")
+      testtarget2.succeed("echo 12 > /var/db/testService1/state")
+
+      manifest = coordinator.succeed(
+          "${env} disnix-manifest -s ${snapshotTests}/services-state.nix -i ${snapshotTests}/infrastructure.nix -d ${snapshotTests}/distribution-simple.nix"
+      )
+      coordinator.succeed("${env} disnix-distribute {}".format(manifest))
+      coordinator.succeed("${env} disnix-activate {}".format(manifest))
+      result = coordinator.succeed(
+          "${env} DISNIX_MAX_SNAPSHOT_BYTES=1 disnix-migrate {}".format(manifest)
+      )
+      coordinator.succeed("${env} disnix-set {}".format(manifest))
+
+      if "batch: 1 of 2" in result and "batch: 2 of 2" in result:
+          print("The services have been migrated in two batches")
+      else:
+          raise Exception("The services should have been migrated in two batches!")
+
+      result = testtarget1.succeed("cat /var/db/testService1/state")
+
+      if result[:-1] == "12":
+          print("result is: 12")
+      else:
+          raise Exception("result should be: 12, but it is: {}".format(result[:-1]))
+
+      result = testtarget2.succeed("cat /var/db/testService2/state")
+
+      if result[:-1] == "11":
+          print("result is: 11")
+      else:
+          raise Exception("result should be: 11, but it is: {}".format(result[:-1]))
+
+      result = coordinator.succeed(
+          "${env} dysnomia-snapshots --query-all --container wrapper | wc -l"
+      )
+
+      if int(result) == 0:
+          print("The coordinator has no remaining snapshots!")
+      else:
+          raise Exception(
+              "The coordinator should not keep any snapshots, but it has: {}".format(result)
+          )
+
+      result = coordinator.succeed(
+          "find /root/dysnomia -maxdepth 1 -name 'disnix-staging-*' | wc -l"
+      )
+
+      if int(result) == 0:
+          print("The staging snapshot stores have been removed!")
+      else:
+          raise Exception(
+              "The staging snapshot stores should have been removed, but there are: {}".format(result)
+          )
     '';
 }
@@ -6,6 +6,20 @@ let
 in
 with import "${nixpkgs}/nixos/lib/testing-python.nix" { system = builtins.currentSystem; };
 
+let
+  # Dysnomia module of which the snapshot operation takes a while, so that we
+  # can observe state operations waiting for admission
+  sleeperModule = pkgs.writeScriptBin "sleeper" ''
+    #! ${pkgs.stdenv.shell} -e
+
+    case "$1" in
+        snapshot)
+            sleep 10
+            ;;
+    esac
+  '';
+in
+
 simpleTest {
   nodes = {
     client = machine;
@@ -189,5 +203,68 @@ simpleTest {
       # contain one property: "foo" = "bar";
       result = client.succeed("disnix-client --capture-config")
       client.succeed('(cat {}) | grep \'"foo" = "bar"\${"'"}'.format(result))
+
+      # Admission test. We restart the service with a limit of one concurrent
+      # state operation and run two slow snapshot operations. The second one
+      # should wait in the queue until the first one has finished.
+
+      client.stop_job("disnix")
+      client.succeed(
+          "DYSNOMIA_MODULES_PATH=${sleeperModule}/bin disnix-service --max-concurrent-state-operations=1 > /root/disnix-service.log 2>&1 &"
+      )
+      client.wait_until_succeeds("disnix-client --query-admission-status")
+
+      result = client.succeed("disnix-client --query-admission-status")
+
+      if "state running=0 limit=1 queued=0" in result:
+          print("No state operations are running!")
+      else:
+          raise Exception("No state operations should be running! The status is: {}".format(result))
+
+      client.succeed(
+          "(disnix-client --snapshot --type sleeper ${pkgs.bash} > /dev/null 2>&1 &)"
+      )
+      client.succeed(
+          "(disnix-client --snapshot --type sleeper ${pkgs.bash} > /dev/null 2>&1 &)"
+      )
+      client.wait_until_succeeds(
+          "disnix-client --query-admission-status | grep 'state running=1 limit=1 queued=1'"
+      )
+      client.wait_until_succeeds(
+          "disnix-client --query-admission-status | grep 'state running=0 limit=1 queued=0'"
+      )
+
+      result = client.succeed(
+          "disnix-client --query-admission-status | grep '^state' | sed -e 's/.*average-wait=//'"
+      )
+
+      if float(result) > 0:
+          print("The second snapshot operation had to wait!")
+      else:
+          raise Exception("The second snapshot operation should have waited!")
+
+      # A snapshot digest query is a state operation, so it should queue
+      # behind a running snapshot operation.
+
+      client.succeed(
+          "(disnix-client --snapshot --type sleeper ${pkgs.bash} > /dev/null 2>&1 &)"
+      )
+      client.wait_until_succeeds(
+          "disnix-client --query-admission-status | grep 'state running=1 limit=1 queued=0'"
+      )
+      client.succeed(
+          "(disnix-client --query-snapshot-digests wrapper/wrapper/none > /dev/null 2>&1 &)"
+      )
+      client.wait_until_succeeds(
+          "disnix-client --query-admission-status | grep 'state running=1 limit=1 queued=1'"
+      )
+      client.wait_until_succeeds(
+          "disnix-client --query-admission-status | grep 'state running=0 limit=1 queued=0'"
+      )
+
+      # Restore the service that the system runs by default
+      client.succeed("pkill -x disnix-service")
+      client.start_job("disnix")
+      client.wait_for_unit("disnix")
     '';
 }
@@ -4,6 +4,7 @@ let
   manifestTests = ./manifest;
   machine = import ./machine.nix { inherit dysnomia disnix; };
   wrapper = import ./snapshots/wrapper.nix { inherit stdenv dysnomia; } {};
+  wrapper2 = import ./snapshots/wrapper.nix { inherit stdenv dysnomia; } { name = "wrapper2"; };
 in
 with import "${nixpkgs}/nixos/lib/testing-python.nix" { system = builtins.currentSystem; };
 
@@ -344,5 +345,403 @@ simpleTest {
           print("Result is 2")
       else:
           raise Exception("Result should be 2, instead it is: {}!".format(result))
+
+      #### Test fetching snapshots directly from another machine
+
+      # Allow the server to connect to the client, so that it can fetch the
+      # snapshots from the client itself
+
+      client.copy_from_host("key.pub", "/root/.ssh/authorized_keys")
+      server.copy_from_host("key", "/root/.ssh/id_dsa")
+      server.succeed("chmod 600 /root/.ssh/id_dsa")
+      server.succeed("echo 'StrictHostKeyChecking no' > /root/.ssh/config")
+      server.succeed("echo 'UserKnownHostsFile /dev/null' >> /root/.ssh/config")
+
+      # Delete all snapshots from the server and let it fetch the latest
+      # snapshot from the client. It should only have one snapshot that
+      # contains the string: 2
+
+      client.succeed(
+          "${env} disnix-ssh-client --target server --clean-snapshots --container wrapper --component ${wrapper} --keep 0"
+      )
+      client.succeed(
+          "${env} disnix-ssh-client --target server --fetch-snapshots --source-target client --container wrapper --component ${wrapper}"
+      )
+      result = server.succeed(
+          "dysnomia-snapshots --query-all --container wrapper --component ${wrapper} | wc -l"
+      )
+
+      if int(result) == 1:
+          print("We have only one snapshot!")
+      else:
+          raise Exception("Expecting only one snapshot, but we have: {}!".format(result))
+
+      lastSnapshot = server.succeed(
+          "dysnomia-snapshots --query-latest --container wrapper --component ${wrapper}"
+      )
+      lastResolvedSnapshot = server.succeed(
+          "dysnomia-snapshots --resolve {}".format(lastSnapshot[:-1])
+      )
+      result = server.succeed("cat {}/state".format(lastResolvedSnapshot[:-1]))
+
+      if result == "2\n":
+          print("Result is 2")
+      else:
+          raise Exception("Result should be 2, instead it is: {}!".format(result))
+
+      # Fetching with a client interface that the server does not permit
+      # should fail, regardless of whether it is a name or a path.
+
+      client.fail(
+          "${env} disnix-ssh-client --target server --fetch-snapshots --source-interface touch --source-target client --container wrapper --component ${wrapper} --all"
+      )
+      client.fail(
+          "${env} disnix-ssh-client --target server --fetch-snapshots --source-interface /run/current-system/sw/bin/disnix-ssh-client --source-target client --container wrapper --component ${wrapper} --all"
+      )
+
+      # Fetching from a source target that ssh would take for an option should
+      # be refused, both by the SSH client and by the Disnix service itself.
+
+      client.fail(
+          "${env} disnix-ssh-client --target server --fetch-snapshots --source-target=-oProxyCommand=touch\\ /tmp/pwned --container wrapper --component ${wrapper} --all"
+      )
+      server.fail(
+          "disnix-client --fetch-snapshots '--source-target=-oProxyCommand=touch /tmp/pwned' --container wrapper --component ${wrapper} --all"
+      )
+      server.succeed("[ ! -e /tmp/pwned ]")
+
+      # Fetch all snapshots from the client and check whether the server has
+      # all 4 of them.
+
+      client.succeed(
+          "${env} disnix-ssh-client --target server --fetch-snapshots --source-interface disnix-ssh-client --source-target client --container wrapper --component ${wrapper} --all"
+      )
+      result = server.succeed(
+          "dysnomia-snapshots --query-all --container wrapper --component ${wrapper} | wc -l"
+      )
+
+      if int(result) == 4:
+          print("We have 4 snapshots!")
+      else:
+          raise Exception("Expecting 4 snapshots, but we have: {}!".format(result))
+
+      #### Test delta transfers of snapshots
+
+      # Make another change on the server, take a snapshot and retrieve it by
+      # only transferring the blocks that differ from the latest snapshot of
+      # the client. The client should have 5 snapshots, of which the latest
+      # contains the string: 5
+
+      server.succeed("echo 5 > /var/db/wrapper/state")
+      client.succeed(
+          "${env} disnix-ssh-client --target server --snapshot --type wrapper ${wrapper}"
+      )
+      client.succeed(
+          "${env} DISNIX_DELTA_SNAPSHOTS=1 disnix-copy-snapshots --from --target server --container wrapper --component ${wrapper}"
+      )
+      result = client.succeed(
+          "dysnomia-snapshots --query-all --container wrapper --component ${wrapper} | wc -l"
+      )
+
+      if int(result) == 5:
+          print("We have 5 snapshots!")
+      else:
+          raise Exception("Expecting 5 snapshots, but we have: {}!".format(result))
+
+      lastSnapshot = client.succeed(
+          "dysnomia-snapshots --query-latest --container wrapper --component ${wrapper}"
+      )[:-1]
+      lastResolvedSnapshot = client.succeed(
+          "dysnomia-snapshots --resolve {}".format(lastSnapshot)
+      )
+      result = client.succeed("cat {}/state".format(lastResolvedSnapshot[:-1]))
+
+      if result == "5\n":
+          print("Result is 5")
+      else:
+          raise Exception("Result should be 5, instead it is: {}!".format(result))
+
+      # Only keep the latest snapshot on the server and send all older
+      # generations with delta transfers. We add a symlink to one of them, to
+      # check whether the transfer preserves it.
+
+      client.succeed(
+          "${env} disnix-ssh-client --target server --clean-snapshots --container wrapper --component ${wrapper}"
+      )
+
+      snapshots = client.succeed(
+          "dysnomia-snapshots --query-all --container wrapper --component ${wrapper}"
+      ).split("\n")
+      olderSnapshot = [s for s in snapshots[:-1] if s != lastSnapshot][0]
+      olderResolvedSnapshot = client.succeed(
+          "dysnomia-snapshots --resolve {}".format(olderSnapshot)
+      )[:-1]
+      client.succeed("ln -s state {}/link".format(olderResolvedSnapshot))
+
+      client.succeed(
+          "${env} DISNIX_DELTA_SNAPSHOTS=1 disnix-copy-snapshots --to --target server --container wrapper --component ${wrapper} --all"
+      )
+      result = server.succeed(
+          "dysnomia-snapshots --query-all --container wrapper --component ${wrapper} | wc -l"
+      )
+
+      if int(result) == 5:
+          print("We have 5 snapshots!")
+      else:
+          raise Exception("Expecting 5 snapshots, but we have: {}!".format(result))
+
+      olderResolvedSnapshot = server.succeed(
+          "dysnomia-snapshots --resolve {}".format(olderSnapshot)
+      )[:-1]
+      result = server.succeed("readlink {}/link".format(olderResolvedSnapshot))
+
+      if result == "state\n":
+          print("The symlink has been preserved")
+      else:
+          raise Exception("The symlink should refer to state, instead it refers to: {}!".format(result))
+
+      #### Test querying the sizes of snapshots
+
+      # The latest snapshot only contains the state file with the string: 5.
+      # The size of the older snapshot should include the size of the symlink
+      # itself, not of the file that it refers to.
+
+      result = client.succeed(
+          "${env} disnix-ssh-client --target server --query-snapshot-sizes {} {}".format(
+              lastSnapshot, olderSnapshot
+          )
+      ).split("\n")
+      stateSize = server.succeed("wc -c < {}/state".format(olderResolvedSnapshot))
+
+      if int(result[0]) == 2:
+          print("The size of the latest snapshot is 2")
+      else:
+          raise Exception("The size of the latest snapshot should be 2, instead it is: {}!".format(result[0]))
+
+      if int(result[1]) == int(stateSize) + len("state"):
+          print("The size of the older snapshot includes the symlink")
+      else:
+          raise Exception(
+              "The size of the older snapshot should be: {}, instead it is: {}!".format(
+                  int(stateSize) + len("state"), result[1]
+              )
+          )
+
+      #### Test cleaning the snapshots of multiple components in one operation
+
+      # Deploy a second component with two snapshots on the server. Cleaning
+      # both components at once should only keep the latest snapshot of each.
+
+      client.succeed(
+          "${env} disnix-ssh-client --target server --activate --type wrapper ${wrapper2}"
+      )
+      client.succeed(
+          "${env} disnix-ssh-client --target server --snapshot --type wrapper ${wrapper2}"
+      )
+      server.succeed("echo 1 > /var/db/wrapper2/state")
+      client.succeed(
+          "${env} disnix-ssh-client --target server --snapshot --type wrapper ${wrapper2}"
+      )
+
+      # A pair without a component is rejected, and nothing gets cleaned
+      client.fail(
+          "${env} disnix-ssh-client --target server --clean-snapshots --keep 1 wrapper/"
+      )
+      result = server.succeed(
+          "dysnomia-snapshots --query-all --container wrapper --component wrapper2 | wc -l"
+      )
+
+      if int(result) == 2:
+          print("We have 2 snapshots!")
+      else:
+          raise Exception("Expecting 2 snapshots, but we have: {}!".format(result))
+
+      client.succeed(
+          "${env} disnix-ssh-client --target server --clean-snapshots --keep 1 wrapper/wrapper wrapper/wrapper2"
+      )
+
+      for component in ["wrapper", "wrapper2"]:
+          result = server.succeed(
+              "dysnomia-snapshots --query-all --container wrapper --component {} | wc -l".format(
+                  component
+              )
+          )
+
+          if int(result) == 1:
+              print("We have 1 snapshot of {}!".format(component))
+          else:
+              raise Exception(
+                  "Expecting 1 snapshot of {}, but we have: {}!".format(component, result)
+              )
+
+      result = server.succeed(
+          "cat $(dysnomia-snapshots --resolve $(dysnomia-snapshots --query-latest --container wrapper --component wrapper2))/state"
+      )
+
+      if int(result) == 1:
+          print("Result is 1")
+      else:
+          raise Exception("Result should be 1, instead it is: {}!".format(result))
+
+      result = server.succeed(
+          "cat $(dysnomia-snapshots --resolve $(dysnomia-snapshots --query-latest --container wrapper --component wrapper))/state"
+      )
+
+      if int(result) == 5:
+          print("Result is 5")
+      else:
+          raise Exception("Result should be 5, instead it is: {}!".format(result))
+
+      #### Test querying the digests of snapshots and verifying transfers
+
+      # The latest snapshot has the same content on both machines, so its
+      # digest should be the same. A snapshot with a different content should
+      # have a different digest.
+
+      serverDigest = client.succeed(
+          "${env} disnix-ssh-client --target server --query-snapshot-digests {}".format(
+              lastSnapshot
+          )
+      )[:-1]
+      clientDigest = client.succeed(
+          "disnix-run-activity --query-snapshot-digests {}".format(lastSnapshot)
+      )[:-1]
+
+      if serverDigest != "" and serverDigest == clientDigest:
+          print("The digests of the latest snapshot are equal")
+      else:
+          raise Exception(
+              "The digests of the latest snapshot should be equal, but they are: {} and {}!".format(
+                  serverDigest, clientDigest
+              )
+          )
+
+      # Pick an older snapshot without the symlink, as scp follows symlinks
+      verifiedSnapshot = [
+          s for s in snapshots[:-1] if s != lastSnapshot and s != olderSnapshot
+      ][0]
+      verifiedDigest = client.succeed(
+          "disnix-run-activity --query-snapshot-digests {}".format(verifiedSnapshot)
+      )[:-1]
+
+      if verifiedDigest != clientDigest:
+          print("The digests of different snapshots differ")
+      else:
+          raise Exception("The digests of different snapshots should differ!")
+
+      # Importing a snapshot with a digest that does not match should be
+      # refused before anything gets imported.
+
+      client.succeed(
+          "${env} disnix-ssh-client --target server --clean-snapshots --container wrapper --component ${wrapper}"
+      )
+      verifiedResolvedSnapshot = client.succeed(
+          "dysnomia-snapshots --resolve {}".format(verifiedSnapshot)
+      )[:-1]
+
+      client.fail(
+          "${env} disnix-ssh-client --target server --import-snapshots --localfile --container wrapper --component wrapper --digests 0000 {}".format(
+              verifiedResolvedSnapshot
+          )
+      )
+      result = server.succeed(
+          "dysnomia-snapshots --query-all --container wrapper --component ${wrapper} | wc -l"
+      )
+
+      if int(result) == 1:
+          print("We have 1 snapshot!")
+      else:
+          raise Exception("Expecting 1 snapshot, but we have: {}!".format(result))
+
+      client.succeed(
+          "${env} disnix-ssh-client --target server --import-snapshots --localfile --container wrapper --component wrapper --digests {} {}".format(
+              verifiedDigest, verifiedResolvedSnapshot
+          )
+      )
+      result = server.succeed(
+          "dysnomia-snapshots --query-all --container wrapper --component ${wrapper} | wc -l"
+      )
+
+      if int(result) == 2:
+          print("We have 2 snapshots!")
+      else:
+          raise Exception("Expecting 2 snapshots, but we have: {}!".format(result))
+
+      # Send all remaining snapshots with verification enabled. Delta transfers
+      # preserve the symlink, so its snapshot should pass verification too. The
+      # server should have all snapshots of the client afterwards.
+
+      client.succeed(
+          "${env} DISNIX_DELTA_SNAPSHOTS=1 DISNIX_VERIFY_SNAPSHOTS=1 disnix-copy-snapshots --to --target server --container wrapper --component ${wrapper} --all"
+      )
+      result = server.succeed(
+          "dysnomia-snapshots --query-all --container wrapper --component ${wrapper} | wc -l"
+      )
+
+      if int(result) == 5:
+          print("We have 5 snapshots!")
+      else:
+          raise Exception("Expecting 5 snapshots, but we have: {}!".format(result))
+
+      #### Test deduplicating retrieved snapshots
+
+      # Give both components a state file with the same contents, but with
+      # different permissions, and retrieve their snapshots with deduplication
+      # enabled. Files in the chunk store share their inode, so the two files
+      # should not be linked to each other and each should keep its own
+      # permissions.
+
+      server.succeed(
+          "echo dedup > /var/db/wrapper/state && chmod 644 /var/db/wrapper/state"
+      )
+      server.succeed(
+          "echo dedup > /var/db/wrapper2/state && chmod 600 /var/db/wrapper2/state"
+      )
+
+      for component in ["${wrapper}", "${wrapper2}"]:
+          client.succeed(
+              "${env} disnix-ssh-client --target server --snapshot --type wrapper {}".format(
+                  component
+              )
+          )
+          client.succeed(
+              "${env} DISNIX_DEDUPLICATE_SNAPSHOTS=1 disnix-copy-snapshots --from --target server --container wrapper --component {}".format(
+                  component
+              )
+          )
+
+      client.succeed("[ $(ls /var/state/dysnomia/chunks | wc -l) -gt 0 ]")
+
+      statePaths = []
+
+      for component, expectedMode in [("${wrapper}", "644"), ("${wrapper2}", "600")]:
+          lastSnapshot = client.succeed(
+              "dysnomia-snapshots --query-latest --container wrapper --component {}".format(
+                  component
+              )
+          )
+          lastResolvedSnapshot = client.succeed(
+              "dysnomia-snapshots --resolve {}".format(lastSnapshot[:-1])
+          )[:-1]
+          statePath = "{}/state".format(lastResolvedSnapshot)
+          statePaths.append(statePath)
+
+          result = client.succeed("cat {}".format(statePath))
+
+          if result == "dedup\n":
+              print("Result is dedup")
+          else:
+              raise Exception("Result should be dedup, instead it is: {}!".format(result))
+
+          result = client.succeed("stat -c %a {}".format(statePath))[:-1]
+
+          if result == expectedMode:
+              print("The state file has mode: {}".format(expectedMode))
+          else:
+              raise Exception(
+                  "The state file should have mode: {}, instead it has: {}!".format(expectedMode, result)
+              )
+
+      client.fail("[ {} -ef {} ]".format(statePaths[0], statePaths[1]))
     '';
 }
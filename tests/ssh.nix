@@ -6,6 +6,21 @@ let
 in
 with import "${nixpkgs}/nixos/lib/testing-python.nix" { system = builtins.currentSystem; };
 
+let
+  # Records every ssh invocation and fails the upload of the chunk that is
+  # named in /root/interrupt-chunk, to simulate an interrupted transfer
+  sshWrapper = pkgs.writeShellScriptBin "ssh" ''
+    echo "$@" >> /root/ssh.log
+
+    if [ -e /root/interrupt-chunk ] && echo "$@" | grep -q "$(cat /root/interrupt-chunk)"
+    then
+        exit 1
+    fi
+
+    exec ${pkgs.openssh}/bin/ssh "$@"
+  '';
+in
+
 simpleTest {
   nodes = {
     client = machine;
@@ -130,6 +145,57 @@ simpleTest {
           "${env} disnix-ssh-client --target server --import --remotefile /root/bash.closure"
       )
 
+      # Chunked import test. Creates a closure that is larger than the chunk
+      # size and interrupts its transfer while the last chunk is uploaded. The
+      # retried transfer should only upload the remaining chunk, after which
+      # the closure should be imported and the staging directory removed.
+
+      payload = client.succeed(
+          "head -c 3000000 /dev/urandom > /root/payload && nix-store --add /root/payload"
+      )[:-1]
+      client.succeed("nix-store --export {} > /root/payload.closure".format(payload))
+      closureHash = client.succeed(
+          "sha256sum /root/payload.closure | cut -d ' ' -f1"
+      )[:-1]
+      stagingDir = "/tmp/disnix-staging-0-{}".format(closureHash)
+
+      client.succeed("echo chunk.000002.part > /root/interrupt-chunk")
+      client.fail(
+          "PATH=${sshWrapper}/bin:$PATH DISNIX_CHUNK_SIZE=1048576 ${env} disnix-ssh-client --target server --import --localfile /root/payload.closure"
+      )
+      server.fail("nix-store --check-validity {}".format(payload))
+
+      result = server.succeed("cat {}/completed".format(stagingDir))
+
+      if result == "chunk.000000\nchunk.000001\n":
+          print("The first two chunks have been staged")
+      else:
+          raise Exception(
+              "Only the first two chunks should be staged, instead we have: {}".format(result)
+          )
+
+      client.succeed("rm /root/interrupt-chunk /root/ssh.log")
+      client.succeed(
+          "PATH=${sshWrapper}/bin:$PATH DISNIX_CHUNK_SIZE=1048576 ${env} disnix-ssh-client --target server --import --localfile /root/payload.closure"
+      )
+      client.fail("grep -e chunk.000000.part -e chunk.000001.part /root/ssh.log")
+      client.succeed("grep chunk.000002.part /root/ssh.log")
+      server.succeed("nix-store --check-validity {}".format(payload))
+      server.succeed("[ ! -e {} ]".format(stagingDir))
+
+      # Chunked import of an invalid closure. The chunks are transferred and
+      # verified, but the import itself fails. The staging directory should
+      # be removed nonetheless.
+
+      client.succeed("head -c 3000000 /dev/urandom > /root/invalid.closure")
+      invalidHash = client.succeed(
+          "sha256sum /root/invalid.closure | cut -d ' ' -f1"
+      )[:-1]
+      client.fail(
+          "DISNIX_CHUNK_SIZE=1048576 ${env} disnix-ssh-client --target server --import --localfile /root/invalid.closure"
+      )
+      server.succeed("[ ! -e /tmp/disnix-staging-0-{} ]".format(invalidHash))
+
       # Set test. Adds the testtarget2 profile as only derivation into
       # the Disnix profile. We first set the profile, then we check
       # whether the profile is part of the closure.